@@ -96,6 +96,7 @@ tflite_registrar.SELECT_TFTEXT_OPS = [
     tflite_registrar.AddByteSplit,
     tflite_registrar.AddByteSplitByOffsets,
     tflite_registrar.AddFastBertNormalize,
+    tflite_registrar.AddFastBertTokenize,
     tflite_registrar.AddFastSentencepieceDetokenize,
     tflite_registrar.AddFastSentencepieceTokenize,
     tflite_registrar.AddFastWordpieceTokenize,
@@ -15,7 +15,9 @@
 #ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_NORMALIZER_H_
 #define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_NORMALIZER_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "absl/strings/string_view.h"
@@ -69,6 +71,68 @@ static constexpr unsigned int kMaximumOffsetOfNormalizedString =
 
 }  // namespace text_norm
 
+// A compact mapping from the byte offsets in a normalized text to the byte
+// offsets in the original text (see FastBertNormalizer::NormalizeText()).
+//
+// It maps the offsets the same way as `output_normalized_offset_mapping`, but
+// only records the codepoints changed by the normalization: the unchanged text
+// in between maps to the original text byte by byte. Most texts only change
+// at a few places (if at all), so this is much smaller than one offset per
+// byte of the normalized text.
+class NormalizedOffsetMap {
+ public:
+  // Resets to the identity mapping. Keeps the allocated memory, so that an
+  // instance can be reused for many texts.
+  void Clear() { runs_.clear(); }
+
+  // Returns true if every offset maps to itself.
+  bool IsIdentity() const { return runs_.empty(); }
+
+  // Returns the offset in the original text for `normalized_offset`, which is
+  // in [0, size of the normalized text].
+  int Map(int normalized_offset) const {
+    // Find the last run starting at or before `normalized_offset`.
+    auto it = std::upper_bound(runs_.begin(), runs_.end(), normalized_offset,
+                               [](int offset, const Run& run) {
+                                 return offset < run.normalized_offset;
+                               });
+    if (it == runs_.begin()) {
+      // Nothing has changed before `normalized_offset`.
+      return normalized_offset;
+    }
+    --it;
+    if (it->is_changed) {
+      return it->original_offset;
+    }
+    return it->original_offset + (normalized_offset - it->normalized_offset);
+  }
+
+ private:
+  friend class FastBertNormalizer;
+
+  // A part of the normalized text, from `normalized_offset` to the start of
+  // the next run (or the end of the text). All the bytes of a changed
+  // codepoint map to its start `original_offset`, while the bytes of an
+  // unchanged run map one by one from `original_offset` on.
+  struct Run {
+    int normalized_offset;
+    int original_offset;
+    bool is_changed;
+  };
+
+  // Records that the codepoint at [`original_begin`, `original_end`) of the
+  // original text is normalized into `normalized_size` bytes at
+  // `normalized_offset`, followed by unchanged text (if any).
+  void AddChangedCodepoint(int normalized_offset, int original_begin,
+                           int original_end, int normalized_size) {
+    runs_.push_back({normalized_offset, original_begin, /*is_changed=*/true});
+    runs_.push_back({normalized_offset + normalized_size, original_end,
+                     /*is_changed=*/false});
+  }
+
+  std::vector<Run> runs_;
+};
+
 // A fast text normalizer for BERT based on codepoint-wise mappings.
 class FastBertNormalizer {
  public:
@@ -187,12 +251,81 @@ class FastBertNormalizer {
                      bool* is_output_identical_as_input,
                      std::string* output_normalized_text,
                      std::vector<int>* output_normalized_offset_mapping) const {
-    *output_normalized_text = "";
     // `output_normalized_offset_mapping` is not cleared so the existing content
     // is kept.
+    NormalizeTextImpl(
+        input_text, is_output_identical_as_input, output_normalized_text,
+        [output_normalized_offset_mapping](int begin, int end) {
+          if constexpr (kGetOffsets) {
+            for (int i = begin; i < end; ++i) {
+              output_normalized_offset_mapping->push_back(i);
+            }
+          }
+        },
+        [output_normalized_offset_mapping](int normalized_offset,
+                                           int original_begin,
+                                           int original_end,
+                                           int normalized_size) {
+          if constexpr (kGetOffsets) {
+            // Every byte of the normalized string should be map to the same
+            // start position of the current codepoint in the original
+            // `input_text`.
+            for (int i = 0; i < normalized_size; ++i) {
+              output_normalized_offset_mapping->push_back(original_begin);
+            }
+          }
+        });
+    if (*is_output_identical_as_input) {
+      return;
+    }
+    // Push one more mapping from end_of_normalized to end_of_original.
+    if constexpr (kGetOffsets) {
+      output_normalized_offset_mapping->push_back(input_text.size());
+    }
+  }
+
+  // Same as above, but records the offset mapping compactly into
+  // `output_offset_map` (which is cleared first) instead of one offset per
+  // byte. When `is_output_identical_as_input` is true, `output_offset_map` is
+  // the identity mapping.
+  void NormalizeText(absl::string_view input_text,
+                     bool* is_output_identical_as_input,
+                     std::string* output_normalized_text,
+                     NormalizedOffsetMap* output_offset_map) const {
+    output_offset_map->Clear();
+    NormalizeTextImpl(
+        input_text, is_output_identical_as_input, output_normalized_text,
+        [](int begin, int end) {},
+        [output_offset_map](int normalized_offset, int original_begin,
+                            int original_end, int normalized_size) {
+          output_offset_map->AddChangedCodepoint(
+              normalized_offset, original_begin, original_end,
+              normalized_size);
+        });
+  }
+
+ private:
+  // Use the public Create() method.
+  FastBertNormalizer() {}
+
+  // The actual implementation of NormalizeText(). Calls `on_copy(begin, end)`
+  // for each part [begin, end) of `input_text` copied over unchanged, and
+  // `on_change(normalized_offset, original_begin, original_end,
+  // normalized_size)` for each codepoint (or invalid byte) at [original_begin,
+  // original_end) of `input_text` normalized into `normalized_size` bytes at
+  // `normalized_offset` of `output_normalized_text`. The calls are in the
+  // order of `input_text`. When the normalized string is the same as the
+  // input, neither is called and `output_normalized_text` is empty.
+  template <typename OnCopyFn, typename OnChangeFn>
+  void NormalizeTextImpl(absl::string_view input_text,
+                         bool* is_output_identical_as_input,
+                         std::string* output_normalized_text, OnCopyFn on_copy,
+                         OnChangeFn on_change) const {
+    // Keeps the capacity, for callers reusing `output_normalized_text`.
+    output_normalized_text->clear();
     int last_pos_to_copy_over = 0;  // Mark where the copy stopped last time.
     auto copy_unchanged_input_to_output =
-        [input_text, output_normalized_text, output_normalized_offset_mapping,
+        [input_text, output_normalized_text, &on_copy,
          &last_pos_to_copy_over](int exclusive_copy_end) {
           // Copy from `last_pos_to_copy_over` to `exclusive_copy_end` and
           // update `last_pos_to_copy_over` accordingly.
@@ -201,11 +334,7 @@ class FastBertNormalizer {
                 output_normalized_text,
                 input_text.substr(last_pos_to_copy_over,
                                   exclusive_copy_end - last_pos_to_copy_over));
-            if constexpr (kGetOffsets) {
-              for (int i = last_pos_to_copy_over; i < exclusive_copy_end; ++i) {
-                output_normalized_offset_mapping->push_back(i);
-              }
-            }
+            on_copy(last_pos_to_copy_over, exclusive_copy_end);
             last_pos_to_copy_over = exclusive_copy_end;
           }
         };
@@ -219,10 +348,9 @@ class FastBertNormalizer {
         // Copy the remaining unchanged text if any.
         copy_unchanged_input_to_output(cur_pos);
         // Output a whitespace here to replace the invalid UTF-8 byte.
+        on_change(output_normalized_text->size(), cur_pos, cur_pos + 1,
+                  /*normalized_size=*/1);
         absl::StrAppend(output_normalized_text, " ");
-        if constexpr (kGetOffsets) {
-          output_normalized_offset_mapping->push_back(cur_pos);
-        }
         // Move by one byte.
         ++cur_pos;
         // Mark the next position to copy over.
@@ -243,14 +371,9 @@ class FastBertNormalizer {
       copy_unchanged_input_to_output(cur_pos);
 
       // Output the normalized codepoint text.
+      on_change(output_normalized_text->size(), cur_pos,
+                cur_pos + cp_byte_length, normalized_codepoint.size());
       absl::StrAppend(output_normalized_text, normalized_codepoint);
-      if constexpr (kGetOffsets) {
-        // Every byte of the normalized string should be map to the same start
-        // position of the current codepoint in the original `input_text`.
-        for (int i = 0; i < normalized_codepoint.size(); ++i) {
-          output_normalized_offset_mapping->push_back(cur_pos);
-        }
-      }
       // Move by one codepoint.
       cur_pos += cp_byte_length;
       // Mark the next position to copy over.
@@ -264,16 +387,8 @@ class FastBertNormalizer {
     *is_output_identical_as_input = false;
     // Copy the remaining unchanged text if any.
     copy_unchanged_input_to_output(input_text.size());
-    // Push one more mapping from end_of_normalized to end_of_original.
-    if constexpr (kGetOffsets) {
-      output_normalized_offset_mapping->push_back(input_text.size());
-    }
   }
 
- private:
-  // Use the public Create() method.
-  FastBertNormalizer() {}
-
   // Returns true if the normalized string is different from the codepoint (from
   // the encoded `data`). If `data`==0, it means the normalized string is the
   // same; in that case, this function returns false correctly.
@@ -217,6 +217,32 @@ TEST_P(TestNormalization, TestNoGetOffsets) {
   }
 }
 
+TEST_P(TestNormalization, TestGetOffsetMap) {
+  const auto spec = GetParam();
+  const auto fast_bert_normalizer =
+      FastBertNormalizerFactory::GetInstance(spec.lower_case_nfd_strip_accents)
+          .GetNormalizer();
+
+  std::string output_normalized_text = "Something existing";
+  NormalizedOffsetMap output_offset_map;
+  bool is_normalized_identical;
+  fast_bert_normalizer->NormalizeText(spec.input, &is_normalized_identical,
+                                      &output_normalized_text,
+                                      &output_offset_map);
+  if (is_normalized_identical) {
+    ASSERT_THAT(output_normalized_text, "");
+    ASSERT_THAT(spec.input, spec.expected_output);
+    ASSERT_TRUE(output_offset_map.IsIdentity());
+  } else {
+    ASSERT_THAT(output_normalized_text, spec.expected_output);
+  }
+  std::vector<int> offset_mapping;
+  for (int i = 0; i <= spec.expected_output.size(); ++i) {
+    offset_mapping.push_back(output_offset_map.Map(i));
+  }
+  ASSERT_THAT(offset_mapping, spec.expected_offset_mapping);
+}
+
 INSTANTIATE_TEST_SUITE_P(FastBertNormalizerTest, TestNormalization,
                          testing::ValuesIn(GetTestSpecs()));
 }  // namespace
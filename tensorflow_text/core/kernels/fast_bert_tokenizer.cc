@@ -0,0 +1,97 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer.h"
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/lite/kernels/shim/status_macros.h"
+
+namespace tensorflow {
+namespace text {
+
+/*static*/ absl::StatusOr<FastBertTokenizer> FastBertTokenizer::Create(
+    const void* normalizer_model_flatbuffer,
+    const void* wordpiece_config_flatbuffer) {
+  SH_ASSIGN_OR_RETURN(auto normalizer,
+                      FastBertNormalizer::Create(normalizer_model_flatbuffer));
+  SH_ASSIGN_OR_RETURN(
+      auto wordpiece_tokenizer,
+      FastWordpieceTokenizer::Create(wordpiece_config_flatbuffer));
+  return FastBertTokenizer(std::move(normalizer),
+                           std::move(wordpiece_tokenizer));
+}
+
+void FastBertTokenizer::Tokenize(absl::string_view input, Buffers& buffers,
+                                 std::vector<std::string>* output_pieces,
+                                 std::vector<int>* output_ids,
+                                 std::vector<int>* output_start_offsets,
+                                 std::vector<int>* output_end_offsets,
+                                 bool* error) const {
+  const int first_token = output_ids->size();
+  wordpiece_tokenizer_.Tokenize(Normalize(input, buffers), output_pieces,
+                                output_ids, output_start_offsets,
+                                output_end_offsets,
+                                /*input_word_offset_in_text=*/0, error);
+  MapOffsetsToOriginalText(buffers, first_token, output_start_offsets,
+                           output_end_offsets);
+}
+
+void FastBertTokenizer::Tokenize(absl::string_view input, Buffers& buffers,
+                                 std::vector<int>* output_ids,
+                                 std::vector<int>* output_start_offsets,
+                                 std::vector<int>* output_end_offsets,
+                                 bool* error) const {
+  const int first_token = output_ids->size();
+  wordpiece_tokenizer_.Tokenize(Normalize(input, buffers), output_ids,
+                                output_start_offsets, output_end_offsets,
+                                /*input_word_offset_in_text=*/0, error);
+  MapOffsetsToOriginalText(buffers, first_token, output_start_offsets,
+                           output_end_offsets);
+}
+
+void FastBertTokenizer::Tokenize(absl::string_view input, Buffers& buffers,
+                                 std::vector<int>* output_ids,
+                                 bool* error) const {
+  wordpiece_tokenizer_.Tokenize(Normalize(input, buffers), output_ids,
+                                /*input_word_offset_in_text=*/0, error);
+}
+
+absl::string_view FastBertTokenizer::Normalize(absl::string_view input,
+                                               Buffers& buffers) const {
+  bool is_normalized_text_identical;
+  normalizer_.NormalizeText(input, &is_normalized_text_identical,
+                            &buffers.normalized_text_, &buffers.offset_map_);
+  if (is_normalized_text_identical) {
+    return input;
+  }
+  return buffers.normalized_text_;
+}
+
+/*static*/ void FastBertTokenizer::MapOffsetsToOriginalText(
+    const Buffers& buffers, int first_token,
+    std::vector<int>* output_start_offsets,
+    std::vector<int>* output_end_offsets) {
+  const NormalizedOffsetMap& offset_map = buffers.offset_map_;
+  if (offset_map.IsIdentity()) {
+    return;
+  }
+  for (int i = first_token; i < output_start_offsets->size(); ++i) {
+    (*output_start_offsets)[i] = offset_map.Map((*output_start_offsets)[i]);
+    (*output_end_offsets)[i] = offset_map.Map((*output_end_offsets)[i]);
+  }
+}
+
+}  // namespace text
+}  // namespace tensorflow
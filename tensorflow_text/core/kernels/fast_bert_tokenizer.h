@@ -0,0 +1,135 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_H_
+#define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow_text/core/kernels/fast_bert_normalizer.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer.h"
+
+namespace tensorflow {
+namespace text {
+
+// Tokenizes texts for BERT: normalizes them with FastBertNormalizer, then
+// tokenizes them with FastWordpieceTokenizer, with the offsets in the original
+// texts.
+//
+// The result is the same as running the two steps one after the other and
+// mapping the offsets back with the offset mapping of the normalizer, but
+// nothing is materialized per text in between:
+// * Texts that the normalization does not change (e.g., text that is already
+//   lower-cased) are tokenized in place.
+// * Other texts are normalized into a buffer that is reused from text to text,
+//   and the offsets of their tokens are mapped back right away with a compact
+//   NormalizedOffsetMap instead of one offset per normalized byte.
+class FastBertTokenizer {
+ public:
+  // The memory reused by Tokenize() from one text to the next. Each thread
+  // needs its own instance.
+  class Buffers {
+   private:
+    friend class FastBertTokenizer;
+
+    std::string normalized_text_;
+    NormalizedOffsetMap offset_map_;
+  };
+
+  // Creates an instance.
+  //
+  // Args:
+  //  * normalizer_model_flatbuffer: the FastBertNormalizerModel flatbuffer.
+  //  * wordpiece_config_flatbuffer: the FastWordpieceTokenizerConfig
+  //    flatbuffer.
+  // Neither is owned by this instance, so they should be kept alive through
+  // the lifetime of the instance.
+  static absl::StatusOr<FastBertTokenizer> Create(
+      const void* normalizer_model_flatbuffer,
+      const void* wordpiece_config_flatbuffer);
+
+  // Tokenizes `input` and appends the tokens to the end of the outputs. The
+  // pieces are substrings of the normalized text, while the offsets are in
+  // `input`. See FastWordpieceTokenizer::Tokenize() for the other args.
+  void Tokenize(absl::string_view input, Buffers& buffers,
+                std::vector<std::string>* output_pieces,
+                std::vector<int>* output_ids,
+                std::vector<int>* output_start_offsets,
+                std::vector<int>* output_end_offsets,
+                bool* error = nullptr) const;
+
+  // An override not returning `output_pieces`.
+  void Tokenize(absl::string_view input, Buffers& buffers,
+                std::vector<int>* output_ids,
+                std::vector<int>* output_start_offsets,
+                std::vector<int>* output_end_offsets,
+                bool* error = nullptr) const;
+
+  // An override only returning `output_ids`.
+  void Tokenize(absl::string_view input, Buffers& buffers,
+                std::vector<int>* output_ids, bool* error = nullptr) const;
+
+  // Tokenizes `input` and writes the tokens into `output` instead of appending
+  // them to std::vectors (see FastWordpieceTokenizer::TokenizeIntoBuffer()).
+  // Otherwise the same as `Tokenize`.
+  template <bool kGetPieces, bool kGetOffsets, typename T>
+  void TokenizeIntoBuffer(absl::string_view input, Buffers& buffers,
+                          TokenBufferWriter<T>& output,
+                          bool* error = nullptr) const;
+
+ private:
+  FastBertTokenizer(FastBertNormalizer normalizer,
+                    FastWordpieceTokenizer wordpiece_tokenizer)
+      : normalizer_(std::move(normalizer)),
+        wordpiece_tokenizer_(std::move(wordpiece_tokenizer)) {}
+
+  // Normalizes `input` into `buffers`, and returns the text to tokenize:
+  // either `input` itself or the normalized text in `buffers`.
+  absl::string_view Normalize(absl::string_view input, Buffers& buffers) const;
+
+  // Maps the offsets of the tokens from `first_token` on from the normalized
+  // text back to the original text.
+  static void MapOffsetsToOriginalText(const Buffers& buffers, int first_token,
+                                       std::vector<int>* output_start_offsets,
+                                       std::vector<int>* output_end_offsets);
+
+  FastBertNormalizer normalizer_;
+  FastWordpieceTokenizer wordpiece_tokenizer_;
+};
+
+template <bool kGetPieces, bool kGetOffsets, typename T>
+void FastBertTokenizer::TokenizeIntoBuffer(absl::string_view input,
+                                           Buffers& buffers,
+                                           TokenBufferWriter<T>& output,
+                                           bool* error) const {
+  const int first_token = output.size();
+  wordpiece_tokenizer_.TokenizeIntoBuffer<kGetPieces, kGetOffsets>(
+      Normalize(input, buffers), output, /*input_word_offset_in_text=*/0,
+      error);
+  const NormalizedOffsetMap& offset_map = buffers.offset_map_;
+  if (kGetOffsets && !offset_map.IsIdentity()) {
+    output.MapOffsets(first_token, [&offset_map](T normalized_offset) {
+      return offset_map.Map(normalized_offset);
+    });
+  }
+}
+
+}  // namespace text
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_H_
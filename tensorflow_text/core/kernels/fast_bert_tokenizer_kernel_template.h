@@ -0,0 +1,603 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_KERNEL_TEMPLATE_H_
+#define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_KERNEL_TEMPLATE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/lite/kernels/shim/op_kernel.h"
+#include "tensorflow/lite/kernels/shim/status_macros.h"
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer.h"
+#include "tensorflow_text/core/kernels/text_batch_sharding.h"
+
+namespace tensorflow {
+namespace text {
+
+// See `kDoc` data member for the documentation on this op kernel.
+//
+// This template class can be instantiated into a kernel for either TF or
+// TFLite. See
+// https://github.com/tensorflow/tensorflow/tree/master/tensorflow/lite/kernels/shim
+// for more info on how this works.
+//
+// `T` is the type of the ids and offsets, and `Tsplits` is the type of the row
+// splits (int32_t or int64_t for both).
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+class FastBertTokenizeWithOffsetsOp
+    : public tflite::shim::OpKernelShim<FastBertTokenizeWithOffsetsOp, Rt, T,
+                                        Tsplits> {
+ private:
+  enum Inputs { kInputValues = 0, kFastBertNormalizerModel, kWpModel };
+  enum Outputs {
+    kOutputSubwords = 0,
+    kOutputIds,
+    kOutputRowSplits,
+    kStartValues,
+    kEndValues
+  };
+
+  using Shape = tflite::shim::Shape;
+  using typename tflite::shim::OpKernelShim<FastBertTokenizeWithOffsetsOp, Rt,
+                                            T, Tsplits>::InitContext;
+  using typename tflite::shim::OpKernelShim<FastBertTokenizeWithOffsetsOp, Rt,
+                                            T, Tsplits>::InvokeContext;
+  using typename tflite::shim::OpKernelShim<FastBertTokenizeWithOffsetsOp, Rt,
+                                            T, Tsplits>::ShapeInferenceContext;
+
+ public:
+  FastBertTokenizeWithOffsetsOp() = default;
+  static constexpr char kOpName[] = "FastBertTokenizeWithOffsets";
+  static constexpr char kDoc[] = R"doc(
+    Tokenizes texts for BERT: normalizes them, then tokenizes them into
+    sub-word pieces using the fast linear WordPiece algorithm.
+
+    Same as `FastBertNormalize` followed by `FastWordpieceTokenizeWithOffsets`,
+    with the offsets mapped back to the input, but fused row by row: each row
+    is normalized into a buffer reused across rows (or tokenized in place if
+    the normalization leaves it unchanged), and the offsets of its wordpieces
+    are mapped back right away. Hence, neither the normalized texts nor their
+    offset mappings are materialized for the whole batch.
+
+    Args:
+      input_values: 1D Tensor of strings to tokenize.
+      fast_bert_normalizer_model: Buffer tensor for the FastBertNormalizerModel
+        flatbuffer.
+      wp_model: Buffer tensor for the FastWordpieceTokenizerConfig flatbuffer.
+      get_subwords: If false, the wordpiece strings are not computed and
+        `output_subwords` is empty. Useful when only the ids are consumed.
+      get_offsets: If false, the offsets are not computed and `start_values`
+        and `end_values` are empty.
+      in_place_output: If true, tokenizes every input twice: the first pass
+        only counts the wordpieces to size the output tensors, and the second
+        pass writes the wordpieces directly into the output tensors. This
+        avoids any intermediate buffer per wordpiece, at the cost of
+        normalizing and tokenizing twice.
+      out_type: The type of `output_ids`, `start_values` and `end_values`.
+      Tsplits: The type of `output_row_splits`.
+
+    Returns:
+      * output_subwords: 1D tensor containing the wordpieces (of the normalized
+        texts) for all input strings. A 2D RaggedTensor can be constructed from
+        this and output_row_splits.
+      * output_ids: 1D tensor containing the wordpiece ids for all input strings.
+        A 2D RaggedTensor can be constructed from this and output_row_splits.
+      * output_row_splits: 1D int tensor with the row splits that allow us to
+        build RaggedTensors from output_subwords, output_ids, start_values, and
+        end_values.
+      * start_values: 1D tensor containing the inclusive start byte offset in
+        the input strings for each wordpiece.
+      * end_values: 1D tensor containing the exclusive end byte offset in the
+        input strings for each wordpiece.
+  )doc";
+
+  static const char* OpName() { return kOpName; }
+  static const char* Doc() { return kDoc; }
+
+  static const char kGetSubwordsAttr[];
+  static const char kGetOffsetsAttr[];
+  static const char kInPlaceOutputAttr[];
+  static const char kOutTypeAttr[];
+  static const char kTsplitsAttr[];
+
+  // Attributes declaration (syntax: https://www.tensorflow.org/guide/create_op)
+  static std::vector<std::string> Attrs();
+
+  // Input tensors declaration (syntax:
+  // https://www.tensorflow.org/guide/create_op)
+  static std::vector<std::string> Inputs();
+
+  // Output tensors declaration (syntax:
+  // https://www.tensorflow.org/guide/create_op)
+  static std::vector<std::string> Outputs();
+
+  // Initializes the op
+  absl::Status Init(InitContext* context);
+
+  // Runs the operation
+  absl::Status Invoke(InvokeContext* context);
+
+  // Runs the operation, splitting the batch into blocks of inputs with
+  // roughly the same number of bytes and tokenizing the blocks with `runner`.
+  // Each block is tokenized into its own buffers, which are merged in order,
+  // so the result does not depend on the scheduling of `runner`.
+  absl::Status Invoke(InvokeContext* context, int max_parallelism,
+                      const BatchShardRunner& runner);
+
+  // Shape inference
+  static absl::Status ShapeInference(ShapeInferenceContext* c);
+
+ private:
+  // Rough cost of normalizing and tokenizing one row, in the unit of
+  // ::tensorflow::Shard's cost_per_unit (about 1ns).
+  static constexpr TextRowCost kTokenizeCost = {/*per_row=*/100,
+                                                /*per_byte=*/80};
+
+  struct BatchSharding {
+    int max_parallelism;
+    const BatchShardRunner& runner;
+  };
+
+  // Tokenizes all the inputs into per-block buffers of the output types, then
+  // moves them to the output tensors. The outputs that are not requested are
+  // left empty.
+  template <bool kGetPieces, bool kGetOffsets>
+  absl::Status InvokeWithIntermediateBuffers(const FastBertTokenizer& tokenizer,
+                                             const BatchSharding& sharding,
+                                             InvokeContext* context);
+
+  // Counts the wordpieces first, then tokenizes again to write the wordpieces
+  // directly into the output tensors. The outputs that are not requested are
+  // left empty.
+  template <bool kGetPieces, bool kGetOffsets>
+  absl::Status InvokeWithInPlaceOutput(const FastBertTokenizer& tokenizer,
+                                       const BatchSharding& sharding,
+                                       InvokeContext* context);
+
+  // Dispatches to one of the two methods above.
+  template <bool kGetPieces, bool kGetOffsets>
+  absl::Status InvokeRealWork(const FastBertTokenizer& tokenizer,
+                              const BatchSharding& sharding,
+                              InvokeContext* context);
+
+  bool get_subwords_ = true;
+  bool get_offsets_ = true;
+  bool in_place_output_ = false;
+};
+
+////////////////////////// Implementation
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::kGetSubwordsAttr[] =
+    "get_subwords";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::kGetOffsetsAttr[] =
+    "get_offsets";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char
+    FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::kInPlaceOutputAttr[] =
+        "in_place_output";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::kOutTypeAttr[] =
+    "out_type";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::kTsplitsAttr[] =
+    "Tsplits";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+std::vector<std::string>
+FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::Attrs() {
+  return {
+      absl::StrCat(kGetSubwordsAttr, ": bool = true"),
+      absl::StrCat(kGetOffsetsAttr, ": bool = true"),
+      absl::StrCat(kInPlaceOutputAttr, ": bool = false"),
+      absl::StrCat(kOutTypeAttr, ": {int32, int64} = DT_INT64"),
+      absl::StrCat(kTsplitsAttr, ": {int32, int64} = DT_INT64"),
+  };
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+std::vector<std::string>
+FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::Inputs() {
+  return {"input_values: string", "fast_bert_normalizer_model: uint8",
+          "wp_model: uint8"};
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+std::vector<std::string>
+FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::Outputs() {
+  return {"output_subwords: string", "output_ids: out_type",
+          "output_row_splits: Tsplits", "start_values: out_type",
+          "end_values: out_type"};
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::Init(
+    InitContext* context) {
+  SH_RETURN_IF_ERROR(context->GetAttr(kGetSubwordsAttr, &get_subwords_));
+  SH_RETURN_IF_ERROR(context->GetAttr(kGetOffsetsAttr, &get_offsets_));
+  SH_RETURN_IF_ERROR(context->GetAttr(kInPlaceOutputAttr, &in_place_output_));
+  return absl::OkStatus();
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::Invoke(
+    InvokeContext* context) {
+  return Invoke(context, /*max_parallelism=*/1, RunBatchShardsInline);
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::Invoke(
+    InvokeContext* context, int max_parallelism,
+    const BatchShardRunner& runner) {
+  SH_ASSIGN_OR_RETURN(const auto fast_bert_normalizer_model,
+                      context->GetInput(kFastBertNormalizerModel));
+  SH_ASSIGN_OR_RETURN(const auto wp_model, context->GetInput(kWpModel));
+  // OK to create on every call because FastBertTokenizer is a lightweight,
+  // memory-mapped wrapper on the model tensors, and thus Create() is very
+  // cheap.
+  auto fast_bert_tokenizer = FastBertTokenizer::Create(
+      fast_bert_normalizer_model->template Data<uint8>().data(),
+      wp_model->template Data<uint8>().data());
+  SH_RETURN_IF_ERROR(fast_bert_tokenizer.status());
+
+  const auto& tokenizer = *fast_bert_tokenizer;
+  const BatchSharding sharding{max_parallelism, runner};
+  if (get_subwords_) {
+    if (get_offsets_) {
+      return InvokeRealWork</*kGetPieces=*/true, /*kGetOffsets=*/true>(
+          tokenizer, sharding, context);
+    } else {
+      return InvokeRealWork</*kGetPieces=*/true, /*kGetOffsets=*/false>(
+          tokenizer, sharding, context);
+    }
+  } else {
+    if (get_offsets_) {
+      return InvokeRealWork</*kGetPieces=*/false, /*kGetOffsets=*/true>(
+          tokenizer, sharding, context);
+    } else {
+      return InvokeRealWork</*kGetPieces=*/false, /*kGetOffsets=*/false>(
+          tokenizer, sharding, context);
+    }
+  }
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+template <bool kGetPieces, bool kGetOffsets>
+absl::Status FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::InvokeRealWork(
+    const FastBertTokenizer& tokenizer, const BatchSharding& sharding,
+    InvokeContext* context) {
+  if (in_place_output_) {
+    return InvokeWithInPlaceOutput<kGetPieces, kGetOffsets>(tokenizer,
+                                                            sharding, context);
+  }
+  return InvokeWithIntermediateBuffers<kGetPieces, kGetOffsets>(
+      tokenizer, sharding, context);
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+template <bool kGetPieces, bool kGetOffsets>
+absl::Status
+FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::InvokeWithIntermediateBuffers(
+    const FastBertTokenizer& tokenizer, const BatchSharding& sharding,
+    InvokeContext* context) {
+  SH_ASSIGN_OR_RETURN(const auto input_values, context->GetInput(kInputValues));
+  const auto& values_vec = input_values->template As<tstring, 1>();
+  const int num_values = values_vec.Dim(0);
+
+  // The output of one block of consecutive inputs, already of the types of the
+  // output tensors. The vectors that are not requested stay empty, and so do
+  // the corresponding output tensors.
+  struct BlockOutput {
+    std::vector<tensorflow::tstring> subwords;
+    std::vector<T> ids;
+    std::vector<T> start_values;
+    std::vector<T> end_values;
+    // The number of wordpieces of each input in the block.
+    std::vector<int> row_lengths;
+    bool error = false;
+  };
+
+  int64_t cost_per_block;
+  const std::vector<int64_t> block_starts = SplitIntoBlocks(
+      num_values, sharding.max_parallelism,
+      [&values_vec](int64_t i) { return kTokenizeCost(values_vec(i).size()); },
+      &cost_per_block);
+  const int num_blocks = block_starts.size() - 1;
+  std::vector<BlockOutput> blocks(num_blocks);
+
+  // Tokenize each block into its own buffers, growing them as needed.
+  auto tokenize_blocks = [&](int64_t start, int64_t limit) {
+    for (int b = start; b < limit; ++b) {
+      BlockOutput& block = blocks[b];
+      FastBertTokenizer::Buffers buffers;
+      for (int i = block_starts[b]; i < block_starts[b + 1]; ++i) {
+        const int num_written = block.ids.size();
+        // Most rows have fewer wordpieces than bytes; the rare rows with more
+        // are tokenized again once the buffers are large enough.
+        int capacity = values_vec(i).size() + 1;
+        for (;;) {
+          block.ids.resize(num_written + capacity);
+          if constexpr (kGetOffsets) {
+            block.start_values.resize(num_written + capacity);
+            block.end_values.resize(num_written + capacity);
+          }
+          if constexpr (kGetPieces) {
+            block.subwords.resize(num_written + capacity);
+          }
+          auto write_subword = [&block, num_written](
+                                   int index, absl::string_view piece_prefix,
+                                   absl::string_view piece) {
+            tensorflow::tstring& subword = block.subwords[num_written + index];
+            subword.assign(piece_prefix.data(), piece_prefix.size());
+            subword.append(piece.data(), piece.size());
+          };
+          TokenBufferWriter<T> writer(
+              capacity, block.ids.data() + num_written,
+              kGetOffsets ? block.start_values.data() + num_written : nullptr,
+              kGetOffsets ? block.end_values.data() + num_written : nullptr,
+              write_subword);
+          bool error = false;
+          tokenizer.TokenizeIntoBuffer<kGetPieces, kGetOffsets>(
+              values_vec(i), buffers, writer, &error);
+          if (error) {
+            block.error = true;
+            return;
+          }
+          if (writer.size() <= capacity) {
+            capacity = writer.size();
+            break;
+          }
+          capacity = writer.size();
+        }
+        block.ids.resize(num_written + capacity);
+        if constexpr (kGetOffsets) {
+          block.start_values.resize(num_written + capacity);
+          block.end_values.resize(num_written + capacity);
+        }
+        if constexpr (kGetPieces) {
+          block.subwords.resize(num_written + capacity);
+        }
+        block.row_lengths.push_back(capacity);
+      }
+    }
+  };
+  if (num_blocks == 1) {
+    tokenize_blocks(0, 1);
+  } else {
+    sharding.runner(num_blocks, cost_per_block, tokenize_blocks);
+  }
+
+  // Merge the blocks: the row splits are the prefix sums of the row lengths,
+  // and the block outputs are moved to the output tensors in order.
+  SH_ASSIGN_OR_RETURN(
+      auto output_row_splits,
+      context->GetOutput(kOutputRowSplits, Shape({num_values + 1})));
+  auto row_splits = output_row_splits->template Data<Tsplits>();
+  row_splits[0] = 0;
+  int row = 0;
+  for (const BlockOutput& block : blocks) {
+    if (block.error) {
+      return absl::InternalError(
+          "Failed to make any progress in tokenizing the input text.");
+    }
+    for (const int row_length : block.row_lengths) {
+      row_splits[row + 1] = row_splits[row] + row_length;
+      ++row;
+    }
+  }
+
+  const int num_wordpieces = row_splits[num_values];
+  const int num_subwords = kGetPieces ? num_wordpieces : 0;
+  const int num_offsets = kGetOffsets ? num_wordpieces : 0;
+  SH_ASSIGN_OR_RETURN(
+      auto output_subwords,
+      context->GetOutput(kOutputSubwords, Shape({num_subwords})));
+  auto subwords = output_subwords->template As<tensorflow::tstring, 1>();
+  SH_ASSIGN_OR_RETURN(auto output_ids,
+                      context->GetOutput(kOutputIds, Shape({num_wordpieces})));
+  T* ids = output_ids->template Data<T>().data();
+  SH_ASSIGN_OR_RETURN(auto output_start_values,
+                      context->GetOutput(kStartValues, Shape({num_offsets})));
+  T* start_values = output_start_values->template Data<T>().data();
+  SH_ASSIGN_OR_RETURN(auto output_end_values,
+                      context->GetOutput(kEndValues, Shape({num_offsets})));
+  T* end_values = output_end_values->template Data<T>().data();
+
+  int offset = 0;
+  for (BlockOutput& block : blocks) {
+    std::copy(block.ids.begin(), block.ids.end(), ids + offset);
+    if constexpr (kGetOffsets) {
+      std::copy(block.start_values.begin(), block.start_values.end(),
+                start_values + offset);
+      std::copy(block.end_values.begin(), block.end_values.end(),
+                end_values + offset);
+    }
+    if constexpr (kGetPieces) {
+      for (int j = 0; j < block.subwords.size(); ++j) {
+        subwords(offset + j) = std::move(block.subwords[j]);
+      }
+    }
+    offset += block.ids.size();
+  }
+
+  return absl::OkStatus();
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+template <bool kGetPieces, bool kGetOffsets>
+absl::Status
+FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::InvokeWithInPlaceOutput(
+    const FastBertTokenizer& tokenizer, const BatchSharding& sharding,
+    InvokeContext* context) {
+  SH_ASSIGN_OR_RETURN(const auto input_values, context->GetInput(kInputValues));
+  const auto& values_vec = input_values->template As<tstring, 1>();
+  const int num_values = values_vec.Dim(0);
+
+  int64_t cost_per_block;
+  const std::vector<int64_t> block_starts = SplitIntoBlocks(
+      num_values, sharding.max_parallelism,
+      [&values_vec](int64_t i) { return kTokenizeCost(values_vec(i).size()); },
+      &cost_per_block);
+  const int num_blocks = block_starts.size() - 1;
+  // Uses char instead of bool so that the blocks can be updated concurrently.
+  std::vector<char> block_errors(num_blocks, false);
+  auto run_blocks = [&](const std::function<void(int64_t, int64_t)>& work) {
+    if (num_blocks == 1) {
+      work(0, 1);
+    } else {
+      sharding.runner(num_blocks, cost_per_block, work);
+    }
+  };
+
+  // First pass: count the wordpieces of each input, then turn the counts into
+  // row splits.
+  SH_ASSIGN_OR_RETURN(
+      auto output_row_splits,
+      context->GetOutput(kOutputRowSplits, Shape({num_values + 1})));
+  auto row_splits = output_row_splits->template Data<Tsplits>();
+  row_splits[0] = 0;
+  run_blocks([&](int64_t start, int64_t limit) {
+    FastBertTokenizer::Buffers buffers;
+    for (int b = start; b < limit; ++b) {
+      for (int i = block_starts[b]; i < block_starts[b + 1]; ++i) {
+        TokenBufferWriter<T> counter;
+        bool error = false;
+        tokenizer
+            .TokenizeIntoBuffer</*kGetPieces=*/false, /*kGetOffsets=*/false>(
+                values_vec(i), buffers, counter, &error);
+        if (error) {
+          block_errors[b] = true;
+          break;
+        }
+        row_splits[i + 1] = counter.size();
+      }
+    }
+  });
+  for (const char error : block_errors) {
+    if (error) {
+      return absl::InternalError(
+          "Failed to make any progress in tokenizing the input text.");
+    }
+  }
+  for (int i = 0; i < num_values; ++i) {
+    row_splits[i + 1] += row_splits[i];
+  }
+
+  // Second pass: write the wordpieces into the output tensors. Each block
+  // writes to its own slice of the outputs, starting at the row split of its
+  // first input.
+  const int num_wordpieces = row_splits[num_values];
+  const int num_subwords = kGetPieces ? num_wordpieces : 0;
+  const int num_offsets = kGetOffsets ? num_wordpieces : 0;
+  SH_ASSIGN_OR_RETURN(
+      auto output_subwords,
+      context->GetOutput(kOutputSubwords, Shape({num_subwords})));
+  auto subwords = output_subwords->template As<tensorflow::tstring, 1>();
+  SH_ASSIGN_OR_RETURN(auto output_ids,
+                      context->GetOutput(kOutputIds, Shape({num_wordpieces})));
+  T* ids = output_ids->template Data<T>().data();
+  SH_ASSIGN_OR_RETURN(auto output_start_values,
+                      context->GetOutput(kStartValues, Shape({num_offsets})));
+  T* start_values = output_start_values->template Data<T>().data();
+  SH_ASSIGN_OR_RETURN(auto output_end_values,
+                      context->GetOutput(kEndValues, Shape({num_offsets})));
+  T* end_values = output_end_values->template Data<T>().data();
+  run_blocks([&](int64_t start, int64_t limit) {
+    FastBertTokenizer::Buffers buffers;
+    for (int b = start; b < limit; ++b) {
+      const int block_offset = row_splits[block_starts[b]];
+      auto write_subword = [&subwords, block_offset](
+                               int index, absl::string_view piece_prefix,
+                               absl::string_view piece) {
+        tensorflow::tstring& subword = subwords(block_offset + index);
+        subword.assign(piece_prefix.data(), piece_prefix.size());
+        subword.append(piece.data(), piece.size());
+      };
+      TokenBufferWriter<T> writer(
+          row_splits[block_starts[b + 1]] - block_offset, ids + block_offset,
+          kGetOffsets ? start_values + block_offset : nullptr,
+          kGetOffsets ? end_values + block_offset : nullptr, write_subword);
+      for (int i = block_starts[b]; i < block_starts[b + 1]; ++i) {
+        tokenizer.TokenizeIntoBuffer<kGetPieces, kGetOffsets>(
+            values_vec(i), buffers, writer);
+        if (block_offset + writer.size() != row_splits[i + 1]) {
+          block_errors[b] = true;
+          break;
+        }
+      }
+    }
+  });
+  for (const char error : block_errors) {
+    if (error) {
+      return absl::InternalError(
+          "The number of wordpieces differs between the counting pass and "
+          "the writing pass.");
+    }
+  }
+
+  return absl::OkStatus();
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status FastBertTokenizeWithOffsetsOp<Rt, T, Tsplits>::ShapeInference(
+    ShapeInferenceContext* c) {
+  using tflite::shim::Shape;
+  SH_ASSIGN_OR_RETURN(const Shape input_values_shape,
+                      c->GetInputShape(kInputValues));
+  SH_ASSIGN_OR_RETURN(const auto fast_bert_normalizer_model_shape,
+                      c->GetInputShape(kFastBertNormalizerModel));
+  SH_ASSIGN_OR_RETURN(const auto wp_model_shape, c->GetInputShape(kWpModel));
+  const auto rank_1_shape = Shape({Shape::kUnknownDim});
+  if (!input_values_shape.Compatible(rank_1_shape)) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Shape must be rank 1: ", input_values_shape.ToString()));
+  }
+  if (!fast_bert_normalizer_model_shape.Compatible(rank_1_shape)) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Shape must be rank 1: ",
+                     fast_bert_normalizer_model_shape.ToString()));
+  }
+  if (!wp_model_shape.Compatible(rank_1_shape)) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Shape must be rank 1: ", wp_model_shape.ToString()));
+  }
+  SH_RETURN_IF_ERROR(c->SetOutputShape(kOutputSubwords, rank_1_shape));
+  SH_RETURN_IF_ERROR(c->SetOutputShape(kOutputIds, rank_1_shape));
+  // row splits size
+  const int num_splits = Shape::AddDims(1, input_values_shape.Dim(0));
+  SH_RETURN_IF_ERROR(c->SetOutputShape(kOutputRowSplits, Shape({num_splits})));
+  SH_RETURN_IF_ERROR(c->SetOutputShape(kStartValues, rank_1_shape));
+  SH_RETURN_IF_ERROR(c->SetOutputShape(kEndValues, rank_1_shape));
+
+  return absl::OkStatus();
+}
+
+}  // namespace text
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_KERNEL_TEMPLATE_H_
@@ -0,0 +1,240 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow_text/core/kernels/fast_bert_normalizer.h"
+#include "tensorflow_text/core/kernels/fast_bert_normalizer_model_builder.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_model_builder.h"
+
+namespace tensorflow {
+namespace text {
+namespace {
+
+using ::testing::ElementsAre;
+
+const std::vector<std::string>& GetTestVocab() {
+  static const std::vector<std::string>& v = *new std::vector<std::string>{
+      "[UNK]", "a",   "abc", "##b", "##c", "##de", "great", "##est",
+      "the",   ".",   "!",   "1",   "4",   "\xE2\x81\x84",  // U+2044
+      "\xCE\xB7",                                            // U+03B7
+      "\xC3\xA0",                                            // U+00E0
+  };
+  return v;
+}
+
+// Texts that the normalization changes at various places, or not at all.
+const std::vector<std::string>& GetTestInputs() {
+  static const std::vector<std::string>& v = *new std::vector<std::string>{
+      "",
+      "abc abcde",
+      "ABC Abcde!",
+      "The GREATEST.",
+      // "\xC3\x80" is U+00C0 "Latin Capital Letter A with Grave".
+      "\xC3\x80" "bc the",
+      // "\x41\xCC\x80" is the decomposition of U+00C0.
+      "x\x41\xCC\x80" "BC \x41\xCC\x80",
+      // "\xC2\xBC" is U+00BC "Vulgar Fraction One Quarter".
+      "a\xC2\xBC" " \xC2\xBC",
+      // "\xCE\x89" is U+0389 "Greek Capital Letter Eta with Tonos".
+      "\xCE\x89 a\xCE\x89",
+      // Control chars, which are normalized into whitespaces.
+      "abc\x11" "abc\x11",
+      // Invalid UTF-8.
+      "a\x80 \xFF abc",
+  };
+  return v;
+}
+
+// Tokenizes `input` in two steps, as FastBertTokenizer is meant to.
+void TokenizeInTwoSteps(const FastBertNormalizer& normalizer,
+                        const FastWordpieceTokenizer& wordpiece_tokenizer,
+                        absl::string_view input,
+                        std::vector<std::string>* output_pieces,
+                        std::vector<int>* output_ids,
+                        std::vector<int>* output_start_offsets,
+                        std::vector<int>* output_end_offsets) {
+  bool is_normalized_identical;
+  std::string normalized_text;
+  std::vector<int> offset_mapping;
+  normalizer.NormalizeText</*kGetOffsets=*/true>(
+      input, &is_normalized_identical, &normalized_text, &offset_mapping);
+  if (is_normalized_identical) {
+    normalized_text = std::string(input);
+    for (int i = 0; i <= input.size(); ++i) {
+      offset_mapping.push_back(i);
+    }
+  }
+  wordpiece_tokenizer.Tokenize(normalized_text, output_pieces, output_ids,
+                               output_start_offsets, output_end_offsets);
+  for (int i = 0; i < output_ids->size(); ++i) {
+    (*output_start_offsets)[i] = offset_mapping[(*output_start_offsets)[i]];
+    (*output_end_offsets)[i] = offset_mapping[(*output_end_offsets)[i]];
+  }
+}
+
+class FastBertTokenizerTest : public testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    const bool lower_case_nfd_strip_accents = GetParam();
+    auto normalizer_model = BuildFastBertNormalizerModelAndExportToFlatBuffer(
+        lower_case_nfd_strip_accents);
+    ASSERT_TRUE(normalizer_model.ok());
+    normalizer_model_ = *normalizer_model;
+    auto wordpiece_model = BuildModelAndExportToFlatBuffer(
+        GetTestVocab(), /*max_bytes_per_token=*/100,
+        /*suffix_indicator=*/"##", /*unk_token=*/"[UNK]");
+    ASSERT_TRUE(wordpiece_model.ok());
+    wordpiece_model_ = *wordpiece_model;
+  }
+
+  std::string normalizer_model_;
+  std::string wordpiece_model_;
+};
+
+TEST_P(FastBertTokenizerTest, SameAsTokenizingInTwoSteps) {
+  auto tokenizer = FastBertTokenizer::Create(normalizer_model_.data(),
+                                             wordpiece_model_.data());
+  ASSERT_TRUE(tokenizer.ok());
+  auto normalizer = FastBertNormalizer::Create(normalizer_model_.data());
+  ASSERT_TRUE(normalizer.ok());
+  auto wordpiece_tokenizer =
+      FastWordpieceTokenizer::Create(wordpiece_model_.data());
+  ASSERT_TRUE(wordpiece_tokenizer.ok());
+
+  // The buffers are reused for all the inputs.
+  FastBertTokenizer::Buffers buffers;
+  for (const std::string& input : GetTestInputs()) {
+    SCOPED_TRACE(input);
+    std::vector<std::string> expected_pieces;
+    std::vector<int> expected_ids;
+    std::vector<int> expected_start_offsets;
+    std::vector<int> expected_end_offsets;
+    TokenizeInTwoSteps(*normalizer, *wordpiece_tokenizer, input,
+                       &expected_pieces, &expected_ids,
+                       &expected_start_offsets, &expected_end_offsets);
+
+    std::vector<std::string> pieces;
+    std::vector<int> ids;
+    std::vector<int> start_offsets;
+    std::vector<int> end_offsets;
+    tokenizer->Tokenize(input, buffers, &pieces, &ids, &start_offsets,
+                        &end_offsets);
+    EXPECT_THAT(pieces, expected_pieces);
+    EXPECT_THAT(ids, expected_ids);
+    EXPECT_THAT(start_offsets, expected_start_offsets);
+    EXPECT_THAT(end_offsets, expected_end_offsets);
+
+    ids.clear();
+    start_offsets.clear();
+    end_offsets.clear();
+    tokenizer->Tokenize(input, buffers, &ids, &start_offsets, &end_offsets);
+    EXPECT_THAT(ids, expected_ids);
+    EXPECT_THAT(start_offsets, expected_start_offsets);
+    EXPECT_THAT(end_offsets, expected_end_offsets);
+
+    ids.clear();
+    tokenizer->Tokenize(input, buffers, &ids);
+    EXPECT_THAT(ids, expected_ids);
+  }
+}
+
+TEST_P(FastBertTokenizerTest, AppendsToOutputs) {
+  auto tokenizer = FastBertTokenizer::Create(normalizer_model_.data(),
+                                             wordpiece_model_.data());
+  ASSERT_TRUE(tokenizer.ok());
+
+  FastBertTokenizer::Buffers buffers;
+  std::vector<std::string> pieces;
+  std::vector<int> ids;
+  std::vector<int> start_offsets;
+  std::vector<int> end_offsets;
+  tokenizer->Tokenize("abc", buffers, &pieces, &ids, &start_offsets,
+                      &end_offsets);
+  tokenizer->Tokenize("\xC3\x80" "bc", buffers, &pieces, &ids, &start_offsets,
+                      &end_offsets);
+  if (GetParam()) {
+    // "\xC3\x80" is normalized into "a".
+    EXPECT_THAT(pieces, ElementsAre("abc", "abc"));
+    EXPECT_THAT(start_offsets, ElementsAre(0, 0));
+    EXPECT_THAT(end_offsets, ElementsAre(3, 4));
+  } else {
+    EXPECT_THAT(pieces, ElementsAre("abc", "[UNK]"));
+    EXPECT_THAT(start_offsets, ElementsAre(0, 0));
+    EXPECT_THAT(end_offsets, ElementsAre(3, 4));
+  }
+}
+
+TEST_P(FastBertTokenizerTest, TokenizeIntoBuffer) {
+  auto tokenizer = FastBertTokenizer::Create(normalizer_model_.data(),
+                                             wordpiece_model_.data());
+  ASSERT_TRUE(tokenizer.ok());
+
+  FastBertTokenizer::Buffers buffers;
+  for (const std::string& input : GetTestInputs()) {
+    SCOPED_TRACE(input);
+    std::vector<std::string> expected_pieces;
+    std::vector<int> expected_ids;
+    std::vector<int> expected_start_offsets;
+    std::vector<int> expected_end_offsets;
+    tokenizer->Tokenize(input, buffers, &expected_pieces, &expected_ids,
+                        &expected_start_offsets, &expected_end_offsets);
+
+    // Count the tokens first, then write them after a token already there.
+    TokenBufferWriter<int64_t> counter;
+    tokenizer->TokenizeIntoBuffer</*kGetPieces=*/false, /*kGetOffsets=*/false>(
+        input, buffers, counter);
+    ASSERT_EQ(counter.size(), expected_ids.size());
+    const int size = counter.size() + 1;
+    std::vector<std::string> pieces(size);
+    std::vector<int64_t> ids(size, -1);
+    std::vector<int64_t> start_offsets(size, -1);
+    std::vector<int64_t> end_offsets(size, -1);
+    TokenBufferWriter<int64_t> writer(
+        size, ids.data(), start_offsets.data(), end_offsets.data(),
+        [&pieces](int index, absl::string_view piece_prefix,
+                  absl::string_view piece) {
+          pieces[index] = absl::StrCat(piece_prefix, piece);
+        });
+    writer.Append</*kGetPieces=*/true, /*kGetIds=*/true, /*kGetOffsets=*/true>(
+        -1, -1, -1, "", "x");
+    tokenizer->TokenizeIntoBuffer</*kGetPieces=*/true, /*kGetOffsets=*/true>(
+        input, buffers, writer);
+    EXPECT_EQ(writer.size(), size);
+    EXPECT_THAT(std::vector<std::string>(pieces.begin() + 1, pieces.end()),
+                expected_pieces);
+    EXPECT_THAT(std::vector<int>(ids.begin() + 1, ids.end()), expected_ids);
+    EXPECT_THAT(
+        std::vector<int>(start_offsets.begin() + 1, start_offsets.end()),
+        expected_start_offsets);
+    EXPECT_THAT(std::vector<int>(end_offsets.begin() + 1, end_offsets.end()),
+                expected_end_offsets);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(LowerCaseNfdStripAccents, FastBertTokenizerTest,
+                         testing::Bool());
+
+}  // namespace
+}  // namespace text
+}  // namespace tensorflow
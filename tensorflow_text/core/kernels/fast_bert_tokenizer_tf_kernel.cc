@@ -0,0 +1,69 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer_tf_kernel.h"
+
+#include <cstdint>
+#include <functional>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/util/work_sharder.h"
+#include "tensorflow_text/core/kernels/text_batch_sharding.h"
+
+namespace tensorflow {
+namespace text {
+
+template <typename T, typename Tsplits>
+void FastBertTokenizeWithOffsetsOpKernel<T, Tsplits>::Compute(
+    OpKernelContext* c) {
+  const auto& worker_threads = *(c->device()->tensorflow_cpu_worker_threads());
+  BatchShardRunner runner =
+      [&worker_threads](
+          int64_t total, int64_t cost_per_unit,
+          const std::function<void(int64_t start, int64_t limit)>& work) {
+        ::tensorflow::Shard(worker_threads.num_threads,  // max parallelism
+                            worker_threads.workers,      // thread pool
+                            total,  // total number of data to process.
+                            cost_per_unit, work);
+      };
+  // The base class owns and initializes the op implementation.
+  using ImplType = typename FastBertTokenizeWithOffsetsOpKernel::ImplType;
+  auto* op = static_cast<ImplType*>(this->impl_.get());
+  tflite::shim::TfInvokeContext ctx(c);
+  OP_REQUIRES_OK(c, op->Invoke(&ctx, worker_threads.num_threads, runner));
+}
+
+using FastBertTokenizeWithOffsetsOpKernelInstance =
+    FastBertTokenizeWithOffsetsOpKernel<int64_t, int64_t>;
+
+#define REGISTER_FAST_BERT_TOKENIZE_SPLITS(out_type, splits_type)     \
+  REGISTER_KERNEL_BUILDER(                                           \
+      Name(FastBertTokenizeWithOffsetsOpKernelInstance::OpName())    \
+          .Device(tensorflow::DEVICE_CPU)                            \
+          .TypeConstraint<out_type>("out_type")                      \
+          .TypeConstraint<splits_type>("Tsplits"),                   \
+      FastBertTokenizeWithOffsetsOpKernel<out_type, splits_type>);
+
+#define REGISTER_FAST_BERT_TOKENIZE(out_type)           \
+  REGISTER_FAST_BERT_TOKENIZE_SPLITS(out_type, int32_t) \
+  REGISTER_FAST_BERT_TOKENIZE_SPLITS(out_type, int64_t)
+
+REGISTER_FAST_BERT_TOKENIZE(int32_t)
+REGISTER_FAST_BERT_TOKENIZE(int64_t)
+
+#undef REGISTER_FAST_BERT_TOKENIZE
+#undef REGISTER_FAST_BERT_TOKENIZE_SPLITS
+
+}  // namespace text
+}  // namespace tensorflow
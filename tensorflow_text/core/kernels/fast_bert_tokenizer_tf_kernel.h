@@ -0,0 +1,42 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_TF_KERNEL_H_
+#define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_TF_KERNEL_H_
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/lite/kernels/shim/tf_op_shim.h"
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer_kernel_template.h"
+
+namespace tensorflow {
+namespace text {
+
+// Like FastWordpieceTokenizeWithOffsetsOpKernel, overrides Compute() to shard
+// the batch across the TF CPU worker threads. `T` is the type of the ids and
+// offsets, and `Tsplits` the type of the row splits.
+template <typename T, typename Tsplits>
+class FastBertTokenizeWithOffsetsOpKernel
+    : public tflite::shim::TfOpKernel<FastBertTokenizeWithOffsetsOp, T,
+                                      Tsplits> {
+ public:
+  using tflite::shim::TfOpKernel<FastBertTokenizeWithOffsetsOp, T,
+                                 Tsplits>::TfOpKernel;
+
+  void Compute(::tensorflow::OpKernelContext* c) override;
+};
+
+}  // namespace text
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_BERT_TOKENIZER_TF_KERNEL_H_
@@ -0,0 +1,55 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer_tflite.h"
+
+#include <cstdint>
+
+#include "tensorflow/lite/kernels/shim/tflite_op_shim.h"
+#include "tensorflow/lite/kernels/shim/tflite_op_wrapper.h"
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer_kernel_template.h"
+#include "tensorflow_text/core/kernels/tflite_type_attr_defaults.h"
+
+namespace tflite {
+namespace ops {
+namespace custom {
+namespace text {
+namespace {
+const char out_type[]("out_type"), splits_type[]("Tsplits");
+}  // namespace
+
+using ::tflite::shim::op_wrapper::Attr;
+using ::tflite::shim::op_wrapper::AttrName;
+using ::tflite::shim::op_wrapper::OpWrapper;
+
+template <shim::Runtime Rt>
+using FastBertTokenizeWithOffsetsOp =
+    OpWrapper<Rt, tensorflow::text::FastBertTokenizeWithOffsetsOp,
+              Attr<AttrName<out_type>, int32_t, int64_t>,
+              Attr<AttrName<splits_type>, int32_t, int64_t>>;
+
+using FastBertTokenizeWithOffsetsOpKernel =
+    tflite::shim::TfLiteOpKernel<FastBertTokenizeWithOffsetsOp>;
+
+extern "C" void AddFastBertTokenize(tflite::MutableOpResolver* resolver) {
+  resolver->AddCustom(
+      FastBertTokenizeWithOffsetsOp<shim::Runtime::kTfLite>::OpName(),
+      GetRegistrationWithInt64TypeDefaults<FastBertTokenizeWithOffsetsOpKernel,
+                                           out_type, splits_type>());
+}
+
+}  // namespace text
+}  // namespace custom
+}  // namespace ops
+}  // namespace tflite
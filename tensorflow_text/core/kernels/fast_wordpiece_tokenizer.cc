@@ -14,6 +14,7 @@
 
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "absl/base/attributes.h"
@@ -26,19 +27,212 @@
 #include "icu4c/source/common/unicode/utf8.h"
 #include "tensorflow/lite/kernels/shim/status_macros.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_utils.h"
+#include "tensorflow_text/core/kernels/vocab_pool.h"
 
 namespace tensorflow {
 namespace text {
 namespace {
 
-template <bool kGetPieces>
-int GetCurrentOutputSize(std::vector<std::string>* output_pieces,
-                         std::vector<int>* output_ids) {
-  if constexpr (kGetPieces) {
-    return output_pieces->size();
-  } else {
-    return output_ids->size();
+// Appends the output of FastWordpieceTokenizer to the end of the (optional)
+// output vectors of `FastWordpieceTokenizer::Tokenize`. The vectors that are
+// not requested are nullptr.
+class VectorTokenOutput {
+ public:
+  VectorTokenOutput(std::vector<std::string>* output_pieces,
+                    std::vector<int>* output_ids,
+                    std::vector<int>* output_start_offsets,
+                    std::vector<int>* output_end_offsets)
+      : output_pieces_(output_pieces),
+        output_ids_(output_ids),
+        output_start_offsets_(output_start_offsets),
+        output_end_offsets_(output_end_offsets) {}
+
+  int size() const {
+    return output_ids_ != nullptr ? output_ids_->size()
+                                  : output_pieces_->size();
+  }
+
+  void Truncate(int size) {
+    if (output_pieces_ != nullptr) output_pieces_->resize(size);
+    if (output_ids_ != nullptr) output_ids_->resize(size);
+    if (output_start_offsets_ != nullptr) output_start_offsets_->resize(size);
+    if (output_end_offsets_ != nullptr) output_end_offsets_->resize(size);
+  }
+
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+  void Append(int token_id, int start_offset, int end_offset,
+              absl::string_view piece_prefix, absl::string_view piece) {
+    if constexpr (kGetPieces) {
+      output_pieces_->emplace_back(
+          piece_prefix.empty() ? std::string(piece)
+                               : absl::StrCat(piece_prefix, piece));
+    }
+    if constexpr (kGetIds) {
+      output_ids_->push_back(token_id);
+    }
+    if constexpr (kGetOffsets) {
+      output_start_offsets_->push_back(start_offset);
+      output_end_offsets_->push_back(end_offset);
+    }
+  }
+
+ private:
+  std::vector<std::string>* output_pieces_;
+  std::vector<int>* output_ids_;
+  std::vector<int>* output_start_offsets_;
+  std::vector<int>* output_end_offsets_;
+};
+
+// Forwards the tokens of a single word to `output`, and records them (with
+// offsets relative to the word) for FastWordpieceWordCache. The tokens should
+// be appended with offsets relative to the word; they are shifted by
+// `input_word_offset_in_text` for `output`, whose offsets are only computed if
+// `kGetOffsets`.
+template <typename OutputT, bool kGetOffsets>
+class CachingTokenOutput {
+ public:
+  CachingTokenOutput(int input_word_offset_in_text, OutputT& output)
+      : input_word_offset_in_text_(input_word_offset_in_text),
+        output_(output),
+        original_num_tokens_(output.size()) {}
+
+  int size() const { return output_.size(); }
+
+  void Truncate(int size) {
+    output_.Truncate(size);
+    tokens_.resize(size - original_num_tokens_);
+  }
+
+  template <bool kGetPieces, bool kGetIds, bool kUnusedGetOffsets>
+  void Append(int token_id, int start_offset, int end_offset,
+              absl::string_view piece_prefix, absl::string_view piece) {
+    tokens_.push_back({token_id, start_offset, end_offset});
+    output_.template Append<kGetPieces, kGetIds, kGetOffsets>(
+        token_id, input_word_offset_in_text_ + start_offset,
+        input_word_offset_in_text_ + end_offset, piece_prefix, piece);
+  }
+
+  std::vector<FastWordpieceWordCache::Token>& tokens() { return tokens_; }
+
+ private:
+  const int input_word_offset_in_text_;
+  OutputT& output_;
+  const int original_num_tokens_;
+  std::vector<FastWordpieceWordCache::Token> tokens_;
+};
+
+// Forwards the tokens to `output`, with their offsets shifted by `offset`. Used
+// to tokenize a part of a text, starting at `offset`, with offsets in the text.
+template <typename OutputT>
+class ShiftedTokenOutput {
+ public:
+  ShiftedTokenOutput(int offset, OutputT& output)
+      : offset_(offset), output_(output) {}
+
+  int size() const { return output_.size(); }
+
+  void Truncate(int size) { output_.Truncate(size); }
+
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+  void Append(int token_id, int start_offset, int end_offset,
+              absl::string_view piece_prefix, absl::string_view piece) {
+    output_.template Append<kGetPieces, kGetIds, kGetOffsets>(
+        token_id, offset_ + start_offset, offset_ + end_offset, piece_prefix,
+        piece);
+  }
+
+ private:
+  const int offset_;
+  OutputT& output_;
+};
+
+absl::Status DetokenizationNotSupportedError() {
+  return absl::FailedPreconditionError(
+      "Detokenize function is only enabled when support_detokenization is "
+      "true in the config flatbuffer. Please rebuild the model flatbuffer "
+      "by setting support_detokenization=true.");
+}
+
+absl::Status WideTokenOutOfRangeError(absl::string_view where,
+                                      int encoded_token_value,
+                                      int num_wide_tokens) {
+  return absl::InvalidArgumentError(absl::StrCat(
+      "Malformed wide encoding in FastWordpieceTokenizerConfig: token ",
+      encoded_token_value, " in ", where, " is out of range [0, ",
+      num_wide_tokens, ")."));
+}
+
+// Checks that every encoded token value of a model with the wide encoding is
+// the index of a token in `wide_token_array`, so that GetTokenId() and friends
+// never read out of the array. These are the values on the trie, the
+// precomputed result for the suffix indicator and the tokens of the failure
+// pop lists. The failure pop lists must also lie in `failure_pops_pool`.
+absl::Status ValidateWideEncoding(const FastWordpieceTokenizerConfig& config) {
+  const int num_wide_tokens = config.wide_token_array()->size();
+
+  // The leaf units of a darts_clone trie are the ones with the MSB set, and
+  // hold the value in the other bits (see darts_clone_trie_wrapper.h).
+  if (config.trie_array() != nullptr) {
+    for (const uint32_t unit : *config.trie_array()) {
+      const int value = static_cast<int>(unit & 0x7fffffff);
+      if ((unit & 0x80000000) != 0 && value >= num_wide_tokens) {
+        return WideTokenOutOfRangeError("trie_array", value, num_wide_tokens);
+      }
+    }
+  }
+  if (config.precomputed_result_for_suffix_indicator() != nullptr) {
+    for (const int encoded_token_value :
+         *config.precomputed_result_for_suffix_indicator()) {
+      if (encoded_token_value < 0 || encoded_token_value >= num_wide_tokens) {
+        return WideTokenOutOfRangeError(
+            "precomputed_result_for_suffix_indicator", encoded_token_value,
+            num_wide_tokens);
+      }
+    }
+  }
+
+  // The pool is a sequence of lists, each stored as its length followed by its
+  // tokens, and the failure structs refer to the start of a list.
+  const auto* failure_pops_pool = config.failure_pops_pool();
+  const int pool_size =
+      failure_pops_pool == nullptr ? 0 : failure_pops_pool->size();
+  std::vector<bool> is_list_start(pool_size, false);
+  for (int offset = 0; offset < pool_size;) {
+    const int length = failure_pops_pool->Get(offset);
+    if (length < 0 || length >= pool_size - offset) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Malformed wide encoding in FastWordpieceTokenizerConfig: failure "
+          "pops list at ",
+          offset, " of length ", length,
+          " does not fit in failure_pops_pool."));
+    }
+    is_list_start[offset] = true;
+    for (int i = offset + 1; i <= offset + length; ++i) {
+      const int encoded_token_value = failure_pops_pool->Get(i);
+      if (encoded_token_value < 0 || encoded_token_value >= num_wide_tokens) {
+        return WideTokenOutOfRangeError("failure_pops_pool",
+                                        encoded_token_value, num_wide_tokens);
+      }
+    }
+    offset += length + 1;
+  }
+  if (config.failure_struct_array() != nullptr) {
+    for (const auto* failure_struct : *config.failure_struct_array()) {
+      const uint32_t encoded_offset =
+          failure_struct->failure_pops_offset_length();
+      if (encoded_offset !=
+              fast_wordpiece_tokenizer_utils::kNullFailurePopsList &&
+          (encoded_offset >= static_cast<uint32_t>(pool_size) ||
+           !is_list_start[encoded_offset])) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Malformed wide encoding in FastWordpieceTokenizerConfig: failure "
+            "pops list offset ",
+            encoded_offset,
+            " is not the start of a list in failure_pops_pool."));
+      }
+    }
   }
+  return absl::OkStatus();
 }
 
 }  // namespace
@@ -57,6 +251,28 @@ FastWordpieceTokenizer::Create(const void* config_flatbuffer) {
   }
   tokenizer.trie_ =
       std::make_unique<trie_utils::DartsCloneTrieWrapper>(*std::move(trie_or));
+  const auto* char_class_block_index =
+      tokenizer.config_->char_class_block_index();
+  const auto* char_class_blocks = tokenizer.config_->char_class_blocks();
+  if (char_class_block_index != nullptr && char_class_blocks != nullptr) {
+    auto char_classes_or =
+        fast_wordpiece_tokenizer_utils::CharClassTable::Create(
+            char_class_block_index->data(), char_class_block_index->size(),
+            char_class_blocks->data(), char_class_blocks->size());
+    if (!char_classes_or.ok()) {
+      return char_classes_or.status();
+    }
+    tokenizer.char_classes_ = *char_classes_or;
+  }
+  if (tokenizer.config_->wide_token_encoding()) {
+    if (tokenizer.config_->wide_token_array() == nullptr) {
+      return absl::InvalidArgumentError(
+          "Missing wide_token_array in FastWordpieceTokenizerConfig.");
+    }
+    SH_RETURN_IF_ERROR(ValidateWideEncoding(*tokenizer.config_));
+    tokenizer.wide_tokens_ = reinterpret_cast<const WideToken*>(
+        tokenizer.config_->wide_token_array()->Data());
+  }
   return std::move(tokenizer);
 }
 
@@ -66,54 +282,211 @@ void FastWordpieceTokenizer::Tokenize(absl::string_view input,
                                       std::vector<int>* output_start_offsets,
                                       std::vector<int>* output_end_offsets,
                                       int input_word_offset_in_text,
-                                      bool* error) const {
-  if (config_->end_to_end()) {
-    TokenizeTextImpl</*kGetPieces=*/true, /*kGetIds=*/true,
-                     /*kGetOffsets=*/true>(input, output_pieces, output_ids,
-                                           output_start_offsets,
-                                           output_end_offsets, error);
-  } else {
-    TokenizeSingleWordImpl</*kGetPieces=*/true, /*kGetIds=*/true,
-                           /*kGetOffsets=*/true>(
-        input, input_word_offset_in_text, output_pieces, output_ids,
-        output_start_offsets, output_end_offsets);
-  }
+                                      bool* error, int max_num_tokens,
+                                      bool* truncated) const {
+  VectorTokenOutput output(output_pieces, output_ids, output_start_offsets,
+                           output_end_offsets);
+  TokenizeImpl</*kGetPieces=*/true, /*kGetIds=*/true, /*kGetOffsets=*/true>(
+      input, input_word_offset_in_text, max_num_tokens, output, error,
+      truncated);
 }
 
 void FastWordpieceTokenizer::Tokenize(absl::string_view input,
                                       std::vector<int>* output_ids,
                                       std::vector<int>* output_start_offsets,
                                       std::vector<int>* output_end_offsets,
-                                      int input_word_offset_in_text) const {
-  if (config_->end_to_end()) {
-    TokenizeTextImpl</*kGetPieces=*/false, /*kGetIds=*/true,
-                     /*kGetOffsets=*/true>(
-        input, /*output_pieces=*/nullptr, output_ids, output_start_offsets,
-        output_end_offsets, /*error=*/nullptr);
-  } else {
-    TokenizeSingleWordImpl</*kGetPieces=*/false, /*kGetIds=*/true,
-                           /*kGetOffsets=*/true>(
-        input, input_word_offset_in_text, /*output_pieces=*/nullptr, output_ids,
-        output_start_offsets, output_end_offsets);
-  }
+                                      int input_word_offset_in_text,
+                                      bool* error, int max_num_tokens,
+                                      bool* truncated) const {
+  VectorTokenOutput output(/*output_pieces=*/nullptr, output_ids,
+                           output_start_offsets, output_end_offsets);
+  TokenizeImpl</*kGetPieces=*/false, /*kGetIds=*/true, /*kGetOffsets=*/true>(
+      input, input_word_offset_in_text, max_num_tokens, output, error,
+      truncated);
 }
 
 void FastWordpieceTokenizer::Tokenize(absl::string_view input,
                                       std::vector<int>* output_ids,
-                                      int input_word_offset_in_text) const {
+                                      int input_word_offset_in_text,
+                                      bool* error, int max_num_tokens,
+                                      bool* truncated) const {
+  VectorTokenOutput output(/*output_pieces=*/nullptr, output_ids,
+                           /*output_start_offsets=*/nullptr,
+                           /*output_end_offsets=*/nullptr);
+  TokenizeImpl</*kGetPieces=*/false, /*kGetIds=*/true, /*kGetOffsets=*/false>(
+      input, input_word_offset_in_text, max_num_tokens, output, error,
+      truncated);
+}
+
+template <bool kGetPieces, bool kGetOffsets, typename T>
+void FastWordpieceTokenizer::TokenizeIntoBuffer(absl::string_view input,
+                                                TokenBufferWriter<T>& output,
+                                                int input_word_offset_in_text,
+                                                bool* error, int max_num_tokens,
+                                                bool* truncated) const {
+  TokenizeImpl<kGetPieces, /*kGetIds=*/true, kGetOffsets>(
+      input, input_word_offset_in_text, max_num_tokens, output, error,
+      truncated);
+}
+
+void FastWordpieceTokenizer::TokenizeChunk(
+    absl::string_view chunk, StreamState& state,
+    std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
+    std::vector<int>* output_start_offsets,
+    std::vector<int>* output_end_offsets, bool* error) const {
+  VectorTokenOutput output(output_pieces, output_ids, output_start_offsets,
+                           output_end_offsets);
+  TokenizeChunkImpl</*kGetPieces=*/true, /*kGetIds=*/true,
+                    /*kGetOffsets=*/true>(chunk, state, output, error);
+}
+
+void FastWordpieceTokenizer::TokenizeChunk(
+    absl::string_view chunk, StreamState& state, std::vector<int>* output_ids,
+    std::vector<int>* output_start_offsets,
+    std::vector<int>* output_end_offsets, bool* error) const {
+  VectorTokenOutput output(/*output_pieces=*/nullptr, output_ids,
+                           output_start_offsets, output_end_offsets);
+  TokenizeChunkImpl</*kGetPieces=*/false, /*kGetIds=*/true,
+                    /*kGetOffsets=*/true>(chunk, state, output, error);
+}
+
+void FastWordpieceTokenizer::FinishStream(
+    StreamState& state, std::vector<std::string>* output_pieces,
+    std::vector<int>* output_ids, std::vector<int>* output_start_offsets,
+    std::vector<int>* output_end_offsets, bool* error) const {
+  VectorTokenOutput output(output_pieces, output_ids, output_start_offsets,
+                           output_end_offsets);
+  FinishStreamImpl</*kGetPieces=*/true, /*kGetIds=*/true,
+                   /*kGetOffsets=*/true>(state, output, error);
+}
+
+void FastWordpieceTokenizer::FinishStream(
+    StreamState& state, std::vector<int>* output_ids,
+    std::vector<int>* output_start_offsets,
+    std::vector<int>* output_end_offsets, bool* error) const {
+  VectorTokenOutput output(/*output_pieces=*/nullptr, output_ids,
+                           output_start_offsets, output_end_offsets);
+  FinishStreamImpl</*kGetPieces=*/false, /*kGetIds=*/true,
+                   /*kGetOffsets=*/true>(state, output, error);
+}
+
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+void FastWordpieceTokenizer::TokenizeChunkImpl(absl::string_view chunk,
+                                               StreamState& state,
+                                               OutputT& output,
+                                               bool* error) const {
+  const int chunk_offset = state.num_bytes_;
+  state.num_bytes_ += chunk.size();
+  if (!config_->end_to_end()) {
+    // The whole text is a single word. Keep just enough of it to tell whether
+    // it is longer than `max_bytes_per_token`.
+    const int max_pending_size = config_->max_bytes_per_token() + 1;
+    const int num_bytes_to_keep = std::min<int>(
+        chunk.size(),
+        std::max<int>(0, max_pending_size - state.pending_text_.size()));
+    state.pending_text_.append(chunk.data(), num_bytes_to_keep);
+    return;
+  }
+
+  // Tokenizing the text in pieces gives the same result as tokenizing it at
+  // once only if each piece ends right after a whitespace (a word may end at a
+  // punctuation, but whether the punctuation is a token by itself depends on
+  // the rest of the word).
+  const int end_of_last_white_space = FindEndOfLastWhiteSpace(chunk);
+  if (end_of_last_white_space == 0) {
+    state.pending_text_.append(chunk.data(), chunk.size());
+    FlushLongPendingText<kGetPieces, kGetIds, kGetOffsets>(state, output,
+                                                           error);
+    return;
+  }
+  int cur_pos = 0;
+  if (!state.pending_text_.empty()) {
+    // Complete the pending word with the start of `chunk`.
+    cur_pos =
+        std::min(FindEndOfFirstWhiteSpace(chunk), end_of_last_white_space);
+    state.pending_text_.append(chunk.data(), cur_pos);
+    ShiftedTokenOutput<OutputT> shifted_output(
+        chunk_offset + cur_pos - state.pending_text_.size(), output);
+    TokenizeTextImpl<kGetPieces, kGetIds, kGetOffsets>(state.pending_text_,
+                                                       shifted_output, error);
+    state.pending_text_.clear();
+  }
+  // The rest of `chunk` up to its last whitespace is tokenized in place.
+  ShiftedTokenOutput<OutputT> shifted_output(chunk_offset + cur_pos, output);
+  TokenizeTextImpl<kGetPieces, kGetIds, kGetOffsets>(
+      chunk.substr(cur_pos, end_of_last_white_space - cur_pos), shifted_output,
+      error);
+  state.pending_text_.assign(chunk.data() + end_of_last_white_space,
+                             chunk.size() - end_of_last_white_space);
+  FlushLongPendingText<kGetPieces, kGetIds, kGetOffsets>(state, output, error);
+}
+
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+void FastWordpieceTokenizer::FlushLongPendingText(StreamState& state,
+                                                  OutputT& output,
+                                                  bool* error) const {
+  if (static_cast<int>(state.pending_text_.size()) <=
+      state.max_pending_bytes_) {
+    return;
+  }
+  // Keep about half of the limit, so that the text is not scanned again for
+  // each of the next chunks.
+  const int cut =
+      FindCutInRun(state.pending_text_, state.max_pending_bytes_ / 2);
+  ShiftedTokenOutput<OutputT> shifted_output(
+      state.num_bytes_ - state.pending_text_.size(), output);
+  TokenizeTextImpl<kGetPieces, kGetIds, kGetOffsets>(
+      absl::string_view(state.pending_text_).substr(0, cut), shifted_output,
+      error);
+  state.pending_text_.erase(0, cut);
+}
+
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+void FastWordpieceTokenizer::FinishStreamImpl(StreamState& state,
+                                              OutputT& output,
+                                              bool* error) const {
   if (config_->end_to_end()) {
-    TokenizeTextImpl</*kGetPieces=*/false, /*kGetIds=*/true,
-                     /*kGetOffsets=*/false>(
-        input, /*output_pieces=*/nullptr, output_ids,
-        /*output_start_offsets=*/nullptr,
-        /*output_end_offsets=*/nullptr, /*error=*/nullptr);
+    ShiftedTokenOutput<OutputT> shifted_output(
+        state.num_bytes_ - state.pending_text_.size(), output);
+    TokenizeTextImpl<kGetPieces, kGetIds, kGetOffsets>(state.pending_text_,
+                                                       shifted_output, error);
+  } else if (state.num_bytes_ > config_->max_bytes_per_token()) {
+    int original_num_tokens = output.size();
+    ResetOutputAppendUnknownToken<kGetPieces, kGetIds, kGetOffsets>(
+        /*input_word_offset_in_text=*/0, state.num_bytes_, original_num_tokens,
+        output);
   } else {
-    TokenizeSingleWordImpl</*kGetPieces=*/false, /*kGetIds=*/true,
-                           /*kGetOffsets=*/false>(
-        input, input_word_offset_in_text, /*output_pieces=*/nullptr, output_ids,
-        /*output_start_offsets=*/nullptr,
-        /*output_end_offsets=*/nullptr);
+    TokenizeImpl<kGetPieces, kGetIds, kGetOffsets>(
+        state.pending_text_, /*input_word_offset_in_text=*/0, kNoTokenLimit,
+        output, error, /*truncated=*/nullptr);
+  }
+  state = StreamState(state.max_pending_bytes_);
+}
+
+template <typename AppendFn>
+absl::Status FastWordpieceTokenizer::ForEachDetokenizedPiece(
+    absl::Span<const int> input, AppendFn append) const {
+  const VocabPool vocab = VocabPool::FromConfig(*config_);
+  const auto* vocab_is_suffix_array = config_->vocab_is_suffix_array();
+  for (int i = 0; i < input.size(); ++i) {
+    const int id = input[i];
+    const absl::StatusOr<absl::string_view> token = vocab.Get(id);
+    if (!token.ok()) {
+      return token.status();
+    }
+    if (vocab_is_suffix_array->Get(id)) {
+      // Special case: when a suffix token e.g. "##a" appears at the start of
+      // the input ids, we preserve the suffix_indicator.
+      if (i == 0) {
+        append(config_->suffix_indicator()->string_view());
+      }
+    } else if (i > 0) {
+      // A token that is not a suffix token starts a new word.
+      append(" ");
+    }
+    append(*token);
   }
+  return absl::OkStatus();
 }
 
 absl::StatusOr<std::vector<std::string>>
@@ -122,13 +495,14 @@ FastWordpieceTokenizer::DetokenizeToTokens(
   std::vector<std::string> subwords;
   std::vector<std::string> output_tokens;
   if (!config_->support_detokenization()) {
-    return absl::FailedPreconditionError(
-        "Detokenize function is only enabled when support_detokenization is "
-        "true in the config flatbuffer. Please rebuild the model flatbuffer "
-        "by setting support_detokenization=true.");
+    return DetokenizationNotSupportedError();
   }
+  const VocabPool vocab_pool = VocabPool::FromConfig(*config_);
   for (int id : input) {
-    auto vocab = config_->vocab_array()->Get(id);
+    const absl::StatusOr<absl::string_view> vocab = vocab_pool.Get(id);
+    if (!vocab.ok()) {
+      return vocab.status();
+    }
     auto is_suffix = config_->vocab_is_suffix_array()->Get(id);
     if (!subwords.empty() && !is_suffix) {
       // When current subword is not a suffix token, it marks the start of a new
@@ -142,7 +516,7 @@ FastWordpieceTokenizer::DetokenizeToTokens(
     if (subwords.empty() && is_suffix) {
       subwords.emplace_back(config_->suffix_indicator()->string_view());
     }
-    subwords.emplace_back(vocab->string_view());
+    subwords.emplace_back(*vocab);
   }
   if (!subwords.empty()) {
     output_tokens.emplace_back(absl::StrJoin(subwords, ""));
@@ -152,9 +526,54 @@ FastWordpieceTokenizer::DetokenizeToTokens(
 
 absl::StatusOr<std::string> FastWordpieceTokenizer::Detokenize(
     const absl::Span<const int> input) const {
-  SH_ASSIGN_OR_RETURN(std::vector<std::string> output_tokens,
-                      DetokenizeToTokens(input));
-  return absl::StrJoin(output_tokens, " ");
+  if (!config_->support_detokenization()) {
+    return DetokenizationNotSupportedError();
+  }
+  std::string text;
+  SH_RETURN_IF_ERROR(
+      ForEachDetokenizedPiece(input, [&text](absl::string_view piece) {
+        text.append(piece.data(), piece.size());
+      }));
+  return text;
+}
+
+absl::Status FastWordpieceTokenizer::DetokenizeBatch(
+    absl::Span<const int> input, absl::Span<const int64_t> row_splits,
+    std::string* output_texts, std::vector<int64_t>* output_text_ends) const {
+  if (!config_->support_detokenization()) {
+    return DetokenizationNotSupportedError();
+  }
+  const int num_rows = std::max<int>(0, row_splits.size() - 1);
+  for (int i = 0; i < num_rows; ++i) {
+    if (row_splits[i] < 0 || row_splits[i] > row_splits[i + 1] ||
+        row_splits[i + 1] > static_cast<int64_t>(input.size())) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Invalid row splits: [", row_splits[i], ", ", row_splits[i + 1],
+          ") for ", input.size(), " wordpiece ids."));
+    }
+  }
+  auto row = [&input, &row_splits](int i) {
+    return input.subspan(row_splits[i], row_splits[i + 1] - row_splits[i]);
+  };
+
+  // Size the texts first, so that `output_texts` is allocated at most once.
+  size_t texts_size = output_texts->size();
+  for (int i = 0; i < num_rows; ++i) {
+    SH_RETURN_IF_ERROR(
+        ForEachDetokenizedPiece(row(i), [&texts_size](absl::string_view piece) {
+          texts_size += piece.size();
+        }));
+  }
+  output_texts->reserve(texts_size);
+  output_text_ends->reserve(output_text_ends->size() + num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    // The ids are all checked above.
+    ForEachDetokenizedPiece(row(i), [output_texts](absl::string_view piece) {
+      output_texts->append(piece.data(), piece.size());
+    }).IgnoreError();
+    output_text_ends->push_back(output_texts->size());
+  }
+  return absl::OkStatus();
 }
 
 int FastWordpieceTokenizer::SkipTheRemainingOfWordAndTrailingWhiteSpaces(
@@ -166,13 +585,12 @@ int FastWordpieceTokenizer::SkipTheRemainingOfWordAndTrailingWhiteSpaces(
   while (cur_pos < input_size) {
     next_pos = cur_pos;
     U8_NEXT(input, next_pos, input_size, cur_unicode_char);
-    if (u_isUWhiteSpace(cur_unicode_char)) {
+    if (IsWhiteSpace(cur_unicode_char)) {
       cur_pos = next_pos;  // Skip the whitespace as well.
       // Break and return since we've met a word boundary.
       break;
     }
-    if (fast_wordpiece_tokenizer_utils::IsPunctuationOrChineseChar(
-            cur_unicode_char)) {
+    if (IsPunctuationOrChineseChar(cur_unicode_char)) {
       // Break and return since we've met a word boundary. We do not skip the
       // punctuation character: that character may be a token by itself.
       break;
@@ -183,11 +601,136 @@ int FastWordpieceTokenizer::SkipTheRemainingOfWordAndTrailingWhiteSpaces(
   return end_of_word;
 }
 
-template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
-void FastWordpieceTokenizer::TokenizeTextImpl(
-    absl::string_view input_text, std::vector<std::string>* output_pieces,
-    std::vector<int>* output_ids, std::vector<int>* output_start_offsets,
-    std::vector<int>* output_end_offsets, bool* error) const {
+int FastWordpieceTokenizer::FindEndOfLastWhiteSpace(
+    absl::string_view input) const {
+  int cur_pos = input.size();
+  while (cur_pos > 0) {
+    const int end_pos = cur_pos;
+    UChar32 cur_unicode_char;
+    U8_PREV(input.data(), 0, cur_pos, cur_unicode_char);
+    if (IsWhiteSpace(cur_unicode_char)) {
+      return end_pos;
+    }
+  }
+  return 0;
+}
+
+int FastWordpieceTokenizer::FindEndOfFirstWhiteSpace(
+    absl::string_view input) const {
+  const int input_size = input.size();
+  int cur_pos = 0;
+  while (cur_pos < input_size) {
+    UChar32 cur_unicode_char;
+    U8_NEXT(input, cur_pos, input_size, cur_unicode_char);
+    if (IsWhiteSpace(cur_unicode_char)) {
+      break;
+    }
+  }
+  return cur_pos;
+}
+
+int FastWordpieceTokenizer::FindCutInRun(absl::string_view input,
+                                         int max_kept) const {
+  const int input_size = input.size();
+  // Skip the trailing bytes of the last character, which may still be
+  // completed by the next chunk.
+  int last_char_start = input_size;
+  do {
+    --last_char_start;
+  } while (last_char_start > 0 &&
+           input_size - last_char_start < U8_MAX_LENGTH &&
+           U8_IS_TRAIL(input[last_char_start]));
+  int cur_pos = last_char_start;
+  while (cur_pos > 0 && input_size - cur_pos <= max_kept) {
+    const int end_pos = cur_pos;
+    UChar32 cur_unicode_char;
+    U8_PREV(input.data(), 0, cur_pos, cur_unicode_char);
+    if (cur_unicode_char >= 0 &&
+        IsPunctuationOrChineseChar(cur_unicode_char)) {
+      return end_pos;
+    }
+  }
+  return last_char_start;
+}
+
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+void FastWordpieceTokenizer::TokenizeImpl(absl::string_view input,
+                                          int input_word_offset_in_text,
+                                          int max_num_tokens, OutputT& output,
+                                          bool* error, bool* truncated) const {
+  const int max_output_size =
+      max_num_tokens >= kNoTokenLimit - output.size()
+          ? kNoTokenLimit
+          : output.size() + max_num_tokens;
+  if (config_->end_to_end()) {
+    TokenizeTextImpl<kGetPieces, kGetIds, kGetOffsets>(
+        input, output, error, max_output_size, truncated);
+  } else if (word_cache_ != nullptr) {
+    TokenizeSingleWordWithCache<kGetPieces, kGetIds, kGetOffsets>(
+        input, input_word_offset_in_text, output);
+  } else {
+    TokenizeSingleWordImpl<kGetPieces, kGetIds, kGetOffsets>(
+        input, input_word_offset_in_text, output);
+  }
+  if (output.size() > max_output_size) {
+    // The last word went over the budget.
+    output.Truncate(max_output_size);
+    if (truncated != nullptr) {
+      *truncated = true;
+    }
+  }
+}
+
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+void FastWordpieceTokenizer::TokenizeSingleWordWithCache(
+    absl::string_view input_word, int input_word_offset_in_text,
+    OutputT& output) const {
+  if (input_word.empty() ||
+      input_word.size() > config_->max_bytes_per_token()) {
+    // Cheap anyway (the latter is mapped to unk_token right away).
+    TokenizeSingleWordImpl<kGetPieces, kGetIds, kGetOffsets>(
+        input_word, input_word_offset_in_text, output);
+    return;
+  }
+  auto append_cached_tokens =
+      [&](absl::Span<const FastWordpieceWordCache::Token> tokens) {
+        for (const auto& token : tokens) {
+          // Recover the token string the same way as AppendTokenToOutput()
+          // and ResetOutputAppendUnknownToken().
+          absl::string_view piece_prefix;
+          absl::string_view piece;
+          if constexpr (kGetPieces) {
+            piece = token.token_id == config_->unk_token_id()
+                        ? config_->unk_token()->string_view()
+                        : input_word.substr(
+                              token.start_offset,
+                              token.end_offset - token.start_offset);
+            if (token.start_offset > 0) {
+              piece_prefix = config_->suffix_indicator()->string_view();
+            }
+          }
+          output.template Append<kGetPieces, kGetIds, kGetOffsets>(
+              token.token_id, input_word_offset_in_text + token.start_offset,
+              input_word_offset_in_text + token.end_offset, piece_prefix,
+              piece);
+        }
+      };
+  if (word_cache_->Lookup(input_word, append_cached_tokens)) {
+    return;
+  }
+  // The cache needs the offsets, even if `output` does not.
+  CachingTokenOutput<OutputT, kGetOffsets> caching_output(
+      input_word_offset_in_text, output);
+  TokenizeSingleWordImpl<kGetPieces, kGetIds, /*kGetOffsets=*/true>(
+      input_word, /*input_word_offset_in_text=*/0, caching_output);
+  word_cache_->Insert(input_word, std::move(caching_output.tokens()));
+}
+
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+void FastWordpieceTokenizer::TokenizeTextImpl(absl::string_view input_text,
+                                              OutputT& output, bool* error,
+                                              int max_output_size,
+                                              bool* truncated) const {
   static_assert(kGetPieces || kGetIds,
                 "At least one of `kGetPieces` and `kGetIds` should be true.");
   if (input_text.empty()) {
@@ -197,11 +740,26 @@ void FastWordpieceTokenizer::TokenizeTextImpl(
   int prev_pos = -1;
   int next_pos = 0;
   int cur_pos = 0;
-  int original_num_tokens =
-      GetCurrentOutputSize<kGetPieces>(output_pieces, output_ids);
+  int original_num_tokens = output.size();
   UChar32 prev_unicode_char;
   UChar32 cur_unicode_char;
+  // The bytes in [cur_pos, ascii_word_end) are known to be ASCII word chars
+  // (see `CountLeadingAsciiWordBytes`).
+  int ascii_word_end = 0;
   while (cur_pos < input_size) {
+    if (output.size() >= max_output_size) {
+      // The tokens of the words so far are final. Stop here, without looking
+      // at the rest of the text beyond its first non-whitespace character,
+      // which would be (part of) at least one more token.
+      while (truncated != nullptr && cur_pos < input_size) {
+        U8_NEXT(input_text, cur_pos, input_size, cur_unicode_char);
+        if (!IsWhiteSpace(cur_unicode_char)) {
+          *truncated = true;
+          break;
+        }
+      }
+      return;
+    }
     // Prevent looping without progress in cur_pos.
     if (prev_pos == cur_pos && error != nullptr) {
       *error = true;
@@ -209,6 +767,29 @@ void FastWordpieceTokenizer::TokenizeTextImpl(
     }
     prev_pos = cur_pos;
 
+    if (word_cache_ != nullptr) {
+      // Words of ASCII word chars followed by a word boundary are tokenized
+      // exactly as single words, so they can go through the cache.
+      const int word_end =
+          cur_pos + fast_wordpiece_tokenizer_utils::CountLeadingAsciiWordBytes(
+                        input_text.data() + cur_pos, input_size - cur_pos);
+      if (word_end > cur_pos &&
+          (word_end == input_size ||
+           static_cast<unsigned char>(input_text[word_end]) < 0x80)) {
+        TokenizeSingleWordWithCache<kGetPieces, kGetIds, kGetOffsets>(
+            input_text.substr(cur_pos, word_end - cur_pos), cur_pos, output);
+        original_num_tokens = output.size();
+        cur_pos = word_end;
+        if (cur_pos < input_size &&
+            fast_wordpiece_tokenizer_utils::IsAsciiWhiteSpace(
+                input_text[cur_pos])) {
+          // Skip the whitespace.
+          ++cur_pos;
+        }
+        continue;
+      }
+    }
+
     int cur_offset_in_input_word = 0;
     // Tokenize the word starting at the current position.
     auto cur_node = trie_->CreateTraversalCursorPointToRoot();
@@ -229,15 +810,30 @@ void FastWordpieceTokenizer::TokenizeTextImpl(
       prev_pos_inner = cur_pos;
 
       prev_unicode_char = cur_unicode_char;
-      next_pos = cur_pos;
-      U8_NEXT(input_text, next_pos, input_text.length(), cur_unicode_char);
+      if (cur_pos >= ascii_word_end &&
+          static_cast<unsigned char>(input_text[cur_pos]) < 0x80) {
+        ascii_word_end =
+            cur_pos + fast_wordpiece_tokenizer_utils::CountLeadingAsciiWordBytes(
+                          input_text.data() + cur_pos, input_size - cur_pos);
+      }
+      if (cur_pos < ascii_word_end) {
+        // Fast path for ASCII word chars: each byte is a whole character.
+        next_pos = cur_pos + 1;
+        cur_unicode_char = static_cast<unsigned char>(input_text[cur_pos]);
+      } else {
+        next_pos = cur_pos;
+        U8_NEXT(input_text, next_pos, input_text.length(), cur_unicode_char);
+      }
 
       if (word_byte_length_so_far + next_pos - cur_pos >
           config_->max_bytes_per_token())
         break;
       // Try matching one Unicode character from here.
-      while (!trie_->TryTraverseSeveralSteps(
-          cur_node, input_text.substr(cur_pos, next_pos - cur_pos))) {
+      while (next_pos - cur_pos == 1
+                 ? !trie_->TryTraverseOneStep(cur_node, input_text[cur_pos])
+                 : !trie_->TryTraverseSeveralSteps(
+                       cur_node,
+                       input_text.substr(cur_pos, next_pos - cur_pos))) {
         // Trie cannot consume the whole Unicode character. We need to pop one
         // or more longest-matching tokens off the beginning of the string
         // represented by the current node. We then transit to the node pointed
@@ -250,8 +846,7 @@ void FastWordpieceTokenizer::TokenizeTextImpl(
         if (!TryFollowFailureLinkAndCollectTokens<kGetPieces, kGetIds,
                                                   kGetOffsets>(
                 input_substr, input_word_offset_in_text,
-                cur_offset_in_input_word, cur_node, output_pieces, output_ids,
-                output_start_offsets, output_end_offsets)) {
+                cur_offset_in_input_word, cur_node, output)) {
           goto outside_trie_match_loop;
         }
       }
@@ -265,25 +860,20 @@ void FastWordpieceTokenizer::TokenizeTextImpl(
       // Collect the remaining tokens stored on a path on the trie.
       HandleTheRemainingStringOnTriePath<kGetPieces, kGetIds, kGetOffsets>(
           input_substr, input_word_offset_in_text, cur_node,
-          original_num_tokens, cur_offset_in_input_word, output_pieces,
-          output_ids, output_start_offsets, output_end_offsets);
+          original_num_tokens, cur_offset_in_input_word, output);
       // Break as we've finished all characters.
       break;
     }
-    bool is_white_space = u_isUWhiteSpace(cur_unicode_char);
-    if (is_white_space ||
-        fast_wordpiece_tokenizer_utils::IsPunctuationOrChineseChar(
-            cur_unicode_char) ||
-        (cur_pos && fast_wordpiece_tokenizer_utils::IsPunctuationOrChineseChar(
-                        prev_unicode_char))) {
+    bool is_white_space = IsWhiteSpace(cur_unicode_char);
+    if (is_white_space || IsPunctuationOrChineseChar(cur_unicode_char) ||
+        (cur_pos && IsPunctuationOrChineseChar(prev_unicode_char))) {
       // If the current Unicode character is a valid word boundary, collect the
       // remaining tokens stored on a path on the trie.
       absl::string_view cur_str = absl::string_view(
           input_substr.data(), cur_pos - input_word_offset_in_text);
       HandleTheRemainingStringOnTriePath<kGetPieces, kGetIds, kGetOffsets>(
           cur_str, input_word_offset_in_text, cur_node, original_num_tokens,
-          cur_offset_in_input_word, output_pieces, output_ids,
-          output_start_offsets, output_end_offsets);
+          cur_offset_in_input_word, output);
       if (is_white_space) {
         // Skip the whitespace.
         cur_pos = next_pos;
@@ -293,8 +883,7 @@ void FastWordpieceTokenizer::TokenizeTextImpl(
         cur_pos = next_pos;
         ResetOutputAppendUnknownToken<kGetPieces, kGetIds, kGetOffsets>(
             input_word_offset_in_text, (cur_pos - input_word_offset_in_text),
-            original_num_tokens, output_pieces, output_ids,
-            output_start_offsets, output_end_offsets);
+            original_num_tokens, output);
       }
       // Continue in the outer while loop to process the remaining input.
       continue;
@@ -315,8 +904,7 @@ void FastWordpieceTokenizer::TokenizeTextImpl(
     // portion, and continue.
     ResetOutputAppendUnknownToken<kGetPieces, kGetIds, kGetOffsets>(
         input_word_offset_in_text, (end_of_word - input_word_offset_in_text),
-        original_num_tokens, output_pieces, output_ids, output_start_offsets,
-        output_end_offsets);
+        original_num_tokens, output);
   }
 }
 // This function implements the new linear WordPiece algorithm. The overall
@@ -363,12 +951,10 @@ void FastWordpieceTokenizer::TokenizeTextImpl(
 //    smart enough to set itself into such a state as if it has only seen and
 //    matched "##ef" so far. Now given the next character being "z", it
 //    immediately identifies the next matching token as "##efz".
-template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
 void FastWordpieceTokenizer::TokenizeSingleWordImpl(
     absl::string_view input_word, int input_word_offset_in_text,
-    std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-    std::vector<int>* output_start_offsets,
-    std::vector<int>* output_end_offsets) const {
+    OutputT& output) const {
   static_assert(kGetPieces || kGetIds,
                 "At least one of `kGetPieces` and `kGetIds` should be true.");
   if (input_word.empty()) {
@@ -381,15 +967,13 @@ void FastWordpieceTokenizer::TokenizeSingleWordImpl(
   // `input_word` into word piece tokens and append the recognized tokens to the
   // outputs on the fly. If we later find out that `input_word` cannot be
   // tokenized into sub-tokens with the current vocabulary, we roll-back the
-  // output vectors (by removing those tentative tokens) based on
+  // output (by removing those tentative tokens) based on
   // `original_num_tokens` and appends the "unk_token".
-  int original_num_tokens =
-      GetCurrentOutputSize<kGetPieces>(output_pieces, output_ids);
+  int original_num_tokens = output.size();
 
   if (input_word.size() > config_->max_bytes_per_token()) {
     ResetOutputAppendUnknownToken<kGetPieces, kGetIds, kGetOffsets>(
-        input_word_offset_in_text, input_size, original_num_tokens,
-        output_pieces, output_ids, output_start_offsets, output_end_offsets);
+        input_word_offset_in_text, input_size, original_num_tokens, output);
     return;
   }
 
@@ -482,16 +1066,14 @@ void FastWordpieceTokenizer::TokenizeSingleWordImpl(
       if (!TryFollowFailureLinkAndCollectTokens<kGetPieces, kGetIds,
                                                 kGetOffsets>(
               input_word, input_word_offset_in_text, cur_offset_in_input_word,
-              cur_node, output_pieces, output_ids, output_start_offsets,
-              output_end_offsets)) {
+              cur_node, output)) {
         // If unable to follow the failure link, it means that the current trie
         // node doesn't have any matching prefix vocab tokens to pop. Since the
         // next character is not associated with a valid trie edge, the entire
         // word cannot be tokenized.
         ResetOutputAppendUnknownToken<kGetPieces, kGetIds, kGetOffsets>(
             input_word_offset_in_text, input_size, original_num_tokens,
-            output_pieces, output_ids, output_start_offsets,
-            output_end_offsets);
+            output);
         return;
       }
     }
@@ -502,19 +1084,16 @@ void FastWordpieceTokenizer::TokenizeSingleWordImpl(
   // determine that the word cannot be tokenized.
   HandleTheRemainingStringOnTriePath<kGetPieces, kGetIds, kGetOffsets>(
       input_word, input_word_offset_in_text, cur_node, original_num_tokens,
-      cur_offset_in_input_word, output_pieces, output_ids, output_start_offsets,
-      output_end_offsets);
+      cur_offset_in_input_word, output);
 }
 
-template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
 ABSL_ATTRIBUTE_ALWAYS_INLINE bool
 FastWordpieceTokenizer::TryFollowFailureLinkAndCollectTokens(
     absl::string_view input_word, int input_word_offset_in_text,
     int& cur_offset_in_input_word,
     trie_utils::DartsCloneTrieWrapper::TraversalCursor& node,
-    std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-    std::vector<int>* output_start_offsets,
-    std::vector<int>* output_end_offsets) const {
+    OutputT& output) const {
   int cur_node_data;
   if (trie_->TryGetData(node, cur_node_data)) {
     // A shortcut to get f(cur_node) (i.e., the failure link) and F(cur_node)
@@ -522,8 +1101,7 @@ FastWordpieceTokenizer::TryFollowFailureLinkAndCollectTokens(
     // speedup (statistically significant).
     AppendTokenToOutput<kGetPieces, kGetIds, kGetOffsets>(
         input_word, input_word_offset_in_text, cur_offset_in_input_word,
-        cur_node_data, output_pieces, output_ids, output_start_offsets,
-        output_end_offsets);
+        cur_node_data, output);
     // Transit through the failure link.
     trie_->SetTraversalCursor(
         node,
@@ -541,16 +1119,22 @@ FastWordpieceTokenizer::TryFollowFailureLinkAndCollectTokens(
   // Collect the tokens (i.e., failure pops), represented by (offset, length) in
   // a failure_pops pool (held by the config flatbuffer).
   int failure_pops_offset, failure_pops_length;
-  fast_wordpiece_tokenizer_utils::GetFailurePopsOffsetAndLength(
-      node_aux->failure_pops_offset_length(), failure_pops_offset,
-      failure_pops_length);
+  if (ABSL_PREDICT_FALSE(wide_tokens_ != nullptr)) {
+    fast_wordpiece_tokenizer_utils::GetWideFailurePopsOffsetAndLength(
+        node_aux->failure_pops_offset_length(),
+        config_->failure_pops_pool()->data(), failure_pops_offset,
+        failure_pops_length);
+  } else {
+    fast_wordpiece_tokenizer_utils::GetFailurePopsOffsetAndLength(
+        node_aux->failure_pops_offset_length(), failure_pops_offset,
+        failure_pops_length);
+  }
   const int failure_pops_end_offset = failure_pops_offset + failure_pops_length;
   for (int offset_in_pool = failure_pops_offset;
        offset_in_pool < failure_pops_end_offset; ++offset_in_pool) {
     AppendTokenToOutput<kGetPieces, kGetIds, kGetOffsets>(
         input_word, input_word_offset_in_text, cur_offset_in_input_word,
-        config_->failure_pops_pool()->Get(offset_in_pool), output_pieces,
-        output_ids, output_start_offsets, output_end_offsets);
+        config_->failure_pops_pool()->Get(offset_in_pool), output);
   }
 
   // Transit through the failure link.
@@ -558,67 +1142,59 @@ FastWordpieceTokenizer::TryFollowFailureLinkAndCollectTokens(
   return true;
 }
 
-template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
 void FastWordpieceTokenizer::AppendTokenToOutput(
     absl::string_view input_word, int input_word_offset_in_text,
     int& cur_offset_in_input_word, int encoded_token_value,
-    std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-    std::vector<int>* output_start_offsets,
-    std::vector<int>* output_end_offsets) const {
-  auto token_id =
-      fast_wordpiece_tokenizer_utils::GetTokenId(encoded_token_value);
-  if constexpr (kGetIds) {
-    output_ids->push_back(token_id);
-  }
+    OutputT& output) const {
+  auto token_id = GetTokenId(encoded_token_value);
   if constexpr (kGetPieces || kGetOffsets) {
     // For suffix tokens, the length below is without the suffix indicator.
-    int token_substr_length =
-        fast_wordpiece_tokenizer_utils::GetTokenLength(encoded_token_value);
-    if (!cur_offset_in_input_word &&
-        fast_wordpiece_tokenizer_utils::IsSuffixToken(encoded_token_value)) {
+    int token_substr_length = GetTokenLength(encoded_token_value);
+    if (!cur_offset_in_input_word && IsSuffixToken(encoded_token_value)) {
       // This is a special case where `input_word` happens to start with the
       // suffix indicator (e.g., "##") and a suffix token is recognized at the
       // start (since `cur_offset_input_word == 0`). In this case, we need
       // to adjust and add the length of the suffix indicator string.
       token_substr_length += config_->suffix_indicator()->size();
     }
+    absl::string_view piece_prefix;
+    absl::string_view subword_str;
     if constexpr (kGetPieces) {
       // If token id is unk_token_id, it means that it is a dummy node for
       // punctuations that are not contained in the vocabulary, we append
       // the unk_token in this case. Otherwise, we
       // get the subword string from `input_word` by the offset and length.
-      auto unk_token = config_->unk_token()->string_view();
-      auto subword_str =
+      subword_str =
           (token_id == config_->unk_token_id())
-              ? absl::string_view(unk_token.data(), unk_token.size())
+              ? config_->unk_token()->string_view()
               : absl::string_view(input_word.data() + cur_offset_in_input_word,
                                   token_substr_length);
-      output_pieces->emplace_back(
-          cur_offset_in_input_word
-              ? absl::StrCat(config_->suffix_indicator()->str(), subword_str)
-              : subword_str);
-    }
-    if constexpr (kGetOffsets) {
-      // Record the offsets relative to the start of the whole text.
-      output_start_offsets->push_back(input_word_offset_in_text +
-                                      cur_offset_in_input_word);
-      output_end_offsets->push_back(input_word_offset_in_text +
-                                    cur_offset_in_input_word +
-                                    token_substr_length);
+      if (cur_offset_in_input_word) {
+        piece_prefix = config_->suffix_indicator()->string_view();
+      }
     }
+    // Record the offsets relative to the start of the whole text.
+    output.template Append<kGetPieces, kGetIds, kGetOffsets>(
+        token_id, input_word_offset_in_text + cur_offset_in_input_word,
+        input_word_offset_in_text + cur_offset_in_input_word +
+            token_substr_length,
+        piece_prefix, subword_str);
     cur_offset_in_input_word += token_substr_length;
+  } else {
+    output.template Append<kGetPieces, kGetIds, kGetOffsets>(
+        token_id, /*start_offset=*/0, /*end_offset=*/0,
+        /*piece_prefix=*/absl::string_view(), /*piece=*/absl::string_view());
   }
 }
 
-template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
 ABSL_ATTRIBUTE_ALWAYS_INLINE void
 FastWordpieceTokenizer::HandleTheRemainingStringOnTriePath(
     absl::string_view input_word, int input_word_offset_in_text,
     trie_utils::DartsCloneTrieWrapper::TraversalCursor& cur_node,
     int& original_num_tokens, int& cur_offset_in_input_word,
-    std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-    std::vector<int>* output_start_offsets,
-    std::vector<int>* output_end_offsets) const {
+    OutputT& output) const {
   if (cur_node.node_id == trie_utils::DartsCloneTrieWrapper::kRootNodeId) {
     // We've seen an empty input word. Just return.
     return;
@@ -628,10 +1204,8 @@ FastWordpieceTokenizer::HandleTheRemainingStringOnTriePath(
   if (TryHandleTheInputWordBeingSuffixIndicatorItself<kGetPieces, kGetIds,
                                                       kGetOffsets>(
           input_word, input_word_offset_in_text, cur_node,
-          cur_offset_in_input_word, original_num_tokens, output_pieces,
-          output_ids, output_start_offsets, output_end_offsets)) {
-    original_num_tokens =
-        GetCurrentOutputSize<kGetPieces>(output_pieces, output_ids);
+          cur_offset_in_input_word, original_num_tokens, output)) {
+    original_num_tokens = output.size();
     return;
   }
 
@@ -651,59 +1225,43 @@ FastWordpieceTokenizer::HandleTheRemainingStringOnTriePath(
          cur_node.node_id != config_->trie_punct_failure_link_node()) {
     if (!TryFollowFailureLinkAndCollectTokens<kGetPieces, kGetIds, kGetOffsets>(
             input_word, input_word_offset_in_text, cur_offset_in_input_word,
-            cur_node, output_pieces, output_ids, output_start_offsets,
-            output_end_offsets)) {
+            cur_node, output)) {
       // The remaining string cannot be tokenized, neither can the input word.
       ResetOutputAppendUnknownToken<kGetPieces, kGetIds, kGetOffsets>(
           input_word_offset_in_text, input_word.size(), original_num_tokens,
-          output_pieces, output_ids, output_start_offsets, output_end_offsets);
+          output);
       return;
     }
   }
   // Arrive at `trie_suffix_root_`.
 
   // Update the `original_num_tokens`.
-  original_num_tokens =
-      GetCurrentOutputSize<kGetPieces>(output_pieces, output_ids);
+  original_num_tokens = output.size();
 
   // Succeed and exit.
 }
 
-template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
 void FastWordpieceTokenizer::ResetOutputAppendUnknownToken(
     int input_word_offset_in_text, int input_size, int& original_num_tokens,
-    std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-    std::vector<int>* output_start_offsets,
-    std::vector<int>* output_end_offsets) const {
-  if constexpr (kGetPieces) {
-    output_pieces->resize(original_num_tokens + 1);
-    output_pieces->back() = config_->unk_token()->str();
-  }
-  if constexpr (kGetIds) {
-    output_ids->resize(original_num_tokens + 1);
-    output_ids->back() = config_->unk_token_id();
-  }
-  if constexpr (kGetOffsets) {
-    output_start_offsets->resize(original_num_tokens + 1);
-    output_start_offsets->back() = input_word_offset_in_text;
-
-    output_end_offsets->resize(original_num_tokens + 1);
-    output_end_offsets->back() = input_word_offset_in_text + input_size;
-  }
+    OutputT& output) const {
+  output.Truncate(original_num_tokens);
+  output.template Append<kGetPieces, kGetIds, kGetOffsets>(
+      config_->unk_token_id(), input_word_offset_in_text,
+      input_word_offset_in_text + input_size,
+      /*piece_prefix=*/absl::string_view(), config_->unk_token()->string_view());
 
   // Update `original_num_tokens` (since we have appended the "unk_token").
   ++original_num_tokens;
 }
 
-template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
 ABSL_ATTRIBUTE_ALWAYS_INLINE bool
 FastWordpieceTokenizer::TryHandleTheInputWordBeingSuffixIndicatorItself(
     absl::string_view input_word, int input_word_offset_in_text,
     const trie_utils::DartsCloneTrieWrapper::TraversalCursor& cur_node,
     int& cur_offset_in_input_word, int original_num_tokens,
-    std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-    std::vector<int>* output_start_offsets,
-    std::vector<int>* output_end_offsets) const {
+    OutputT& output) const {
   // Handle the special case where the input word is the suffix indicator (e.g.,
   // "##") itself. This is because that, after all the characters of an input
   // word were successfully processed, if we ended by standing at
@@ -714,23 +1272,20 @@ FastWordpieceTokenizer::TryHandleTheInputWordBeingSuffixIndicatorItself(
     // The input word is not the suffix indicator itself.
     return false;
   }
-  int cur_num_tokens =
-      GetCurrentOutputSize<kGetPieces>(output_pieces, output_ids);
-  if (cur_num_tokens != original_num_tokens) {
+  if (output.size() != original_num_tokens) {
     // The input word is not the suffix indicator itself.
     return false;
   }
 
   // The input word is the suffix indicator itself. Next we handle two cases.
   if (config_->precomputed_result_for_suffix_indicator()->size() == 1 &&
-      fast_wordpiece_tokenizer_utils::GetTokenId(
-          config_->precomputed_result_for_suffix_indicator()->Get(0)) ==
+      GetTokenId(config_->precomputed_result_for_suffix_indicator()->Get(0)) ==
           config_->unk_token_id()) {
     // Case 1: The suffix indicator string cannot be tokenized but has to be
     // mapped to unk_token.
     ResetOutputAppendUnknownToken<kGetPieces, kGetIds, kGetOffsets>(
         input_word_offset_in_text, input_word.size(), original_num_tokens,
-        output_pieces, output_ids, output_start_offsets, output_end_offsets);
+        output);
     return true;
   }
 
@@ -739,10 +1294,29 @@ FastWordpieceTokenizer::TryHandleTheInputWordBeingSuffixIndicatorItself(
        *config_->precomputed_result_for_suffix_indicator()) {
     AppendTokenToOutput<kGetPieces, kGetIds, kGetOffsets>(
         input_word, input_word_offset_in_text, cur_offset_in_input_word,
-        encoded_token_value, output_pieces, output_ids, output_start_offsets,
-        output_end_offsets);
+        encoded_token_value, output);
   }
   return true;
 }
+
+#define INSTANTIATE_TOKENIZE_INTO_BUFFER(T)                                   \
+  template void FastWordpieceTokenizer::TokenizeIntoBuffer<false, false, T>(  \
+      absl::string_view, TokenBufferWriter<T>&, int, bool*, int, bool*)       \
+      const;                                                                  \
+  template void FastWordpieceTokenizer::TokenizeIntoBuffer<false, true, T>(   \
+      absl::string_view, TokenBufferWriter<T>&, int, bool*, int, bool*)       \
+      const;                                                                  \
+  template void FastWordpieceTokenizer::TokenizeIntoBuffer<true, false, T>(   \
+      absl::string_view, TokenBufferWriter<T>&, int, bool*, int, bool*)       \
+      const;                                                                  \
+  template void FastWordpieceTokenizer::TokenizeIntoBuffer<true, true, T>(    \
+      absl::string_view, TokenBufferWriter<T>&, int, bool*, int, bool*)       \
+      const;
+
+INSTANTIATE_TOKENIZE_INTO_BUFFER(int32_t)
+INSTANTIATE_TOKENIZE_INTO_BUFFER(int64_t)
+
+#undef INSTANTIATE_TOKENIZE_INTO_BUFFER
+
 }  // namespace text
 }  // namespace tensorflow
@@ -15,18 +15,110 @@
 #ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_H_
 #define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 
+#include "absl/base/optimization.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tensorflow_text/core/kernels/darts_clone_trie_wrapper.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_model_generated.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_utils.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_word_cache.h"
 
 namespace tensorflow {
 namespace text {
 
+// Writes the output of FastWordpieceTokenizer directly into caller-owned,
+// preallocated buffers (e.g., the memory of the output tensors of an op
+// kernel), without creating any std::string or std::vector per token.
+//
+// Tokens are written at consecutive positions starting from 0, across all the
+// calls to FastWordpieceTokenizer::TokenizeIntoBuffer() with the same writer.
+// Positions at or after `capacity` are not written, but are still counted by
+// size(). Hence, a writer constructed without buffers only counts the tokens,
+// which can be used in a first pass to compute the sizes of the buffers.
+template <typename T>
+class TokenBufferWriter {
+ public:
+  // Called to write the token string at position `index`. The token string is
+  // the concatenation of `piece_prefix` (e.g., the suffix indicator "##") and
+  // `piece`.
+  using PieceWriter = absl::FunctionRef<void(
+      int index, absl::string_view piece_prefix, absl::string_view piece)>;
+
+  // Creates a writer that only counts the tokens.
+  TokenBufferWriter() = default;
+
+  // Creates a writer that writes up to `capacity` tokens. A buffer (or
+  // `piece_writer`) only needs to be valid when the corresponding output is
+  // requested from FastWordpieceTokenizer::TokenizeIntoBuffer(). The buffers
+  // are not owned and must hold at least `capacity` elements.
+  TokenBufferWriter(int capacity, T* output_ids, T* output_start_offsets,
+                    T* output_end_offsets,
+                    PieceWriter piece_writer = &IgnorePiece)
+      : capacity_(capacity),
+        output_ids_(output_ids),
+        output_start_offsets_(output_start_offsets),
+        output_end_offsets_(output_end_offsets),
+        piece_writer_(piece_writer) {}
+
+  // Returns the number of tokens written so far.
+  int size() const { return size_; }
+
+  // Drops all the tokens after the first `size` ones.
+  void Truncate(int size) { size_ = size; }
+
+  // Replaces each offset of the tokens written from position `first` on with
+  // `map(offset)`, e.g., to map offsets in a normalized text back to the
+  // original text. Does nothing if the offsets are not written.
+  template <typename MapFn>
+  void MapOffsets(int first, MapFn map) {
+    if (output_start_offsets_ == nullptr) return;
+    const int end = std::min(size_, capacity_);
+    for (int i = first; i < end; ++i) {
+      output_start_offsets_[i] = map(output_start_offsets_[i]);
+      output_end_offsets_[i] = map(output_end_offsets_[i]);
+    }
+  }
+
+  // Appends a token.
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+  void Append(int token_id, int start_offset, int end_offset,
+              absl::string_view piece_prefix, absl::string_view piece) {
+    if (size_ < capacity_) {
+      if constexpr (kGetIds) {
+        output_ids_[size_] = token_id;
+      }
+      if constexpr (kGetOffsets) {
+        output_start_offsets_[size_] = start_offset;
+        output_end_offsets_[size_] = end_offset;
+      }
+      if constexpr (kGetPieces) {
+        piece_writer_(size_, piece_prefix, piece);
+      }
+    }
+    ++size_;
+  }
+
+ private:
+  static void IgnorePiece(int index, absl::string_view piece_prefix,
+                          absl::string_view piece) {}
+
+  int size_ = 0;
+  int capacity_ = 0;
+  T* output_ids_ = nullptr;
+  T* output_start_offsets_ = nullptr;
+  T* output_end_offsets_ = nullptr;
+  PieceWriter piece_writer_ = &IgnorePiece;
+};
+
 // Applies WordPiece tokenization with an existing WordPiece vocabulary.
 //
 // Example:
@@ -42,6 +134,41 @@ namespace text {
 // https://github.com/tensorflow/tensor2tensor/blob/master/tensor2tensor/data_generators/text_encoder.py
 class FastWordpieceTokenizer {
  public:
+  // The state of a streaming tokenization, i.e., of a text given in
+  // consecutive chunks to TokenizeChunk() (see there).
+  class StreamState {
+   public:
+    // The default bound on `num_pending_bytes()`.
+    static constexpr int kDefaultMaxPendingBytes = 1 << 16;
+
+    StreamState() = default;
+
+    // Creates a state that keeps at most `max_pending_bytes` bytes of text
+    // until the next chunk (see TokenizeChunk()). Must be at least 8.
+    explicit StreamState(int max_pending_bytes)
+        : max_pending_bytes_(max_pending_bytes) {}
+
+    // The number of bytes of the text given so far.
+    int num_bytes() const { return num_bytes_; }
+
+    // The number of bytes of the text given so far that are not tokenized yet.
+    int num_pending_bytes() const { return pending_text_.size(); }
+
+   private:
+    friend class FastWordpieceTokenizer;
+
+    // The end of the text given so far that is not tokenized yet, since it may
+    // be the start of a word that continues in the next chunk. For models for
+    // single words, only its first `max_bytes_per_token + 1` bytes are kept:
+    // longer words are mapped to unk_token anyway.
+    std::string pending_text_;
+    int num_bytes_ = 0;
+    int max_pending_bytes_ = kDefaultMaxPendingBytes;
+  };
+
+  // The value of `max_num_tokens` in `Tokenize` for no limit.
+  static constexpr int kNoTokenLimit = std::numeric_limits<int>::max();
+
   // Creates an instance.
   //
   // Args:
@@ -51,6 +178,15 @@ class FastWordpieceTokenizer {
   static absl::StatusOr<FastWordpieceTokenizer> Create(
       const void* config_flatbuffer);
 
+  // Attaches `word_cache` (not owned; may be nullptr to detach) to this
+  // instance. When attached, the tokenization of each word is looked up in
+  // `word_cache` first, and added to it on a miss. In the end-to-end mode, only
+  // the words of ASCII characters are cached. The results are the same with or
+  // without the cache, as long as `word_cache` is only used with this model.
+  void SetWordCache(FastWordpieceWordCache* word_cache) {
+    word_cache_ = word_cache;
+  }
+
   // Tokenizes `input` into its word pieces (i.e., subword tokens) and
   // appends the new tokens to the end of the outputs.
   // When `config_->end_to_end() is `false`, `input` should be a single
@@ -74,23 +210,96 @@ class FastWordpieceTokenizer {
   //    the whole text. Only used when not using end-to-end tokenizer.
   //  * error: If not null, this will be set to true if the tokenizer failed to
   //    make progress in decoding the input.
+  //  * max_num_tokens: The maximum number of tokens to append (non-negative).
+  //    For general text, the tokenization stops at the first word boundary
+  //    where this many tokens are reached, so its cost depends on the number
+  //    of tokens kept rather than on the length of `input`.
+  //  * truncated: If not null, this will be set to true if `input` has more
+  //    than `max_num_tokens` tokens, i.e., if the output is truncated.
   // Note: the start offsets are inclusive and the end offsets are exclusive.
   void Tokenize(absl::string_view input,
                 std::vector<std::string>* output_pieces,
                 std::vector<int>* output_ids,
                 std::vector<int>* output_start_offsets,
                 std::vector<int>* output_end_offsets,
-                int input_word_offset_in_text = 0, bool* error = nullptr) const;
+                int input_word_offset_in_text = 0, bool* error = nullptr,
+                int max_num_tokens = kNoTokenLimit,
+                bool* truncated = nullptr) const;
 
   // An override not returning `output_pieces`.
   void Tokenize(absl::string_view input, std::vector<int>* output_ids,
                 std::vector<int>* output_start_offsets,
                 std::vector<int>* output_end_offsets,
-                int input_word_offset_in_text = 0) const;
+                int input_word_offset_in_text = 0, bool* error = nullptr,
+                int max_num_tokens = kNoTokenLimit,
+                bool* truncated = nullptr) const;
 
   // An override only returning `output_ids`.
   void Tokenize(absl::string_view input, std::vector<int>* output_ids,
-                int input_word_offset_in_text = 0) const;
+                int input_word_offset_in_text = 0, bool* error = nullptr,
+                int max_num_tokens = kNoTokenLimit,
+                bool* truncated = nullptr) const;
+
+  // Tokenizes `input` and writes the token ids (plus the token strings if
+  // `kGetPieces` and the offsets if `kGetOffsets`) into `output`, instead of
+  // appending them to std::vectors. Otherwise the same as `Tokenize`.
+  //
+  // Explicitly instantiated for `T` being int32_t and int64_t.
+  template <bool kGetPieces, bool kGetOffsets, typename T>
+  void TokenizeIntoBuffer(absl::string_view input,
+                          TokenBufferWriter<T>& output,
+                          int input_word_offset_in_text = 0,
+                          bool* error = nullptr,
+                          int max_num_tokens = kNoTokenLimit,
+                          bool* truncated = nullptr) const;
+
+  // Tokenizes the next `chunk` of a text given in consecutive chunks (e.g., a
+  // document read from a file), and appends the tokens that are final to the
+  // end of the outputs. The offsets are in the whole text. `state` must be the
+  // same for all the chunks of the text, starting from a default-constructed
+  // one. Call FinishStream() after the last chunk.
+  //
+  // Chunks may end anywhere, even in the middle of a UTF-8 character. The
+  // tokens of a word are final once the word is followed by a whitespace, so
+  // the end of the chunk after its last whitespace is kept in `state` until the
+  // next chunk. A run of text without whitespaces longer than the
+  // `max_pending_bytes` of `state` is tokenized early, cut right after one of
+  // its last punctuation or Chinese characters, or else at a character
+  // boundary. Hence, the memory used is bounded by the size of the chunks
+  // plus `max_pending_bytes`. When `config_->end_to_end()` is `false`, the
+  // whole text is a single word, which is tokenized by FinishStream().
+  //
+  // The result is the same as tokenizing the whole text at once with
+  // `Tokenize`, as long as no vocab token contains a whitespace and the text
+  // has no run without whitespaces longer than `max_pending_bytes`.
+  void TokenizeChunk(absl::string_view chunk, StreamState& state,
+                     std::vector<std::string>* output_pieces,
+                     std::vector<int>* output_ids,
+                     std::vector<int>* output_start_offsets,
+                     std::vector<int>* output_end_offsets,
+                     bool* error = nullptr) const;
+
+  // An override not returning `output_pieces`.
+  void TokenizeChunk(absl::string_view chunk, StreamState& state,
+                     std::vector<int>* output_ids,
+                     std::vector<int>* output_start_offsets,
+                     std::vector<int>* output_end_offsets,
+                     bool* error = nullptr) const;
+
+  // Tokenizes the rest of the text of `state` (see TokenizeChunk()), appends
+  // the tokens to the end of the outputs, and resets `state` for a new text.
+  void FinishStream(StreamState& state,
+                    std::vector<std::string>* output_pieces,
+                    std::vector<int>* output_ids,
+                    std::vector<int>* output_start_offsets,
+                    std::vector<int>* output_end_offsets,
+                    bool* error = nullptr) const;
+
+  // An override not returning `output_pieces`.
+  void FinishStream(StreamState& state, std::vector<int>* output_ids,
+                    std::vector<int>* output_start_offsets,
+                    std::vector<int>* output_end_offsets,
+                    bool* error = nullptr) const;
 
   // Detokenizes wordpiece ids into a vector of tokens.
   absl::StatusOr<std::vector<std::string>> DetokenizeToTokens(
@@ -103,40 +312,106 @@ class FastWordpieceTokenizer {
   absl::StatusOr<std::string> Detokenize(
       const absl::Span<const int> input) const;
 
+  // Detokenizes a batch of rows of wordpiece ids, where the ids of row `i` are
+  // `input[row_splits[i], row_splits[i + 1])`. The text of each row, the same
+  // as Detokenize() of the row, is appended to the end of `output_texts`, and
+  // its end in `output_texts` is appended to `output_text_ends`.
+  //
+  // The vocab strings are copied straight into `output_texts`, which is
+  // allocated at most once, so there is no allocation per token or per row.
+  absl::Status DetokenizeBatch(absl::Span<const int> input,
+                               absl::Span<const int64_t> row_splits,
+                               std::string* output_texts,
+                               std::vector<int64_t>* output_text_ends) const;
+
  private:
   // The actual implementation of `Tokenize` when configured for single words.
   //
   // The template parameters `kGetPieces`, `kGetIds', and `kGetOffsets` control
   // which parts of the output we generate. At least one of `kGetPieces` and
   // `kGetIds` should be true.
-  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+  //
+  // `OutputT` is where the tokens are written to. It is either a
+  // TokenBufferWriter, or a thin wrapper around the output std::vectors of
+  // `Tokenize` (see fast_wordpiece_tokenizer.cc). It provides `size()`,
+  // `Truncate()`, and `Append()` (see TokenBufferWriter).
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
   void TokenizeSingleWordImpl(absl::string_view input_word,
                               int input_word_offset_in_text,
-                              std::vector<std::string>* output_pieces,
-                              std::vector<int>* output_ids,
-                              std::vector<int>* output_start_offsets,
-                              std::vector<int>* output_end_offsets) const;
+                              OutputT& output) const;
 
   // The actual implementation of `Tokenize` when configured for general texts.
   //
   // The work of this method is equivalent to first splitting `input_text` into
   // words (by splitting on punctuation and whitespaces, and next running
   // `TokenizeSingleWordImpl` on each word.
-  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
-  void TokenizeTextImpl(absl::string_view input_text,
-                        std::vector<std::string>* output_pieces,
-                        std::vector<int>* output_ids,
-                        std::vector<int>* output_start_offsets,
-                        std::vector<int>* output_end_offsets,
+  //
+  // Stops at the first word boundary where `output` has at least
+  // `max_output_size` tokens, and then sets `truncated` (if not null) to true
+  // if the rest of `input_text` has more tokens. The tokens beyond
+  // `max_output_size` are left in `output`.
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+  void TokenizeTextImpl(absl::string_view input_text, OutputT& output,
+                        bool* error, int max_output_size = kNoTokenLimit,
+                        bool* truncated = nullptr) const;
+
+  // Same as `TokenizeSingleWordImpl`, but looks `input_word` up in
+  // `word_cache_` (which should not be null) first, and caches the result on a
+  // miss.
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+  void TokenizeSingleWordWithCache(absl::string_view input_word,
+                                   int input_word_offset_in_text,
+                                   OutputT& output) const;
+
+  // Dispatches to `TokenizeTextImpl` or `TokenizeSingleWordImpl` depending on
+  // `config_->end_to_end()`, and truncates the output to `max_num_tokens` new
+  // tokens.
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+  void TokenizeImpl(absl::string_view input, int input_word_offset_in_text,
+                    int max_num_tokens, OutputT& output, bool* error,
+                    bool* truncated) const;
+
+  // Calls `append(piece)` on each piece of the detokenized text of `input`
+  // (see Detokenize()), in order. Returns an error if an id is not in the
+  // vocab. Requires `config_->support_detokenization()`.
+  template <typename AppendFn>
+  absl::Status ForEachDetokenizedPiece(absl::Span<const int> input,
+                                       AppendFn append) const;
+
+  // The actual implementations of TokenizeChunk() and FinishStream().
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+  void TokenizeChunkImpl(absl::string_view chunk, StreamState& state,
+                         OutputT& output, bool* error) const;
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+  void FinishStreamImpl(StreamState& state, OutputT& output,
                         bool* error) const;
 
+  // Tokenizes the start of the pending text of `state` if it is longer than
+  // its `max_pending_bytes_` (see TokenizeChunk()).
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+  void FlushLongPendingText(StreamState& state, OutputT& output,
+                            bool* error) const;
+
+  // Returns the position (in bytes) immediately after the last whitespace of
+  // `input`, or 0 if there is none.
+  int FindEndOfLastWhiteSpace(absl::string_view input) const;
+
+  // Returns the position (in bytes) immediately after the first whitespace of
+  // `input`, or the size of `input` if there is none.
+  int FindEndOfFirstWhiteSpace(absl::string_view input) const;
+
+  // Returns where to cut `input`, a run of text without whitespaces, so that
+  // at most about `max_kept` bytes are after the cut: immediately after its
+  // last punctuation or Chinese character in that range if any, or else at the
+  // start of its last character, which may be incomplete.
+  int FindCutInRun(absl::string_view input, int max_kept) const;
+
   // Try following the failure link to make the transition when trie matching
   // fails.
   //
   // If f(node) (i.e., failure link) is not null, it does the following:
-  //  (1) collects tokens F(node) (i.e., failure pops) and appends to the end of
-  //      `output_ids`, `output_pieces`, and/or `output_start_offsets` and
-  //      `output_end_offsets`,
+  //  (1) collects tokens F(node) (i.e., failure pops) and appends them to
+  //      `output`,
   //  (2) moves `cur_offset_in_input_word` accordingly to pass the collected
   //      tokens when `kGetPieces=true` or `kGetOffsets=true`, in order to
   //      calculate the start/end offsets of tokens and to get the token
@@ -152,14 +427,12 @@ class FastWordpieceTokenizer {
   //    collected in this function. This value is used if 'kGetPieces=true' or
   //    'kGetOffsets=true', and when so, this value will be updated accordingly
   //    after the new word piece tokens have been appended to the output.
-  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
   bool TryFollowFailureLinkAndCollectTokens(
       absl::string_view input_word, int input_word_offset_in_text,
       int& cur_offset_in_input_word,
       trie_utils::DartsCloneTrieWrapper::TraversalCursor& node,
-      std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-      std::vector<int>* output_start_offsets,
-      std::vector<int>* output_end_offsets) const;
+      OutputT& output) const;
 
   // Appends a word piece token (represented by `encoded_token_value`) to the
   // output.
@@ -172,15 +445,11 @@ class FastWordpieceTokenizer {
   //    appended to the output.
   //  * encoded_token_value: the encoded value of the word piece token to be
   //    appended. See EncodeToken() in fast_wordpiece_tokenizer_utils.h.
-  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
   void AppendTokenToOutput(absl::string_view input_word,
                            int input_word_offset_in_text,
                            int& cur_offset_in_input_word,
-                           int encoded_token_value,
-                           std::vector<std::string>* output_pieces,
-                           std::vector<int>* output_ids,
-                           std::vector<int>* output_start_offsets,
-                           std::vector<int>* output_end_offsets) const;
+                           int encoded_token_value, OutputT& output) const;
 
   // This method is called when the trie matching loop encounters a word
   // boundary (e.g., the end-of-input). This method segments the remaining
@@ -201,14 +470,12 @@ class FastWordpieceTokenizer {
   // segment "abc" into tokens. It fails since the remaining string "abc" cannot
   // be tokenized into tokens given the vocabulary. In this case, it resets the
   // outputs and appends unk_token at the end as expected.
-  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
   void HandleTheRemainingStringOnTriePath(
       absl::string_view input_word, int input_word_offset_in_text,
       trie_utils::DartsCloneTrieWrapper::TraversalCursor& cur_node,
       int& original_num_tokens, int& cur_offset_in_input_word,
-      std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-      std::vector<int>* output_start_offsets,
-      std::vector<int>* output_end_offsets) const;
+      OutputT& output) const;
 
   // Resets the output and appends unk_token.
   //
@@ -223,35 +490,82 @@ class FastWordpieceTokenizer {
   //  * original_num_tokens: The original number of tokens in the output before
   //    we started the tokenization of the current input word. It is updated
   //    after this method.
-  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
-  void ResetOutputAppendUnknownToken(
-      int input_word_offset_in_text, int input_size, int& original_num_tokens,
-      std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-      std::vector<int>* output_start_offsets,
-      std::vector<int>* output_end_offsets) const;
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
+  void ResetOutputAppendUnknownToken(int input_word_offset_in_text,
+                                     int input_size, int& original_num_tokens,
+                                     OutputT& output) const;
 
   // Try handling the special case when the input word is the suffix indicator
-  // itself. If so, appends the precomputed result to output_pieces and
-  // output_ids, and returns true. Otherwise, it does nothing and returns false.
-  template <bool kGetPieces, bool kGetIds, bool kGetOffsets>
+  // itself. If so, appends the precomputed result to `output` and returns
+  // true. Otherwise, it does nothing and returns false.
+  template <bool kGetPieces, bool kGetIds, bool kGetOffsets, typename OutputT>
   bool TryHandleTheInputWordBeingSuffixIndicatorItself(
       absl::string_view input_word, int input_word_offset_in_text,
       const trie_utils::DartsCloneTrieWrapper::TraversalCursor& cur_node,
       int& cur_offset_in_input_word, int original_num_tokens,
-      std::vector<std::string>* output_pieces, std::vector<int>* output_ids,
-      std::vector<int>* output_start_offsets,
-      std::vector<int>* output_end_offsets) const;
+      OutputT& output) const;
 
   // Returns the position (in bytes) immediately after the end of the word.
   int SkipTheRemainingOfWordAndTrailingWhiteSpaces(absl::string_view input,
                                                    int& cur_pos) const;
 
+  // Same as the helpers with the same names in fast_wordpiece_tokenizer_utils,
+  // but also decode the wide encoding of tokens (if used by the model).
+  int GetTokenId(int encoded_token_value) const {
+    if (ABSL_PREDICT_FALSE(wide_tokens_ != nullptr)) {
+      return wide_tokens_[encoded_token_value].token_id();
+    }
+    return fast_wordpiece_tokenizer_utils::GetTokenId(encoded_token_value);
+  }
+  int GetTokenLength(int encoded_token_value) const {
+    if (ABSL_PREDICT_FALSE(wide_tokens_ != nullptr)) {
+      return wide_tokens_[encoded_token_value].token_length();
+    }
+    return fast_wordpiece_tokenizer_utils::GetTokenLength(encoded_token_value);
+  }
+  bool IsSuffixToken(int encoded_token_value) const {
+    if (ABSL_PREDICT_FALSE(wide_tokens_ != nullptr)) {
+      return wide_tokens_[encoded_token_value].is_suffix_token();
+    }
+    return fast_wordpiece_tokenizer_utils::IsSuffixToken(encoded_token_value);
+  }
+
+  // Same as the helpers with the same names in fast_wordpiece_tokenizer_utils,
+  // but use the code point class table of the model (if any) for non-ASCII
+  // chars instead of ICU.
+  bool IsWhiteSpace(UChar32 char_value) const {
+    if (char_classes_.empty() || (char_value >= 0 && char_value < 0x80)) {
+      return fast_wordpiece_tokenizer_utils::IsWhiteSpace(char_value);
+    }
+    return char_classes_.Get(char_value) ==
+           fast_wordpiece_tokenizer_utils::kWhiteSpaceChar;
+  }
+  bool IsPunctuationOrChineseChar(UChar32 char_value) const {
+    if (char_classes_.empty() || (char_value >= 0 && char_value < 0x80)) {
+      return fast_wordpiece_tokenizer_utils::IsPunctuationOrChineseChar(
+          char_value);
+    }
+    return char_classes_.Get(char_value) >=
+           fast_wordpiece_tokenizer_utils::kPunctuationChar;
+  }
+
   // Points to the FastWordpieceTokenizer config flatbuffer (not owned).
   const FastWordpieceTokenizerConfig* config_ = nullptr;
 
   // A wrapper to access the trie encoded inside the flatbuffer that `config_`
   // points to.
   std::unique_ptr<trie_utils::DartsCloneTrieWrapper> trie_ = nullptr;
+
+  // The code point class table stored in the flatbuffer that `config_` points
+  // to. Empty for models built without it.
+  fast_wordpiece_tokenizer_utils::CharClassTable char_classes_;
+
+  // The `wide_token_array` of the flatbuffer that `config_` points to, or null
+  // for models with the compact encoding of tokens.
+  const WideToken* wide_tokens_ = nullptr;
+
+  // The optional cache of word tokenizations (not owned).
+  FastWordpieceWordCache* word_cache_ = nullptr;
 };
 
 }  // namespace text
@@ -14,14 +14,83 @@
 
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_kernel.h"
 
+#include <cstdint>
+#include <functional>
+
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace text {
+namespace {
 
-REGISTER_KERNEL_BUILDER(Name(FastWordpieceTokenizeWithOffsetsOpKernel::OpName())
-                            .Device(tensorflow::DEVICE_CPU),
-                        FastWordpieceTokenizeWithOffsetsOpKernel);
+auto* word_cache_lookups = monitoring::Counter<1>::New(
+    "/tensorflow/text/fast_wordpiece_word_cache/lookups",
+    "The number of word lookups in the word caches of the "
+    "FastWordpieceTokenizeWithOffsets kernels (see the `word_cache_size` "
+    "attr), by result.",
+    "result");
+
+}  // namespace
+
+template <typename T, typename Tsplits>
+void FastWordpieceTokenizeWithOffsetsOpKernel<T, Tsplits>::Compute(
+    OpKernelContext* c) {
+  const auto& worker_threads = *(c->device()->tensorflow_cpu_worker_threads());
+  BatchShardRunner runner =
+      [&worker_threads](
+          int64_t total, int64_t cost_per_unit,
+          const std::function<void(int64_t start, int64_t limit)>& work) {
+        ::tensorflow::Shard(worker_threads.num_threads,  // max parallelism
+                            worker_threads.workers,      // thread pool
+                            total,  // total number of data to process.
+                            cost_per_unit, work);
+      };
+  // The base class owns and initializes the op implementation.
+  using ImplType = typename FastWordpieceTokenizeWithOffsetsOpKernel::ImplType;
+  auto* op = static_cast<ImplType*>(this->impl_.get());
+  tflite::shim::TfInvokeContext ctx(c);
+  OP_REQUIRES_OK(c, op->Invoke(&ctx, worker_threads.num_threads, runner));
+  if (op->word_cache() != nullptr) {
+    ExportWordCacheLookups(*op->word_cache());
+  }
+}
+
+template <typename T, typename Tsplits>
+void FastWordpieceTokenizeWithOffsetsOpKernel<T, Tsplits>::
+    ExportWordCacheLookups(const FastWordpieceWordCache& word_cache) {
+  // The counters of the cache only grow, so reading them under the lock keeps
+  // the exported deltas non-negative with concurrent calls.
+  mutex_lock lock(export_mu_);
+  const int64_t hits = word_cache.hits();
+  const int64_t misses = word_cache.misses();
+  word_cache_lookups->GetCell("hit")->IncrementBy(hits - exported_hits_);
+  word_cache_lookups->GetCell("miss")->IncrementBy(misses - exported_misses_);
+  exported_hits_ = hits;
+  exported_misses_ = misses;
+}
+
+using FastWordpieceTokenizeWithOffsetsOpKernelInstance =
+    FastWordpieceTokenizeWithOffsetsOpKernel<int64_t, int64_t>;
+
+#define REGISTER_FAST_WORDPIECE_TOKENIZE_SPLITS(out_type, splits_type) \
+  REGISTER_KERNEL_BUILDER(                                             \
+      Name(FastWordpieceTokenizeWithOffsetsOpKernelInstance::OpName()) \
+          .Device(tensorflow::DEVICE_CPU)                              \
+          .TypeConstraint<out_type>("out_type")                        \
+          .TypeConstraint<splits_type>("Tsplits"),                     \
+      FastWordpieceTokenizeWithOffsetsOpKernel<out_type, splits_type>);
+
+#define REGISTER_FAST_WORDPIECE_TOKENIZE(out_type)           \
+  REGISTER_FAST_WORDPIECE_TOKENIZE_SPLITS(out_type, int32_t) \
+  REGISTER_FAST_WORDPIECE_TOKENIZE_SPLITS(out_type, int64_t)
+
+REGISTER_FAST_WORDPIECE_TOKENIZE(int32_t)
+REGISTER_FAST_WORDPIECE_TOKENIZE(int64_t)
+
+#undef REGISTER_FAST_WORDPIECE_TOKENIZE
+#undef REGISTER_FAST_WORDPIECE_TOKENIZE_SPLITS
 
 REGISTER_KERNEL_BUILDER(Name(FastWordpieceDetokenizeOpKernel::OpName())
                             .Device(tensorflow::DEVICE_CPU),
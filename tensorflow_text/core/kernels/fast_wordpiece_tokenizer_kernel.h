@@ -15,16 +15,40 @@
 #ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_KERNEL_H_
 #define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_KERNEL_H_
 
+#include <cstdint>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/lite/kernels/shim/tf_op_shim.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_kernel_template.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_word_cache.h"
 
 namespace tensorflow {
 namespace text {
 
+// Unlike the other shim kernels, this one overrides Compute() to shard the
+// batch across the TF CPU worker threads, with the op implementation owned by
+// TfOpKernel. `T` is the type of the ids and offsets, and `Tsplits` the type of
+// the row splits.
+template <typename T, typename Tsplits>
 class FastWordpieceTokenizeWithOffsetsOpKernel
-    : public tflite::shim::TfOpKernel<FastWordpieceTokenizeWithOffsetsOp> {
+    : public tflite::shim::TfOpKernel<FastWordpieceTokenizeWithOffsetsOp, T,
+                                      Tsplits> {
  public:
-  using TfOpKernel::TfOpKernel;
+  using tflite::shim::TfOpKernel<FastWordpieceTokenizeWithOffsetsOp, T,
+                                 Tsplits>::TfOpKernel;
+
+  void Compute(::tensorflow::OpKernelContext* c) override;
+
+ private:
+  // Adds the word cache lookups since the previous call to the
+  // `/tensorflow/text/fast_wordpiece_word_cache/lookups` monitoring counter.
+  void ExportWordCacheLookups(const FastWordpieceWordCache& word_cache);
+
+  mutex export_mu_;
+  int64_t exported_hits_ TF_GUARDED_BY(export_mu_) = 0;
+  int64_t exported_misses_ TF_GUARDED_BY(export_mu_) = 0;
 };
 
 class FastWordpieceDetokenizeOpKernel
@@ -15,11 +15,23 @@
 #ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_KERNEL_TEMPLATE_H_
 #define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_KERNEL_TEMPLATE_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tensorflow/lite/kernels/shim/op_kernel.h"
 #include "tensorflow/lite/kernels/shim/status_macros.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_word_cache.h"
+#include "tensorflow_text/core/kernels/text_batch_sharding.h"
 
 namespace tensorflow {
 namespace text {
@@ -30,10 +42,13 @@ namespace text {
 // TFLite. See
 // https://github.com/tensorflow/tensorflow/tree/master/tensorflow/lite/kernels/shim
 // for more info on how this works.
-template <tflite::shim::Runtime Rt>
+//
+// `T` is the type of the ids and offsets, and `Tsplits` is the type of the row
+// splits (int32_t or int64_t for both).
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
 class FastWordpieceTokenizeWithOffsetsOp
-    : public tflite::shim::OpKernelShim<FastWordpieceTokenizeWithOffsetsOp,
-                                        Rt> {
+    : public tflite::shim::OpKernelShim<FastWordpieceTokenizeWithOffsetsOp, Rt,
+                                        T, Tsplits> {
  private:
   enum Inputs { kInputValues = 0, kWpModel };
   enum Outputs {
@@ -41,16 +56,18 @@ class FastWordpieceTokenizeWithOffsetsOp
     kOutputIds,
     kOutputRowSplits,
     kStartValues,
-    kEndValues
+    kEndValues,
+    kRowTruncated
   };
 
   using Shape = tflite::shim::Shape;
   using typename tflite::shim::OpKernelShim<FastWordpieceTokenizeWithOffsetsOp,
-                                            Rt>::InitContext;
+                                            Rt, T, Tsplits>::InitContext;
   using typename tflite::shim::OpKernelShim<FastWordpieceTokenizeWithOffsetsOp,
-                                            Rt>::InvokeContext;
+                                            Rt, T, Tsplits>::InvokeContext;
   using typename tflite::shim::OpKernelShim<FastWordpieceTokenizeWithOffsetsOp,
-                                            Rt>::ShapeInferenceContext;
+                                            Rt, T,
+                                            Tsplits>::ShapeInferenceContext;
 
  public:
   FastWordpieceTokenizeWithOffsetsOp() = default;
@@ -80,6 +97,26 @@ class FastWordpieceTokenizeWithOffsetsOp
     Args:
       input_values: 1D Tensor of strings to tokenize with.
       wp_model: Buffer tensor for the FastWordpieceTokenizerConfig flatbuffer.
+      get_subwords: If false, the wordpiece strings are not computed and
+        `output_values` is empty. Useful when only the ids are consumed.
+      get_offsets: If false, the offsets are not computed and `start_values`
+        and `end_values` are empty.
+      in_place_output: If true, tokenizes every input twice: the first pass
+        only counts the wordpieces to size the output tensors, and the second
+        pass writes the wordpieces directly into the output tensors. This
+        avoids creating any intermediate buffer per wordpiece, at the cost of
+        tokenizing twice.
+      word_cache_size: If positive, the tokenization of up to this many words is
+        cached by the kernel, and looked up before tokenizing a word. Useful
+        for natural language text, where a few thousand frequent words make up
+        most of the input. The cache only serves the first `wp_model` the op
+        runs with; the calls with another model do not use it.
+      max_tokens_per_row: If non-negative, at most this many wordpieces are
+        returned for each input string. The tokenization of an input stops at
+        the first word boundary where the budget is reached, so that its cost
+        depends on the budget rather than on the length of the input.
+      out_type: The type of `output_ids`, `start_values` and `end_values`.
+      Tsplits: The type of `output_row_splits`.
 
     Returns:
       * output_values: 1D tensor containing the wordpieces for all input strings.
@@ -95,13 +132,23 @@ class FastWordpieceTokenizeWithOffsetsOp
       * end_values: 1D tensor containing the exclusive end byte offset for
         each wordpiece in all input strings.  Corresponds 1:1 with output_values.
         A 2D RaggedTensor can be constructed from this and output_row_splits.
+      * row_truncated: 1D bool tensor, true for the input strings that have
+        more than `max_tokens_per_row` wordpieces.
   )doc";
 
   static const char* OpName() { return kOpName; }
   static const char* Doc() { return kDoc; }
 
+  static const char kGetSubwordsAttr[];
+  static const char kGetOffsetsAttr[];
+  static const char kInPlaceOutputAttr[];
+  static const char kWordCacheSizeAttr[];
+  static const char kMaxTokensPerRowAttr[];
+  static const char kOutTypeAttr[];
+  static const char kTsplitsAttr[];
+
   // Attributes declaration (syntax: https://www.tensorflow.org/guide/create_op)
-  static std::vector<std::string> Attrs() { return {}; }
+  static std::vector<std::string> Attrs();
 
   // Input tensors declaration (syntax:
   // https://www.tensorflow.org/guide/create_op)
@@ -112,35 +159,214 @@ class FastWordpieceTokenizeWithOffsetsOp
   static std::vector<std::string> Outputs();
 
   // Initializes the op
-  absl::Status Init(InitContext* context) { return absl::OkStatus(); }
+  absl::Status Init(InitContext* context);
 
   // Runs the operation
   absl::Status Invoke(InvokeContext* context);
 
+  // Runs the operation, splitting the batch into blocks of inputs with
+  // roughly the same number of bytes and tokenizing the blocks with `runner`.
+  // Each block is tokenized into its own buffers, which are merged in order,
+  // so the result does not depend on the scheduling of `runner`.
+  absl::Status Invoke(InvokeContext* context, int max_parallelism,
+                      const BatchShardRunner& runner);
+
   // Shape inference
   static absl::Status ShapeInference(ShapeInferenceContext* c);
+
+  // Returns the word cache of this op (e.g., for reading its hit and miss
+  // counters), or nullptr if disabled by the `word_cache_size` attr.
+  const FastWordpieceWordCache* word_cache() const { return word_cache_.get(); }
+
+ private:
+  // Rough cost of tokenizing one row, in the unit of ::tensorflow::Shard's
+  // cost_per_unit (about 1ns).
+  static constexpr TextRowCost kTokenizeCost = {/*per_row=*/50,
+                                                /*per_byte=*/50};
+
+  struct BatchSharding {
+    int max_parallelism;
+    const BatchShardRunner& runner;
+  };
+
+  // Splits the inputs into blocks of consecutive inputs with about the same
+  // cost, see ::tensorflow::text::SplitIntoBlocks. Returns the start of each
+  // block followed by the number of inputs, and sets `cost_per_block` for
+  // `BatchShardRunner`.
+  template <typename ValuesVec>
+  static std::vector<int64_t> SplitIntoBlocks(const ValuesVec& values_vec,
+                                              int max_parallelism,
+                                              int64_t* cost_per_block);
+
+  // Tokenizes all the inputs into intermediate vectors, then copies them to
+  // the output tensors. The outputs that are not requested are left empty.
+  template <bool kGetPieces, bool kGetOffsets>
+  absl::Status InvokeWithIntermediateBuffers(
+      const FastWordpieceTokenizer& tokenizer, const BatchSharding& sharding,
+      InvokeContext* context);
+
+  // Counts the wordpieces first, then tokenizes again to write the wordpieces
+  // directly into the output tensors. The outputs that are not requested are
+  // left empty.
+  template <bool kGetPieces, bool kGetOffsets>
+  absl::Status InvokeWithInPlaceOutput(const FastWordpieceTokenizer& tokenizer,
+                                       const BatchSharding& sharding,
+                                       InvokeContext* context);
+
+  // Dispatches to one of the two methods above.
+  template <bool kGetPieces, bool kGetOffsets>
+  absl::Status InvokeRealWork(const FastWordpieceTokenizer& tokenizer,
+                              const BatchSharding& sharding,
+                              InvokeContext* context);
+
+  // Reads the attr `name` into `value`, leaving `value` unchanged if the attr
+  // is missing from a TFLite model.
+  template <typename AttrT>
+  static absl::Status GetOptionalAttr(InitContext* context, const char* name,
+                                      AttrT* value);
+
+  // Writes the `row_truncated` output, unless the op has no such output (i.e.,
+  // in a TFLite model converted before it was added).
+  static absl::Status WriteRowTruncated(const std::vector<char>& row_truncated,
+                                        InvokeContext* context);
+
+  bool get_subwords_ = true;
+  bool get_offsets_ = true;
+  bool in_place_output_ = false;
+  int max_tokens_per_row_ = FastWordpieceTokenizer::kNoTokenLimit;
+  // Shared by all the calls (and all their threads) of this op.
+  std::unique_ptr<FastWordpieceWordCache> word_cache_;
 };
 
 ////////////////////////// Implementation
 
-template <tflite::shim::Runtime Rt>
-std::vector<std::string> FastWordpieceTokenizeWithOffsetsOp<Rt>::Inputs() {
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char
+    FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::kGetSubwordsAttr[] =
+        "get_subwords";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char
+    FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::kGetOffsetsAttr[] =
+        "get_offsets";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char
+    FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::kInPlaceOutputAttr[] =
+        "in_place_output";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char
+    FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::kWordCacheSizeAttr[] =
+        "word_cache_size";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char
+    FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::kMaxTokensPerRowAttr[] =
+        "max_tokens_per_row";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::kOutTypeAttr[] =
+    "out_type";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+const char FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::kTsplitsAttr[] =
+    "Tsplits";
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+std::vector<std::string>
+FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::Attrs() {
+  return {
+      absl::StrCat(kGetSubwordsAttr, ": bool = true"),
+      absl::StrCat(kGetOffsetsAttr, ": bool = true"),
+      absl::StrCat(kInPlaceOutputAttr, ": bool = false"),
+      absl::StrCat(kWordCacheSizeAttr, ": int = 0"),
+      absl::StrCat(kMaxTokensPerRowAttr, ": int = -1"),
+      absl::StrCat(kOutTypeAttr, ": {int32, int64} = DT_INT64"),
+      absl::StrCat(kTsplitsAttr, ": {int32, int64} = DT_INT64"),
+  };
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+std::vector<std::string>
+FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::Inputs() {
   return {"input_values: string", "wp_model: uint8"};
 }
 
-template <tflite::shim::Runtime Rt>
-std::vector<std::string> FastWordpieceTokenizeWithOffsetsOp<Rt>::Outputs() {
-  return {"output_subwords: string", "output_ids: int64",
-          "output_row_splits: int64", "start_values: int64",
-          "end_values: int64"};
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+std::vector<std::string>
+FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::Outputs() {
+  return {"output_subwords: string", "output_ids: out_type",
+          "output_row_splits: Tsplits", "start_values: out_type",
+          "end_values: out_type", "row_truncated: bool"};
 }
 
-template <tflite::shim::Runtime Rt>
-absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt>::Invoke(
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::Init(
+    InitContext* context) {
+  SH_RETURN_IF_ERROR(
+      GetOptionalAttr(context, kGetSubwordsAttr, &get_subwords_));
+  SH_RETURN_IF_ERROR(GetOptionalAttr(context, kGetOffsetsAttr, &get_offsets_));
+  SH_RETURN_IF_ERROR(
+      GetOptionalAttr(context, kInPlaceOutputAttr, &in_place_output_));
+  int64_t word_cache_size = 0;
+  SH_RETURN_IF_ERROR(
+      GetOptionalAttr(context, kWordCacheSizeAttr, &word_cache_size));
+  if (word_cache_size > 0) {
+    word_cache_ = std::make_unique<FastWordpieceWordCache>(static_cast<int>(
+        std::min<int64_t>(word_cache_size, std::numeric_limits<int>::max())));
+  }
+  int64_t max_tokens_per_row = -1;
+  SH_RETURN_IF_ERROR(
+      GetOptionalAttr(context, kMaxTokensPerRowAttr, &max_tokens_per_row));
+  if (max_tokens_per_row >= 0) {
+    max_tokens_per_row_ = static_cast<int>(std::min<int64_t>(
+        max_tokens_per_row, FastWordpieceTokenizer::kNoTokenLimit));
+  }
+  return absl::OkStatus();
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+template <typename AttrT>
+absl::Status
+FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::GetOptionalAttr(
+    InitContext* context, const char* name, AttrT* value) {
+  const absl::Status status = context->GetAttr(name, value);
+  // TF always fills in the attr defaults, but TFLite models converted before
+  // an attr was added do not carry it. Keep the default value in that case.
+  if (!status.ok() && Rt == tflite::shim::Runtime::kTf) {
+    return status;
+  }
+  return absl::OkStatus();
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status
+FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::WriteRowTruncated(
+    const std::vector<char>& row_truncated, InvokeContext* context) {
+  if (context->NumOutputs() <= kRowTruncated) {
+    return absl::OkStatus();
+  }
+  const int num_values = row_truncated.size();
+  SH_ASSIGN_OR_RETURN(auto output_row_truncated,
+                      context->GetOutput(kRowTruncated, Shape({num_values})));
+  auto truncated = output_row_truncated->template Data<bool>();
+  for (int i = 0; i < num_values; ++i) {
+    truncated[i] = row_truncated[i];
+  }
+  return absl::OkStatus();
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::Invoke(
     InvokeContext* context) {
-  SH_ASSIGN_OR_RETURN(const auto input_values, context->GetInput(kInputValues));
-  const auto& values_vec = input_values->template As<tstring, 1>();
+  return Invoke(context, /*max_parallelism=*/1, RunBatchShardsInline);
+}
 
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::Invoke(
+    InvokeContext* context, int max_parallelism,
+    const BatchShardRunner& runner) {
   SH_ASSIGN_OR_RETURN(const auto wp_model, context->GetInput(kWpModel));
   // OK to create on every call because FastWordpieceTokenizer is a
   // lightweight, memory-mapped wrapper on `wp_model` tensor, and thus
@@ -149,51 +375,304 @@ absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt>::Invoke(
       ::tensorflow::text::FastWordpieceTokenizer::Create(
           wp_model->template Data<uint8>().data());
   SH_RETURN_IF_ERROR(fast_wordpiece_tokenizer.status());
+  if (word_cache_ != nullptr) {
+    const auto model = wp_model->template Data<uint8>();
+    if (word_cache_->BindToModel(absl::string_view(
+            reinterpret_cast<const char*>(model.data()), model.size()))) {
+      fast_wordpiece_tokenizer->SetWordCache(word_cache_.get());
+    }
+  }
 
-  // TODO(xysong): Optimize based on which information below is requested.
-  std::vector<std::string> subwords;
-  std::vector<int> subword_ids;
-  std::vector<int> begin_offset;
-  std::vector<int> end_offset;
-  std::vector<int> row_splits;
+  const auto& tokenizer = *fast_wordpiece_tokenizer;
+  const BatchSharding sharding{max_parallelism, runner};
+  if (get_subwords_) {
+    if (get_offsets_) {
+      return InvokeRealWork</*kGetPieces=*/true, /*kGetOffsets=*/true>(
+          tokenizer, sharding, context);
+    } else {
+      return InvokeRealWork</*kGetPieces=*/true, /*kGetOffsets=*/false>(
+          tokenizer, sharding, context);
+    }
+  } else {
+    if (get_offsets_) {
+      return InvokeRealWork</*kGetPieces=*/false, /*kGetOffsets=*/true>(
+          tokenizer, sharding, context);
+    } else {
+      return InvokeRealWork</*kGetPieces=*/false, /*kGetOffsets=*/false>(
+          tokenizer, sharding, context);
+    }
+  }
+}
 
-  row_splits.push_back(0);
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+template <bool kGetPieces, bool kGetOffsets>
+absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::InvokeRealWork(
+    const FastWordpieceTokenizer& tokenizer, const BatchSharding& sharding,
+    InvokeContext* context) {
+  if (in_place_output_) {
+    return InvokeWithInPlaceOutput<kGetPieces, kGetOffsets>(tokenizer,
+                                                            sharding, context);
+  }
+  return InvokeWithIntermediateBuffers<kGetPieces, kGetOffsets>(
+      tokenizer, sharding, context);
+}
+
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+template <typename ValuesVec>
+std::vector<int64_t>
+FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::SplitIntoBlocks(
+    const ValuesVec& values_vec, int max_parallelism,
+    int64_t* cost_per_block) {
+  return ::tensorflow::text::SplitIntoBlocks(
+      values_vec.Dim(0), max_parallelism,
+      [&values_vec](int64_t i) { return kTokenizeCost(values_vec(i).size()); },
+      cost_per_block);
+}
 
-  // Iterate through all the values and wordpiece tokenize them.
-  for (int i = 0; i < values_vec.Dim(0); ++i) {
-    // Tokenize into subwords and record the offset locations.
-    const int original_num_wordpieces = subwords.size();
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+template <bool kGetPieces, bool kGetOffsets>
+absl::Status
+FastWordpieceTokenizeWithOffsetsOp<
+    Rt, T, Tsplits>::InvokeWithIntermediateBuffers(
+    const FastWordpieceTokenizer& tokenizer, const BatchSharding& sharding,
+    InvokeContext* context) {
+  SH_ASSIGN_OR_RETURN(const auto input_values, context->GetInput(kInputValues));
+  const auto& values_vec = input_values->template As<tstring, 1>();
+  const int num_values = values_vec.Dim(0);
+
+  // The output of one block of consecutive inputs. The vectors that are not
+  // requested stay empty, and so do the corresponding output tensors.
+  struct BlockOutput {
+    std::vector<std::string> subwords;
+    std::vector<int> subword_ids;
+    std::vector<int> begin_offset;
+    std::vector<int> end_offset;
+    // The number of wordpieces of each input in the block.
+    std::vector<int> row_lengths;
     bool error = false;
-    fast_wordpiece_tokenizer->Tokenize(values_vec(i), &subwords, &subword_ids,
-                                       &begin_offset, &end_offset,
-                                       /*input_word_offset_in_text=*/0, &error);
-    if (error) {
+  };
+
+  int64_t cost_per_block;
+  const std::vector<int64_t> block_starts =
+      SplitIntoBlocks(values_vec, sharding.max_parallelism, &cost_per_block);
+  const int num_blocks = block_starts.size() - 1;
+  std::vector<BlockOutput> blocks(num_blocks);
+  // Uses char instead of bool so that the rows can be updated concurrently.
+  std::vector<char> row_truncated(num_values, false);
+
+  // Tokenize each block into its own buffers.
+  auto tokenize_blocks = [&](int64_t start, int64_t limit) {
+    for (int b = start; b < limit; ++b) {
+      BlockOutput& block = blocks[b];
+      for (int i = block_starts[b]; i < block_starts[b + 1]; ++i) {
+        const int original_num_wordpieces = block.subword_ids.size();
+        bool error = false;
+        bool truncated = false;
+        if constexpr (kGetPieces) {
+          // There is no overload for pieces without offsets; the offsets are
+          // cheap compared to the pieces, and are dropped below if not
+          // requested.
+          tokenizer.Tokenize(values_vec(i), &block.subwords, &block.subword_ids,
+                             &block.begin_offset, &block.end_offset,
+                             /*input_word_offset_in_text=*/0, &error,
+                             max_tokens_per_row_, &truncated);
+        } else if constexpr (kGetOffsets) {
+          tokenizer.Tokenize(values_vec(i), &block.subword_ids,
+                             &block.begin_offset, &block.end_offset,
+                             /*input_word_offset_in_text=*/0, &error,
+                             max_tokens_per_row_, &truncated);
+        } else {
+          tokenizer.Tokenize(values_vec(i), &block.subword_ids,
+                             /*input_word_offset_in_text=*/0, &error,
+                             max_tokens_per_row_, &truncated);
+        }
+        row_truncated[i] = truncated;
+        if (error) {
+          block.error = true;
+          return;
+        }
+        block.row_lengths.push_back(block.subword_ids.size() -
+                                    original_num_wordpieces);
+      }
+    }
+  };
+  if (num_blocks == 1) {
+    tokenize_blocks(0, 1);
+  } else {
+    sharding.runner(num_blocks, cost_per_block, tokenize_blocks);
+  }
+
+  // Merge the blocks: the row splits are the prefix sums of the row lengths,
+  // and the block outputs are concatenated in order.
+  SH_ASSIGN_OR_RETURN(
+      auto output_row_splits,
+      context->GetOutput(kOutputRowSplits, Shape({num_values + 1})));
+  auto row_splits = output_row_splits->template Data<Tsplits>();
+  row_splits[0] = 0;
+  int row = 0;
+  for (const BlockOutput& block : blocks) {
+    if (block.error) {
       return absl::InternalError(
           "Failed to make any progress in tokenizing the input text.");
     }
-    const int delta_num_wordpieces = subwords.size() - original_num_wordpieces;
+    for (const int row_length : block.row_lengths) {
+      row_splits[row + 1] = row_splits[row] + row_length;
+      ++row;
+    }
+  }
 
-    // Record the row splits.
-    row_splits.push_back(delta_num_wordpieces + row_splits.back());
+  const int num_wordpieces = row_splits[num_values];
+  const int num_subwords = kGetPieces ? num_wordpieces : 0;
+  const int num_offsets = kGetOffsets ? num_wordpieces : 0;
+  SH_ASSIGN_OR_RETURN(
+      auto output_subwords,
+      context->GetOutput(kOutputSubwords, Shape({num_subwords})));
+  auto subwords = output_subwords->template As<tensorflow::tstring, 1>();
+  SH_ASSIGN_OR_RETURN(auto output_ids,
+                      context->GetOutput(kOutputIds, Shape({num_wordpieces})));
+  auto ids = output_ids->template Data<T>();
+  SH_ASSIGN_OR_RETURN(auto output_start_values,
+                      context->GetOutput(kStartValues, Shape({num_offsets})));
+  auto start_values = output_start_values->template Data<T>();
+  SH_ASSIGN_OR_RETURN(auto output_end_values,
+                      context->GetOutput(kEndValues, Shape({num_offsets})));
+  auto end_values = output_end_values->template Data<T>();
+
+  int offset = 0;
+  for (const BlockOutput& block : blocks) {
+    for (int j = 0; j < block.subword_ids.size(); ++j, ++offset) {
+      ids[offset] = block.subword_ids[j];
+      if constexpr (kGetPieces) {
+        subwords(offset) = block.subwords[j];
+      }
+      if constexpr (kGetOffsets) {
+        start_values[offset] = block.begin_offset[j];
+        end_values[offset] = block.end_offset[j];
+      }
+    }
   }
 
-  SH_RETURN_IF_ERROR(this->template FillOutputTensor<std::string,
-                                                     tensorflow::tstring>(
-      subwords, kOutputSubwords, context));
-  SH_RETURN_IF_ERROR(this->template FillOutputTensor<int, int64>(
-      subword_ids, kOutputIds, context));
-  SH_RETURN_IF_ERROR(this->template FillOutputTensor<int, int64>(
-      row_splits, kOutputRowSplits, context));
-  SH_RETURN_IF_ERROR(this->template FillOutputTensor<int, int64>(
-      begin_offset, kStartValues, context));
-  SH_RETURN_IF_ERROR(this->template FillOutputTensor<int, int64>(
-      end_offset, kEndValues, context));
+  return WriteRowTruncated(row_truncated, context);
+}
 
-  return absl::OkStatus();
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+template <bool kGetPieces, bool kGetOffsets>
+absl::Status
+FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::InvokeWithInPlaceOutput(
+    const FastWordpieceTokenizer& tokenizer, const BatchSharding& sharding,
+    InvokeContext* context) {
+  SH_ASSIGN_OR_RETURN(const auto input_values, context->GetInput(kInputValues));
+  const auto& values_vec = input_values->template As<tstring, 1>();
+  const int num_values = values_vec.Dim(0);
+
+  int64_t cost_per_block;
+  const std::vector<int64_t> block_starts =
+      SplitIntoBlocks(values_vec, sharding.max_parallelism, &cost_per_block);
+  const int num_blocks = block_starts.size() - 1;
+  // Uses char instead of bool so that the blocks can be updated concurrently.
+  std::vector<char> block_errors(num_blocks, false);
+  std::vector<char> row_truncated(num_values, false);
+  auto run_blocks = [&](const std::function<void(int64_t, int64_t)>& work) {
+    if (num_blocks == 1) {
+      work(0, 1);
+    } else {
+      sharding.runner(num_blocks, cost_per_block, work);
+    }
+  };
+
+  // First pass: count the wordpieces of each input, then turn the counts into
+  // row splits.
+  SH_ASSIGN_OR_RETURN(
+      auto output_row_splits,
+      context->GetOutput(kOutputRowSplits, Shape({num_values + 1})));
+  auto row_splits = output_row_splits->template Data<Tsplits>();
+  row_splits[0] = 0;
+  run_blocks([&](int64_t start, int64_t limit) {
+    for (int b = start; b < limit; ++b) {
+      for (int i = block_starts[b]; i < block_starts[b + 1]; ++i) {
+        TokenBufferWriter<T> counter;
+        bool error = false;
+        bool truncated = false;
+        tokenizer
+            .TokenizeIntoBuffer</*kGetPieces=*/false, /*kGetOffsets=*/false>(
+                values_vec(i), counter, /*input_word_offset_in_text=*/0,
+                &error, max_tokens_per_row_, &truncated);
+        row_truncated[i] = truncated;
+        if (error) {
+          block_errors[b] = true;
+          break;
+        }
+        row_splits[i + 1] = counter.size();
+      }
+    }
+  });
+  for (const char error : block_errors) {
+    if (error) {
+      return absl::InternalError(
+          "Failed to make any progress in tokenizing the input text.");
+    }
+  }
+  for (int i = 0; i < num_values; ++i) {
+    row_splits[i + 1] += row_splits[i];
+  }
+
+  // Second pass: write the wordpieces into the output tensors. Each block
+  // writes to its own slice of the outputs, starting at the row split of its
+  // first input.
+  const int num_wordpieces = row_splits[num_values];
+  const int num_subwords = kGetPieces ? num_wordpieces : 0;
+  const int num_offsets = kGetOffsets ? num_wordpieces : 0;
+  SH_ASSIGN_OR_RETURN(
+      auto output_subwords,
+      context->GetOutput(kOutputSubwords, Shape({num_subwords})));
+  auto subwords = output_subwords->template As<tensorflow::tstring, 1>();
+  SH_ASSIGN_OR_RETURN(auto output_ids,
+                      context->GetOutput(kOutputIds, Shape({num_wordpieces})));
+  T* ids = output_ids->template Data<T>().data();
+  SH_ASSIGN_OR_RETURN(auto output_start_values,
+                      context->GetOutput(kStartValues, Shape({num_offsets})));
+  T* start_values = output_start_values->template Data<T>().data();
+  SH_ASSIGN_OR_RETURN(auto output_end_values,
+                      context->GetOutput(kEndValues, Shape({num_offsets})));
+  T* end_values = output_end_values->template Data<T>().data();
+  run_blocks([&](int64_t start, int64_t limit) {
+    for (int b = start; b < limit; ++b) {
+      const int block_offset = row_splits[block_starts[b]];
+      auto write_subword = [&subwords, block_offset](
+                               int index, absl::string_view piece_prefix,
+                               absl::string_view piece) {
+        tensorflow::tstring& subword = subwords(block_offset + index);
+        subword.assign(piece_prefix.data(), piece_prefix.size());
+        subword.append(piece.data(), piece.size());
+      };
+      TokenBufferWriter<T> writer(
+          row_splits[block_starts[b + 1]] - block_offset, ids + block_offset,
+          kGetOffsets ? start_values + block_offset : nullptr,
+          kGetOffsets ? end_values + block_offset : nullptr, write_subword);
+      for (int i = block_starts[b]; i < block_starts[b + 1]; ++i) {
+        tokenizer.TokenizeIntoBuffer<kGetPieces, kGetOffsets>(
+            values_vec(i), writer, /*input_word_offset_in_text=*/0,
+            /*error=*/nullptr, max_tokens_per_row_);
+        if (block_offset + writer.size() != row_splits[i + 1]) {
+          block_errors[b] = true;
+          break;
+        }
+      }
+    }
+  });
+  for (const char error : block_errors) {
+    if (error) {
+      return absl::InternalError(
+          "The number of wordpieces differs between the counting pass and "
+          "the writing pass.");
+    }
+  }
+
+  return WriteRowTruncated(row_truncated, context);
 }
 
-template <tflite::shim::Runtime Rt>
-absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt>::ShapeInference(
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt, T, Tsplits>::ShapeInference(
     ShapeInferenceContext* c) {
   using tflite::shim::Shape;
   SH_ASSIGN_OR_RETURN(const Shape input_values_shape,
@@ -215,11 +694,15 @@ absl::Status FastWordpieceTokenizeWithOffsetsOp<Rt>::ShapeInference(
   SH_RETURN_IF_ERROR(c->SetOutputShape(kOutputRowSplits, Shape({num_splits})));
   SH_RETURN_IF_ERROR(c->SetOutputShape(kStartValues, rank_1_shape));
   SH_RETURN_IF_ERROR(c->SetOutputShape(kEndValues, rank_1_shape));
+  // TFLite models converted before `row_truncated` was added lack it.
+  if (c->NumOutputs() > kRowTruncated) {
+    SH_RETURN_IF_ERROR(c->SetOutputShape(
+        kRowTruncated, Shape({input_values_shape.Dim(0)})));
+  }
 
   return absl::OkStatus();
 }
 
-
 // See `kDoc` data member for the documentation on this op kernel.
 //
 // This template class can be instantiated into a kernel for either TF or
@@ -322,25 +805,25 @@ absl::Status FastWordpieceDetokenizeOp<Rt>::Invoke(InvokeContext* context) {
           wp_model->template Data<uint8>().data());
   SH_RETURN_IF_ERROR(fast_wordpiece_tokenizer.status());
 
-  std::vector<std::string> sentences;
-
-  // Iterate through row_splits to split input_values.
-  for (int i = 0; i < row_splits_vec.Dim(0) - 1; ++i) {
-    auto single_input =
-        absl::Span<const int>(values_vec.Ptr() + row_splits_vec(i),
-                              row_splits_vec(i + 1) - row_splits_vec(i));
-    SH_ASSIGN_OR_RETURN(auto sentence,
-                        fast_wordpiece_tokenizer->Detokenize(single_input));
-    sentences.push_back(sentence);
-  }
+  // The texts of all the rows, one after another, so that there is no
+  // allocation per token or per row before the copy into the output tensor.
+  std::string texts;
+  std::vector<int64_t> text_ends;
+  SH_RETURN_IF_ERROR(fast_wordpiece_tokenizer->DetokenizeBatch(
+      absl::MakeConstSpan(values_vec.Ptr(), values_vec.Dim(0)),
+      absl::MakeConstSpan(row_splits_vec.Ptr(), row_splits_vec.Dim(0)),
+      &texts, &text_ends));
 
-  const int words_size = sentences.size();
+  const int words_size = text_ends.size();
   SH_ASSIGN_OR_RETURN(auto output_words,
                       context->GetOutput(kOutputWords, Shape({words_size})));
   auto output_words_vec = output_words->template As<tensorflow::tstring, 1>();
 
+  int64_t text_start = 0;
   for (int i = 0; i < words_size; ++i) {
-    output_words_vec(i) = sentences[i];
+    output_words_vec(i).assign(texts.data() + text_start,
+                               text_ends[i] - text_start);
+    text_start = text_ends[i];
   }
 
   return absl::OkStatus();
@@ -0,0 +1,91 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_model_builder.h"
+#include "tensorflow_text/core/kernels/text_kernels_test_util.h"
+
+namespace tensorflow {
+namespace text {
+namespace {
+
+using ::tensorflow::monitoring::testing::CellReader;
+using ::tensorflow::text_kernels_test_util::VectorEq;
+
+constexpr char kWordCacheLookups[] =
+    "/tensorflow/text/fast_wordpiece_word_cache/lookups";
+
+class FastWordpieceTokenizeWithOffsetsKernelTest : public OpsTestBase {
+ public:
+  void MakeOp(int word_cache_size) {
+    TF_ASSERT_OK(
+        NodeDefBuilder("tested_op", "FastWordpieceTokenizeWithOffsets")
+            .Input(FakeInput(DT_STRING))
+            .Input(FakeInput(DT_UINT8))
+            .Attr("word_cache_size", word_cache_size)
+            .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  void AddInputs(const std::vector<tstring>& text) {
+    const auto model = BuildModelAndExportToFlatBuffer(
+        {"a", "b", "##b", "[UNK]"}, /*max_bytes_per_token=*/100,
+        /*suffix_indicator=*/"##", /*unk_token=*/"[UNK]");
+    ASSERT_TRUE(model.ok());
+    AddInputFromArray<tstring>(TensorShape({static_cast<int64_t>(text.size())}),
+                               text);
+    AddInputFromArray<uint8>(
+        TensorShape({static_cast<int64_t>(model->size())}),
+        std::vector<uint8>(model->begin(), model->end()));
+  }
+};
+
+TEST_F(FastWordpieceTokenizeWithOffsetsKernelTest, ExportsWordCacheLookups) {
+  CellReader<int64_t> lookups(kWordCacheLookups);
+  MakeOp(/*word_cache_size=*/16);
+  AddInputs({"a bb a", "bb"});
+  TF_ASSERT_OK(RunOpKernel());
+
+  EXPECT_THAT(*GetOutput(1), VectorEq<int64_t>({0, 1, 2, 0, 1, 2}));
+  // "a" and "bb" miss the cache the first time, then hit it.
+  EXPECT_EQ(lookups.Delta("miss"), 2);
+  EXPECT_EQ(lookups.Delta("hit"), 2);
+}
+
+TEST_F(FastWordpieceTokenizeWithOffsetsKernelTest, NoLookupsWithoutCache) {
+  CellReader<int64_t> lookups(kWordCacheLookups);
+  MakeOp(/*word_cache_size=*/0);
+  AddInputs({"a bb a", "bb"});
+  TF_ASSERT_OK(RunOpKernel());
+
+  EXPECT_THAT(*GetOutput(1), VectorEq<int64_t>({0, 1, 2, 0, 1, 2}));
+  EXPECT_EQ(lookups.Delta("miss"), 0);
+  EXPECT_EQ(lookups.Delta("hit"), 0);
+}
+
+}  // namespace
+}  // namespace text
+}  // namespace tensorflow
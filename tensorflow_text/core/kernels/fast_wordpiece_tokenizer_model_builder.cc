@@ -16,12 +16,14 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <functional>
 #include <memory>
-#include <queue>
-#include <stack>
+#include <thread>  // NOLINT(build/c++11)
+#include <tuple>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
-#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
@@ -29,6 +31,7 @@
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "absl/types/span.h"
 #include /* cppitertools */ "imap.hpp"
 #include "icu4c/source/common/unicode/umachine.h"
 #include "icu4c/source/common/unicode/utf8.h"
@@ -39,6 +42,7 @@
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_utils.h"
 #include "tensorflow_text/core/kernels/sentence_fragmenter_v2.h"
 #include "tensorflow_text/core/kernels/string_vocab.h"
+#include "tensorflow_text/core/kernels/vocab_pool.h"
 
 namespace tensorflow {
 namespace text {
@@ -48,6 +52,37 @@ namespace {
 // during text normalization. It is used to build dummy nodes in the trie.
 static constexpr char kInvalidControlChar = 0x11;
 
+// The minimum number of trie nodes of a BFS level handled by one thread when
+// building the failure structure. Smaller levels are handled by fewer threads.
+static constexpr int kMinTrieNodesPerShard = 4096;
+
+// Returns the number of shards to split `num_items` items into: at most one per
+// hardware thread, each of at least `min_shard_size` items.
+int GetNumShards(int num_items, int min_shard_size) {
+  const int max_num_shards =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  return std::max(1, std::min(max_num_shards, num_items / min_shard_size));
+}
+
+// Splits [0, `num_items`) into `num_shards` contiguous shards and calls
+// `fn(shard, begin, end)` for each shard, each in its own thread.
+void RunInShards(int num_items, int num_shards,
+                 const std::function<void(int, int, int)>& fn) {
+  const auto shard_begin = [num_items, num_shards](int shard) {
+    return static_cast<int>(static_cast<int64_t>(num_items) * shard /
+                            num_shards);
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(num_shards - 1);
+  for (int shard = 1; shard < num_shards; ++shard) {
+    threads.emplace_back(fn, shard, shard_begin(shard), shard_begin(shard + 1));
+  }
+  fn(0, 0, shard_begin(1));
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
 // A wrapper of vocab tokens that will be used to build the trie.
 class TrieVocabToken {
  public:
@@ -123,7 +158,8 @@ struct FailureStruct {
   //
   // It is stored as a pair of offset and length that represents a continuous
   // vector in `failure_pops_pool_`. This pair is encoded using
-  // EncodeFailurePopList() in fast_wordpiece_tokenizer_utils.h.
+  // EncodeFailurePopList() in fast_wordpiece_tokenizer_utils.h, or as the
+  // offset of the list with the wide encoding.
   uint32_t failure_pops_offset_length =
       fast_wordpiece_tokenizer_utils::kNullFailurePopsList;
 };
@@ -138,11 +174,18 @@ class FastWordpieceBuilder {
                           absl::string_view suffix_indicator,
                           absl::string_view unk_token,
                           bool no_pretokenization,
-                          bool support_detokenization);
+                          bool support_detokenization,
+                          bool wide_token_encoding, bool compact_vocab);
 
   absl::StatusOr<std::string> ExportToFlatBuffer() const;
 
  private:
+  // Encodes a token into the value stored on the trie and in the failure pops
+  // pool, with the compact or the wide encoding (see
+  // fast_wordpiece_tokenizer_utils.h).
+  absl::StatusOr<int> EncodeToken(int token_id, int token_length,
+                                  bool is_suffix_token);
+
   absl::StatusOr<std::vector<TrieVocabToken>> PrepareVocabTokensToBuildTrie();
 
   absl::Status ConstructTrie(
@@ -151,34 +194,77 @@ class FastWordpieceBuilder {
   absl::Status BuildFailureStructure(
       const std::vector<TrieVocabToken>& tokens_to_build_trie);
 
-  // Builds the set of outgoing edge labels for each trie node and returns a
-  // mapping (node_id -> set<char>). Used in BuildFailureStructure().
-  absl::StatusOr<std::vector<absl::flat_hash_set<char>>>
-  BuildOutgoingEdgeLabelsForTrie(
+  // The failure link and the one step pops computed for a trie node by
+  // ComputeFailureLinksOfChildren(), before they are assigned to the node by
+  // AssignFailureLinkAndPops().
+  struct PendingFailureLink {
+    uint32_t node_id;
+    uint32_t failure_link;
+    int parent_failure_pops_offset_length;
+    // The range of the one step pops in `FailureLinksOfLevel::one_step_pops`.
+    int one_step_pops_begin;
+    int one_step_pops_end;
+  };
+
+  // The failure links computed for the children of a range of nodes of a BFS
+  // level.
+  struct FailureLinksOfLevel {
+    // In BFS order.
+    std::vector<PendingFailureLink> children;
+    std::vector<int> one_step_pops;
+  };
+
+  // Computes the failure links and the one step pops of the children of
+  // `parent_ids`, and appends them to `out` in BFS order. Only reads the
+  // failure structure (of the nodes of the previous levels), so that it can run
+  // on several ranges of the same level in parallel.
+  absl::Status ComputeFailureLinksOfChildren(
+      absl::Span<const uint32_t> parent_ids, FailureLinksOfLevel& out);
+
+  // Sets `outgoing_edges` to the (label, child node id) pairs of the outgoing
+  // edges of `node_id`, sorted by label.
+  //
+  // darts-clone does not provide an API to enumerate the outgoing edges of a
+  // node. The child of a node for label c is at `node_id ^ offset ^ c` and has
+  // label c (see DartsCloneTrieWrapper), so all the children of a node are in
+  // the same block of 256 units, which we scan in memory order. A unit of the
+  // block with the matching label is always a child of `node_id`, since
+  // darts-clone never uses the same `node_id ^ offset` for two nodes.
+  void GetOutgoingEdgesSortedByLabel(
+      uint32_t node_id,
+      std::vector<std::pair<char, uint32_t>>& outgoing_edges) const;
+
+  // Records in `node_id_is_punc_map_` whether the trie node of each vocab token
+  // is a punctuation char. Used in BuildFailureStructure().
+  absl::Status BuildNodeIdIsPuncMap(
       const std::vector<TrieVocabToken>& tokens_to_build_trie);
 
-  // Builds the set of outgoing edge labels for nodes along the trie path of
-  // `vocab_token`. Used in BuildOutgoingEdgeLabelsForTrie().
-  absl::Status BuildOutgoingEdgeLabelsAlongVocabToken(
-      const TrieVocabToken& vocab_token,
-      std::vector<absl::flat_hash_set<char>>& node_outgoing_edge_labels);
+  // Records in `node_id_is_punc_map_` whether the trie node of `vocab_token` is
+  // a punctuation char. Used in BuildNodeIdIsPuncMap().
+  absl::Status AddVocabTokenToNodeIdIsPuncMap(
+      const TrieVocabToken& vocab_token);
 
   // Assigns failure link f(cur_node) to `failure_link` and populates failure
   // pops F(cur_node) (based on `one_step_pops` and
   // `parent_failure_pops_offset_length`).
   absl::Status AssignFailureLinkAndPops(uint32_t cur_node,
                                         uint32_t failure_link,
-                                        const std::vector<int>& one_step_pops,
+                                        absl::Span<const int> one_step_pops,
                                         int parent_failure_pops_offset_length);
 
   // If `failure_pops_offset_length` encodes a valid failure pop list, appends
   // the failure pop list to the end of `out_failure_pops`. Otherwise, does
   // nothing.
   void GetFailurePopsAndAppendToOut(uint32_t failure_pops_offset_length,
-                                    std::vector<int>& out_failure_pops);
+                                    std::vector<int>& out_failure_pops) const;
 
   absl::Status PrecomputeResultForSuffixIndicator();
 
+  // Builds the two-level code point class table (see
+  // fast_wordpiece_tokenizer_utils::CharClassTable). Identical blocks of the
+  // second level are stored only once.
+  void BuildCharClassTable();
+
   inline void BreakTrieLinkFromParentToChild(uint32_t child_node_id) {
     // In trie, the least significant 8 bits encode the label of the trie link
     // from the parent to the node itself.
@@ -216,6 +302,11 @@ class FastWordpieceBuilder {
 
   int unk_token_id_ = -1;
 
+  // The two levels of the code point class table. Only built for the
+  // end-to-end tokenizer.
+  std::vector<uint16_t> char_class_block_index_;
+  std::vector<uint8_t> char_class_blocks_;
+
   // A wrapper to access the trie encoded by `trie_array_`.
   absl::optional<trie_utils::DartsCloneTrieWrapper> trie_;
 
@@ -238,6 +329,10 @@ class FastWordpieceBuilder {
   // Whether the tokenizer supports the detokenization function.
   bool support_detokenization_;
 
+  // Whether to store the vocab for detokenization as a VocabPool rather than as
+  // `vocab_array`.
+  bool compact_vocab_;
+
   std::vector<FailureStruct> failure_struct_array_;
 
   // Each element in the failure pops pool is an encoded vocab token.
@@ -252,17 +347,29 @@ class FastWordpieceBuilder {
   // The mapping from node id to whether the corresponding token is a
   // punctuation char.
   absl::flat_hash_map<uint32_t, bool> node_id_is_punc_map_;
+
+  // Whether to use the wide encoding of tokens and failure pop lists. Set when
+  // the vocabulary exceeds the limits of the compact encoding.
+  bool wide_token_encoding_ = false;
+
+  // With `wide_token_encoding_`, the distinct tokens that the encoded token
+  // values are indices of, and the index of each of them.
+  std::vector<tensorflow::text::WideToken> wide_tokens_;
+  absl::flat_hash_map<std::tuple<int, int, bool>, int> wide_token_index_;
 };
 
 absl::Status FastWordpieceBuilder::BuildModel(
     const std::vector<std::string>& vocab, int max_bytes_per_token,
     absl::string_view suffix_indicator, absl::string_view unk_token,
-    bool no_pretokenization, bool support_detokenization) {
+    bool no_pretokenization, bool support_detokenization,
+    bool wide_token_encoding, bool compact_vocab) {
   unk_token_ = std::string(unk_token);
   suffix_indicator_ = std::string(suffix_indicator);
   max_bytes_per_token_ = max_bytes_per_token;
   no_pretokenization_ = no_pretokenization;
   support_detokenization_ = support_detokenization;
+  compact_vocab_ = compact_vocab;
+  wide_token_encoding_ = wide_token_encoding;
 
   vocab_ = std::make_unique<StringVocab>(vocab);
   if (vocab_->Size() != vocab.size()) {
@@ -286,6 +393,10 @@ absl::Status FastWordpieceBuilder::BuildModel(
   // Precompute the result when the input is the suffix indicator string itself.
   SH_RETURN_IF_ERROR(PrecomputeResultForSuffixIndicator());
 
+  if (!no_pretokenization_) {
+    BuildCharClassTable();
+  }
+
   return absl::OkStatus();
 }
 
@@ -298,12 +409,16 @@ FastWordpieceBuilder::PrepareVocabTokensToBuildTrie() {
   //  * We don't actually add the end-of-input symbol "$" but use an alternative
   //    logic. See FastWordpieceTokenizer::HandleTheRemainingStringOnTriePath().
 
-  if (vocab_->Size() > fast_wordpiece_tokenizer_utils::kMaxSupportedVocabSize) {
+  if (vocab_->Size() >
+      fast_wordpiece_tokenizer_utils::kMaxSupportedWideVocabSize) {
     return absl::FailedPreconditionError(
         absl::StrCat("Vocab size exceeds the max supported (",
-                     fast_wordpiece_tokenizer_utils::kMaxSupportedVocabSize,
+                     fast_wordpiece_tokenizer_utils::kMaxSupportedWideVocabSize,
                      "). Found vocab size: ", vocab_->Size(), "."));
   }
+  if (vocab_->Size() > fast_wordpiece_tokenizer_utils::kMaxSupportedVocabSize) {
+    wide_token_encoding_ = true;
+  }
 
   // Collect a subset of tokens (and variations) to build the trie.
   std::vector<TrieVocabToken> tokens_to_build_trie;
@@ -350,13 +465,8 @@ FastWordpieceBuilder::PrepareVocabTokensToBuildTrie() {
     TrieVocabToken vocab_token(*word, token_id, suffix_indicator_);
     if (vocab_token.TokenLengthWithoutSuffixIndicator() >
         fast_wordpiece_tokenizer_utils::kMaxVocabTokenLengthInUTF8Bytes) {
-      return absl::FailedPreconditionError(absl::StrCat(
-          "Vocab token utf8 length (excluding suffix indicator) exceeds the "
-          "max supported (",
-          fast_wordpiece_tokenizer_utils::kMaxVocabTokenLengthInUTF8Bytes,
-          "). The vocab token is: ", *word,
-          " with utf8 length (excluding suffix indicator): ",
-          vocab_token.TokenLengthWithoutSuffixIndicator(), "."));
+      // The length does not fit in the compact encoding.
+      wide_token_encoding_ = true;
     }
     // Skip word that contains punctuation but is not a punctuation itself.
     // <unk>, <pad>, ##. are skipped in this step.
@@ -423,11 +533,11 @@ absl::Status FastWordpieceBuilder::ConstructTrie(
   std::vector<int> values;
   for (const TrieVocabToken& vocab_token : tokens_to_build_trie) {
     keys.emplace_back(vocab_token.Token());
-    SH_ASSIGN_OR_RETURN(int encoded_value,
-                        fast_wordpiece_tokenizer_utils::EncodeToken(
-                            vocab_token.TokenId(),
-                            vocab_token.TokenLengthWithoutSuffixIndicator(),
-                            vocab_token.IsSuffixToken()));
+    SH_ASSIGN_OR_RETURN(
+        int encoded_value,
+        EncodeToken(vocab_token.TokenId(),
+                    vocab_token.TokenLengthWithoutSuffixIndicator(),
+                    vocab_token.IsSuffixToken()));
     values.push_back(encoded_value);
   }
   SH_ASSIGN_OR_RETURN(trie_array_,
@@ -471,16 +581,14 @@ absl::Status FastWordpieceBuilder::ConstructTrie(
   return absl::OkStatus();
 }
 
-absl::Status FastWordpieceBuilder::BuildOutgoingEdgeLabelsAlongVocabToken(
-    const TrieVocabToken& vocab_token,
-    std::vector<absl::flat_hash_set<char>>& node_outgoing_edge_labels) {
+absl::Status FastWordpieceBuilder::AddVocabTokenToNodeIdIsPuncMap(
+    const TrieVocabToken& vocab_token) {
   const absl::string_view token = vocab_token.Token();
   trie_utils::DartsCloneTrieWrapper::TraversalCursor cur_node;
   int char_pos = 0;
   trie_->SetTraversalCursor(cur_node, trie_->kRootNodeId);
   while (char_pos < token.size()) {
     const char edge_label = token[char_pos];
-    node_outgoing_edge_labels[cur_node.node_id].insert(edge_label);
     if (!trie_->TryTraverseOneStep(cur_node, edge_label)) {
       // Should never happen, since we built trie using all of `vocab_token`.
       return absl::FailedPreconditionError(absl::StrCat(
@@ -511,70 +619,62 @@ absl::Status FastWordpieceBuilder::BuildOutgoingEdgeLabelsAlongVocabToken(
   return absl::OkStatus();
 }
 
-absl::StatusOr<std::vector<absl::flat_hash_set<char>>>
-FastWordpieceBuilder::BuildOutgoingEdgeLabelsForTrie(
+void FastWordpieceBuilder::GetOutgoingEdgesSortedByLabel(
+    uint32_t node_id,
+    std::vector<std::pair<char, uint32_t>>& outgoing_edges) const {
+  outgoing_edges.clear();
+  // The offset of the node, as in DartsCloneTrieWrapper.
+  const uint32_t unit = trie_array_[node_id];
+  const uint32_t base = node_id ^ ((unit >> 10) << ((unit & 0x200) >> 6));
+  const uint32_t block_begin = base & ~uint32_t{0xFF};
+  const uint32_t block_end =
+      std::min<uint32_t>(block_begin + 0x100, trie_array_.size());
+  for (uint32_t child_id = block_begin; child_id < block_end; ++child_id) {
+    const uint32_t label = child_id ^ base;
+    // The label 0 is the leaf unit that holds the data of the node (and
+    // darts-clone keys never contain '\0'). Leaf units have the most
+    // significant bit set, so they never match.
+    if (label != 0 && (trie_array_[child_id] & 0x800000FF) == label) {
+      outgoing_edges.emplace_back(static_cast<char>(label), child_id);
+    }
+  }
+  std::sort(outgoing_edges.begin(), outgoing_edges.end());
+}
+
+absl::Status FastWordpieceBuilder::BuildNodeIdIsPuncMap(
     const std::vector<TrieVocabToken>& tokens_to_build_trie) {
-  std::vector<absl::flat_hash_set<char>> node_outgoing_edge_labels(
-      trie_array_.size());
   const std::string dummy_token_for_trie_punct_failure_link_node =
       std::string(1, kInvalidControlChar);
   for (const TrieVocabToken& vocab_token : tokens_to_build_trie) {
     if (vocab_token.Token() == dummy_token_for_trie_punct_failure_link_node)
       continue;
-    SH_RETURN_IF_ERROR(BuildOutgoingEdgeLabelsAlongVocabToken(
-        vocab_token, node_outgoing_edge_labels));
+    SH_RETURN_IF_ERROR(AddVocabTokenToNodeIdIsPuncMap(vocab_token));
   }
-  return node_outgoing_edge_labels;
+  return absl::OkStatus();
 }
 
-// Computes failure links and failure pops using BFS traversal.
-absl::Status FastWordpieceBuilder::BuildFailureStructure(
-    const std::vector<TrieVocabToken>& tokens_to_build_trie) {
-  // Build the set of outgoing edge labels for each trie node (node_id ->
-  // set<char>). This is needed by BFS because darts-clone does not provide an
-  // API to enumerate the outgoing links for a node.
-  SH_ASSIGN_OR_RETURN(
-      std::vector<absl::flat_hash_set<char>> node_outgoing_edge_labels,
-      BuildOutgoingEdgeLabelsForTrie(tokens_to_build_trie));
-
-  failure_struct_array_.resize(trie_array_.size());
-  // Initialize the BFS queue.
-  std::queue<uint32_t> bfs_queue({trie_->kRootNodeId});
-  if (trie_suffix_root_ != trie_->kRootNodeId) {
-    // When `suffix_indicator_` is empty, `trie_suffix_root_` will collapse
-    // with root. In this case, we don't visit it twice.
-    //
-    // In addition, we have ensured that `trie_suffix_root_` will never be null.
-    // See PrepareVocabTokensToBuildTrie().
-    bfs_queue.push(trie_suffix_root_);
-  }
-
-  // The BFS loop.
-  while (!bfs_queue.empty()) {
-    uint32_t parent_id = bfs_queue.front();
-    bfs_queue.pop();
-
+absl::Status FastWordpieceBuilder::ComputeFailureLinksOfChildren(
+    absl::Span<const uint32_t> parent_ids, FailureLinksOfLevel& out) {
+  std::vector<std::pair<char, uint32_t>> outgoing_edges;
+  for (const uint32_t parent_id : parent_ids) {
     // Explore the children of the parent node.
     //
     // Fix the iteration order of the outgoing edges to ensure that the model is
     // always built in the same way (i.e., visiting nodes in the same order).
-    std::vector<char> outgoing_labels_sorted(
-        node_outgoing_edge_labels[parent_id].begin(),
-        node_outgoing_edge_labels[parent_id].end());
-    std::sort(outgoing_labels_sorted.begin(), outgoing_labels_sorted.end());
-    for (const char edge_label : outgoing_labels_sorted) {
-      auto child_node = trie_->CreateTraversalCursor(parent_id);
-      if (!trie_->TryTraverseOneStep(child_node, edge_label)) {
-        // Should never happen, due to how we built `node_outgoing_edge_labels`;
-        // see BuildOutgoingEdgeLabelsAlongVocabToken().
-        return absl::FailedPreconditionError(absl::StrCat(
-            "Failed to traverse to child following edge ",
-            absl::string_view(&edge_label, 1), " at parent ", parent_id, "."));
-      }
+    GetOutgoingEdgesSortedByLabel(parent_id, outgoing_edges);
+    for (const auto& [edge_label, child_node_id] : outgoing_edges) {
+      const auto child_node = trie_->CreateTraversalCursor(child_node_id);
       if (child_node.node_id == trie_suffix_root_) {
         // Avoid visiting `trie_suffix_root_` twice.
         continue;
       }
+      PendingFailureLink& pending = out.children.emplace_back();
+      pending.node_id = child_node.node_id;
+      pending.failure_link = fast_wordpiece_tokenizer_utils::kNullNode;
+      pending.parent_failure_pops_offset_length =
+          fast_wordpiece_tokenizer_utils::kNullFailurePopsList;
+      pending.one_step_pops_begin = out.one_step_pops.size();
+      pending.one_step_pops_end = out.one_step_pops.size();
 
       // For the child node v, compute failure link f(v) and failure pops F(v).
       //
@@ -612,12 +712,9 @@ absl::Status FastWordpieceBuilder::BuildFailureStructure(
         // the match process. In summary, we have:
         //  * f(v) = trie_suffix_root_.
         //  * F(v) = [str(v)].
-        SH_RETURN_IF_ERROR(AssignFailureLinkAndPops(
-            /*cur_node=*/child_node.node_id, /*failure_link=*/failure_link,
-            /*one_step_pops=*/{child_data_value},
-            /*parent_failure_pops_offset_length=*/
-            fast_wordpiece_tokenizer_utils::kNullFailurePopsList));
-        bfs_queue.push(child_node.node_id);
+        pending.failure_link = failure_link;
+        out.one_step_pops.push_back(child_data_value);
+        pending.one_step_pops_end = out.one_step_pops.size();
         continue;
       }
 
@@ -654,7 +751,8 @@ absl::Status FastWordpieceBuilder::BuildFailureStructure(
       //
       // Note 1: processing node v depends on the info for nodes z that are
       // closer to the root than v. Due to our use of the BFS traversal, that
-      // info is guaranteed to exist when we examine node v.
+      // info is guaranteed to exist when we examine node v: those nodes are on
+      // the previous BFS levels, which are assigned before this one.
       //
       // Note 2: f(v) is null means that during the tokenization process of some
       // input word, if the trie matching cannot continue at node v, there are
@@ -665,15 +763,15 @@ absl::Status FastWordpieceBuilder::BuildFailureStructure(
       // https://arxiv.org/abs/2012.15524
       const FailureStruct& parent_fs = failure_struct_array_[parent_id];
       if (parent_fs.failure_link != fast_wordpiece_tokenizer_utils::kNullNode) {
-        std::vector<int> one_step_pops;
+        std::vector<int>& one_step_pops = out.one_step_pops;
         auto itr_node = trie_->CreateTraversalCursor(parent_fs.failure_link);
         while (true) {
           if (trie_->TryTraverseOneStep(itr_node, edge_label)) {
             // Set the failure link and failure pops for `child_node`.
-            SH_RETURN_IF_ERROR(AssignFailureLinkAndPops(
-                /*cur_node=*/child_node.node_id,
-                /*failure_link=*/itr_node.node_id, one_step_pops,
-                parent_fs.failure_pops_offset_length));
+            pending.failure_link = itr_node.node_id;
+            pending.parent_failure_pops_offset_length =
+                parent_fs.failure_pops_offset_length;
+            pending.one_step_pops_end = one_step_pops.size();
             break;
           }
           const FailureStruct& itr_node_fs =
@@ -689,10 +787,71 @@ absl::Status FastWordpieceBuilder::BuildFailureStructure(
           // Follow the failure link.
           trie_->SetTraversalCursor(itr_node, itr_node_fs.failure_link);
         }
+        one_step_pops.resize(pending.one_step_pops_end);
       }
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Computes failure links and failure pops using BFS traversal.
+//
+// The failure structure of a node only depends on the nodes of the previous
+// BFS levels (see ComputeFailureLinksOfChildren()), so each level is computed
+// in parallel over ranges of its nodes, and then assigned in BFS order, which
+// builds the same model as a sequential BFS.
+absl::Status FastWordpieceBuilder::BuildFailureStructure(
+    const std::vector<TrieVocabToken>& tokens_to_build_trie) {
+  SH_RETURN_IF_ERROR(BuildNodeIdIsPuncMap(tokens_to_build_trie));
+
+  failure_struct_array_.resize(trie_array_.size());
+  // Initialize the first BFS level.
+  std::vector<uint32_t> bfs_level = {trie_->kRootNodeId};
+  if (trie_suffix_root_ != trie_->kRootNodeId) {
+    // When `suffix_indicator_` is empty, `trie_suffix_root_` will collapse
+    // with root. In this case, we don't visit it twice.
+    //
+    // In addition, we have ensured that `trie_suffix_root_` will never be null.
+    // See PrepareVocabTokensToBuildTrie().
+    bfs_level.push_back(trie_suffix_root_);
+  }
 
-      bfs_queue.push(child_node.node_id);
+  // The BFS loop, one level at a time.
+  std::vector<FailureLinksOfLevel> shards;
+  std::vector<absl::Status> shard_statuses;
+  std::vector<uint32_t> next_bfs_level;
+  while (!bfs_level.empty()) {
+    const int num_shards =
+        GetNumShards(bfs_level.size(), kMinTrieNodesPerShard);
+    if (shards.size() < num_shards) shards.resize(num_shards);
+    shard_statuses.assign(num_shards, absl::OkStatus());
+    RunInShards(
+        bfs_level.size(), num_shards,
+        [this, &bfs_level, &shards, &shard_statuses](int shard, int begin,
+                                                      int end) {
+          shards[shard].children.clear();
+          shards[shard].one_step_pops.clear();
+          shard_statuses[shard] = ComputeFailureLinksOfChildren(
+              absl::MakeConstSpan(bfs_level).subspan(begin, end - begin),
+              shards[shard]);
+        });
+
+    next_bfs_level.clear();
+    for (int shard = 0; shard < num_shards; ++shard) {
+      SH_RETURN_IF_ERROR(shard_statuses[shard]);
+      const std::vector<int>& one_step_pops = shards[shard].one_step_pops;
+      for (const PendingFailureLink& pending : shards[shard].children) {
+        SH_RETURN_IF_ERROR(AssignFailureLinkAndPops(
+            pending.node_id, pending.failure_link,
+            absl::MakeConstSpan(one_step_pops)
+                .subspan(pending.one_step_pops_begin,
+                         pending.one_step_pops_end -
+                             pending.one_step_pops_begin),
+            pending.parent_failure_pops_offset_length));
+        next_bfs_level.push_back(pending.node_id);
+      }
     }
+    bfs_level.swap(next_bfs_level);
   }
 
   if (!no_pretokenization_ && !suffix_indicator_.empty()) {
@@ -757,7 +916,7 @@ absl::Status FastWordpieceBuilder::BuildFailureStructure(
 
 absl::Status FastWordpieceBuilder::AssignFailureLinkAndPops(
     uint32_t cur_node, uint32_t failure_link,
-    const std::vector<int>& one_step_pops,
+    absl::Span<const int> one_step_pops,
     int parent_failure_pops_offset_length) {
   if (failure_link == fast_wordpiece_tokenizer_utils::kNullNode) {
     return absl::OkStatus();
@@ -772,10 +931,32 @@ absl::Status FastWordpieceBuilder::AssignFailureLinkAndPops(
   } else {
     // Case 2: F(v) = F(u) + `one_step_pops`. We need to create a new vector and
     // append to `failure_pops_pool_`.
+    if (wide_token_encoding_) {
+      // The list is stored as its length followed by its tokens.
+      const size_t encoded_offset = failure_pops_pool_.size();
+      if (encoded_offset >
+          fast_wordpiece_tokenizer_utils::kMaxSupportedWideFailurePoolOffset) {
+        return absl::FailedPreconditionError(absl::StrCat(
+            "Failure pops list offset is ", encoded_offset,
+            ", which exceeds maximum supported offset ",
+            fast_wordpiece_tokenizer_utils::kMaxSupportedWideFailurePoolOffset,
+            ". The vocabulary seems to be too large to be supported."));
+      }
+      failure_pops_pool_.push_back(0);
+      GetFailurePopsAndAppendToOut(parent_failure_pops_offset_length,
+                                   failure_pops_pool_);
+      failure_pops_pool_.insert(failure_pops_pool_.end(),
+                                one_step_pops.begin(), one_step_pops.end());
+      failure_pops_pool_[encoded_offset] =
+          failure_pops_pool_.size() - encoded_offset - 1;
+      cur_node_fs.failure_pops_offset_length = encoded_offset;
+      return absl::OkStatus();
+    }
     const int failure_pops_offset = failure_pops_pool_.size();
     if (failure_pops_offset >
         fast_wordpiece_tokenizer_utils::kMaxSupportedFailurePoolOffset) {
-      return absl::FailedPreconditionError(absl::StrCat(
+      // BuildModelAndExportToFlatBuffer() retries with the wide encoding.
+      return absl::ResourceExhaustedError(absl::StrCat(
           "Failure pops list offset is ", failure_pops_offset,
           ", which exceeds maximum supported offset ",
           fast_wordpiece_tokenizer_utils::kMaxSupportedFailurePoolOffset,
@@ -808,14 +989,21 @@ absl::Status FastWordpieceBuilder::AssignFailureLinkAndPops(
 }
 
 void FastWordpieceBuilder::GetFailurePopsAndAppendToOut(
-    uint32_t failure_pops_offset_length, std::vector<int>& out_failure_pops) {
+    uint32_t failure_pops_offset_length,
+    std::vector<int>& out_failure_pops) const {
   if (failure_pops_offset_length ==
       fast_wordpiece_tokenizer_utils::kNullFailurePopsList) {
     return;
   }
   int failure_pops_offset, failure_pops_length;
-  fast_wordpiece_tokenizer_utils::GetFailurePopsOffsetAndLength(
-      failure_pops_offset_length, failure_pops_offset, failure_pops_length);
+  if (wide_token_encoding_) {
+    fast_wordpiece_tokenizer_utils::GetWideFailurePopsOffsetAndLength(
+        failure_pops_offset_length, failure_pops_pool_.data(),
+        failure_pops_offset, failure_pops_length);
+  } else {
+    fast_wordpiece_tokenizer_utils::GetFailurePopsOffsetAndLength(
+        failure_pops_offset_length, failure_pops_offset, failure_pops_length);
+  }
   out_failure_pops.insert(
       out_failure_pops.end(), failure_pops_pool_.begin() + failure_pops_offset,
       failure_pops_pool_.begin() + failure_pops_offset + failure_pops_length);
@@ -843,16 +1031,63 @@ absl::Status FastWordpieceBuilder::PrecomputeResultForSuffixIndicator() {
           "Impossible because `subwords[i]` must be in the vocabulary!");
     }
     TrieVocabToken token(subwords[i], *subword_id, suffix_indicator_);
-    SH_ASSIGN_OR_RETURN(
-        int encoded_value,
-        fast_wordpiece_tokenizer_utils::EncodeToken(
-            token.TokenId(), token.TokenLengthWithoutSuffixIndicator(),
-            token.IsSuffixToken()));
+    SH_ASSIGN_OR_RETURN(int encoded_value,
+                        EncodeToken(token.TokenId(),
+                                    token.TokenLengthWithoutSuffixIndicator(),
+                                    token.IsSuffixToken()));
     precomputed_result_for_suffix_indicator_.push_back(encoded_value);
   }
   return absl::OkStatus();
 }
 
+absl::StatusOr<int> FastWordpieceBuilder::EncodeToken(int token_id,
+                                                      int token_length,
+                                                      bool is_suffix_token) {
+  if (!wide_token_encoding_) {
+    return fast_wordpiece_tokenizer_utils::EncodeToken(token_id, token_length,
+                                                       is_suffix_token);
+  }
+  const auto [it, inserted] = wide_token_index_.try_emplace(
+      std::make_tuple(token_id, token_length, is_suffix_token),
+      wide_tokens_.size());
+  if (inserted) {
+    wide_tokens_.emplace_back(token_id, token_length, is_suffix_token);
+  }
+  return it->second;
+}
+
+void FastWordpieceBuilder::BuildCharClassTable() {
+  using fast_wordpiece_tokenizer_utils::kCharClassBitsPerChar;
+  using fast_wordpiece_tokenizer_utils::kCharClassBlockBytes;
+  using fast_wordpiece_tokenizer_utils::kCharClassBlockSize;
+  using fast_wordpiece_tokenizer_utils::kCharClassesPerByte;
+  using fast_wordpiece_tokenizer_utils::kNumCharClassBlocks;
+
+  // Maps the content of each distinct block to its index.
+  absl::flat_hash_map<std::string, uint16_t> block_to_index;
+  char_class_block_index_.clear();
+  char_class_blocks_.clear();
+  char_class_block_index_.reserve(kNumCharClassBlocks);
+  std::string block(kCharClassBlockBytes, 0);
+  for (int block_id = 0; block_id < kNumCharClassBlocks; ++block_id) {
+    std::fill(block.begin(), block.end(), 0);
+    for (int i = 0; i < kCharClassBlockSize; ++i) {
+      const UChar32 cp = block_id * kCharClassBlockSize + i;
+      const uint8_t char_class =
+          fast_wordpiece_tokenizer_utils::GetCharClassFromIcu(cp);
+      block[i / kCharClassesPerByte] |=
+          char_class << ((i % kCharClassesPerByte) * kCharClassBitsPerChar);
+    }
+    const auto [it, inserted] = block_to_index.try_emplace(
+        block, char_class_blocks_.size() / kCharClassBlockBytes);
+    if (inserted) {
+      char_class_blocks_.insert(char_class_blocks_.end(), block.begin(),
+                                block.end());
+    }
+    char_class_block_index_.push_back(it->second);
+  }
+}
+
 absl::StatusOr<std::string> FastWordpieceBuilder::ExportToFlatBuffer() const {
   flatbuffers::FlatBufferBuilder builder;
 
@@ -870,12 +1105,18 @@ absl::StatusOr<std::string> FastWordpieceBuilder::ExportToFlatBuffer() const {
       builder.CreateVector(precomputed_result_for_suffix_indicator_);
   const auto suffix_indicator = builder.CreateString(suffix_indicator_);
   const auto unk_token = builder.CreateString(unk_token_);
+  flatbuffers::Offset<flatbuffers::Vector<const WideToken*>> wide_token_array;
+  if (wide_token_encoding_) {
+    wide_token_array = builder.CreateVectorOfStructs(wide_tokens_);
+  }
 
   std::vector<flatbuffers::Offset<flatbuffers::String>> vocab_fbs_vector;
+  VocabPoolBuilder vocab_pool_builder;
   std::vector<bool> vocab_is_suffix_fbs_vector;
 
   if (support_detokenization_) {
-    vocab_fbs_vector.reserve(vocab_->Size());
+    if (!compact_vocab_) vocab_fbs_vector.reserve(vocab_->Size());
+    vocab_is_suffix_fbs_vector.reserve(vocab_->Size());
     for (int i = 0; i < vocab_->Size(); ++i) {
       const absl::optional<absl::string_view> word = vocab_->LookupWord(i);
       if (!word.has_value()) {
@@ -893,14 +1134,34 @@ absl::StatusOr<std::string> FastWordpieceBuilder::ExportToFlatBuffer() const {
         // stripped anyway).
         token = token.substr(suffix_indicator_.size());
       }
-      vocab_fbs_vector.emplace_back(builder.CreateString(token));
+      if (compact_vocab_) {
+        vocab_pool_builder.Add(token);
+      } else {
+        vocab_fbs_vector.emplace_back(builder.CreateString(token));
+      }
       vocab_is_suffix_fbs_vector.emplace_back(is_suffix_token);
     }
   }
 
-  auto vocab_array = builder.CreateVector(vocab_fbs_vector);
+  const bool write_vocab_pool = support_detokenization_ && compact_vocab_;
+  flatbuffers::Offset<VocabPool::StringVector> vocab_array;
+  flatbuffers::Offset<flatbuffers::String> vocab_pool;
+  flatbuffers::Offset<flatbuffers::Vector<uint32_t>> vocab_offsets;
+  if (write_vocab_pool) {
+    vocab_pool = vocab_pool_builder.CreatePool(builder);
+    vocab_offsets = vocab_pool_builder.CreateOffsets(builder);
+  } else {
+    vocab_array = builder.CreateVector(vocab_fbs_vector);
+  }
   auto vocab_is_suffix_array = builder.CreateVector(vocab_is_suffix_fbs_vector);
 
+  flatbuffers::Offset<flatbuffers::Vector<uint16_t>> char_class_block_index;
+  flatbuffers::Offset<flatbuffers::Vector<uint8_t>> char_class_blocks;
+  if (!char_class_block_index_.empty()) {
+    char_class_block_index = builder.CreateVector(char_class_block_index_);
+    char_class_blocks = builder.CreateVector(char_class_blocks_);
+  }
+
   FastWordpieceTokenizerConfigBuilder wtcb(builder);
   wtcb.add_trie_array(trie_array);
   wtcb.add_failure_struct_array(failure_structure_array);
@@ -916,8 +1177,21 @@ absl::StatusOr<std::string> FastWordpieceBuilder::ExportToFlatBuffer() const {
       precomputed_result_for_suffix_indicator);
   wtcb.add_end_to_end(!no_pretokenization_);
   wtcb.add_support_detokenization(support_detokenization_);
-  wtcb.add_vocab_array(vocab_array);
+  if (write_vocab_pool) {
+    wtcb.add_vocab_pool(vocab_pool);
+    wtcb.add_vocab_offsets(vocab_offsets);
+  } else {
+    wtcb.add_vocab_array(vocab_array);
+  }
   wtcb.add_vocab_is_suffix_array(vocab_is_suffix_array);
+  if (!char_class_block_index_.empty()) {
+    wtcb.add_char_class_block_index(char_class_block_index);
+    wtcb.add_char_class_blocks(char_class_blocks);
+  }
+  if (wide_token_encoding_) {
+    wtcb.add_wide_token_encoding(true);
+    wtcb.add_wide_token_array(wide_token_array);
+  }
   FinishFastWordpieceTokenizerConfigBuffer(builder, wtcb.Finish());
   return std::string(reinterpret_cast<const char*>(builder.GetBufferPointer()),
                      builder.GetSize());
@@ -927,12 +1201,21 @@ absl::StatusOr<std::string> FastWordpieceBuilder::ExportToFlatBuffer() const {
 absl::StatusOr<std::string> BuildModelAndExportToFlatBuffer(
     const std::vector<std::string>& vocab, int max_bytes_per_token,
     absl::string_view suffix_indicator, absl::string_view unk_token,
-    bool no_pretokenization, bool support_detokenization) {
+    bool no_pretokenization, bool support_detokenization,
+    bool wide_token_encoding, bool compact_vocab) {
   FastWordpieceBuilder builder;
-  SH_RETURN_IF_ERROR(builder.BuildModel(vocab, max_bytes_per_token,
-                                        suffix_indicator, unk_token,
-                                        no_pretokenization,
-                                        support_detokenization));
+  const absl::Status status = builder.BuildModel(
+      vocab, max_bytes_per_token, suffix_indicator, unk_token,
+      no_pretokenization, support_detokenization, wide_token_encoding,
+      compact_vocab);
+  if (absl::IsResourceExhausted(status) && !wide_token_encoding) {
+    // The failure pops of the vocabulary do not fit in the compact encoding.
+    return BuildModelAndExportToFlatBuffer(
+        vocab, max_bytes_per_token, suffix_indicator, unk_token,
+        no_pretokenization, support_detokenization,
+        /*wide_token_encoding=*/true, compact_vocab);
+  }
+  SH_RETURN_IF_ERROR(status);
   SH_ASSIGN_OR_RETURN(std::string flatbuffer, builder.ExportToFlatBuffer());
   return flatbuffer;
 }
@@ -41,12 +41,23 @@ namespace text {
 //    Setting it to true expands the size of the flatbuffer. As a reference,
 //    When using 120k multilingual BERT WordPiece vocab, the flatbuffer's size
 //    increases from ~5MB to ~6MB.
+//  * wide_token_encoding: Whether to force the wide encoding of tokens (see
+//    fast_wordpiece_tokenizer_utils.h). It is used anyway when the vocabulary
+//    exceeds the limits of the compact encoding, e.g., has more than 2^22
+//    tokens. The models built with it can only be read by the tokenizers that
+//    support it.
+//  * compact_vocab: Whether to store the vocab for detokenization as a single
+//    pool of characters plus the offset of each token (see vocab_pool.h) rather
+//    than as an array of strings. It saves about 6.5 bytes per token, but the
+//    models built with it can only be detokenized by the tokenizers that
+//    support it.
 // Returns:
 //  The bytes of the flatbuffer that stores the model.
 absl::StatusOr<std::string> BuildModelAndExportToFlatBuffer(
     const std::vector<std::string>& vocab, int max_bytes_per_token,
     absl::string_view suffix_indicator, absl::string_view unk_token,
-    bool no_pretokenization = false, bool support_detokenization = false);
+    bool no_pretokenization = false, bool support_detokenization = false,
+    bool wide_token_encoding = false, bool compact_vocab = false);
 }  // namespace text
 }  // namespace tensorflow
 
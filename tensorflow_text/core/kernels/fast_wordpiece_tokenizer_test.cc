@@ -14,12 +14,17 @@
 
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer.h"
 
+#include <algorithm>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
 #include "icu4c/source/common/unicode/uchar.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_model_builder.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_model_generated.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_word_cache.h"
 
 namespace tensorflow {
 namespace text {
@@ -27,6 +32,7 @@ namespace {
 
 using ::testing::AnyOf;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 
 constexpr char kTestConfigPath[] =
     "tensorflow_text/python/ops/test_data/"
@@ -1227,6 +1233,29 @@ TEST_P(TestTokenizeSingleWord, Test) {
   EXPECT_THAT(output_end_offsets, spec.expected_token_end_offsets);
 }
 
+TEST_P(TestTokenizeSingleWord, TestWideTokenEncoding) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(
+          spec.vocab, spec.max_bytes_per_token, spec.suffix_indicator,
+          spec.unk_token, /*no_pretokenization=*/true,
+          /*support_detokenization=*/false, /*wide_token_encoding=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  std::vector<std::string> output_tokens;
+  std::vector<int> output_ids;
+  std::vector<int> output_begin_offsets;
+  std::vector<int> output_end_offsets;
+  tokenizer.Tokenize(spec.input, &output_tokens, &output_ids,
+                     &output_begin_offsets, &output_end_offsets);
+  EXPECT_THAT(output_tokens, spec.expected_tokens);
+  EXPECT_THAT(output_ids, spec.expected_token_ids);
+  EXPECT_THAT(output_begin_offsets, spec.expected_token_start_offsets);
+  EXPECT_THAT(output_end_offsets, spec.expected_token_end_offsets);
+}
+
 TEST_P(TestTokenizeSingleWord, TestNoOutputPieces) {
   const Spec& spec = GetParam();
   ASSERT_OK_AND_ASSIGN(
@@ -1294,6 +1323,147 @@ TEST_P(TestTokenizeSingleWord, TestNoOutputPiecesWithPositiveSentenceOffsets) {
   EXPECT_THAT(output_end_offsets, expected_token_end_offsets);
 }
 
+TEST_P(TestTokenizeSingleWord, TestTokenizeIntoBuffer) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token,
+                                      /*no_pretokenization=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  // First pass: only count the tokens.
+  TokenBufferWriter<int64_t> counter;
+  tokenizer.TokenizeIntoBuffer</*kGetPieces=*/false, /*kGetOffsets=*/false>(
+      spec.input, counter);
+  ASSERT_EQ(counter.size(), spec.expected_token_ids.size());
+
+  // Second pass: write the tokens into preallocated buffers.
+  std::vector<std::string> output_tokens(counter.size());
+  std::vector<int64_t> output_ids(counter.size());
+  std::vector<int64_t> output_begin_offsets(counter.size());
+  std::vector<int64_t> output_end_offsets(counter.size());
+  auto write_token = [&output_tokens](int index, absl::string_view prefix,
+                                      absl::string_view piece) {
+    output_tokens[index] = absl::StrCat(prefix, piece);
+  };
+  TokenBufferWriter<int64_t> writer(counter.size(), output_ids.data(),
+                                    output_begin_offsets.data(),
+                                    output_end_offsets.data(), write_token);
+  tokenizer.TokenizeIntoBuffer</*kGetPieces=*/true, /*kGetOffsets=*/true>(
+      spec.input, writer);
+  EXPECT_EQ(writer.size(), counter.size());
+  EXPECT_THAT(output_tokens, spec.expected_tokens);
+  EXPECT_THAT(output_ids, ElementsAreArray(spec.expected_token_ids));
+  EXPECT_THAT(output_begin_offsets,
+              ElementsAreArray(spec.expected_token_start_offsets));
+  EXPECT_THAT(output_end_offsets,
+              ElementsAreArray(spec.expected_token_end_offsets));
+}
+
+TEST_P(TestTokenizeSingleWord, TestWithWordCache) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token,
+                                      /*no_pretokenization=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+  FastWordpieceWordCache word_cache(/*capacity=*/16);
+  tokenizer.SetWordCache(&word_cache);
+
+  // The first round fills the cache and the second one reads from it. The
+  // results should be the same as without the cache.
+  for (int round = 0; round < 2; ++round) {
+    std::vector<std::string> output_tokens;
+    std::vector<int> output_ids;
+    std::vector<int> output_begin_offsets;
+    std::vector<int> output_end_offsets;
+    tokenizer.Tokenize(spec.input, &output_tokens, &output_ids,
+                       &output_begin_offsets, &output_end_offsets);
+    EXPECT_THAT(output_tokens, spec.expected_tokens);
+    EXPECT_THAT(output_ids, spec.expected_token_ids);
+    EXPECT_THAT(output_begin_offsets, spec.expected_token_start_offsets);
+    EXPECT_THAT(output_end_offsets, spec.expected_token_end_offsets);
+
+    std::vector<int> output_ids_only;
+    tokenizer.Tokenize(spec.input, &output_ids_only);
+    EXPECT_THAT(output_ids_only, spec.expected_token_ids);
+  }
+  if (word_cache.size() > 0) {
+    EXPECT_GT(word_cache.hits(), 0);
+  }
+}
+
+TEST_P(TestTokenizeSingleWord, TestMaxNumTokens) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token,
+                                      /*no_pretokenization=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  const int num_tokens = spec.expected_token_ids.size();
+  for (int max_num_tokens = 0; max_num_tokens <= num_tokens + 1;
+       ++max_num_tokens) {
+    const int num_kept = std::min(max_num_tokens, num_tokens);
+    std::vector<std::string> output_tokens;
+    std::vector<int> output_ids;
+    std::vector<int> output_begin_offsets;
+    std::vector<int> output_end_offsets;
+    bool truncated = false;
+    tokenizer.Tokenize(spec.input, &output_tokens, &output_ids,
+                       &output_begin_offsets, &output_end_offsets,
+                       /*input_word_offset_in_text=*/0, /*error=*/nullptr,
+                       max_num_tokens, &truncated);
+    EXPECT_THAT(output_tokens,
+                ElementsAreArray(spec.expected_tokens.begin(),
+                                 spec.expected_tokens.begin() + num_kept));
+    EXPECT_THAT(output_ids,
+                ElementsAreArray(spec.expected_token_ids.begin(),
+                                 spec.expected_token_ids.begin() + num_kept));
+    EXPECT_EQ(truncated, max_num_tokens < num_tokens);
+  }
+}
+
+TEST_P(TestTokenizeSingleWord, TestStreaming) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token,
+                                      /*no_pretokenization=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  // Chunks may end anywhere, even in the middle of a UTF-8 character.
+  FastWordpieceTokenizer::StreamState state;
+  for (int chunk_size : {1, 2, 3, 7}) {
+    std::vector<std::string> output_tokens;
+    std::vector<int> output_ids;
+    std::vector<int> output_begin_offsets;
+    std::vector<int> output_end_offsets;
+    for (int pos = 0; pos < static_cast<int>(spec.input.size());
+         pos += chunk_size) {
+      tokenizer.TokenizeChunk(
+          absl::string_view(spec.input).substr(pos, chunk_size), state,
+          &output_tokens, &output_ids, &output_begin_offsets,
+          &output_end_offsets);
+    }
+    tokenizer.FinishStream(state, &output_tokens, &output_ids,
+                           &output_begin_offsets, &output_end_offsets);
+    EXPECT_THAT(output_tokens, spec.expected_tokens);
+    EXPECT_THAT(output_ids, spec.expected_token_ids);
+    EXPECT_THAT(output_begin_offsets, spec.expected_token_start_offsets);
+    EXPECT_THAT(output_end_offsets, spec.expected_token_end_offsets);
+    EXPECT_EQ(state.num_bytes(), 0);
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(
     FastWordpieceTokenizerParameterizedTest, TestTokenizeSingleWord,
     testing::ValuesIn(GetTestSpecsForTokenizeSingleWord()));
@@ -2452,6 +2622,29 @@ TEST_P(TestTokenizeText, Test) {
   EXPECT_THAT(output_end_offsets, spec.expected_token_end_offsets);
 }
 
+TEST_P(TestTokenizeText, TestWideTokenEncoding) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(
+          spec.vocab, spec.max_bytes_per_token, spec.suffix_indicator,
+          spec.unk_token, /*no_pretokenization=*/false,
+          /*support_detokenization=*/false, /*wide_token_encoding=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  std::vector<std::string> output_tokens;
+  std::vector<int> output_ids;
+  std::vector<int> output_begin_offsets;
+  std::vector<int> output_end_offsets;
+  tokenizer.Tokenize(spec.input, &output_tokens, &output_ids,
+                     &output_begin_offsets, &output_end_offsets);
+  EXPECT_THAT(output_tokens, spec.expected_tokens);
+  EXPECT_THAT(output_ids, spec.expected_token_ids);
+  EXPECT_THAT(output_begin_offsets, spec.expected_token_start_offsets);
+  EXPECT_THAT(output_end_offsets, spec.expected_token_end_offsets);
+}
+
 TEST_P(TestTokenizeText, TestNoOutputPieces) {
   const Spec& spec = GetParam();
   ASSERT_OK_AND_ASSIGN(
@@ -2485,6 +2678,160 @@ TEST_P(TestTokenizeText, TestNoOutputPiecesOnlyOutputIds) {
   EXPECT_THAT(output_ids, spec.expected_token_ids);
 }
 
+TEST_P(TestTokenizeText, TestTokenizeIntoBuffer) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  // First pass: only count the tokens.
+  TokenBufferWriter<int64_t> counter;
+  tokenizer.TokenizeIntoBuffer</*kGetPieces=*/false, /*kGetOffsets=*/false>(
+      spec.input, counter);
+  ASSERT_EQ(counter.size(), spec.expected_token_ids.size());
+
+  // Second pass: write the tokens into preallocated buffers.
+  std::vector<std::string> output_tokens(counter.size());
+  std::vector<int64_t> output_ids(counter.size());
+  std::vector<int64_t> output_begin_offsets(counter.size());
+  std::vector<int64_t> output_end_offsets(counter.size());
+  auto write_token = [&output_tokens](int index, absl::string_view prefix,
+                                      absl::string_view piece) {
+    output_tokens[index] = absl::StrCat(prefix, piece);
+  };
+  TokenBufferWriter<int64_t> writer(counter.size(), output_ids.data(),
+                                    output_begin_offsets.data(),
+                                    output_end_offsets.data(), write_token);
+  tokenizer.TokenizeIntoBuffer</*kGetPieces=*/true, /*kGetOffsets=*/true>(
+      spec.input, writer);
+  EXPECT_EQ(writer.size(), counter.size());
+  EXPECT_THAT(output_tokens, spec.expected_tokens);
+  EXPECT_THAT(output_ids, ElementsAreArray(spec.expected_token_ids));
+  EXPECT_THAT(output_begin_offsets,
+              ElementsAreArray(spec.expected_token_start_offsets));
+  EXPECT_THAT(output_end_offsets,
+              ElementsAreArray(spec.expected_token_end_offsets));
+}
+
+TEST_P(TestTokenizeText, TestWithWordCache) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+  FastWordpieceWordCache word_cache(/*capacity=*/16);
+  tokenizer.SetWordCache(&word_cache);
+
+  // The first round fills the cache and the second one reads from it. The
+  // results should be the same as without the cache.
+  for (int round = 0; round < 2; ++round) {
+    std::vector<std::string> output_tokens;
+    std::vector<int> output_ids;
+    std::vector<int> output_begin_offsets;
+    std::vector<int> output_end_offsets;
+    tokenizer.Tokenize(spec.input, &output_tokens, &output_ids,
+                       &output_begin_offsets, &output_end_offsets);
+    EXPECT_THAT(output_tokens, spec.expected_tokens);
+    EXPECT_THAT(output_ids, spec.expected_token_ids);
+    EXPECT_THAT(output_begin_offsets, spec.expected_token_start_offsets);
+    EXPECT_THAT(output_end_offsets, spec.expected_token_end_offsets);
+
+    std::vector<int> output_ids_only;
+    tokenizer.Tokenize(spec.input, &output_ids_only);
+    EXPECT_THAT(output_ids_only, spec.expected_token_ids);
+  }
+  if (word_cache.size() > 0) {
+    EXPECT_GT(word_cache.hits(), 0);
+  }
+}
+
+TEST_P(TestTokenizeText, TestStreaming) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  // Chunks may end anywhere, even in the middle of a UTF-8 character.
+  FastWordpieceTokenizer::StreamState state;
+  for (int chunk_size : {1, 2, 3, 7}) {
+    std::vector<std::string> output_tokens;
+    std::vector<int> output_ids;
+    std::vector<int> output_begin_offsets;
+    std::vector<int> output_end_offsets;
+    for (int pos = 0; pos < static_cast<int>(spec.input.size());
+         pos += chunk_size) {
+      tokenizer.TokenizeChunk(
+          absl::string_view(spec.input).substr(pos, chunk_size), state,
+          &output_tokens, &output_ids, &output_begin_offsets,
+          &output_end_offsets);
+    }
+    tokenizer.FinishStream(state, &output_tokens, &output_ids,
+                           &output_begin_offsets, &output_end_offsets);
+    EXPECT_THAT(output_tokens, spec.expected_tokens);
+    EXPECT_THAT(output_ids, spec.expected_token_ids);
+    EXPECT_THAT(output_begin_offsets, spec.expected_token_start_offsets);
+    EXPECT_THAT(output_end_offsets, spec.expected_token_end_offsets);
+    EXPECT_EQ(state.num_bytes(), 0);
+  }
+}
+
+TEST_P(TestTokenizeText, TestMaxNumTokens) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  const int num_tokens = spec.expected_token_ids.size();
+  for (int max_num_tokens = 0; max_num_tokens <= num_tokens + 1;
+       ++max_num_tokens) {
+    const int num_kept = std::min(max_num_tokens, num_tokens);
+    // The budget is for the new tokens, after the ones already in the output.
+    std::vector<std::string> output_tokens = {"x"};
+    std::vector<int> output_ids = {-1};
+    std::vector<int> output_begin_offsets = {-1};
+    std::vector<int> output_end_offsets = {-1};
+    bool truncated = false;
+    tokenizer.Tokenize(spec.input, &output_tokens, &output_ids,
+                       &output_begin_offsets, &output_end_offsets,
+                       /*input_word_offset_in_text=*/0, /*error=*/nullptr,
+                       max_num_tokens, &truncated);
+    ASSERT_EQ(output_ids.size(), num_kept + 1);
+    EXPECT_THAT(std::vector<int>(output_ids.begin() + 1, output_ids.end()),
+                ElementsAreArray(spec.expected_token_ids.begin(),
+                                 spec.expected_token_ids.begin() + num_kept));
+    EXPECT_THAT(std::vector<std::string>(output_tokens.begin() + 1,
+                                         output_tokens.end()),
+                ElementsAreArray(spec.expected_tokens.begin(),
+                                 spec.expected_tokens.begin() + num_kept));
+    EXPECT_THAT(std::vector<int>(output_end_offsets.begin() + 1,
+                                 output_end_offsets.end()),
+                ElementsAreArray(
+                    spec.expected_token_end_offsets.begin(),
+                    spec.expected_token_end_offsets.begin() + num_kept));
+    EXPECT_EQ(truncated, max_num_tokens < num_tokens);
+
+    // Counting the tokens gives the same result.
+    TokenBufferWriter<int64_t> counter;
+    bool counter_truncated = false;
+    tokenizer.TokenizeIntoBuffer</*kGetPieces=*/false, /*kGetOffsets=*/false>(
+        spec.input, counter, /*input_word_offset_in_text=*/0,
+        /*error=*/nullptr, max_num_tokens, &counter_truncated);
+    EXPECT_EQ(counter.size(), num_kept);
+    EXPECT_EQ(counter_truncated, truncated);
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(EndToEndFastWordpieceTokenizerParameterizedTest,
                          TestTokenizeText,
                          testing::ValuesIn(GetTestSpecsForTokenizeText()));
@@ -2545,10 +2892,187 @@ TEST_P(TestTokenizeDetokenize, Test) {
   EXPECT_THAT(output_text, spec.expected_detokenized_text);
 }
 
+TEST_P(TestTokenizeDetokenize, TestDetokenizeBatch) {
+  const Spec& spec = GetParam();
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(spec.vocab, spec.max_bytes_per_token,
+                                      spec.suffix_indicator, spec.unk_token,
+                                      /*no_pretokenization=*/true,
+                                      /*support_detokenization=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  // Rows: the ids of the spec, an empty row, and the ids of the spec again.
+  std::vector<int> ids = spec.expected_token_ids;
+  ids.insert(ids.end(), spec.expected_token_ids.begin(),
+             spec.expected_token_ids.end());
+  const int64_t num_ids = spec.expected_token_ids.size();
+  const std::vector<int64_t> row_splits = {0, num_ids, num_ids, 2 * num_ids};
+  std::string texts = "prefix";
+  std::vector<int64_t> text_ends;
+  ASSERT_TRUE(
+      tokenizer.DetokenizeBatch(ids, row_splits, &texts, &text_ends).ok());
+  const int64_t text_size = spec.expected_detokenized_text.size();
+  EXPECT_EQ(texts, absl::StrCat("prefix", spec.expected_detokenized_text,
+                                spec.expected_detokenized_text));
+  EXPECT_THAT(text_ends, ElementsAre(6 + text_size, 6 + text_size,
+                                     6 + 2 * text_size));
+}
+
 INSTANTIATE_TEST_SUITE_P(
     FastWordpieceTokenizerDetokenizeParameterizedTest, TestTokenizeDetokenize,
     testing::ValuesIn(GetTestSpecsForTokenizeDetokenize()));
 
+TEST(FastWordpieceTokenizerTest, DetokenizeBatchInvalidInput) {
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer({"a", "##b", "<unk>"},
+                                      /*max_bytes_per_token=*/100,
+                                      /*suffix_indicator=*/"##",
+                                      /*unk_token=*/"<unk>",
+                                      /*no_pretokenization=*/true,
+                                      /*support_detokenization=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+  std::string texts;
+  std::vector<int64_t> text_ends;
+  EXPECT_FALSE(tokenizer.DetokenizeBatch({0, 3}, {0, 2}, &texts, &text_ends)
+                   .ok());
+  EXPECT_FALSE(tokenizer.DetokenizeBatch({0, 1}, {0, 3}, &texts, &text_ends)
+                   .ok());
+  EXPECT_FALSE(tokenizer.DetokenizeBatch({0, 1}, {1, 0}, &texts, &text_ends)
+                   .ok());
+  EXPECT_TRUE(texts.empty());
+  EXPECT_TRUE(text_ends.empty());
+}
+
+TEST(FastWordpieceTokenizerTest, StreamingBoundsPendingText) {
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer({"a", "##a", ".", "é", "##é", "<unk>"},
+                                      /*max_bytes_per_token=*/100,
+                                      /*suffix_indicator=*/"##",
+                                      /*unk_token=*/"<unk>"));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  // Streams `text` one byte at a time, keeping at most 8 bytes pending.
+  auto stream = [&tokenizer](absl::string_view text) {
+    FastWordpieceTokenizer::StreamState state(/*max_pending_bytes=*/8);
+    std::vector<std::string> output_tokens;
+    std::vector<int> output_ids;
+    std::vector<int> output_begin_offsets;
+    std::vector<int> output_end_offsets;
+    for (int pos = 0; pos < static_cast<int>(text.size()); ++pos) {
+      tokenizer.TokenizeChunk(text.substr(pos, 1), state, &output_tokens,
+                              &output_ids, &output_begin_offsets,
+                              &output_end_offsets);
+      EXPECT_LE(state.num_pending_bytes(), 8);
+    }
+    tokenizer.FinishStream(state, &output_tokens, &output_ids,
+                           &output_begin_offsets, &output_end_offsets);
+    return output_tokens;
+  };
+
+  // Long runs are cut after a punctuation, which keeps the words whole.
+  const std::string punctuated = "aa.aa.aa.aa.aa.aa.";
+  std::vector<std::string> expected_tokens;
+  std::vector<int> expected_ids;
+  std::vector<int> expected_begin_offsets;
+  std::vector<int> expected_end_offsets;
+  tokenizer.Tokenize(punctuated, &expected_tokens, &expected_ids,
+                     &expected_begin_offsets, &expected_end_offsets);
+  EXPECT_THAT(stream(punctuated), ElementsAreArray(expected_tokens));
+
+  // Otherwise, they are cut between characters, which splits the words.
+  EXPECT_THAT(stream(std::string(20, 'a')),
+              ElementsAre("a", "##a", "##a", "##a", "##a", "##a", "##a", "##a",
+                          "a", "##a", "##a", "##a", "##a", "##a", "##a", "##a",
+                          "a", "##a", "##a", "##a"));
+  EXPECT_THAT(stream("ééééé"), ElementsAre("é", "##é", "##é", "##é", "é"));
+}
+
+TEST(FastWordpieceTokenizerTest, TokenizeWithVocabTokensLongerThan256Bytes) {
+  // Such tokens do not fit in the compact encoding, so the builder uses the
+  // wide encoding.
+  const std::string long_token(300, 'a');
+  ASSERT_OK_AND_ASSIGN(
+      std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(
+          {"a", long_token, absl::StrCat("##", long_token), "##b", "<unk>",
+           "##a"},
+          /*max_bytes_per_token=*/1000,
+          /*suffix_indicator=*/"##",
+          /*unk_token=*/"<unk>",
+          /*no_pretokenization=*/true));
+  ASSERT_OK_AND_ASSIGN(auto tokenizer,
+                       FastWordpieceTokenizer::Create(flatbuffer.data()));
+
+  std::vector<std::string> output_tokens;
+  std::vector<int> output_ids;
+  std::vector<int> output_begin_offsets;
+  std::vector<int> output_end_offsets;
+  tokenizer.Tokenize(absl::StrCat(long_token, long_token, "ab"),
+                     &output_tokens, &output_ids, &output_begin_offsets,
+                     &output_end_offsets);
+  EXPECT_THAT(output_tokens,
+              ElementsAre(long_token, absl::StrCat("##", long_token), "##a",
+                          "##b"));
+  EXPECT_THAT(output_ids, ElementsAre(1, 2, 5, 3));
+  EXPECT_THAT(output_begin_offsets, ElementsAre(0, 300, 600, 601));
+  EXPECT_THAT(output_end_offsets, ElementsAre(300, 600, 601, 602));
+}
+
+TEST(FastWordpieceTokenizerTest, CreateRejectsOutOfRangeWideTokens) {
+  ASSERT_OK_AND_ASSIGN(
+      const std::string flatbuffer,
+      BuildModelAndExportToFlatBuffer(
+          {"a", "abc", "##b", "##c", "<unk>"}, /*max_bytes_per_token=*/100,
+          /*suffix_indicator=*/"##", /*unk_token=*/"<unk>",
+          /*no_pretokenization=*/true, /*support_detokenization=*/false,
+          /*wide_token_encoding=*/true));
+  ASSERT_TRUE(FastWordpieceTokenizer::Create(flatbuffer.data()).ok());
+  const int num_wide_tokens =
+      GetFastWordpieceTokenizerConfig(flatbuffer.data())
+          ->wide_token_array()
+          ->size();
+
+  // Each case below overwrites one encoded token value, in a copy of the
+  // model, with the first index out of `wide_token_array`.
+  {
+    std::string model = flatbuffer;
+    const auto* trie =
+        GetFastWordpieceTokenizerConfig(model.data())->trie_array();
+    uint32_t* units = const_cast<uint32_t*>(trie->data());
+    // A leaf unit of the darts_clone trie: the MSB is set and the other bits
+    // hold the value.
+    uint32_t* leaf = std::find_if(units, units + trie->size(),
+                                  [](uint32_t unit) { return unit >> 31; });
+    ASSERT_NE(leaf, units + trie->size());
+    *leaf = 0x80000000 | num_wide_tokens;
+    EXPECT_FALSE(FastWordpieceTokenizer::Create(model.data()).ok());
+  }
+  {
+    std::string model = flatbuffer;
+    const auto* precomputed_result =
+        GetFastWordpieceTokenizerConfig(model.data())
+            ->precomputed_result_for_suffix_indicator();
+    ASSERT_GT(precomputed_result->size(), 0);
+    const_cast<int*>(precomputed_result->data())[0] = num_wide_tokens;
+    EXPECT_FALSE(FastWordpieceTokenizer::Create(model.data()).ok());
+  }
+  {
+    std::string model = flatbuffer;
+    const auto* failure_pops_pool =
+        GetFastWordpieceTokenizerConfig(model.data())->failure_pops_pool();
+    // The first list of the pool: its length, then its tokens.
+    ASSERT_GT(failure_pops_pool->size(), 1);
+    const_cast<int*>(failure_pops_pool->data())[1] = num_wide_tokens;
+    EXPECT_FALSE(FastWordpieceTokenizer::Create(model.data()).ok());
+  }
+}
+
 }  // namespace
 }  // namespace text
 }  // namespace tensorflow
@@ -14,22 +14,44 @@
 
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_tflite.h"
 
+#include <cstdint>
+
 #include "tensorflow/lite/kernels/shim/tflite_op_shim.h"
+#include "tensorflow/lite/kernels/shim/tflite_op_wrapper.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_kernel_template.h"
+#include "tensorflow_text/core/kernels/tflite_type_attr_defaults.h"
 
 namespace tflite {
 namespace ops {
 namespace custom {
 namespace text {
+namespace {
+const char out_type[]("out_type"), splits_type[]("Tsplits");
+}  // namespace
+
+using ::tflite::shim::op_wrapper::Attr;
+using ::tflite::shim::op_wrapper::AttrName;
+using ::tflite::shim::op_wrapper::OpWrapper;
+
+template <shim::Runtime Rt>
+using TokenizeOp =
+    OpWrapper<Rt, tensorflow::text::FastWordpieceTokenizeWithOffsetsOp,
+              Attr<AttrName<out_type>, int32_t, int64_t>,
+              Attr<AttrName<splits_type>, int32_t, int64_t>>;
 
-using TokenizeOpKernel = tflite::shim::TfLiteOpKernel<
-    tensorflow::text::FastWordpieceTokenizeWithOffsetsOp>;
+using TokenizeOpKernel = tflite::shim::TfLiteOpKernel<TokenizeOp>;
 
 using DetokenizeOpKernel =
     tflite::shim::TfLiteOpKernel<tensorflow::text::FastWordpieceDetokenizeOp>;
 
 extern "C" void AddFastWordpieceTokenize(tflite::MutableOpResolver* resolver) {
-  TokenizeOpKernel::Add(resolver);
+  resolver->AddCustom(TokenizeOp<shim::Runtime::kTfLite>::OpName(),
+                      Register_FastWordpieceTokenize());
+}
+
+TfLiteRegistration* Register_FastWordpieceTokenize() {
+  return GetRegistrationWithInt64TypeDefaults<TokenizeOpKernel, out_type,
+                                              splits_type>();
 }
 
 extern "C" void AddFastWordpieceDetokenize(
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_TENSORFLOW_TEXT_GOOGLE_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_TFLITE_H_
 #define THIRD_PARTY_TENSORFLOW_TEXT_GOOGLE_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_TFLITE_H_
 
+#include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/mutable_op_resolver.h"
 
 namespace tflite {
@@ -27,6 +28,8 @@ extern "C" void AddFastWordpieceTokenize(::tflite::MutableOpResolver* resolver);
 extern "C" void AddFastWordpieceDetokenize(
     ::tflite::MutableOpResolver* resolver);
 
+TfLiteRegistration* Register_FastWordpieceTokenize();
+
 }  // namespace text
 }  // namespace custom
 }  // namespace ops
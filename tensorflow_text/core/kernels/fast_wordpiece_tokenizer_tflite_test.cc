@@ -0,0 +1,137 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_tflite.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "flatbuffers/flexbuffers.h"
+#include "tensorflow/lite/kernels/test_util.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/string_util.h"
+#include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_model_builder.h"
+
+namespace tflite {
+namespace ops {
+namespace custom {
+namespace text {
+namespace {
+
+using ::testing::ElementsAre;
+
+// A FastWordpieceTokenizeWithOffsets op as in the TFLite models converted
+// before the `row_truncated` output was added, i.e., with only 5 outputs.
+// Without `type_attrs`, as in the models converted before the `out_type` and
+// `Tsplits` attributes were added.
+class FastWordpieceTokenizeModel : public SingleOpModel {
+ public:
+  FastWordpieceTokenizeModel(const std::vector<std::string>& input_values,
+                             const std::string& wp_model,
+                             bool type_attrs = true) {
+    input_values_ = AddInput(TensorType_STRING);
+    wp_model_ = AddInput(TensorType_UINT8);
+    output_subwords_ = AddOutput(TensorType_STRING);
+    output_ids_ = AddOutput(TensorType_INT64);
+    output_row_splits_ = AddOutput(TensorType_INT64);
+    start_values_ = AddOutput(TensorType_INT64);
+    end_values_ = AddOutput(TensorType_INT64);
+
+    flexbuffers::Builder fbb;
+    size_t start_map = fbb.StartMap();
+    fbb.Bool("get_subwords", true);
+    fbb.Bool("get_offsets", true);
+    if (type_attrs) {
+      fbb.Int("out_type", TensorType_INT64);
+      fbb.Int("Tsplits", TensorType_INT64);
+    }
+    fbb.EndMap(start_map);
+    fbb.Finish();
+    SetCustomOp("FastWordpieceTokenizeWithOffsets", fbb.GetBuffer(),
+                Register_FastWordpieceTokenize);
+
+    BuildInterpreter({{static_cast<int>(input_values.size())},
+                      {static_cast<int>(wp_model.size())}});
+    PopulateStringTensor(input_values_, input_values);
+    PopulateTensor<uint8_t>(
+        wp_model_, std::vector<uint8_t>(wp_model.begin(), wp_model.end()));
+  }
+
+  std::vector<std::string> GetSubwords() {
+    std::vector<std::string> subwords;
+    TfLiteTensor* tensor = interpreter_->tensor(output_subwords_);
+    for (int i = 0; i < GetStringCount(tensor); ++i) {
+      StringRef ref = GetString(tensor, i);
+      subwords.emplace_back(ref.str, ref.len);
+    }
+    return subwords;
+  }
+  std::vector<int64_t> GetIds() { return ExtractVector<int64_t>(output_ids_); }
+  std::vector<int64_t> GetRowSplits() {
+    return ExtractVector<int64_t>(output_row_splits_);
+  }
+  std::vector<int64_t> GetStartValues() {
+    return ExtractVector<int64_t>(start_values_);
+  }
+  std::vector<int64_t> GetEndValues() {
+    return ExtractVector<int64_t>(end_values_);
+  }
+
+ private:
+  int input_values_;
+  int wp_model_;
+  int output_subwords_;
+  int output_ids_;
+  int output_row_splits_;
+  int start_values_;
+  int end_values_;
+};
+
+std::string BuildTestModel() {
+  const auto wp_model = tensorflow::text::BuildModelAndExportToFlatBuffer(
+      {"a", "b", "##b", "[UNK]"}, /*max_bytes_per_token=*/100,
+      /*suffix_indicator=*/"##", /*unk_token=*/"[UNK]");
+  EXPECT_TRUE(wp_model.ok());
+  return wp_model.ok() ? *wp_model : std::string();
+}
+
+void ExpectTokenized(FastWordpieceTokenizeModel& m) {
+  EXPECT_THAT(m.GetSubwords(), ElementsAre("a", "b", "##b", "[UNK]"));
+  EXPECT_THAT(m.GetIds(), ElementsAre(0, 1, 2, 3));
+  EXPECT_THAT(m.GetRowSplits(), ElementsAre(0, 3, 4));
+  EXPECT_THAT(m.GetStartValues(), ElementsAre(0, 2, 3, 0));
+  EXPECT_THAT(m.GetEndValues(), ElementsAre(1, 3, 4, 1));
+}
+
+TEST(FastWordpieceTokenizeTfLiteTest, RunsWithoutRowTruncatedOutput) {
+  FastWordpieceTokenizeModel m({"a bb", "c"}, BuildTestModel());
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+  ExpectTokenized(m);
+}
+
+TEST(FastWordpieceTokenizeTfLiteTest, MissingTypeAttrsDefaultToInt64) {
+  FastWordpieceTokenizeModel m({"a bb", "c"}, BuildTestModel(),
+                               /*type_attrs=*/false);
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+  ExpectTokenized(m);
+}
+
+}  // namespace
+}  // namespace text
+}  // namespace custom
+}  // namespace ops
+}  // namespace tflite
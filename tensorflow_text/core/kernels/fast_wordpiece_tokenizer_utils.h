@@ -18,10 +18,10 @@
 //
 // The assumptions are adjustable by setting the constants defined in this file.
 //
-// Note: by recompiling the underlying trie library and the helper functions in
-// this file to use 64-bit (or even larger) integers, we can support even a
-// larger vocab size and longer vocab tokens. Still, we believe the current
-// implementation covers all real cases.
+// Models whose vocabulary exceeds these limits are built with the wide encoding
+// instead (see "Wide encoding" below), which supports up to 2^31 tokens at the
+// cost of one more memory access per token. Models within the limits are built
+// with the compact encoding as before.
 #ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_UTILS_H_
 #define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_TOKENIZER_UTILS_H_
 
@@ -29,6 +29,13 @@
 
 #include <limits>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "absl/numeric/bits.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "icu4c/source/common/unicode/uchar.h"
@@ -232,6 +239,38 @@ inline void GetFailurePopsOffsetAndLength(uint32_t offset_and_length,
   out_length = (offset_and_length & kMaskToEncodeFailurePopsListSize) + 1;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Wide encoding.
+//
+// Models with `wide_token_encoding` (see FastWordpieceTokenizerConfig) lift the
+// limits of the compact encodings above:
+//  * An encoded token value is the index of the token in `wide_token_array`,
+//    which holds its token id, length and is_suffix_token.
+//  * An encoded failure pop list is the offset of the list in the failure pops
+//    pool, where the list is stored as its length followed by its tokens.
+////////////////////////////////////////////////////////////////////////////////
+
+// The maximum vocab size supported by the wide encoding. The indices in
+// `wide_token_array` are non-negative ints, and also cover the dummy tokens of
+// punctuation chars that are not in the vocabulary.
+static constexpr uint32_t kMaxSupportedWideVocabSize =
+    std::numeric_limits<int>::max() / 2;
+
+// The maximum valid offset in the failure pool with the wide encoding, so that
+// it is different from `kNullFailurePopsList`.
+static constexpr uint32_t kMaxSupportedWideFailurePoolOffset =
+    std::numeric_limits<int>::max();
+
+// Decodes the offset (in the failure pop pool) and the length of a failure pop
+// list of the wide encoding.
+inline void GetWideFailurePopsOffsetAndLength(uint32_t encoded_offset,
+                                              const int* failure_pops_pool,
+                                              int& out_offset,
+                                              int& out_length) {
+  out_offset = encoded_offset + 1;
+  out_length = failure_pops_pool[encoded_offset];
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Constants related to the Trie structure.
 ////////////////////////////////////////////////////////////////////////////////
@@ -248,22 +287,209 @@ static constexpr uint32_t kMaxSupportedTrieSize =
 ////////////////////////////////////////////////////////////////////////////////
 // Helpers for analyzing Unicode characters.
 ////////////////////////////////////////////////////////////////////////////////
+
+// Returns true if the ASCII char `ch` is a punctuation char, as defined by
+// `IsPunctuationOrChineseChar`. Note that some special chars e.g. ">", "$" that
+// are not covered by the u_ispunct are considered as punctuation chars.
+inline constexpr bool IsAsciiPunctuation(unsigned char ch) {
+  return (ch >= 33 && ch <= 47) || (ch >= 58 && ch <= 64) ||
+         (ch >= 91 && ch <= 96) || (ch >= 123 && ch <= 126);
+}
+
+// Returns true if the ASCII char `ch` is a whitespace, i.e., has the Unicode
+// White_Space property as tested by `u_isUWhiteSpace`.
+inline constexpr bool IsAsciiWhiteSpace(unsigned char ch) {
+  return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+// Same as `u_isUWhiteSpace`, but without calling ICU for ASCII chars.
+inline bool IsWhiteSpace(UChar32 char_value) {
+  if (char_value >= 0 && char_value < 0x80) {
+    return IsAsciiWhiteSpace(char_value);
+  }
+  return u_isUWhiteSpace(char_value);
+}
+
+// Returns true for Chinese characters that are treated as punctuation in Bert.
+inline bool IsChineseChar(UChar32 char_value) {
+  uint32_t cp = static_cast<uint32_t>(char_value);
+  return (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF) ||
+         (cp >= 0x20000 && cp <= 0x2A6DF) || (cp >= 0x2A700 && cp <= 0x2B73F) ||
+         (cp >= 0x2B740 && cp <= 0x2B81F) || (cp >= 0x2B820 && cp <= 0x2CEAF) ||
+         (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0x2F800 && cp <= 0x2FA1F);
+}
+
 inline bool IsPunctuationOrChineseChar(UChar32 char_value) {
   uint32_t cp = static_cast<uint32_t>(char_value);
-  // Chinese characters that are treated as punctuation in Bert.
-  if ((cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF) ||
-      (cp >= 0x20000 && cp <= 0x2A6DF) || (cp >= 0x2A700 && cp <= 0x2B73F) ||
-      (cp >= 0x2B740 && cp <= 0x2B81F) || (cp >= 0x2B820 && cp <= 0x2CEAF) ||
-      (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0x2F800 && cp <= 0x2FA1F)) {
-    return true;
+  // ASCII chars are classified without calling ICU.
+  if (cp < 0x80) {
+    return IsAsciiPunctuation(cp);
+  }
+  return IsChineseChar(char_value) || u_ispunct(char_value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constants and helpers for the code point class table.
+////////////////////////////////////////////////////////////////////////////////
+
+// The class of a Unicode code point, as used to split general texts into words
+// in end-to-end tokenization.
+enum CharClass : uint8_t {
+  kOtherChar = 0,
+  // As tested by `IsWhiteSpace`.
+  kWhiteSpaceChar = 1,
+  // Punctuation (but not Chinese) chars, as tested by
+  // `IsPunctuationOrChineseChar`.
+  kPunctuationChar = 2,
+  // As tested by `IsChineseChar`.
+  kChineseChar = 3,
+};
+
+// The code point class table is a two-level table. The code points are split
+// into blocks of 2^kCharClassBlockBits consecutive code points. The first
+// level maps each block to a (deduplicated) block of classes in the second
+// level, which stores the class of each code point in 2 bits.
+static constexpr int kCharClassBlockBits = 8;
+static constexpr int kCharClassBlockSize = 1 << kCharClassBlockBits;
+static constexpr int kCharClassBitsPerChar = 2;
+static constexpr int kCharClassesPerByte = 8 / kCharClassBitsPerChar;
+static constexpr int kCharClassBlockBytes =
+    kCharClassBlockSize / kCharClassesPerByte;
+static constexpr UChar32 kMaxCodePoint = 0x10FFFF;
+static constexpr int kNumCharClassBlocks =
+    (kMaxCodePoint >> kCharClassBlockBits) + 1;
+
+// Returns the class of `char_value` as computed by ICU and the helpers above.
+inline CharClass GetCharClassFromIcu(UChar32 char_value) {
+  if (IsWhiteSpace(char_value)) return kWhiteSpaceChar;
+  if (IsChineseChar(char_value)) return kChineseChar;
+  if (IsPunctuationOrChineseChar(char_value)) return kPunctuationChar;
+  return kOtherChar;
+}
+
+// Looks up the class of code points in a two-level table (see above), e.g.,
+// the one stored in the FastWordpieceTokenizer config flatbuffer.
+class CharClassTable {
+ public:
+  // Creates an empty table.
+  CharClassTable() = default;
+
+  // Creates a table from the two levels. `block_index` has
+  // kNumCharClassBlocks entries, each being the index of a block in `blocks`.
+  // Both arrays are not owned.
+  CharClassTable(const uint16_t* block_index, const uint8_t* blocks)
+      : block_index_(block_index), blocks_(blocks) {}
+
+  // Creates a table from the two levels stored in a model, where `block_index`
+  // has `block_index_size` entries and `blocks` has `blocks_size` bytes.
+  // Returns an error if the table is malformed, e.g., if an entry of
+  // `block_index` is not the index of a block in `blocks`, so that Get() never
+  // reads out of the arrays.
+  static absl::StatusOr<CharClassTable> Create(const uint16_t* block_index,
+                                               int block_index_size,
+                                               const uint8_t* blocks,
+                                               int blocks_size) {
+    if (block_index_size != kNumCharClassBlocks ||
+        blocks_size % kCharClassBlockBytes != 0) {
+      return absl::InvalidArgumentError(
+          "Malformed code point class table: wrong table sizes.");
+    }
+    const int num_blocks = blocks_size / kCharClassBlockBytes;
+    for (int i = 0; i < block_index_size; ++i) {
+      if (block_index[i] >= num_blocks) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Malformed code point class table: block index ", block_index[i],
+            " is out of range [0, ", num_blocks, ")."));
+      }
+    }
+    return CharClassTable(block_index, blocks);
+  }
+
+  bool empty() const { return block_index_ == nullptr; }
+
+  // Returns the class of `char_value`. Invalid code points are kOtherChar.
+  CharClass Get(UChar32 char_value) const {
+    const uint32_t cp = static_cast<uint32_t>(char_value);
+    if (cp > kMaxCodePoint) return kOtherChar;
+    const uint32_t offset_in_block = cp & (kCharClassBlockSize - 1);
+    const uint8_t packed =
+        blocks_[block_index_[cp >> kCharClassBlockBits] * kCharClassBlockBytes +
+                offset_in_block / kCharClassesPerByte];
+    const int shift =
+        (offset_in_block % kCharClassesPerByte) * kCharClassBitsPerChar;
+    return static_cast<CharClass>((packed >> shift) &
+                                  ((1 << kCharClassBitsPerChar) - 1));
+  }
+
+ private:
+  const uint16_t* block_index_ = nullptr;
+  const uint8_t* blocks_ = nullptr;
+};
+
+// Returns the number of leading bytes of `data` (of size `size`) that are
+// ASCII "word" chars, i.e., neither non-ASCII, nor whitespaces, nor
+// punctuation chars. Each such byte is a complete character and is not a word
+// boundary, so the tokenizer can feed it to the trie without decoding and
+// classifying it.
+//
+// Classifies 32 (AVX2) or 16 (SSE2) bytes at a time when available.
+inline int CountLeadingAsciiWordBytes(const char* data, int size) {
+  int pos = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+  // Non-word ASCII bytes are in one of the ranges below; bytes >= 0x80 are
+  // negative when compared as signed chars.
+#if defined(__AVX2__)
+  constexpr int kBlockSize = 32;
+  using Block = __m256i;
+  const auto in_range = [](Block b, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(b, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), b));
+  };
+  const auto load = [](const char* ptr) {
+    return _mm256_loadu_si256(reinterpret_cast<const Block*>(ptr));
+  };
+  const auto either = [](Block a, Block b) { return _mm256_or_si256(a, b); };
+  const auto movemask = [](Block b) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(b));
+  };
+#else
+  constexpr int kBlockSize = 16;
+  using Block = __m128i;
+  const auto in_range = [](Block b, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(b, _mm_set1_epi8(hi + 1)));
+  };
+  const auto load = [](const char* ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const Block*>(ptr));
+  };
+  const auto either = [](Block a, Block b) { return _mm_or_si128(a, b); };
+  const auto movemask = [](Block b) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(b));
+  };
+#endif
+  for (; pos + kBlockSize <= size; pos += kBlockSize) {
+    const Block b = load(data + pos);
+    // Whitespaces: '\t'..'\r' and ' '. The space is merged with the
+    // punctuation range 33..47.
+    Block non_word = either(b, in_range(b, '\t', '\r'));
+    non_word = either(non_word, in_range(b, 32, 47));
+    non_word = either(non_word, in_range(b, 58, 64));
+    non_word = either(non_word, in_range(b, 91, 96));
+    non_word = either(non_word, in_range(b, 123, 126));
+    const uint32_t mask = movemask(non_word);
+    if (mask != 0) {
+      return pos + absl::countr_zero(mask);
+    }
   }
-  // Some special chars e.g. ">", "$" that are not covered by the u_ispunct are
-  // considered as punctuation chars.
-  if ((cp >= 33 && cp <= 47) || (cp >= 58 && cp <= 64) ||
-      (cp >= 91 && cp <= 96) || (cp >= 123 && cp <= 126)) {
-    return true;
+#endif
+  // Portable fallback, also used for the tail.
+  for (; pos < size; ++pos) {
+    const unsigned char ch = static_cast<unsigned char>(data[pos]);
+    if (ch >= 0x80 || IsAsciiWhiteSpace(ch) || IsAsciiPunctuation(ch)) {
+      break;
+    }
   }
-  return u_ispunct(char_value);
+  return pos;
 }
 }  // namespace fast_wordpiece_tokenizer_utils
 }  // namespace text
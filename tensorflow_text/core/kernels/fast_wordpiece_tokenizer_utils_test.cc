@@ -148,6 +148,103 @@ INSTANTIATE_TEST_SUITE_P(TestFailurePopListEncodingDecoding,
                          FailurePopListEncodingDecodingTest,
                          testing::ValuesIn(GetFailurePopListSpecs()));
 
+TEST(CountLeadingAsciiWordBytesTest, StopsAtNonWordBytes) {
+  EXPECT_EQ(CountLeadingAsciiWordBytes("", 0), 0);
+  EXPECT_EQ(CountLeadingAsciiWordBytes("abc", 3), 3);
+  EXPECT_EQ(CountLeadingAsciiWordBytes("abc def", 7), 3);
+  EXPECT_EQ(CountLeadingAsciiWordBytes("abc\tdef", 7), 3);
+  EXPECT_EQ(CountLeadingAsciiWordBytes("abc,def", 7), 3);
+  EXPECT_EQ(CountLeadingAsciiWordBytes("ab\xCE\xB1", 4), 2);
+  EXPECT_EQ(CountLeadingAsciiWordBytes(" abc", 4), 0);
+}
+
+TEST(CountLeadingAsciiWordBytesTest, MatchesPerByteClassification) {
+  // Place every byte value after word prefixes of different lengths, so that
+  // it falls at every position of the (up to 32-byte) vectorized blocks.
+  for (int prefix_size = 0; prefix_size < 70; ++prefix_size) {
+    for (int ch = 0; ch < 256; ++ch) {
+      std::string input(prefix_size, 'x');
+      input.push_back(static_cast<char>(ch));
+      input.append("yz");
+      const bool is_word_byte = ch < 0x80 && !IsAsciiWhiteSpace(ch) &&
+                                !IsAsciiPunctuation(ch);
+      EXPECT_EQ(CountLeadingAsciiWordBytes(input.data(), input.size()),
+                is_word_byte ? input.size() : prefix_size)
+          << "prefix_size: " << prefix_size << ", ch: " << ch;
+    }
+  }
+}
+
+TEST(CharClassTest, AsciiMatchesIcu) {
+  for (UChar32 ch = 0; ch < 0x80; ++ch) {
+    EXPECT_EQ(IsWhiteSpace(ch), static_cast<bool>(u_isUWhiteSpace(ch)))
+        << "ch: " << ch;
+    EXPECT_EQ(IsAsciiPunctuation(ch),
+              u_ispunct(ch) || (ch >= 33 && ch <= 47) ||
+                  (ch >= 58 && ch <= 64) || (ch >= 91 && ch <= 96) ||
+                  (ch >= 123 && ch <= 126))
+        << "ch: " << ch;
+  }
+}
+
+TEST(CharClassTest, GetCharClassFromIcu) {
+  EXPECT_EQ(GetCharClassFromIcu('a'), kOtherChar);
+  EXPECT_EQ(GetCharClassFromIcu(' '), kWhiteSpaceChar);
+  // Ideographic space.
+  EXPECT_EQ(GetCharClassFromIcu(0x3000), kWhiteSpaceChar);
+  EXPECT_EQ(GetCharClassFromIcu('$'), kPunctuationChar);
+  // Ideographic comma.
+  EXPECT_EQ(GetCharClassFromIcu(0x3001), kPunctuationChar);
+  EXPECT_EQ(GetCharClassFromIcu(0x4E2D), kChineseChar);
+  EXPECT_EQ(GetCharClassFromIcu(0x03B1), kOtherChar);  // Greek alpha.
+  EXPECT_EQ(GetCharClassFromIcu(-1), kOtherChar);
+}
+
+TEST(CharClassTest, CharClassTableLookup) {
+  // Block 0 holds kOtherChar only; block 1 holds the classes 0, 1, 2, 3, 0,
+  // 1, ... for consecutive code points.
+  std::vector<uint8_t> blocks(2 * kCharClassBlockBytes, 0);
+  std::fill(blocks.begin() + kCharClassBlockBytes, blocks.end(), 0xE4);
+  std::vector<uint16_t> block_index(kNumCharClassBlocks, 0);
+  block_index[1] = 1;
+  const CharClassTable table(block_index.data(), blocks.data());
+  EXPECT_FALSE(table.empty());
+  EXPECT_EQ(table.Get(0x20), kOtherChar);
+  EXPECT_EQ(table.Get(0x100), kOtherChar);
+  EXPECT_EQ(table.Get(0x101), kWhiteSpaceChar);
+  EXPECT_EQ(table.Get(0x102), kPunctuationChar);
+  EXPECT_EQ(table.Get(0x103), kChineseChar);
+  EXPECT_EQ(table.Get(0x1FF), kChineseChar);
+  EXPECT_EQ(table.Get(0x200), kOtherChar);
+  EXPECT_EQ(table.Get(kMaxCodePoint), kOtherChar);
+  EXPECT_EQ(table.Get(kMaxCodePoint + 1), kOtherChar);
+  EXPECT_EQ(table.Get(-1), kOtherChar);
+  EXPECT_TRUE(CharClassTable().empty());
+}
+
+TEST(CharClassTest, CreateCharClassTable) {
+  std::vector<uint8_t> blocks(2 * kCharClassBlockBytes, 0);
+  std::vector<uint16_t> block_index(kNumCharClassBlocks, 0);
+  block_index[1] = 1;
+  EXPECT_TRUE(CharClassTable::Create(block_index.data(), block_index.size(),
+                                     blocks.data(), blocks.size())
+                  .ok());
+  // A block index out of the blocks.
+  block_index[2] = 2;
+  EXPECT_FALSE(CharClassTable::Create(block_index.data(), block_index.size(),
+                                      blocks.data(), blocks.size())
+                   .ok());
+  block_index[2] = 0;
+  // Tables of the wrong sizes.
+  EXPECT_FALSE(CharClassTable::Create(block_index.data(),
+                                      block_index.size() - 1, blocks.data(),
+                                      blocks.size())
+                   .ok());
+  EXPECT_FALSE(CharClassTable::Create(block_index.data(), block_index.size(),
+                                      blocks.data(), blocks.size() - 1)
+                   .ok());
+}
+
 }  // namespace
 }  // namespace fast_wordpiece_tokenizer_utils
 }  // namespace text
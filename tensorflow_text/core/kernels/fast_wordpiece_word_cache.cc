@@ -0,0 +1,102 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/fast_wordpiece_word_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/hash/hash.h"
+
+namespace tensorflow {
+namespace text {
+
+FastWordpieceWordCache::FastWordpieceWordCache(int capacity)
+    : shard_capacity_(std::max(1, (capacity + kNumShards - 1) / kNumShards)) {}
+
+FastWordpieceWordCache::Shard& FastWordpieceWordCache::GetShard(
+    absl::string_view word) {
+  // Use the high bits, since the low bits also pick the slot in the map.
+  const size_t hash = absl::Hash<absl::string_view>()(word);
+  return shards_[(hash >> (sizeof(size_t) * 8 - 8)) % kNumShards];
+}
+
+bool FastWordpieceWordCache::Lookup(
+    absl::string_view word,
+    absl::FunctionRef<void(absl::Span<const Token>)> found) {
+  Shard& shard = GetShard(word);
+  {
+    absl::ReaderMutexLock lock(&shard.mu);
+    auto it = shard.entries.find(word);
+    if (it != shard.entries.end()) {
+      found(it->second);
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void FastWordpieceWordCache::Insert(absl::string_view word,
+                                    std::vector<Token> tokens) {
+  Shard& shard = GetShard(word);
+  absl::MutexLock lock(&shard.mu);
+  if (!shard.entries.try_emplace(word, std::move(tokens)).second) {
+    // Another thread inserted the same word in the meantime.
+    return;
+  }
+  if (static_cast<int>(shard.insertion_order.size()) < shard_capacity_) {
+    shard.insertion_order.emplace_back(word);
+    return;
+  }
+  std::string& oldest = shard.insertion_order[shard.next_eviction];
+  shard.entries.erase(oldest);
+  oldest.assign(word.data(), word.size());
+  shard.next_eviction = (shard.next_eviction + 1) % shard_capacity_;
+}
+
+void FastWordpieceWordCache::Clear() {
+  for (Shard& shard : shards_) {
+    absl::MutexLock lock(&shard.mu);
+    shard.entries.clear();
+    shard.insertion_order.clear();
+    shard.next_eviction = 0;
+  }
+}
+
+bool FastWordpieceWordCache::BindToModel(absl::string_view model) {
+  uint64_t fingerprint = absl::Hash<absl::string_view>()(model);
+  if (fingerprint == kUnbound) {
+    fingerprint = kUnbound + 1;
+  }
+  uint64_t bound = kUnbound;
+  if (model_fingerprint_.compare_exchange_strong(bound, fingerprint,
+                                                 std::memory_order_relaxed)) {
+    return true;
+  }
+  return bound == fingerprint;
+}
+
+int FastWordpieceWordCache::size() const {
+  int size = 0;
+  for (const Shard& shard : shards_) {
+    absl::ReaderMutexLock lock(&shard.mu);
+    size += shard.entries.size();
+  }
+  return size;
+}
+
+}  // namespace text
+}  // namespace tensorflow
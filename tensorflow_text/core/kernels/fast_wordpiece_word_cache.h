@@ -0,0 +1,121 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_WORD_CACHE_H_
+#define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_WORD_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace tensorflow {
+namespace text {
+
+// A bounded, thread-safe cache from words to their WordPiece tokenization,
+// used by FastWordpieceTokenizer to skip the trie matching of frequent words.
+//
+// Natural language text follows a Zipfian distribution, so a cache of a few
+// thousand words usually serves most of the words of a corpus. The cache is
+// split into shards by the hash of the word, each guarded by its own mutex, so
+// that concurrent tokenizations (e.g., the shards of a batch) rarely contend.
+// When a shard is full, its oldest entry is evicted.
+//
+// The cached tokenization only depends on the word and the model, so a cache
+// is bound to the first model it is used with (see `BindToModel`).
+class FastWordpieceWordCache {
+ public:
+  // A token of a cached word. The offsets are relative to the start of the
+  // word; the token string is recovered from them (see
+  // FastWordpieceTokenizer).
+  struct Token {
+    int token_id;
+    int start_offset;
+    int end_offset;
+  };
+
+  // Creates a cache holding at most about `capacity` words.
+  explicit FastWordpieceWordCache(int capacity);
+
+  FastWordpieceWordCache(const FastWordpieceWordCache&) = delete;
+  FastWordpieceWordCache& operator=(const FastWordpieceWordCache&) = delete;
+
+  // If `word` is in the cache, calls `found` with its tokens and returns true.
+  // Otherwise returns false. `found` runs while the shard of `word` is locked
+  // for reading, so it must not call back into the cache.
+  bool Lookup(absl::string_view word,
+              absl::FunctionRef<void(absl::Span<const Token>)> found);
+
+  // Adds `word` with its `tokens` to the cache, evicting the oldest word of
+  // its shard if needed. Does nothing if `word` is already in the cache.
+  void Insert(absl::string_view word, std::vector<Token> tokens);
+
+  // Removes all the words from the cache. The counters are kept.
+  void Clear();
+
+  // Binds the cache to `model`, the model flatbuffer, if it is not bound yet.
+  // Returns whether the cache may be used with `model`, i.e., whether `model`
+  // has the same content as the model the cache is bound to. Meant to be called
+  // before each use of the cache; a caller with another model must tokenize
+  // without the cache. The models are compared by a fingerprint of their
+  // content, not by their address, which may be reused by another model, and
+  // the cache is never cleared, so that concurrent calls with different models
+  // do not race. Costs one pass over `model`.
+  bool BindToModel(absl::string_view model);
+
+  // The number of successful and failed `Lookup` calls so far.
+  int64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  int64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+  // The number of words in the cache.
+  int size() const;
+
+ private:
+  static constexpr int kNumShards = 16;
+
+  struct Shard {
+    mutable absl::Mutex mu;
+    absl::flat_hash_map<std::string, std::vector<Token>> entries
+        ABSL_GUARDED_BY(mu);
+    // The words in the order they were inserted, as a ring buffer of
+    // `shard_capacity_` words. `next_eviction` is the oldest one once full.
+    std::vector<std::string> insertion_order ABSL_GUARDED_BY(mu);
+    int next_eviction ABSL_GUARDED_BY(mu) = 0;
+  };
+
+  Shard& GetShard(absl::string_view word);
+
+  // The maximum number of words per shard.
+  const int shard_capacity_;
+  Shard shards_[kNumShards];
+
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+
+  // The fingerprint of the model the cache is bound to, or kUnbound.
+  static constexpr uint64_t kUnbound = 0;
+  std::atomic<uint64_t> model_fingerprint_{kUnbound};
+};
+
+}  // namespace text
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_FAST_WORDPIECE_WORD_CACHE_H_
@@ -0,0 +1,114 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/fast_wordpiece_word_cache.h"
+
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+
+namespace tensorflow {
+namespace text {
+namespace {
+
+using Token = FastWordpieceWordCache::Token;
+
+// Returns the token ids of `word` in `cache`, or {-1} if not cached.
+std::vector<int> LookupIds(FastWordpieceWordCache& cache,
+                           absl::string_view word) {
+  std::vector<int> ids;
+  if (!cache.Lookup(word, [&ids](absl::Span<const Token> tokens) {
+        for (const Token& token : tokens) ids.push_back(token.token_id);
+      })) {
+    ids.push_back(-1);
+  }
+  return ids;
+}
+
+TEST(FastWordpieceWordCacheTest, LookupAndInsert) {
+  FastWordpieceWordCache cache(/*capacity=*/100);
+  EXPECT_THAT(LookupIds(cache, "unaffable"), ::testing::ElementsAre(-1));
+  cache.Insert("unaffable", {{1, 0, 2}, {2, 2, 5}, {3, 5, 9}});
+  cache.Insert("", {});
+  EXPECT_THAT(LookupIds(cache, "unaffable"), ::testing::ElementsAre(1, 2, 3));
+  EXPECT_THAT(LookupIds(cache, ""), ::testing::ElementsAre());
+  EXPECT_THAT(LookupIds(cache, "unaff"), ::testing::ElementsAre(-1));
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(cache.misses(), 2);
+
+  // The first insertion wins.
+  cache.Insert("unaffable", {{4, 0, 9}});
+  EXPECT_THAT(LookupIds(cache, "unaffable"), ::testing::ElementsAre(1, 2, 3));
+}
+
+TEST(FastWordpieceWordCacheTest, IsBounded) {
+  constexpr int kCapacity = 64;
+  FastWordpieceWordCache cache(kCapacity);
+  for (int i = 0; i < 100 * kCapacity; ++i) {
+    cache.Insert(absl::StrCat("word", i), {{i, 0, 4}});
+  }
+  // Each shard holds at most its share of the capacity.
+  EXPECT_LE(cache.size(), kCapacity);
+  EXPECT_GT(cache.size(), 0);
+  // The most recent words are still there.
+  const int last = 100 * kCapacity - 1;
+  EXPECT_THAT(LookupIds(cache, absl::StrCat("word", last)),
+              ::testing::ElementsAre(last));
+}
+
+TEST(FastWordpieceWordCacheTest, BindToModel) {
+  FastWordpieceWordCache cache(/*capacity=*/10);
+  std::string model = "model a";
+  EXPECT_TRUE(cache.BindToModel(model));
+  cache.Insert("word", {{1, 0, 4}});
+  // The same content, at another address.
+  EXPECT_TRUE(cache.BindToModel(std::string("model a")));
+  // Another model at the same address.
+  model[6] = 'b';
+  EXPECT_FALSE(cache.BindToModel(model));
+  // The cache is not cleared for the other model.
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_TRUE(cache.BindToModel("model a"));
+}
+
+TEST(FastWordpieceWordCacheTest, ConcurrentAccess) {
+  FastWordpieceWordCache cache(/*capacity=*/32);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache] {
+      for (int i = 0; i < 2000; ++i) {
+        const std::string word = absl::StrCat("w", i % 50);
+        const std::vector<int> ids = LookupIds(cache, word);
+        if (ids[0] == -1) {
+          cache.Insert(word, {{i % 50, 0, static_cast<int>(word.size())}});
+        } else {
+          EXPECT_THAT(ids, ::testing::ElementsAre(i % 50));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(cache.hits() + cache.misses(), 4 * 2000);
+  EXPECT_LE(cache.size(), 32);
+}
+
+}  // namespace
+}  // namespace text
+}  // namespace tensorflow
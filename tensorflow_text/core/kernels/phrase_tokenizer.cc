@@ -24,6 +24,7 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/lite/kernels/shim/status_macros.h"
+#include "tensorflow_text/core/kernels/vocab_pool.h"
 #include "tensorflow_text/core/kernels/whitespace_tokenizer_config_builder.h"
 
 namespace tensorflow {
@@ -174,9 +175,13 @@ absl::StatusOr<std::vector<std::string>> PhraseTokenizer::DetokenizeToTokens(
         "true in the config flatbuffer. Please rebuild the model flatbuffer "
         "by setting support_detokenization=true.");
   }
+  const VocabPool vocab = VocabPool::FromConfig(*phrase_config_);
   for (int id : input) {
-    auto vocab = phrase_config_->vocab_array()->Get(id);
-    output_tokens.emplace_back(vocab->string_view());
+    const absl::StatusOr<absl::string_view> token = vocab.Get(id);
+    if (!token.ok()) {
+      return token.status();
+    }
+    output_tokens.emplace_back(*token);
   }
   return output_tokens;
 }
@@ -14,14 +14,31 @@
 
 #include "tensorflow_text/core/kernels/phrase_tokenizer_kernel.h"
 
+#include <cstdint>
+
 #include "tensorflow/core/framework/op_kernel.h"
 
 namespace tensorflow {
 namespace text {
 
-REGISTER_KERNEL_BUILDER(
-    Name(PhraseTokenizeOpKernel::OpName()).Device(tensorflow::DEVICE_CPU),
-    PhraseTokenizeOpKernel);
+using PhraseTokenizeOpKernelInstance = PhraseTokenizeOpKernel<int64_t, int64_t>;
+
+#define REGISTER_PHRASE_TOKENIZE_SPLITS(out_type, splits_type)            \
+  REGISTER_KERNEL_BUILDER(Name(PhraseTokenizeOpKernelInstance::OpName()) \
+                              .Device(tensorflow::DEVICE_CPU)            \
+                              .TypeConstraint<out_type>("out_type")      \
+                              .TypeConstraint<splits_type>("Tsplits"),   \
+                          PhraseTokenizeOpKernel<out_type, splits_type>);
+
+#define REGISTER_PHRASE_TOKENIZE(out_type)           \
+  REGISTER_PHRASE_TOKENIZE_SPLITS(out_type, int32_t) \
+  REGISTER_PHRASE_TOKENIZE_SPLITS(out_type, int64_t)
+
+REGISTER_PHRASE_TOKENIZE(int32_t)
+REGISTER_PHRASE_TOKENIZE(int64_t)
+
+#undef REGISTER_PHRASE_TOKENIZE
+#undef REGISTER_PHRASE_TOKENIZE_SPLITS
 
 REGISTER_KERNEL_BUILDER(
     Name(PhraseDetokenizeOpKernel::OpName()).Device(tensorflow::DEVICE_CPU),
@@ -21,10 +21,11 @@
 namespace tensorflow {
 namespace text {
 
+template <typename T, typename Tsplits>
 class PhraseTokenizeOpKernel
-    : public tflite::shim::TfOpKernel<PhraseTokenizeOp> {
+    : public tflite::shim::TfOpKernel<PhraseTokenizeOp, T, Tsplits> {
  public:
-  using TfOpKernel::TfOpKernel;
+  using tflite::shim::TfOpKernel<PhraseTokenizeOp, T, Tsplits>::TfOpKernel;
 };
 
 class PhraseDetokenizeOpKernel
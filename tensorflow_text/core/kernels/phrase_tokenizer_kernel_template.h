@@ -30,9 +30,12 @@ namespace text {
 // TFLite. See
 // https://github.com/tensorflow/tensorflow/tree/master/tensorflow/lite/kernels/shim
 // for more info on how this works.
-template <tflite::shim::Runtime Rt>
+//
+// `T` is the type of the ids, and `Tsplits` is the type of the row splits
+// (int32_t or int64_t for both).
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
 class PhraseTokenizeOp
-    : public tflite::shim::OpKernelShim<PhraseTokenizeOp, Rt> {
+    : public tflite::shim::OpKernelShim<PhraseTokenizeOp, Rt, T, Tsplits> {
  private:
   enum Inputs { kInputValues = 0, kPhraseModel };
   enum Outputs {
@@ -42,11 +45,12 @@ class PhraseTokenizeOp
   };
 
   using Shape = tflite::shim::Shape;
-  using typename tflite::shim::OpKernelShim<PhraseTokenizeOp, Rt>::InitContext;
-  using
-      typename tflite::shim::OpKernelShim<PhraseTokenizeOp, Rt>::InvokeContext;
-  using typename tflite::shim::OpKernelShim<PhraseTokenizeOp,
-                                            Rt>::ShapeInferenceContext;
+  using typename tflite::shim::OpKernelShim<PhraseTokenizeOp, Rt, T,
+                                            Tsplits>::InitContext;
+  using typename tflite::shim::OpKernelShim<PhraseTokenizeOp, Rt, T,
+                                            Tsplits>::InvokeContext;
+  using typename tflite::shim::OpKernelShim<PhraseTokenizeOp, Rt, T,
+                                            Tsplits>::ShapeInferenceContext;
 
  public:
   PhraseTokenizeOp() = default;
@@ -69,6 +73,8 @@ class PhraseTokenizeOp
     Args:
       input_values: 1D Tensor of strings to tokenize with.
       phrase_model: Buffer tensor for the PhraseTokenizerConfig flatbuffer.
+      out_type: The type of `output_ids`.
+      Tsplits: The type of `output_row_splits`.
 
     Returns:
       * output_values: 1D tensor containing the phrases for all input strings.
@@ -83,7 +89,10 @@ class PhraseTokenizeOp
   static const char* Doc() { return kDoc; }
 
   // Attributes declaration (syntax: https://www.tensorflow.org/guide/create_op)
-  static std::vector<std::string> Attrs() { return {}; }
+  static std::vector<std::string> Attrs() {
+    return {"out_type: {int32, int64} = DT_INT64",
+            "Tsplits: {int32, int64} = DT_INT64"};
+  }
 
   // Input tensors declaration (syntax:
   // https://www.tensorflow.org/guide/create_op)
@@ -105,19 +114,19 @@ class PhraseTokenizeOp
 
 ////////////////////////// Implementation
 
-template <tflite::shim::Runtime Rt>
-std::vector<std::string> PhraseTokenizeOp<Rt>::Inputs() {
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+std::vector<std::string> PhraseTokenizeOp<Rt, T, Tsplits>::Inputs() {
   return {"input_values: string", "phrase_model: uint8"};
 }
 
-template <tflite::shim::Runtime Rt>
-std::vector<std::string> PhraseTokenizeOp<Rt>::Outputs() {
-  return {"output_subwords: string", "output_ids: int64",
-          "output_row_splits: int64"};
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+std::vector<std::string> PhraseTokenizeOp<Rt, T, Tsplits>::Outputs() {
+  return {"output_subwords: string", "output_ids: out_type",
+          "output_row_splits: Tsplits"};
 }
 
-template <tflite::shim::Runtime Rt>
-absl::Status PhraseTokenizeOp<Rt>::Invoke(InvokeContext* context) {
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status PhraseTokenizeOp<Rt, T, Tsplits>::Invoke(InvokeContext* context) {
   SH_ASSIGN_OR_RETURN(const auto input_values, context->GetInput(kInputValues));
   const auto& values_vec = input_values->template As<tstring, 1>();
 
@@ -159,13 +168,13 @@ absl::Status PhraseTokenizeOp<Rt>::Invoke(InvokeContext* context) {
           kOutputIds,
           Shape({static_cast<int>(
               subword_ids.size())}))); /* same shape as `output_subwords` */
-  auto output_ids_vec = output_ids->template As<int64, 1>();
+  auto output_ids_vec = output_ids->template As<T, 1>();
 
   SH_ASSIGN_OR_RETURN(
       auto output_row_splits,
       context->GetOutput(kOutputRowSplits,
                          Shape({static_cast<int>(row_splits.size())})));
-  auto output_row_splits_vec = output_row_splits->template As<int64, 1>();
+  auto output_row_splits_vec = output_row_splits->template As<Tsplits, 1>();
 
   for (int i = 0; i < subwords.size(); ++i) {
     output_subwords_vec(i) = subwords[i];
@@ -182,8 +191,9 @@ absl::Status PhraseTokenizeOp<Rt>::Invoke(InvokeContext* context) {
   return absl::OkStatus();
 }
 
-template <tflite::shim::Runtime Rt>
-absl::Status PhraseTokenizeOp<Rt>::ShapeInference(ShapeInferenceContext* c) {
+template <tflite::shim::Runtime Rt, typename T, typename Tsplits>
+absl::Status PhraseTokenizeOp<Rt, T, Tsplits>::ShapeInference(
+    ShapeInferenceContext* c) {
   using tflite::shim::Shape;
   SH_ASSIGN_OR_RETURN(const Shape input_values_shape,
                       c->GetInputShape(kInputValues));
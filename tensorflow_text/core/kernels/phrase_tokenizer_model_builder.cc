@@ -28,6 +28,7 @@
 #include "tensorflow_text/core/kernels/phrase_tokenizer_model_generated.h"
 #include "tensorflow_text/core/kernels/sentencepiece/double_array_trie_builder.h"
 #include "tensorflow_text/core/kernels/string_vocab.h"
+#include "tensorflow_text/core/kernels/vocab_pool.h"
 #include "tensorflow_text/core/kernels/whitespace_tokenizer_config_builder.h"
 
 namespace tensorflow {
@@ -40,7 +41,7 @@ class PhraseBuilder {
   absl::Status BuildModel(const std::vector<std::string>& vocab,
                           const std::string& unk_token,
                           bool support_detokenization, int prob,
-                          bool split_end_punctuation);
+                          bool split_end_punctuation, bool compact_vocab);
 
   absl::StatusOr<std::string> ExportToFlatBuffer() const;
 
@@ -53,16 +54,20 @@ class PhraseBuilder {
   bool support_detokenization_;
   int prob_;
   bool split_end_punctuation_;
+  // Whether to store the vocab as a VocabPool rather than as `vocab_array`.
+  bool compact_vocab_;
 };
 
 absl::Status PhraseBuilder::BuildModel(const std::vector<std::string>& vocab,
                                        const std::string& unk_token,
                                        bool support_detokenization, int prob,
-                                       bool split_end_punctuation) {
+                                       bool split_end_punctuation,
+                                       bool compact_vocab) {
   unk_token_ = std::string(unk_token);
   support_detokenization_ = support_detokenization;
   prob_ = prob;
   split_end_punctuation_ = split_end_punctuation;
+  compact_vocab_ = compact_vocab;
 
   vocab_ = std::make_unique<StringVocab>(vocab);
   if (vocab_->Size() != vocab.size()) {
@@ -89,9 +94,10 @@ absl::StatusOr<std::string> PhraseBuilder::ExportToFlatBuffer() const {
   const auto unk_token = builder.CreateString(unk_token_);
 
   std::vector<flatbuffers::Offset<flatbuffers::String>> vocab_fbs_vector;
+  VocabPoolBuilder vocab_pool_builder;
 
   if (support_detokenization_) {
-    vocab_fbs_vector.reserve(vocab_->Size());
+    if (!compact_vocab_) vocab_fbs_vector.reserve(vocab_->Size());
     for (int i = 0; i < vocab_->Size(); ++i) {
       const absl::optional<absl::string_view> word = vocab_->LookupWord(i);
       if (!word.has_value()) {
@@ -100,11 +106,24 @@ absl::StatusOr<std::string> PhraseBuilder::ExportToFlatBuffer() const {
             "token ids; hence LookupWord() should always succeed.");
       }
       absl::string_view token = word.value();
-      vocab_fbs_vector.emplace_back(builder.CreateString(token));
+      if (compact_vocab_) {
+        vocab_pool_builder.Add(token);
+      } else {
+        vocab_fbs_vector.emplace_back(builder.CreateString(token));
+      }
     }
   }
 
-  auto vocab_array = builder.CreateVector(vocab_fbs_vector);
+  const bool write_vocab_pool = support_detokenization_ && compact_vocab_;
+  flatbuffers::Offset<VocabPool::StringVector> vocab_array;
+  flatbuffers::Offset<flatbuffers::String> vocab_pool;
+  flatbuffers::Offset<flatbuffers::Vector<uint32_t>> vocab_offsets;
+  if (write_vocab_pool) {
+    vocab_pool = vocab_pool_builder.CreatePool(builder);
+    vocab_offsets = vocab_pool_builder.CreateOffsets(builder);
+  } else {
+    vocab_array = builder.CreateVector(vocab_fbs_vector);
+  }
 
   std::string ws_config = BuildWhitespaceTokenizerConfig();
   auto whitespace_config = builder.CreateString(ws_config);
@@ -118,7 +137,12 @@ absl::StatusOr<std::string> PhraseBuilder::ExportToFlatBuffer() const {
   wtcb.add_unk_token(unk_token);
   wtcb.add_unk_token_id(unk_token_id_);
   wtcb.add_support_detokenization(support_detokenization_);
-  wtcb.add_vocab_array(vocab_array);
+  if (write_vocab_pool) {
+    wtcb.add_vocab_pool(vocab_pool);
+    wtcb.add_vocab_offsets(vocab_offsets);
+  } else {
+    wtcb.add_vocab_array(vocab_array);
+  }
   wtcb.add_whitespace_config(whitespace_config);
   wtcb.add_vocab_trie(trie_fbs);
   wtcb.add_prob(prob_);
@@ -131,10 +155,12 @@ absl::StatusOr<std::string> PhraseBuilder::ExportToFlatBuffer() const {
 
 absl::StatusOr<std::string> BuildPhraseModelAndExportToFlatBuffer(
     const std::vector<std::string>& vocab, const std::string& unk_token,
-    bool support_detokenization, int prob, bool split_end_punctuation) {
+    bool support_detokenization, int prob, bool split_end_punctuation,
+    bool compact_vocab) {
   PhraseBuilder builder;
-  SH_RETURN_IF_ERROR(builder.BuildModel(
-      vocab, unk_token, support_detokenization, prob, split_end_punctuation));
+  SH_RETURN_IF_ERROR(builder.BuildModel(vocab, unk_token,
+                                        support_detokenization, prob,
+                                        split_end_punctuation, compact_vocab));
   SH_ASSIGN_OR_RETURN(std::string flatbuffer, builder.ExportToFlatBuffer());
   return flatbuffer;
 }
@@ -32,12 +32,16 @@ namespace text {
 //. * support_detokenization: Whether to enable the detokenization function.
 //    Setting it to true expands the size of the flatbuffer.
 //  * prob: Probability of emitting a phrase when there is a match.
+//  * compact_vocab: Whether to store the vocab for detokenization as a single
+//    pool of characters plus the offset of each phrase (see vocab_pool.h)
+//    rather than as an array of strings. The models built with it can only be
+//    detokenized by the tokenizers that support it.
 // Returns:
 //  The bytes of the flatbuffer that stores the model.
 absl::StatusOr<std::string> BuildPhraseModelAndExportToFlatBuffer(
     const std::vector<std::string>& vocab, const std::string& unk_token,
     bool support_detokenization = false, int prob = 0,
-    bool split_end_punctuation = false);
+    bool split_end_punctuation = false, bool compact_vocab = false);
 }  // namespace text
 }  // namespace tensorflow
 
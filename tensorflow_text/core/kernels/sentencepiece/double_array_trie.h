@@ -62,14 +62,47 @@ class DoubleArrayTrie {
     }
   };
 
+  // Darts allocates the nodes by blocks of kBlockSize, so the trie is made of
+  // whole blocks, and `pos ^ label` is in the same block as `pos` for any
+  // label.
+  static constexpr uint32_t kBlockSize = 256;
+
   // nodes and nodes_length specify the array of the nodes of the trie.
   explicit DoubleArrayTrie(const flatbuffers::Vector<uint32_t>* nodes)
-      : nodes_(nodes) {}
+      : nodes_(nodes != nullptr ? nodes->data() : nullptr),
+        size_(nodes != nullptr ? nodes->size() : 0),
+        padded_(size_ % kBlockSize == 0) {}
 
   // Finds matches that are prefixes of a string.
   template <typename callback>
   void IteratePrefixMatches(const utils::string_view& input,
-                            callback update_fn) const;
+                            callback update_fn) const {
+    uint32_t pos;
+    if (!Root(pos)) {
+      return;
+    }
+    if (padded_) {
+      TraverseAll<true>(input, 1, pos, update_fn);
+    } else {
+      TraverseAll<false>(input, 1, pos, update_fn);
+    }
+  }
+
+  // Finds the prefix matches of the suffixes of `input`, i.e., the matches that
+  // start at each position of `input`, in one pass over the trie. Sets
+  // `matches` to all of them, by start then by length, and `match_begins` to
+  // the `input.length() + 1` boundaries of the matches of each start: the
+  // matches that start at `i` are [match_begins[i], match_begins[i + 1]).
+  // Reuses the memory of `matches` and `match_begins`.
+  void FindAllPrefixMatches(const utils::string_view& input,
+                            std::vector<Match>* matches,
+                            std::vector<int>* match_begins) const {
+    if (padded_) {
+      FindAllPrefixMatchesImpl<true>(input, matches, match_begins);
+    } else {
+      FindAllPrefixMatchesImpl<false>(input, matches, match_begins);
+    }
+  }
 
   // Finds the longest prefix match of a string.
   Match LongestPrefixMatch(const utils::string_view& input) const {
@@ -78,53 +111,127 @@ class DoubleArrayTrie {
     return match;
   }
 
+  // Finds the longest prefix match of the string `first` + `input`, without
+  // concatenating them.
+  Match LongestPrefixMatch(char first, const utils::string_view& input) const {
+    Match match;
+    auto update_fn = [&match](const Match& m) { match = m; };
+    uint32_t pos;
+    if (!Root(pos)) {
+      return match;
+    }
+    if (padded_) {
+      if (Traverse<true>(first, 1, pos, update_fn)) {
+        TraverseAll<true>(input, 2, pos, update_fn);
+      }
+    } else if (Traverse<false>(first, 1, pos, update_fn)) {
+      TraverseAll<false>(input, 2, pos, update_fn);
+    }
+    return match;
+  }
+
  private:
+  // Sets `pos` to the children of the root. Returns false if the trie is empty
+  // or corrupted.
+  bool Root(uint32_t& pos) const {
+    if (size_ == 0) {
+      return false;
+    }
+    pos = offset(0);
+    return pos < size_;
+  }
+
+  // Follows the child of `pos` with label `c`, and calls `update_fn` with a
+  // match of length `match_length` if it ends a key. Returns false if there is
+  // no such child.
+  //
+  // `pos` must be in the trie. When the trie is `padded`, i.e., made of whole
+  // blocks, `pos ^ c` is in the same block as `pos`, thus in the trie too, and
+  // is not bounds-checked.
+  template <bool padded, typename callback>
+  bool Traverse(unsigned char c, int match_length, uint32_t& pos,
+                callback& update_fn) const {
+    pos ^= c;
+    if ((!padded && pos >= size_) || label(pos) != c) {
+      // No match, exit.
+      return false;
+    }
+    const bool node_has_leaf = has_leaf(pos);
+    pos ^= offset(pos);
+    if (pos >= size_) {
+      // We can get here only if the structure is corrupted.
+      return false;
+    }
+    if (node_has_leaf) {
+      update_fn(Match(value(pos), match_length));
+    }
+    return true;
+  }
+
+  // Follows `input` from `pos`, where the first character of `input` ends a
+  // match of length `match_length`.
+  template <bool padded, typename callback>
+  void TraverseAll(const utils::string_view& input, int match_length,
+                   uint32_t pos, callback& update_fn) const {
+    const char* data = input.data();
+    const int length = input.length();
+    for (int i = 0; i < length; ++i) {
+      if (!Traverse<padded>(data[i], match_length + i, pos, update_fn)) {
+        return;
+      }
+    }
+  }
+
+  template <bool padded>
+  void FindAllPrefixMatchesImpl(const utils::string_view& input,
+                                std::vector<Match>* matches,
+                                std::vector<int>* match_begins) const {
+    const int length = input.length();
+    matches->clear();
+    match_begins->resize(length + 1);
+    uint32_t root;
+    const bool has_root = Root(root);
+    auto add_match = [matches](const Match& m) { matches->push_back(m); };
+    for (int i = 0; i < length; ++i) {
+      (*match_begins)[i] = matches->size();
+      if (has_root) {
+        TraverseAll<padded>(utils::string_view(input.data() + i, length - i),
+                            1, root, add_match);
+      }
+    }
+    (*match_begins)[length] = matches->size();
+  }
+
+  // Returns the node `i`, read from the raw array rather than through the
+  // accessors of flatbuffers::Vector in the inner loop of the matching.
+  uint32_t node(uint32_t i) const {
+    return flatbuffers::EndianScalar(nodes_[i]);
+  }
+
   // Returns whether a node as a leaf as a child.
-  bool has_leaf(uint32_t i) const { return ((*nodes_)[i]) & 0x100; }
+  bool has_leaf(uint32_t i) const { return node(i) & 0x100; }
 
   // Returns a value associated with a node. Available when a node is a leaf.
   int value(uint32_t i) const {
-    return static_cast<int>(((*nodes_)[i]) & 0x7fffffff);
+    return static_cast<int>(node(i) & 0x7fffffff);
   }
 
   // Returns a label associated with a node.
   // A leaf node will have the MSB set and thus return an invalid label.
-  int32_t label(uint32_t i) const { return ((*nodes_)[i]) & 0x800000ff; }
+  int32_t label(uint32_t i) const { return node(i) & 0x800000ff; }
 
   // Returns offset to children.
   int32_t offset(uint32_t i) const {
-    const uint32_t node = (*nodes_)[i];
-    return (node >> 10) << ((node & 0x200) >> 6);
+    const uint32_t n = node(i);
+    return (n >> 10) << ((n & 0x200) >> 6);
   }
 
-  const flatbuffers::Vector<uint32_t>* nodes_;
+  const uint32_t* nodes_;
+  uint32_t size_;
+  // Whether the nodes are whole blocks, as built by Darts.
+  bool padded_;
 };
 
-template <typename callback>
-void DoubleArrayTrie::IteratePrefixMatches(const utils::string_view& input,
-                                           callback update_fn) const {
-  if (nodes_->size() == 0) {
-    return;
-  }
-  uint32_t pos = offset(0);
-  for (int i = 0; i < input.length(); ++i) {
-    pos ^= static_cast<unsigned char>(input.at(i));
-    if (pos < 0 || pos >= nodes_->size() || label(pos) != input.at(i)) {
-      // No match, exit.
-      return;
-    }
-    const bool node_has_leaf = has_leaf(pos);
-    pos ^= offset(pos);
-    if (pos < 0 || pos >= nodes_->size()) {
-      // We can get here only if the structure is corrupted.
-      return;
-    }
-    if (node_has_leaf) {
-      update_fn(Match(value(pos), i + 1));
-    }
-  }
-}
-
 }  // namespace sentencepiece
 }  // namespace text
 }  // namespace tensorflow
@@ -62,6 +62,27 @@ TEST(DoubleArrayTrieTest, Match) {
                                             DoubleArrayTrie::Match(1, 3)));
 }
 
+TEST(DoubleArrayTrieTest, MatchWithFirstChar) {
+  flatbuffers::FlatBufferBuilder builder(1024);
+  const std::vector<std::string> test_strings = {" ", " A", "A", " AB"};
+  const auto trie_vector = builder.CreateVector(BuildTrie(test_strings));
+  TrieBuilder trie_builder(builder);
+  trie_builder.add_nodes(trie_vector);
+  const auto pieces = trie_builder.Finish();
+  EncoderConfigBuilder ecb(builder);
+  ecb.add_pieces(pieces);
+  FinishEncoderConfigBuffer(builder, ecb.Finish());
+  const EncoderConfig* config = GetEncoderConfig(builder.GetBufferPointer());
+  DoubleArrayTrie dat(config->pieces()->nodes());
+  EXPECT_EQ(dat.LongestPrefixMatch(' ', utils::string_view("ABC")),
+            DoubleArrayTrie::Match(3, 3));
+  EXPECT_EQ(dat.LongestPrefixMatch(' ', utils::string_view("AC")),
+            DoubleArrayTrie::Match(1, 2));
+  EXPECT_EQ(dat.LongestPrefixMatch(' ', utils::string_view("", 0)),
+            DoubleArrayTrie::Match(0, 1));
+  EXPECT_TRUE(dat.LongestPrefixMatch('B', utils::string_view("A")).empty());
+}
+
 TEST(DoubleArrayTrieTest, ComplexMatch) {
   flatbuffers::FlatBufferBuilder builder(1024);
   const std::vector<std::string> test_strings = {"\xe2\x96\x81the", ",", "s",
@@ -85,6 +106,50 @@ TEST(DoubleArrayTrieTest, ComplexMatch) {
   EXPECT_THAT(matches, testing::ElementsAre(DoubleArrayTrie::Match(15, 8)));
 }
 
+TEST(DoubleArrayTrieTest, FindAllPrefixMatches) {
+  flatbuffers::FlatBufferBuilder builder(1024);
+  const std::vector<std::string> test_strings = {"A", "AAX", "AA", "B"};
+  const auto trie_vector = builder.CreateVector(BuildTrie(test_strings));
+  TrieBuilder trie_builder(builder);
+  trie_builder.add_nodes(trie_vector);
+  const auto pieces = trie_builder.Finish();
+  EncoderConfigBuilder ecb(builder);
+  ecb.add_pieces(pieces);
+  FinishEncoderConfigBuffer(builder, ecb.Finish());
+  const EncoderConfig* config = GetEncoderConfig(builder.GetBufferPointer());
+  DoubleArrayTrie dat(config->pieces()->nodes());
+
+  std::vector<DoubleArrayTrie::Match> matches;
+  std::vector<int> match_begins;
+  dat.FindAllPrefixMatches(utils::string_view("AAXB"), &matches,
+                           &match_begins);
+  EXPECT_THAT(matches, testing::ElementsAre(DoubleArrayTrie::Match(0, 1),
+                                            DoubleArrayTrie::Match(2, 2),
+                                            DoubleArrayTrie::Match(1, 3),
+                                            DoubleArrayTrie::Match(0, 1),
+                                            DoubleArrayTrie::Match(3, 1)));
+  EXPECT_THAT(match_begins, testing::ElementsAre(0, 3, 4, 4, 5));
+
+  // The matches of each start are the ones of IteratePrefixMatches().
+  const utils::string_view input("AAXB");
+  for (int i = 0; i < input.length(); ++i) {
+    std::vector<DoubleArrayTrie::Match> start_matches;
+    dat.IteratePrefixMatches(
+        utils::string_view(input.data() + i, input.length() - i),
+        [&start_matches](const DoubleArrayTrie::Match& m) {
+          start_matches.push_back(m);
+        });
+    EXPECT_EQ(start_matches,
+              std::vector<DoubleArrayTrie::Match>(
+                  matches.begin() + match_begins[i],
+                  matches.begin() + match_begins[i + 1]));
+  }
+
+  dat.FindAllPrefixMatches(utils::string_view("", 0), &matches, &match_begins);
+  EXPECT_TRUE(matches.empty());
+  EXPECT_THAT(match_begins, testing::ElementsAre(0));
+}
+
 }  // namespace sentencepiece
 }  // namespace text
 }  // namespace tensorflow
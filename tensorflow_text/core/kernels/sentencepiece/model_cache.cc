@@ -0,0 +1,273 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/sentencepiece/model_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "flatbuffers/flatbuffers.h"
+#include "tensorflow_text/core/kernels/sentencepiece/decoder_config_generated.h"
+#include "tensorflow_text/core/kernels/sentencepiece/encoder_config_generated.h"
+#include "tensorflow_text/core/kernels/sentencepiece/model_converter.h"
+
+namespace tensorflow {
+namespace text {
+namespace sentencepiece {
+namespace {
+
+// Returns the status of a failed system call on `path`, from errno.
+absl::Status ErrnoStatus(absl::string_view what, const std::string& path) {
+  const int error = errno;
+  const std::string message =
+      absl::StrCat(what, " ", path, ": ", std::strerror(error));
+  return error == ENOENT ? absl::NotFoundError(message)
+                         : absl::InternalError(message);
+}
+
+// Returns the SHA-256 digest of `data` in lowercase hex (FIPS 180-4). The
+// cache files are named after it, so that two models never share a file.
+std::string Sha256Hex(absl::string_view data) {
+  static constexpr uint32_t kRoundConstants[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+      0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+      0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+      0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+      0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+      0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+      0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+      0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+  uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  const auto rotr = [](uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+  };
+
+  // Processes one 64-byte block of the message.
+  const auto compress = [&](const unsigned char* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+      w[i] = (uint32_t{block[4 * i]} << 24) |
+             (uint32_t{block[4 * i + 1]} << 16) |
+             (uint32_t{block[4 * i + 2]} << 8) | uint32_t{block[4 * i + 3]};
+    }
+    for (int i = 16; i < 64; ++i) {
+      const uint32_t s0 =
+          rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      const uint32_t s1 =
+          rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+             e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+      const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+                          ((e & f) ^ (~e & g)) + kRoundConstants[i] + w[i];
+      const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+                          ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  };
+
+  const size_t full_blocks_size = data.size() - data.size() % 64;
+  for (size_t offset = 0; offset < full_blocks_size; offset += 64) {
+    compress(reinterpret_cast<const unsigned char*>(data.data()) + offset);
+  }
+  // Pads the rest of the message with a 1 bit, zeros and the message length in
+  // bits, to one or two blocks.
+  std::string tail(data.substr(full_blocks_size));
+  const size_t num_zeros = (119 - tail.size()) % 64;
+  tail.push_back('\x80');
+  tail.append(num_zeros, '\0');
+  const uint64_t num_bits = static_cast<uint64_t>(data.size()) * 8;
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    tail.push_back(static_cast<char>(num_bits >> shift));
+  }
+  for (size_t offset = 0; offset < tail.size(); offset += 64) {
+    compress(reinterpret_cast<const unsigned char*>(tail.data()) + offset);
+  }
+
+  std::string hex;
+  for (const uint32_t word : state) {
+    absl::StrAppendFormat(&hex, "%08x", word);
+  }
+  return hex;
+}
+
+// Writes `contents` to a temporary file next to `path` and renames it to
+// `path`, so that the readers never see a partial file.
+absl::Status WriteFileAtomically(const std::string& path,
+                                 const std::string& contents) {
+  static std::atomic<int> num_writes{0};
+  const std::string temp_path =
+      absl::StrCat(path, ".tmp.", getpid(), ".", num_writes++);
+  const int fd =
+      open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return ErrnoStatus("Cannot create", temp_path);
+  }
+  absl::Status status;
+  for (size_t written = 0; written < contents.size();) {
+    const ssize_t result =
+        write(fd, contents.data() + written, contents.size() - written);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      status = ErrnoStatus("Cannot write", temp_path);
+      break;
+    }
+    written += result;
+  }
+  // Flush the contents before the rename, so that a crash cannot leave a
+  // cache file with the new name but not all of its contents.
+  if (status.ok() && fsync(fd) != 0) {
+    status = ErrnoStatus("Cannot sync", temp_path);
+  }
+  if (close(fd) != 0 && status.ok()) {
+    status = ErrnoStatus("Cannot write", temp_path);
+  }
+  if (status.ok() && rename(temp_path.c_str(), path.c_str()) != 0) {
+    status = ErrnoStatus("Cannot rename to", path);
+  }
+  if (!status.ok()) {
+    unlink(temp_path.c_str());
+  }
+  return status;
+}
+
+// Returns whether `model` is a well-formed flatbuffer of the `type` config,
+// e.g., not a file truncated by a crash or corrupted on disk.
+bool IsValidModel(const MappedModel& model, ConvertedModelType type) {
+  flatbuffers::Verifier verifier(static_cast<const uint8_t*>(model.data()),
+                                 model.size());
+  return type == ConvertedModelType::kEncoder
+             ? VerifyEncoderConfigBuffer(verifier)
+             : VerifyDecoderConfigBuffer(verifier);
+}
+
+// Whether a cached model that failed to load with `status` is to be converted
+// again: it is missing, empty, or not a valid flatbuffer. Other errors, e.g.,
+// a cache directory that is not readable, are returned as-is.
+bool IsMissingOrInvalid(const absl::Status& status) {
+  return absl::IsNotFound(status) || absl::IsInvalidArgument(status) ||
+         absl::IsDataLoss(status);
+}
+
+// Maps the converted model at `path`, and checks that it is valid.
+absl::StatusOr<std::unique_ptr<MappedModel>> OpenValidModel(
+    const std::string& path, ConvertedModelType type) {
+  auto model = MappedModel::Open(path);
+  if (model.ok() && !IsValidModel(**model, type)) {
+    return absl::DataLossError(absl::StrCat("Invalid model ", path));
+  }
+  return model;
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<MappedModel>> MappedModel::Open(
+    const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return ErrnoStatus("Cannot open", path);
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    const absl::Status status = ErrnoStatus("Cannot stat", path);
+    close(fd);
+    return status;
+  }
+  if (file_stat.st_size == 0) {
+    close(fd);
+    return absl::InvalidArgumentError(absl::StrCat("Empty model ", path));
+  }
+  void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  const absl::Status status =
+      data == MAP_FAILED ? ErrnoStatus("Cannot map", path) : absl::OkStatus();
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (!status.ok()) {
+    return status;
+  }
+  return std::unique_ptr<MappedModel>(
+      new MappedModel(data, file_stat.st_size));
+}
+
+MappedModel::~MappedModel() { munmap(data_, size_); }
+
+std::string GetCachedModelPath(const std::string& cache_dir,
+                               const std::string& model_string,
+                               ConvertedModelType type) {
+  const absl::string_view separator =
+      cache_dir.empty() || cache_dir.back() == '/' ? "" : "/";
+  return absl::StrFormat(
+      "%s%ssentencepiece-%s.v%d.%s", cache_dir, separator,
+      Sha256Hex(model_string), kConverterVersion,
+      type == ConvertedModelType::kEncoder ? "encoder" : "decoder");
+}
+
+absl::StatusOr<std::unique_ptr<MappedModel>> LoadOrConvertModel(
+    const std::string& model_string, const std::string& cache_dir,
+    ConvertedModelType type) {
+  const std::string path = GetCachedModelPath(cache_dir, model_string, type);
+  auto model = OpenValidModel(path, type);
+  if (!IsMissingOrInvalid(model.status())) {
+    return model;
+  }
+  // Convert the model, and replace the cached file if it is invalid.
+  const auto converted =
+      type == ConvertedModelType::kEncoder
+          ? ConvertSentencepieceModelToFlatBuffer(model_string)
+          : ConvertSentencepieceModelToFlatBufferForDecoder(model_string);
+  if (!converted.ok()) {
+    return converted.status();
+  }
+  const absl::Status status = WriteFileAtomically(path, *converted);
+  if (!status.ok()) {
+    return status;
+  }
+  return OpenValidModel(path, type);
+}
+
+}  // namespace sentencepiece
+}  // namespace text
+}  // namespace tensorflow
@@ -0,0 +1,83 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TENSORFLOW_LITE_SUPPORT_CUSTOM_OPS_KERNEL_SENTENCEPIECE_MODEL_CACHE_H_
+#define TENSORFLOW_LITE_SUPPORT_CUSTOM_OPS_KERNEL_SENTENCEPIECE_MODEL_CACHE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+
+namespace tensorflow {
+namespace text {
+namespace sentencepiece {
+
+// A converted model (see model_converter.h) mapped read-only from a file. The
+// pages are loaded on demand and shared by all the processes that map the same
+// file.
+//
+// Only the C++ callers that pass data() as the config buffer of Encoder and
+// DecodeString() read the model in place. The TF and TFLite ops take the model
+// as an input tensor, so FastSentencepieceTokenizer only uses the cache to skip
+// the conversion, and still copies the model into a constant.
+class MappedModel {
+ public:
+  // Maps the whole file at `path`, which must not be empty.
+  static absl::StatusOr<std::unique_ptr<MappedModel>> Open(
+      const std::string& path);
+
+  ~MappedModel();
+  MappedModel(const MappedModel&) = delete;
+  MappedModel& operator=(const MappedModel&) = delete;
+
+  // The flatbuffer, e.g., the config buffer of the encoder or of the decoder.
+  const void* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedModel(void* data, size_t size) : data_(data), size_(size) {}
+
+  void* data_;
+  size_t size_;
+};
+
+enum class ConvertedModelType { kEncoder, kDecoder };
+
+// Returns the path of the converted model of `model_string`, a serialized
+// Sentencepiece model, in `cache_dir`. The name holds the SHA-256 of the
+// content of the model, so that the same model gets the same file whatever its
+// source, and the version of the converter.
+std::string GetCachedModelPath(const std::string& cache_dir,
+                               const std::string& model_string,
+                               ConvertedModelType type);
+
+// Maps the converted model of `model_string` from `cache_dir`. On a cache miss,
+// or if the cached file is empty or not a valid flatbuffer, e.g., truncated,
+// converts the model and writes it to the cache first. Concurrent writers are
+// safe: each one writes and syncs its own temporary file, then renames it into
+// place.
+//
+// The cache files are only checked to be well-formed flatbuffers, so
+// `cache_dir` must be as trusted as the models themselves.
+absl::StatusOr<std::unique_ptr<MappedModel>> LoadOrConvertModel(
+    const std::string& model_string, const std::string& cache_dir,
+    ConvertedModelType type);
+
+}  // namespace sentencepiece
+}  // namespace text
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LITE_SUPPORT_CUSTOM_OPS_KERNEL_SENTENCEPIECE_MODEL_CACHE_H_
@@ -0,0 +1,167 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/sentencepiece/model_cache.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "file/base/path.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow_text/core/kernels/sentencepiece/model_converter.h"
+#include "tensorflow_text/core/kernels/sentencepiece/optimized_decoder.h"
+#include "tensorflow_text/core/kernels/sentencepiece/optimized_encoder.h"
+#include "tensorflow_text/core/kernels/sentencepiece/utils.h"
+
+namespace tensorflow {
+namespace text {
+namespace sentencepiece {
+namespace {
+
+static char kConfigFilePath[] =
+    "/tensorflow_text/python/ops/test_data/"
+    "fast_sentencepiece.model";
+
+std::string ReadModel() {
+  std::string config;
+  EXPECT_TRUE(tensorflow::ReadFileToString(
+                  tensorflow::Env::Default(),
+                  file::JoinPath(::testing::SrcDir(), kConfigFilePath), &config)
+                  .ok());
+  return config;
+}
+
+std::string MappedString(const MappedModel& model) {
+  return std::string(static_cast<const char*>(model.data()), model.size());
+}
+
+TEST(ModelCacheTest, MappedModel) {
+  const std::string path = file::JoinPath(::testing::TempDir(), "mapped");
+  std::ofstream(path) << "converted model";
+  const auto model = MappedModel::Open(path);
+  ASSERT_TRUE(model.ok());
+  EXPECT_EQ(MappedString(**model), "converted model");
+
+  EXPECT_TRUE(absl::IsNotFound(
+      MappedModel::Open(file::JoinPath(::testing::TempDir(), "missing"))
+          .status()));
+  const std::string empty_path = file::JoinPath(::testing::TempDir(), "empty");
+  std::ofstream{empty_path};
+  EXPECT_TRUE(absl::IsInvalidArgument(MappedModel::Open(empty_path).status()));
+}
+
+TEST(ModelCacheTest, CachedModelPath) {
+  const auto path = GetCachedModelPath("/cache", "model",
+                                       ConvertedModelType::kEncoder);
+  // The SHA-256 of "model".
+  EXPECT_EQ(path,
+            absl::StrCat("/cache/sentencepiece-9372c470eeadd5ecd9c3c74c2b3cb633"
+                         "f8e2f2fad799250a0f70d652b6b825e4.v",
+                         kConverterVersion, ".encoder"));
+  EXPECT_EQ(GetCachedModelPath("/cache/", "model",
+                               ConvertedModelType::kEncoder),
+            path);
+  EXPECT_NE(GetCachedModelPath("/cache", "model",
+                               ConvertedModelType::kDecoder),
+            path);
+  EXPECT_NE(GetCachedModelPath("/cache", "other model",
+                               ConvertedModelType::kEncoder),
+            path);
+}
+
+TEST(ModelCacheTest, LoadOrConvertModel) {
+  const std::string config = ReadModel();
+  const std::string cache_dir = ::testing::TempDir();
+  for (const auto type :
+       {ConvertedModelType::kEncoder, ConvertedModelType::kDecoder}) {
+    const std::string converted = type == ConvertedModelType::kEncoder
+                                      ? ConvertSentencepieceModel(config)
+                                      : ConvertSentencepieceModelForDecoder(
+                                            config);
+    // Converts the model on the first load, then maps the cached one.
+    for (int i = 0; i < 2; ++i) {
+      const auto model = LoadOrConvertModel(config, cache_dir, type);
+      ASSERT_TRUE(model.ok());
+      EXPECT_EQ(MappedString(**model), converted);
+    }
+    const auto cached =
+        MappedModel::Open(GetCachedModelPath(cache_dir, config, type));
+    ASSERT_TRUE(cached.ok());
+    EXPECT_EQ(MappedString(**cached), converted);
+  }
+}
+
+TEST(ModelCacheTest, ReplacesInvalidCachedModels) {
+  const std::string config = ReadModel();
+  const std::string cache_dir =
+      file::JoinPath(::testing::TempDir(), "invalid_models");
+  ASSERT_EQ(mkdir(cache_dir.c_str(), 0755), 0);
+  const std::string converted = ConvertSentencepieceModel(config);
+  const std::string path =
+      GetCachedModelPath(cache_dir, config, ConvertedModelType::kEncoder);
+  // An empty file, a truncated one, e.g., by a crash, and a corrupted one.
+  for (const std::string& invalid :
+       {std::string(), converted.substr(0, converted.size() / 2),
+        std::string(converted.size(), '\xff')}) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << invalid;
+    const auto model =
+        LoadOrConvertModel(config, cache_dir, ConvertedModelType::kEncoder);
+    ASSERT_TRUE(model.ok()) << model.status();
+    EXPECT_EQ(MappedString(**model), converted);
+  }
+}
+
+TEST(ModelCacheTest, MappedModelIsTheConfigBuffer) {
+  const std::string config = ReadModel();
+  const std::string cache_dir = ::testing::TempDir();
+  const auto encoder_model =
+      LoadOrConvertModel(config, cache_dir, ConvertedModelType::kEncoder);
+  ASSERT_TRUE(encoder_model.ok());
+  const auto decoder_model =
+      LoadOrConvertModel(config, cache_dir, ConvertedModelType::kDecoder);
+  ASSERT_TRUE(decoder_model.ok());
+
+  // The encoder and the decoder read the mapped files in place.
+  const std::string test_string = "Hello world!";
+  const EncoderResult expected =
+      EncodeString(test_string, ConvertSentencepieceModel(config).data(),
+                   /*add_bos=*/false, /*add_eos=*/false, /*reverse=*/false);
+  Encoder encoder;
+  std::vector<int> codes;
+  ASSERT_EQ(encoder.Encode((*encoder_model)->data(),
+                           utils::string_view(test_string), /*add_bos=*/false,
+                           /*add_eos=*/false, /*reverse=*/false, &codes),
+            EncoderResultType::SUCCESS);
+  EXPECT_EQ(codes, expected.codes);
+  std::string decoded;
+  ASSERT_EQ(DecodeString((*decoder_model)->data(), codes.data(), codes.size(),
+                         &decoded),
+            DecoderResultType::SUCCESS);
+  EXPECT_EQ(decoded,
+            DecodeString(codes, ConvertSentencepieceModelForDecoder(config)
+                                    .data())
+                .decoded);
+}
+
+}  // namespace
+}  // namespace sentencepiece
+}  // namespace text
+}  // namespace tensorflow
@@ -28,6 +28,9 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow_text/core/kernels/sentencepiece/model_converter.h"
+
+#include <algorithm>
+#include <numeric>
 #include <tuple>
 
 #include "absl/status/status.h"
@@ -79,12 +82,19 @@ absl::StatusOr<std::string> ConvertSentencepieceModelToFlatBuffer(
   scores.reserve(model_config.pieces_size());
   std::vector<int> ids;
   ids.reserve(model_config.pieces_size());
+  std::vector<std::string> user_defined_pieces;
+  std::vector<int> user_defined_ids;
   float min_score = 0.0;
   int index = 0;
   for (const auto& piece : model_config.pieces()) {
     switch (piece.type()) {
       case ::sentencepiece::ModelProto::SentencePiece::NORMAL:
       case ::sentencepiece::ModelProto::SentencePiece::USER_DEFINED:
+        if (piece.type() ==
+            ::sentencepiece::ModelProto::SentencePiece::USER_DEFINED) {
+          user_defined_pieces.push_back(piece.piece());
+          user_defined_ids.push_back(index);
+        }
         pieces.push_back(piece.piece());
         ids.push_back(index);
         if (piece.score() < min_score) {
@@ -123,6 +133,37 @@ absl::StatusOr<std::string> ConvertSentencepieceModelToFlatBuffer(
   const auto normalization_strings_fbs =
       builder.CreateVector(normalization_strings);
 
+  // BPE merges the pairs of symbols by decreasing score of the merged piece.
+  // Equal scores get equal ranks, so that their merges are ordered by
+  // position, as in SentencePiece.
+  const bool is_bpe = model_config.trainer_spec().model_type() ==
+                      ::sentencepiece::TrainerSpec::BPE;
+  flatbuffers::Offset<flatbuffers::Vector<int32_t>> merge_ranks_fbs;
+  flatbuffers::Offset<Trie> user_defined_trie_fbs;
+  if (is_bpe) {
+    std::vector<int> order(scores.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&scores](int a, int b) {
+      return scores[a] > scores[b];
+    });
+    std::vector<int32_t> merge_ranks(scores.size());
+    int rank = 0;
+    for (int i = 0; i < order.size(); ++i) {
+      if (i > 0 && scores[order[i]] != scores[order[i - 1]]) {
+        ++rank;
+      }
+      merge_ranks[order[i]] = rank;
+    }
+    merge_ranks_fbs = builder.CreateVector(merge_ranks);
+    if (!user_defined_pieces.empty()) {
+      const auto user_defined_trie_vector = builder.CreateVector(
+          BuildTrie(user_defined_pieces, user_defined_ids));
+      TrieBuilder user_defined_trie_builder(builder);
+      user_defined_trie_builder.add_nodes(user_defined_trie_vector);
+      user_defined_trie_fbs = user_defined_trie_builder.Finish();
+    }
+  }
+
   EncoderConfigBuilder ecb(builder);
   ecb.add_version(EncoderVersion::EncoderVersion_SENTENCE_PIECE);
   ecb.add_start_code(model_config.trainer_spec().bos_id());
@@ -139,6 +180,13 @@ absl::StatusOr<std::string> ConvertSentencepieceModelToFlatBuffer(
       model_config.normalizer_spec().escape_whitespaces());
   ecb.add_normalized_prefixes(normalization_trie_fbs);
   ecb.add_normalized_replacements(normalization_strings_fbs);
+  if (is_bpe) {
+    ecb.add_model_type(EncoderModelType::EncoderModelType_BPE);
+    ecb.add_merge_ranks(merge_ranks_fbs);
+    if (!user_defined_pieces.empty()) {
+      ecb.add_user_defined_pieces(user_defined_trie_fbs);
+    }
+  }
   FinishEncoderConfigBuffer(builder, ecb.Finish());
   return std::string(reinterpret_cast<const char*>(builder.GetBufferPointer()),
                      builder.GetSize());
@@ -37,6 +37,11 @@ namespace tensorflow {
 namespace text {
 namespace sentencepiece {
 
+// The version of the output of the converters below. Bump it whenever that
+// output changes, to invalidate the converted models cached on disk (see
+// model_cache.h).
+inline constexpr int kConverterVersion = 1;
+
 // Converts Sentencepiece configuration to flatbuffer format.
 // encoding_offset is used by some encoders that combine different encodings.
 absl::StatusOr<std::string> ConvertSentencepieceModelToFlatBuffer(
@@ -42,32 +42,36 @@ namespace sentencepiece {
 DecoderResult DecodeString(const std::vector<int>& encoded,
                            const void* config_buffer) {
   DecoderResult result;
+  result.type = DecodeString(config_buffer, encoded.data(), encoded.size(),
+                             &result.decoded);
+  return result;
+}
 
+DecoderResultType DecodeString(const void* config_buffer, const int* codes,
+                               int num_codes, std::string* decoded) {
   // Get the config from the buffer.
   const DecoderConfig* config = GetDecoderConfig(config_buffer);
   if (config->version() != EncoderVersion::EncoderVersion_SENTENCE_PIECE) {
-    result.type = DecoderResultType::WRONG_CONFIG;
-    return result;
+    return DecoderResultType::WRONG_CONFIG;
   }
   bool remove_dummy_prefix = config->remove_dummy_prefix();
   const auto config_pieces = config->decode_pieces();
-  for (const auto code : encoded) {
-    const int real_code = code - config->encoding_offset();
-    if (real_code >= config_pieces->size()) {
-      result.type = DecoderResultType::INVALID_INPUT;
-      return result;
+  for (int i = 0; i < num_codes; ++i) {
+    const int real_code = codes[i] - config->encoding_offset();
+    if (real_code < 0 || real_code >= config_pieces->size()) {
+      return DecoderResultType::INVALID_INPUT;
     }
     const auto& piece_text = config_pieces->GetAsString(real_code);
     const char* piece_str = piece_text->c_str();
     if (remove_dummy_prefix && *piece_str == ' ') {
       ++piece_str;
     }
-    result.decoded.append(piece_str);
+    decoded->append(piece_str);
     remove_dummy_prefix = false;
   }
   // TODO(mgubin): Denormalize the string, haven't seen any Sentencepiece model
   // with a denormalizer.
-  return result;
+  return DecoderResultType::SUCCESS;
 }
 
 }  // namespace sentencepiece
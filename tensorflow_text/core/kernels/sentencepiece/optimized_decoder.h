@@ -32,6 +32,8 @@ limitations under the License.
 
 // Sentencepiece decoder optimized with memmapped model.
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -55,6 +57,62 @@ struct DecoderResult {
 DecoderResult DecodeString(const std::vector<int>& encoded,
                            const void* config_buffer);
 
+// Decodes the `num_codes` ids at `codes` and appends the decoded string to
+// `decoded`, which is not reallocated if it has enough capacity. Takes the
+// configuration as a type-erased buffer.
+DecoderResultType DecodeString(const void* config_buffer, const int* codes,
+                               int num_codes, std::string* decoded);
+
+// Decodes a batch of `num_strings` strings, where the ids of the string `i` are
+// `codes[splits[i], splits[i + 1])`, without allocating per string. Sets
+// `decoded` to the decoded strings, one after the other, and `decoded_ends` to
+// the end of each of them in `decoded`. Reuses the memory of `decoded` and
+// `decoded_ends`, e.g., across the calls of a kernel.
+template <typename SplitsType>
+DecoderResultType DecodeStrings(const void* config_buffer, const int* codes,
+                                int64_t num_codes, const SplitsType* splits,
+                                int64_t num_strings, std::string* decoded,
+                                std::vector<size_t>* decoded_ends) {
+  decoded->clear();
+  decoded_ends->clear();
+  if (num_strings > 0) {
+    decoded_ends->reserve(num_strings);
+  }
+  for (int64_t i = 0; i < num_strings; ++i) {
+    if (splits[i] < 0 || splits[i] > splits[i + 1] ||
+        splits[i + 1] > num_codes) {
+      return DecoderResultType::INVALID_INPUT;
+    }
+    const DecoderResultType type =
+        DecodeString(config_buffer, codes + splits[i],
+                     static_cast<int>(splits[i + 1] - splits[i]), decoded);
+    if (type != DecoderResultType::SUCCESS) {
+      return type;
+    }
+    decoded_ends->push_back(decoded->size());
+  }
+  return DecoderResultType::SUCCESS;
+}
+
+// The capacity, in bytes, above which ReleaseLargeDecodeBuffers() frees the
+// buffers of DecodeStrings().
+inline constexpr size_t kMaxRetainedDecodeBufferBytes = size_t{1} << 20;
+
+// Frees `decoded` and `decoded_ends` if they grew past
+// kMaxRetainedDecodeBufferBytes, so that the buffers kept across calls do not
+// hold the memory of the largest batch seen for the lifetime of the thread or
+// of the node.
+inline void ReleaseLargeDecodeBuffers(std::string* decoded,
+                                      std::vector<size_t>* decoded_ends) {
+  if (decoded->capacity() > kMaxRetainedDecodeBufferBytes) {
+    std::string().swap(*decoded);
+  }
+  if (decoded_ends->capacity() * sizeof(size_t) >
+      kMaxRetainedDecodeBufferBytes) {
+    std::vector<size_t>().swap(*decoded_ends);
+  }
+}
+
 }  // namespace sentencepiece
 }  // namespace text
 }  // namespace tensorflow
@@ -29,7 +29,11 @@ limitations under the License.
 
 #include "tensorflow_text/core/kernels/sentencepiece/optimized_decoder.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <string>
+#include <vector>
 
 #include "file/base/path.h"
 #include <gmock/gmock.h>
@@ -100,6 +104,67 @@ TEST(OptimizedEncoder, ConfigConverter) {
   ASSERT_EQ(decoded.type, DecoderResultType::SUCCESS);
   ASSERT_EQ(ref_decoded, decoded.decoded);
 }
+
+TEST(OptimizedEncoder, DecodeStrings) {
+  std::string config;
+
+  auto status = internal::TFReadFileToString(
+      file::JoinPath(::testing::SrcDir(), kConfigFilePath), &config);
+  ASSERT_TRUE(status.ok());
+
+  ::sentencepiece::SentencePieceProcessor processor;
+  ASSERT_TRUE(processor.LoadFromSerializedProto(config).ok());
+  const auto converted_model = ConvertSentencepieceModelForDecoder(config);
+  const std::vector<std::string> test_strings = {"Hello world!", "",
+                                                 "Hello\xF0\x9F\x8D\x95"};
+  std::vector<int> codes;
+  std::vector<int64_t> splits = {0};
+  for (const auto& test_string : test_strings) {
+    std::vector<int> ids;
+    ASSERT_TRUE(processor.Encode(test_string, &ids).ok());
+    codes.insert(codes.end(), ids.begin(), ids.end());
+    splits.push_back(codes.size());
+  }
+
+  std::string decoded;
+  std::vector<size_t> decoded_ends;
+  ASSERT_EQ(DecodeStrings(converted_model.data(), codes.data(), codes.size(),
+                          splits.data(), test_strings.size(), &decoded,
+                          &decoded_ends),
+            DecoderResultType::SUCCESS);
+  ASSERT_EQ(decoded_ends.size(), test_strings.size());
+  size_t begin = 0;
+  for (size_t i = 0; i < test_strings.size(); ++i) {
+    const std::vector<int> ids(codes.begin() + splits[i],
+                               codes.begin() + splits[i + 1]);
+    std::string ref_decoded;
+    ASSERT_TRUE(processor.Decode(ids, &ref_decoded).ok());
+    EXPECT_EQ(decoded.substr(begin, decoded_ends[i] - begin), ref_decoded);
+    EXPECT_EQ(DecodeString(ids, converted_model.data()).decoded, ref_decoded);
+    begin = decoded_ends[i];
+  }
+
+  // Splits out of the ids are rejected.
+  splits.back() = codes.size() + 1;
+  EXPECT_EQ(DecodeStrings(converted_model.data(), codes.data(), codes.size(),
+                          splits.data(), test_strings.size(), &decoded,
+                          &decoded_ends),
+            DecoderResultType::INVALID_INPUT);
+}
+
+TEST(OptimizedEncoder, ReleaseLargeDecodeBuffers) {
+  std::string decoded(kMaxRetainedDecodeBufferBytes, 'a');
+  std::vector<size_t> decoded_ends(16);
+  ReleaseLargeDecodeBuffers(&decoded, &decoded_ends);
+  EXPECT_GE(decoded.capacity(), kMaxRetainedDecodeBufferBytes);
+  EXPECT_GE(decoded_ends.capacity(), 16u);
+
+  decoded.resize(kMaxRetainedDecodeBufferBytes + 1);
+  decoded_ends.resize(kMaxRetainedDecodeBufferBytes / sizeof(size_t) + 1);
+  ReleaseLargeDecodeBuffers(&decoded, &decoded_ends);
+  EXPECT_LT(decoded.capacity(), kMaxRetainedDecodeBufferBytes);
+  EXPECT_EQ(decoded_ends.capacity(), 0u);
+}
 }  // namespace
 
 }  // namespace sentencepiece
@@ -30,6 +30,9 @@ limitations under the License.
 #include "tensorflow_text/core/kernels/sentencepiece/optimized_encoder.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
 #include <tuple>
 
 #include "tensorflow_text/core/kernels/sentencepiece/double_array_trie.h"
@@ -42,138 +45,204 @@ namespace {
 
 const char kSpaceSymbol[] = "\xe2\x96\x81";
 
-template <typename processing_callback>
-std::tuple<std::string, std::vector<int>> process_string(
-    const std::string& input, const std::vector<int>& offsets,
-    const processing_callback& pc) {
-  std::string result_string;
-  result_string.reserve(input.size());
-  std::vector<int> result_offsets;
-  result_offsets.reserve(offsets.size());
-  for (int i = 0, j = 0; i < input.size();) {
-    auto result = pc(input.data() + i, input.size() - i);
-    auto consumed = std::get<0>(result);
-    auto new_string = std::get<1>(result);
-    if (consumed == 0) {
-      // Skip the current byte and move forward.
-      result_string.push_back(input[i]);
-      result_offsets.push_back(offsets[j]);
-      i++;
-      j++;
-      continue;
+inline char is_whitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Applies the whitespace transforms of the config to the bytes produced by the
+// prefix replacement, and appends the result to the output buffers.
+class NormalizedStringWriter {
+ public:
+  NormalizedStringWriter(const EncoderConfig& config, std::string* out_string,
+                         std::vector<int>* out_offsets)
+      : remove_extra_whitespaces_(config.remove_extra_whitespaces()),
+        escape_whitespaces_(config.escape_whitespaces()),
+        out_string_(out_string),
+        out_offsets_(out_offsets) {}
+
+  // Appends `c`, produced from the input byte at `offset`. With
+  // remove_extra_whitespaces, a run of whitespaces is kept pending until the
+  // next non-whitespace, so that trailing whitespaces are never written.
+  void Append(char c, int offset) {
+    if (remove_extra_whitespaces_) {
+      if (is_whitespace(c)) {
+        if (num_pending_whitespaces_++ == 0) {
+          pending_whitespace_ = c;
+          pending_whitespace_offset_ = offset;
+        }
+        return;
+      }
+      if (num_pending_whitespaces_ > 0) {
+        // A run of several whitespaces is replaced with a single space.
+        Write(num_pending_whitespaces_ == 1 ? pending_whitespace_ : ' ',
+              pending_whitespace_offset_);
+        num_pending_whitespaces_ = 0;
+      }
     }
-    result_string.append(new_string.data(), new_string.length());
-    for (int i = 0; i < new_string.length(); ++i) {
-      result_offsets.push_back(offsets[j]);
+    Write(c, offset);
+  }
+
+ private:
+  void Write(char c, int offset) {
+    if (escape_whitespaces_ && is_whitespace(c)) {
+      out_string_->append(kSpaceSymbol, sizeof(kSpaceSymbol) - 1);
+      out_offsets_->insert(out_offsets_->end(), sizeof(kSpaceSymbol) - 1,
+                           offset);
+      return;
     }
-    j += consumed;
-    i += consumed;
+    out_string_->push_back(c);
+    out_offsets_->push_back(offset);
+  }
+
+  const bool remove_extra_whitespaces_;
+  const bool escape_whitespaces_;
+  std::string* out_string_;
+  std::vector<int>* out_offsets_;
+  int num_pending_whitespaces_ = 0;
+  char pending_whitespace_ = ' ';
+  int pending_whitespace_offset_ = 0;
+};
+
+constexpr float kNegativeInfinity = -std::numeric_limits<float>::infinity();
+
+// Returns log(exp(x) + exp(y)).
+inline float LogSumExp(float x, float y) {
+  if (x == kNegativeInfinity) {
+    return y;
   }
-  return std::make_tuple(result_string, result_offsets);
+  if (y == kNegativeInfinity) {
+    return x;
+  }
+  return std::max(x, y) + std::log1p(std::exp(-std::abs(x - y)));
 }
 
-inline char is_whitespace(char c) {
-  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+// Returns the length of the UTF-8 character that starts with `c`.
+inline int OneCharLen(char c) {
+  return "\1\1\1\1\1\1\1\1\1\1\1\1\2\2\3\4"[(c & 0xFF) >> 4];
 }
 
-std::tuple<int, utils::string_view> remove_extra_whitespaces(const char* data,
-                                                             int len) {
-  if (len == 0 || !is_whitespace(*data)) {
-    return std::make_tuple(0, utils::string_view(nullptr, 0));
+// Returns the id of the piece `str`, or -1 if it is not a piece.
+inline int PieceId(const DoubleArrayTrie& piece_matcher,
+                   const utils::string_view& str) {
+  const DoubleArrayTrie::Match match = piece_matcher.LongestPrefixMatch(str);
+  return match.match_length == str.length() ? match.id : -1;
+}
+}  // namespace
+
+void NormalizeString(utils::string_view in_string, const EncoderConfig& config,
+                     std::string* out_string, std::vector<int>* out_offsets) {
+  out_string->clear();
+  out_offsets->clear();
+  if (in_string.empty()) {
+    return;
   }
-  int num_consumed = 1;
-  for (; num_consumed < len && is_whitespace(data[num_consumed]);
-       ++num_consumed) {
+  out_string->reserve(in_string.length() + 1);
+  out_offsets->reserve(in_string.length() + 1);
+  NormalizedStringWriter writer(config, out_string, out_offsets);
+  if (config.normalized_prefixes() == nullptr ||
+      config.normalized_replacements() == nullptr) {
+    if (config.add_dummy_prefix()) {
+      writer.Append(' ', 0);
+    }
+    for (int i = 0; i < in_string.length(); ++i) {
+      writer.Append(in_string.data()[i], i);
+    }
+    return;
   }
-  return num_consumed > 1
-             ? std::make_tuple(num_consumed, utils::string_view(" ", 1))
-             : std::make_tuple(0, utils::string_view(nullptr, 0));
-}
 
-std::tuple<int, utils::string_view> find_replacement(
-    const char* data, int len, const DoubleArrayTrie& dat,
-    const flatbuffers::Vector<int8_t>& replacements) {
-  const auto max_match = dat.LongestPrefixMatch(utils::string_view(data, len));
-  if (!max_match.empty()) {
+  // Greedily replace normalized_prefixes with normalized_replacements.
+  const DoubleArrayTrie normalized_prefixes_matcher(
+      config.normalized_prefixes()->nodes());
+  const auto append_replacement = [&config, &writer](
+                                      const DoubleArrayTrie::Match& match,
+                                      int offset) {
     // Because flatbuffer byte is signed char which is not the same as char,
     // there is the reinterpret_cast here.
-    const char* replaced_string_ptr =
-        reinterpret_cast<const char*>(replacements.data() + max_match.id);
-    return std::make_tuple(max_match.match_length,
-                           utils::string_view(replaced_string_ptr));
+    for (const char* c = reinterpret_cast<const char*>(
+             config.normalized_replacements()->data() + match.id);
+         *c != '\0'; ++c) {
+      writer.Append(*c, offset);
+    }
+  };
+  int i = 0;
+  if (config.add_dummy_prefix()) {
+    // The dummy prefix is matched as if it was the first byte of the input.
+    const auto match =
+        normalized_prefixes_matcher.LongestPrefixMatch(' ', in_string);
+    if (match.empty()) {
+      writer.Append(' ', 0);
+    } else {
+      append_replacement(match, 0);
+      i = match.match_length - 1;
+    }
+  }
+  while (i < in_string.length()) {
+    const auto match = normalized_prefixes_matcher.LongestPrefixMatch(
+        utils::string_view(in_string.data() + i, in_string.length() - i));
+    if (match.empty()) {
+      writer.Append(in_string.data()[i], i);
+      ++i;
+    } else {
+      append_replacement(match, i);
+      i += match.match_length;
+    }
   }
-  return std::make_tuple(0, utils::string_view(nullptr, 0));
 }
-}  // namespace
 
 std::tuple<std::string, std::vector<int>> NormalizeString(
     const std::string& in_string, const EncoderConfig& config) {
+  std::string result;
   std::vector<int> output_offsets;
-  std::string result = in_string;
-  output_offsets.reserve(in_string.length());
-  for (int i = 0; i < in_string.length(); ++i) {
-    output_offsets.push_back(i);
-  }
-  if (in_string.empty()) {
-    return std::make_tuple(result, output_offsets);
-  }
-  if (config.add_dummy_prefix()) {
-    result.insert(result.begin(), ' ');
-    output_offsets.insert(output_offsets.begin(), 0);
-  }
-  // Greedely replace normalized_prefixes with normalized_replacements
-  if (config.normalized_prefixes() != nullptr &&
-      config.normalized_replacements() != nullptr) {
-    const DoubleArrayTrie normalized_prefixes_matcher(
-        config.normalized_prefixes()->nodes());
-    const auto norm_replace = [&config, &normalized_prefixes_matcher](
-                                  const char* data, int len) {
-      return find_replacement(data, len, normalized_prefixes_matcher,
-                              *config.normalized_replacements());
-    };
-    std::tie(result, output_offsets) =
-        process_string(result, output_offsets, norm_replace);
+  NormalizeString(utils::string_view(in_string), config, &result,
+                  &output_offsets);
+  return std::make_tuple(result, output_offsets);
+}
+
+Encoder::Encoder() : random_generator_(std::random_device()()) {}
+
+EncoderResultType Encoder::Encode(const void* config_buffer,
+                                  utils::string_view string, bool add_bos,
+                                  bool add_eos, bool reverse,
+                                  std::vector<int>* codes,
+                                  std::vector<int>* offsets) {
+  const EncoderConfig* config;
+  if (!Normalize(config_buffer, string, &config)) {
+    return EncoderResultType::WRONG_CONFIG;
   }
-  if (config.remove_extra_whitespaces()) {
-    std::tie(result, output_offsets) =
-        process_string(result, output_offsets, remove_extra_whitespaces);
-    if (!result.empty() && is_whitespace(result.back())) {
-      result.pop_back();
-      output_offsets.pop_back();
-    }
-  }
-  if (config.escape_whitespaces()) {
-    const auto replace_whitespaces = [](const char* data, int len) {
-      if (len > 0 && is_whitespace(*data)) {
-        return std::make_tuple(1, utils::string_view(kSpaceSymbol));
-      }
-      return std::make_tuple(0, utils::string_view(nullptr, 0));
-    };
-    std::tie(result, output_offsets) =
-        process_string(result, output_offsets, replace_whitespaces);
+  if (config->model_type() == EncoderModelType::EncoderModelType_BPE) {
+    EncodeBpe(*config, /*dropout=*/0, add_bos, add_eos, reverse, codes,
+              offsets);
+  } else {
+    EncodeNormalizedString(*config, add_bos, add_eos, reverse, codes,
+                           offsets);
   }
+  return EncoderResultType::SUCCESS;
+}
 
-  return std::make_tuple(result, output_offsets);
+bool Encoder::Normalize(const void* config_buffer, utils::string_view string,
+                        const EncoderConfig** config) {
+  // Get the config from the buffer.
+  *config = GetEncoderConfig(config_buffer);
+  if ((*config)->version() != EncoderVersion::EncoderVersion_SENTENCE_PIECE) {
+    return false;
+  }
+  NormalizeString(string, **config, &normalized_string_, &normalized_offsets_);
+  return true;
 }
 
-EncoderResult EncodeNormalizedString(const std::string& str,
-                                     const std::vector<int>& offsets,
-                                     const EncoderConfig& config, bool add_bos,
-                                     bool add_eos, bool reverse) {
+void Encoder::EncodeNormalizedString(const EncoderConfig& config, bool add_bos,
+                                     bool add_eos, bool reverse,
+                                     std::vector<int>* codes,
+                                     std::vector<int>* offsets) {
+  const std::string& str = normalized_string_;
   const DoubleArrayTrie piece_matcher(config.pieces()->nodes());
   const flatbuffers::Vector<float>* piece_scores = config.pieces_scores();
   const int unknown_code = config.unknown_code();
   const float unknown_penalty = config.unknown_penalty();
-  struct LatticeElement {
-    float score = 0;
-    int code = -1;
-    int prev_position = -1;
-    LatticeElement(float score_, int code_, int prev_position_)
-        : score(score_), code(code_), prev_position(prev_position_) {}
-    LatticeElement() {}
-  };
   const int length = str.length();
-  std::vector<LatticeElement> lattice(length + 1);
+  // Reuses the memory of the lattice of the previous calls.
+  std::vector<LatticeElement>& lattice = lattice_;
+  lattice.assign(length + 1, LatticeElement());
   for (int i = 0; i < length; ++i) {
     if (i > 0 && lattice[i].prev_position < 0) {
       // This state is unreachable.
@@ -205,10 +274,14 @@ EncoderResult EncodeNormalizedString(const std::string& str,
         utils::string_view(str.data() + i, length - i), lattice_update);
   }
 
-  EncoderResult result;
+  // The results are appended in reverse order, then reversed if needed.
+  const int codes_begin = codes->size();
+  const int offsets_begin = offsets != nullptr ? offsets->size() : 0;
   if (add_eos) {
-    result.codes.push_back(config.end_code());
-    result.offsets.push_back(length);
+    codes->push_back(config.end_code());
+    if (offsets != nullptr) {
+      offsets->push_back(length);
+    }
   }
   if (lattice[length].prev_position >= 0) {
     for (int pos = length; pos > 0;) {
@@ -216,36 +289,453 @@ EncoderResult EncodeNormalizedString(const std::string& str,
       if (code != config.unknown_code()) {
         code += config.encoding_offset();
       }
-      result.codes.push_back(code);
+      codes->push_back(code);
       pos = lattice[pos].prev_position;
-      result.offsets.push_back(offsets[pos]);
+      if (offsets != nullptr) {
+        offsets->push_back(normalized_offsets_[pos]);
+      }
     }
   }
   if (add_bos) {
-    result.codes.push_back(config.start_code());
-    result.offsets.push_back(0);
+    codes->push_back(config.start_code());
+    if (offsets != nullptr) {
+      offsets->push_back(0);
+    }
   }
   if (!reverse) {
-    std::reverse(result.codes.begin(), result.codes.end());
-    std::reverse(result.offsets.begin(), result.offsets.end());
+    std::reverse(codes->begin() + codes_begin, codes->end());
+    if (offsets != nullptr) {
+      std::reverse(offsets->begin() + offsets_begin, offsets->end());
+    }
+  }
+}
+
+void Encoder::EncodeBpe(const EncoderConfig& config, float dropout,
+                        bool add_bos, bool add_eos, bool reverse,
+                        std::vector<int>* codes, std::vector<int>* offsets) {
+  const std::string& str = normalized_string_;
+  const int length = str.length();
+  const DoubleArrayTrie piece_matcher(config.pieces()->nodes());
+
+  // Splits the string into characters and user defined pieces.
+  std::vector<BpeSymbol>& symbols = bpe_symbols_;
+  symbols.clear();
+  for (int i = 0; i < length;) {
+    const utils::string_view rest(str.data() + i, length - i);
+    DoubleArrayTrie::Match user_defined_match;
+    if (config.user_defined_pieces() != nullptr) {
+      user_defined_match =
+          DoubleArrayTrie(config.user_defined_pieces()->nodes())
+              .LongestPrefixMatch(rest);
+    }
+    BpeSymbol symbol;
+    symbol.start = i;
+    symbol.prev = static_cast<int>(symbols.size()) - 1;
+    symbol.next = symbols.size() + 1;
+    symbol.frozen = !user_defined_match.empty();
+    if (symbol.frozen) {
+      symbol.end = i + user_defined_match.match_length;
+      symbol.id = user_defined_match.id;
+    } else {
+      symbol.end = i + std::min(OneCharLen(str[i]), length - i);
+      symbol.id = PieceId(
+          piece_matcher, utils::string_view(str.data() + i, symbol.end - i));
+    }
+    symbols.push_back(symbol);
+    i = symbol.end;
+  }
+  if (!symbols.empty()) {
+    symbols.back().next = -1;
+  }
+
+  // Merges the pairs of symbols by rank, until no pair is a piece.
+  bpe_agenda_.clear();
+  for (int i = 1; i < symbols.size(); ++i) {
+    MaybeAddBpePair(config, i - 1, i);
+  }
+  std::uniform_real_distribution<float> distribution(0, 1);
+  while (!bpe_agenda_.empty()) {
+    std::pop_heap(bpe_agenda_.begin(), bpe_agenda_.end());
+    const BpePair pair = bpe_agenda_.back();
+    bpe_agenda_.pop_back();
+    BpeSymbol& left = symbols[pair.left];
+    BpeSymbol& right = symbols[pair.right];
+    if (left.start == left.end || right.start == right.end ||
+        right.end - left.start != pair.length) {
+      // One of the symbols was merged since.
+      continue;
+    }
+    if (dropout > 0 && distribution(random_generator_) < dropout) {
+      continue;
+    }
+    left.end = right.end;
+    left.id = pair.id;
+    left.next = right.next;
+    if (right.next >= 0) {
+      symbols[right.next].prev = pair.left;
+    }
+    right.start = right.end;
+    MaybeAddBpePair(config, left.prev, pair.left);
+    MaybeAddBpePair(config, pair.left, left.next);
+  }
+
+  const int codes_begin = codes->size();
+  const int offsets_begin = offsets != nullptr ? offsets->size() : 0;
+  if (add_bos) {
+    codes->push_back(config.start_code());
+    if (offsets != nullptr) {
+      offsets->push_back(0);
+    }
+  }
+  const int unknown_code = config.unknown_code();
+  bool previous_is_unknown = false;
+  for (int i = symbols.empty() ? -1 : 0; i >= 0; i = symbols[i].next) {
+    const BpeSymbol& symbol = symbols[i];
+    if (symbol.id < 0) {
+      // Consecutive unknown symbols are merged into the first one.
+      if (unknown_code >= 0 && !previous_is_unknown) {
+        codes->push_back(unknown_code);
+        if (offsets != nullptr) {
+          offsets->push_back(normalized_offsets_[symbol.start]);
+        }
+      }
+      previous_is_unknown = true;
+      continue;
+    }
+    previous_is_unknown = false;
+    codes->push_back(symbol.id + config.encoding_offset());
+    if (offsets != nullptr) {
+      offsets->push_back(normalized_offsets_[symbol.start]);
+    }
+  }
+  if (add_eos) {
+    codes->push_back(config.end_code());
+    if (offsets != nullptr) {
+      offsets->push_back(length);
+    }
+  }
+  if (reverse) {
+    std::reverse(codes->begin() + codes_begin, codes->end());
+    if (offsets != nullptr) {
+      std::reverse(offsets->begin() + offsets_begin, offsets->end());
+    }
+  }
+}
+
+void Encoder::MaybeAddBpePair(const EncoderConfig& config, int left,
+                              int right) {
+  if (left < 0 || right < 0) {
+    return;
+  }
+  const BpeSymbol& left_symbol = bpe_symbols_[left];
+  const BpeSymbol& right_symbol = bpe_symbols_[right];
+  if (left_symbol.frozen || right_symbol.frozen) {
+    return;
+  }
+  const DoubleArrayTrie piece_matcher(config.pieces()->nodes());
+  const int id =
+      PieceId(piece_matcher,
+              utils::string_view(normalized_string_.data() + left_symbol.start,
+                                 right_symbol.end - left_symbol.start));
+  if (id < 0) {
+    return;
+  }
+  bpe_agenda_.push_back({left, right, id, (*config.merge_ranks())[id],
+                         right_symbol.end - left_symbol.start});
+  std::push_heap(bpe_agenda_.begin(), bpe_agenda_.end());
+}
+
+EncoderResultType Encoder::SampleEncode(const void* config_buffer,
+                                        utils::string_view string,
+                                        int nbest_size, float alpha,
+                                        bool add_bos, bool add_eos,
+                                        bool reverse, std::vector<int>* codes,
+                                        std::vector<int>* offsets) {
+  if (nbest_size == 0 || nbest_size == 1) {
+    return Encode(config_buffer, string, add_bos, add_eos, reverse, codes,
+                  offsets);
+  }
+  const EncoderConfig* config;
+  if (!Normalize(config_buffer, string, &config)) {
+    return EncoderResultType::WRONG_CONFIG;
+  }
+  if (config->model_type() == EncoderModelType::EncoderModelType_BPE) {
+    // Like SentencePiece, BPE samples with BPE-dropout, where `alpha` is the
+    // probability to skip a merge.
+    EncodeBpe(*config, /*dropout=*/alpha, add_bos, add_eos, reverse, codes,
+              offsets);
+    return EncoderResultType::SUCCESS;
+  }
+  BuildLattice(*config);
+  if (nbest_size < 0) {
+    SamplePath(alpha);
+    AppendPath(*config, 0, path_.size(), add_bos, add_eos, reverse, codes,
+               offsets);
+    return EncoderResultType::SUCCESS;
+  }
+  NBestPaths(nbest_size);
+  if (path_scores_.empty()) {
+    // The end of the string is unreachable.
+    AppendPath(*config, 0, 0, add_bos, add_eos, reverse, codes, offsets);
+    return EncoderResultType::SUCCESS;
+  }
+  // Sample one of the n-best paths, with probabilities proportional to
+  // exp(alpha * score).
+  float log_sum = kNegativeInfinity;
+  for (const float score : path_scores_) {
+    log_sum = LogSumExp(log_sum, alpha * score);
+  }
+  const float r =
+      std::uniform_real_distribution<float>(0, 1)(random_generator_);
+  float cumulative = 0;
+  int path_begin = 0;
+  int path_end = 0;
+  for (int k = 0; k < path_scores_.size(); ++k) {
+    path_end = std::find(path_.begin() + path_begin, path_.end(), -1) -
+               path_.begin();
+    cumulative += std::exp(alpha * path_scores_[k] - log_sum);
+    if (r < cumulative || k + 1 == path_scores_.size()) {
+      break;
+    }
+    path_begin = path_end + 1;
+  }
+  AppendPath(*config, path_begin, path_end, add_bos, add_eos, reverse, codes,
+             offsets);
+  return EncoderResultType::SUCCESS;
+}
+
+EncoderResultType Encoder::NBestEncode(const void* config_buffer,
+                                       utils::string_view string,
+                                       int nbest_size, bool add_bos,
+                                       bool add_eos, bool reverse,
+                                       std::vector<EncoderResult>* results) {
+  results->clear();
+  const EncoderConfig* config;
+  if (!Normalize(config_buffer, string, &config)) {
+    return EncoderResultType::WRONG_CONFIG;
+  }
+  if (config->model_type() == EncoderModelType::EncoderModelType_BPE) {
+    // BPE is deterministic: there is only one segmentation.
+    results->emplace_back();
+    EncodeBpe(*config, /*dropout=*/0, add_bos, add_eos, reverse,
+              &results->back().codes, &results->back().offsets);
+    return EncoderResultType::SUCCESS;
+  }
+  BuildLattice(*config);
+  NBestPaths(std::max(nbest_size, 1));
+  int path_begin = 0;
+  for (int k = 0; k < path_scores_.size(); ++k) {
+    const int path_end = std::find(path_.begin() + path_begin, path_.end(),
+                                   -1) -
+                         path_.begin();
+    results->emplace_back();
+    AppendPath(*config, path_begin, path_end, add_bos, add_eos, reverse,
+               &results->back().codes, &results->back().offsets);
+    path_begin = path_end + 1;
+  }
+  return EncoderResultType::SUCCESS;
+}
+
+void Encoder::BuildLattice(const EncoderConfig& config) {
+  const std::string& str = normalized_string_;
+  const int length = str.length();
+  const DoubleArrayTrie piece_matcher(config.pieces()->nodes());
+  const flatbuffers::Vector<float>* piece_scores = config.pieces_scores();
+  const int unknown_code = config.unknown_code();
+  const float unknown_penalty = config.unknown_penalty();
+
+  // The edges are added by start, so that the edges that end at a position
+  // come before the edges that start there.
+  piece_matcher.FindAllPrefixMatches(utils::string_view(str), &piece_matches_,
+                                     &piece_match_begins_);
+  edges_.clear();
+  for (int i = 0; i < length; ++i) {
+    if (unknown_code >= 0) {
+      edges_.push_back({i, i + 1, unknown_code, unknown_penalty});
+    }
+    for (int m = piece_match_begins_[i]; m < piece_match_begins_[i + 1]; ++m) {
+      const DoubleArrayTrie::Match& match = piece_matches_[m];
+      edges_.push_back({i, i + match.match_length, match.id,
+                        (*piece_scores)[match.id]});
+    }
+  }
+
+  // Index the edges by end, with a counting sort.
+  edges_by_end_begin_.assign(length + 2, 0);
+  for (const LatticeEdge& edge : edges_) {
+    ++edges_by_end_begin_[edge.end + 1];
+  }
+  for (int i = 1; i < edges_by_end_begin_.size(); ++i) {
+    edges_by_end_begin_[i] += edges_by_end_begin_[i - 1];
+  }
+  edges_by_end_.resize(edges_.size());
+  for (int e = 0; e < edges_.size(); ++e) {
+    edges_by_end_[edges_by_end_begin_[edges_[e].end]++] = e;
+  }
+  // Each begin was moved to the next one; shift them back.
+  for (int i = edges_by_end_begin_.size() - 1; i > 0; --i) {
+    edges_by_end_begin_[i] = edges_by_end_begin_[i - 1];
+  }
+  edges_by_end_begin_[0] = 0;
+}
+
+void Encoder::NBestPaths(int nbest_size) {
+  const int length = normalized_string_.length();
+  path_.clear();
+  path_scores_.clear();
+
+  // The best score of the paths from the start to each position, which is the
+  // (exact) heuristic of the A* search from the end.
+  node_scores_.assign(length + 1, kNegativeInfinity);
+  node_scores_[0] = 0;
+  for (const LatticeEdge& edge : edges_) {
+    if (node_scores_[edge.start] != kNegativeInfinity) {
+      node_scores_[edge.end] = std::max(node_scores_[edge.end],
+                                        node_scores_[edge.start] + edge.score);
+    }
+  }
+  if (node_scores_[length] == kNegativeInfinity) {
+    // The end of the string is unreachable.
+    return;
+  }
+
+  hypotheses_.clear();
+  agenda_.clear();
+  const auto lower_priority = [this](int a, int b) {
+    return hypotheses_[a].priority < hypotheses_[b].priority;
+  };
+  hypotheses_.push_back({length, -1, -1, 0, node_scores_[length]});
+  agenda_.push_back(0);
+  while (!agenda_.empty() && path_scores_.size() < nbest_size) {
+    std::pop_heap(agenda_.begin(), agenda_.end(), lower_priority);
+    const int top = agenda_.back();
+    agenda_.pop_back();
+    const Hypothesis hypothesis = hypotheses_[top];
+    if (hypothesis.position == 0) {
+      // A complete path. Its edges are stored from the end to the start, as
+      // SamplePath does.
+      const int path_begin = path_.size();
+      for (int h = top; hypotheses_[h].edge >= 0; h = hypotheses_[h].next) {
+        path_.push_back(hypotheses_[h].edge);
+      }
+      std::reverse(path_.begin() + path_begin, path_.end());
+      path_.push_back(-1);
+      path_scores_.push_back(hypothesis.suffix_score);
+      continue;
+    }
+    for (int k = edges_by_end_begin_[hypothesis.position];
+         k < edges_by_end_begin_[hypothesis.position + 1]; ++k) {
+      const int e = edges_by_end_[k];
+      const LatticeEdge& edge = edges_[e];
+      if (node_scores_[edge.start] == kNegativeInfinity) {
+        continue;
+      }
+      const float suffix_score = hypothesis.suffix_score + edge.score;
+      hypotheses_.push_back({edge.start, e, top, suffix_score,
+                             suffix_score + node_scores_[edge.start]});
+      agenda_.push_back(hypotheses_.size() - 1);
+      std::push_heap(agenda_.begin(), agenda_.end(), lower_priority);
+    }
+  }
+}
+
+void Encoder::SamplePath(float alpha) {
+  const int length = normalized_string_.length();
+  path_.clear();
+
+  // Forward filtering: the log-sum-exp of the scores of the paths from the
+  // start to each position.
+  node_scores_.assign(length + 1, kNegativeInfinity);
+  node_scores_[0] = 0;
+  for (const LatticeEdge& edge : edges_) {
+    if (node_scores_[edge.start] != kNegativeInfinity) {
+      node_scores_[edge.end] =
+          LogSumExp(node_scores_[edge.end],
+                    node_scores_[edge.start] + alpha * edge.score);
+    }
+  }
+  if (node_scores_[length] == kNegativeInfinity) {
+    // The end of the string is unreachable.
+    return;
+  }
+
+  // Backward sampling: from the end, sample the edge to each position with
+  // the probability of its paths.
+  std::uniform_real_distribution<float> distribution(0, 1);
+  for (int pos = length; pos > 0;) {
+    const float r = distribution(random_generator_);
+    float cumulative = 0;
+    int sampled_edge = -1;
+    for (int k = edges_by_end_begin_[pos]; k < edges_by_end_begin_[pos + 1];
+         ++k) {
+      const int e = edges_by_end_[k];
+      const LatticeEdge& edge = edges_[e];
+      if (node_scores_[edge.start] == kNegativeInfinity) {
+        continue;
+      }
+      sampled_edge = e;
+      cumulative += std::exp(node_scores_[edge.start] + alpha * edge.score -
+                             node_scores_[pos]);
+      if (r < cumulative) {
+        break;
+      }
+    }
+    path_.push_back(sampled_edge);
+    pos = edges_[sampled_edge].start;
+  }
+}
+
+void Encoder::AppendPath(const EncoderConfig& config, int path_begin,
+                         int path_end, bool add_bos, bool add_eos,
+                         bool reverse, std::vector<int>* codes,
+                         std::vector<int>* offsets) const {
+  const int length = normalized_string_.length();
+  const int unknown_code = config.unknown_code();
+  // The results are appended in reverse order, then reversed if needed.
+  const int codes_begin = codes->size();
+  const int offsets_begin = offsets != nullptr ? offsets->size() : 0;
+  if (add_eos) {
+    codes->push_back(config.end_code());
+    if (offsets != nullptr) {
+      offsets->push_back(length);
+    }
+  }
+  for (int k = path_begin; k < path_end; ++k) {
+    const LatticeEdge& edge = edges_[path_[k]];
+    if (edge.code == unknown_code && k + 1 < path_end &&
+        edges_[path_[k + 1]].code == unknown_code) {
+      // Consecutive unknown codes are merged into the first one.
+      continue;
+    }
+    codes->push_back(edge.code == unknown_code
+                         ? edge.code
+                         : edge.code + config.encoding_offset());
+    if (offsets != nullptr) {
+      offsets->push_back(normalized_offsets_[edge.start]);
+    }
+  }
+  if (add_bos) {
+    codes->push_back(config.start_code());
+    if (offsets != nullptr) {
+      offsets->push_back(0);
+    }
+  }
+  if (!reverse) {
+    std::reverse(codes->begin() + codes_begin, codes->end());
+    if (offsets != nullptr) {
+      std::reverse(offsets->begin() + offsets_begin, offsets->end());
+    }
   }
-  return result;
 }
 
 EncoderResult EncodeString(const std::string& string, const void* config_buffer,
                            bool add_bos, bool add_eos, bool reverse) {
-  // Get the config from the buffer.
-  const EncoderConfig* config = GetEncoderConfig(config_buffer);
-  if (config->version() != EncoderVersion::EncoderVersion_SENTENCE_PIECE) {
-    EncoderResult result;
-    result.type = EncoderResultType::WRONG_CONFIG;
-    return result;
-  }
-  std::string normalized_string;
-  std::vector<int> offsets;
-  std::tie(normalized_string, offsets) = NormalizeString(string, *config);
-  return EncodeNormalizedString(normalized_string, offsets, *config, add_bos,
-                                add_eos, reverse);
+  EncoderResult result;
+  Encoder encoder;
+  result.type =
+      encoder.Encode(config_buffer, utils::string_view(string), add_bos,
+                     add_eos, reverse, &result.codes, &result.offsets);
+  return result;
 }
 
 }  // namespace sentencepiece
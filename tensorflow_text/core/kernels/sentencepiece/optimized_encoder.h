@@ -32,11 +32,15 @@ limitations under the License.
 
 // Sentencepiece encoder optimized with memmapped model.
 
+#include <cstdint>
+#include <random>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include "tensorflow_text/core/kernels/sentencepiece/double_array_trie.h"
 #include "tensorflow_text/core/kernels/sentencepiece/encoder_config_generated.h"
+#include "tensorflow_text/core/kernels/sentencepiece/utils.h"
 
 namespace tensorflow {
 namespace text {
@@ -49,9 +53,193 @@ struct EncoderResult {
   std::vector<int> codes;
   std::vector<int> offsets;
 };
+
+// Normalizes `in_string` as configured by `config`, in a single pass over it:
+// the prefix replacement, the removal of extra whitespaces and the escaping of
+// whitespaces are fused. Sets `out_string` to the normalized string and
+// `out_offsets` to the offset in `in_string` of each of its bytes. The outputs
+// are overwritten, so that they can be reused across calls without allocating.
+void NormalizeString(utils::string_view in_string, const EncoderConfig& config,
+                     std::string* out_string, std::vector<int>* out_offsets);
+
+// Same as above, but returns the outputs.
 std::tuple<std::string, std::vector<int>> NormalizeString(
     const std::string& in_string, const EncoderConfig& config);
 
+// Encodes strings, reusing its workspace (the normalized string, its offsets
+// and the lattice) across calls, so that encoding does not allocate once the
+// workspace has grown to the size of the inputs. Not thread-safe: use one
+// encoder per thread.
+class Encoder {
+ public:
+  Encoder();
+
+  // Encodes `string` and appends its ids to `codes` and their offsets in
+  // `string` to `offsets` (if not null). Takes the configuration as a
+  // type-erased buffer.
+  EncoderResultType Encode(const void* config_buffer, utils::string_view string,
+                           bool add_bos, bool add_eos, bool reverse,
+                           std::vector<int>* codes,
+                           std::vector<int>* offsets = nullptr);
+
+  // Same as Encode(), but samples the segmentation for subword regularization,
+  // like SentencePieceProcessor::SampleEncode():
+  //  * nbest_size = {0, 1}: No sampling, same as Encode().
+  //  * nbest_size > 1: Samples from the `nbest_size` best segmentations.
+  //  * nbest_size < 0: Samples from all the segmentations, with the
+  //    forward-filtering and backward-sampling algorithm.
+  // `alpha` is the inverse temperature of the distribution of the
+  // segmentations, whose scores are the sums of `pieces_scores`.
+  // BPE models sample with BPE-dropout instead, where `alpha` is the
+  // probability to skip a merge.
+  EncoderResultType SampleEncode(const void* config_buffer,
+                                 utils::string_view string, int nbest_size,
+                                 float alpha, bool add_bos, bool add_eos,
+                                 bool reverse, std::vector<int>* codes,
+                                 std::vector<int>* offsets = nullptr);
+
+  // Encodes `string` into its `nbest_size` best segmentations, best first, and
+  // sets `results` to their ids and offsets. BPE models have only one
+  // segmentation.
+  EncoderResultType NBestEncode(const void* config_buffer,
+                                utils::string_view string, int nbest_size,
+                                bool add_bos, bool add_eos, bool reverse,
+                                std::vector<EncoderResult>* results);
+
+  // Seeds the random generator of SampleEncode(), e.g., for tests. Otherwise,
+  // it is seeded with std::random_device.
+  void SetRandomSeed(uint32_t seed) { random_generator_.seed(seed); }
+
+ private:
+  struct LatticeElement {
+    float score = 0;
+    int code = -1;
+    int prev_position = -1;
+    LatticeElement(float score_, int code_, int prev_position_)
+        : score(score_), code(code_), prev_position(prev_position_) {}
+    LatticeElement() {}
+  };
+
+  // Encodes `normalized_string_` with the Viterbi algorithm.
+  void EncodeNormalizedString(const EncoderConfig& config, bool add_bos,
+                              bool add_eos, bool reverse,
+                              std::vector<int>* codes,
+                              std::vector<int>* offsets);
+
+  // A symbol of the BPE segmentation: the piece `id` (or -1 if it is not in
+  // the vocabulary) at `[start, end)` in the normalized string, in a linked
+  // list of the symbols. A symbol merged into its previous one is empty.
+  struct BpeSymbol {
+    int start;
+    int end;
+    int id;
+    int prev;
+    int next;
+    // Whether it is a user defined piece, which is never merged.
+    bool frozen;
+  };
+
+  // A candidate merge of the symbols `left` and `right` into the piece `id`.
+  struct BpePair {
+    int left;
+    int right;
+    int id;
+    int rank;
+    // The length of the merged piece, to detect that a symbol changed since.
+    int length;
+    // Orders the max-heap of the candidate merges: the lowest rank comes
+    // first, then the leftmost merge.
+    bool operator<(const BpePair& p) const {
+      return rank != p.rank ? rank > p.rank : left > p.left;
+    }
+  };
+
+  // Encodes `normalized_string_` with BPE, skipping each merge with
+  // probability `dropout`.
+  void EncodeBpe(const EncoderConfig& config, float dropout, bool add_bos,
+                 bool add_eos, bool reverse, std::vector<int>* codes,
+                 std::vector<int>* offsets);
+
+  // Adds the merge of the symbols `left` and `right` to `bpe_agenda_`, if
+  // they are both valid and their concatenation is a piece.
+  void MaybeAddBpePair(const EncoderConfig& config, int left, int right);
+
+  // An edge of the lattice of all the segmentations of the normalized string:
+  // a piece or the unknown code from `start` to `end`.
+  struct LatticeEdge {
+    int start;
+    int end;
+    int code;
+    float score;
+  };
+
+  // A hypothesis of the A* search of NBestPaths(): a path from `position` to
+  // the end of the string, made of `edge` followed by the path of the
+  // hypothesis `next`.
+  struct Hypothesis {
+    int position;
+    int edge;
+    int next;
+    // The score of the path, and the score of the best complete path with it.
+    float suffix_score;
+    float priority;
+  };
+
+  // Sets `config` to the config in `config_buffer` and normalizes `string`.
+  // Returns false if the config is not a sentencepiece encoder config.
+  bool Normalize(const void* config_buffer, utils::string_view string,
+                 const EncoderConfig** config);
+
+  // Builds the lattice of all the segmentations of the normalized string.
+  void BuildLattice(const EncoderConfig& config);
+
+  // Sets `path_` to the `nbest_size` best paths of the lattice, best first,
+  // each followed by -1, and `path_scores_` to their scores.
+  void NBestPaths(int nbest_size);
+
+  // Sets `path_` to a path of the lattice sampled with forward-filtering and
+  // backward-sampling.
+  void SamplePath(float alpha);
+
+  // Appends the tokens of the path `path_[path_begin, path_end)` to the
+  // outputs, like EncodeNormalizedString() for the best path.
+  void AppendPath(const EncoderConfig& config, int path_begin, int path_end,
+                  bool add_bos, bool add_eos, bool reverse,
+                  std::vector<int>* codes, std::vector<int>* offsets) const;
+
+  std::string normalized_string_;
+  std::vector<int> normalized_offsets_;
+  std::vector<LatticeElement> lattice_;
+
+  // The workspace of SampleEncode() and NBestEncode().
+  //
+  // The edges of the lattice, by start, and the indices of the edges by end:
+  // the edges that end at `i` are in `edges_by_end_[edges_by_end_begin_[i],
+  // edges_by_end_begin_[i + 1])`.
+  std::vector<LatticeEdge> edges_;
+  std::vector<int> edges_by_end_;
+  std::vector<int> edges_by_end_begin_;
+  // The pieces that start at each position, see
+  // DoubleArrayTrie::FindAllPrefixMatches().
+  std::vector<DoubleArrayTrie::Match> piece_matches_;
+  std::vector<int> piece_match_begins_;
+  // For each position, the best or the log-sum-exp score of the paths from the
+  // start of the string.
+  std::vector<float> node_scores_;
+  // Paths of the lattice, as edge indices from the end to the start.
+  std::vector<int> path_;
+  std::vector<float> path_scores_;
+  // The hypotheses and the agenda of the A* search of NBestPaths().
+  std::vector<Hypothesis> hypotheses_;
+  std::vector<int> agenda_;
+  std::mt19937 random_generator_;
+
+  // The workspace of EncodeBpe(): the symbols and the heap of the candidate
+  // merges.
+  std::vector<BpeSymbol> bpe_symbols_;
+  std::vector<BpePair> bpe_agenda_;
+};
+
 // Encodes one string and returns ids and offsets. Takes the configuration as a
 // type-erased buffer.
 EncoderResult EncodeString(const std::string& string, const void* config_buffer,
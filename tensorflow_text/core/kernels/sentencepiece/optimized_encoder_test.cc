@@ -29,6 +29,7 @@ limitations under the License.
 
 #include "tensorflow_text/core/kernels/sentencepiece/optimized_encoder.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include "file/base/path.h"
@@ -158,6 +159,113 @@ TEST(OptimizedEncoder, NormalizeStringWhitespacesRemove) {
   }
 }
 
+TEST(OptimizedEncoder, NormalizeStringDummyPrefixReplacement) {
+  flatbuffers::FlatBufferBuilder builder(1024);
+  const std::vector<std::string> norm_prefixes = {" A"};
+  const char norm_replacements[] = "X";
+  const auto trie_vector =
+      builder.CreateVector(BuildTrie(norm_prefixes, {0}));
+  const auto norm_r = builder.CreateVector<int8_t>(
+      reinterpret_cast<const signed char*>(norm_replacements),
+      sizeof(norm_replacements));
+  TrieBuilder trie_builder(builder);
+  trie_builder.add_nodes(trie_vector);
+  const auto norm_p = trie_builder.Finish();
+  EncoderConfigBuilder ecb(builder);
+  ecb.add_add_dummy_prefix(true);
+  ecb.add_normalized_prefixes(norm_p);
+  ecb.add_normalized_replacements(norm_r);
+  FinishEncoderConfigBuffer(builder, ecb.Finish());
+  const EncoderConfig* config = GetEncoderConfig(builder.GetBufferPointer());
+  // The buffers are reused across calls.
+  std::string res_string;
+  std::vector<int> offsets;
+  NormalizeString(utils::string_view("AB", 2), *config, &res_string, &offsets);
+  EXPECT_EQ(res_string, "XB");
+  EXPECT_THAT(offsets, ::testing::ElementsAre(0, 1));
+  NormalizeString(utils::string_view("BA", 2), *config, &res_string, &offsets);
+  EXPECT_EQ(res_string, " BA");
+  EXPECT_THAT(offsets, ::testing::ElementsAre(0, 0, 1));
+  NormalizeString(utils::string_view("", 0), *config, &res_string, &offsets);
+  EXPECT_TRUE(res_string.empty());
+  EXPECT_TRUE(offsets.empty());
+}
+
+TEST(OptimizedEncoder, EncodeBpe) {
+  flatbuffers::FlatBufferBuilder builder(1024);
+  const std::vector<std::string> pieces = {"a",  "b",   "c",  "ab",
+                                           "bc", "abc", "<u>"};
+  const auto pieces_trie_vector = builder.CreateVector(BuildTrie(pieces));
+  TrieBuilder pieces_trie_builder(builder);
+  pieces_trie_builder.add_nodes(pieces_trie_vector);
+  const auto pieces_trie = pieces_trie_builder.Finish();
+  const auto user_defined_trie_vector =
+      builder.CreateVector(BuildTrie({"<u>"}, {6}));
+  TrieBuilder user_defined_trie_builder(builder);
+  user_defined_trie_builder.add_nodes(user_defined_trie_vector);
+  const auto user_defined_trie = user_defined_trie_builder.Finish();
+  // "bc" is merged first, then "ab", then "abc".
+  const auto merge_ranks =
+      builder.CreateVector(std::vector<int32_t>({3, 3, 3, 1, 0, 2, 0}));
+  EncoderConfigBuilder ecb(builder);
+  ecb.add_start_code(8);
+  ecb.add_end_code(9);
+  ecb.add_unknown_code(7);
+  ecb.add_pieces(pieces_trie);
+  ecb.add_model_type(EncoderModelType::EncoderModelType_BPE);
+  ecb.add_merge_ranks(merge_ranks);
+  ecb.add_user_defined_pieces(user_defined_trie);
+  FinishEncoderConfigBuffer(builder, ecb.Finish());
+  const void* config = builder.GetBufferPointer();
+
+  {
+    const auto result = EncodeString("abc", config, /*add_bos=*/false,
+                                     /*add_eos=*/false, /*reverse=*/false);
+    EXPECT_THAT(result.codes, ::testing::ElementsAre(5));
+    EXPECT_THAT(result.offsets, ::testing::ElementsAre(0));
+  }
+  {
+    // The merge of "ab" at 0 is invalidated by the merge of "bc".
+    const auto result = EncodeString("abcab", config, /*add_bos=*/false,
+                                     /*add_eos=*/false, /*reverse=*/false);
+    EXPECT_THAT(result.codes, ::testing::ElementsAre(5, 3));
+    EXPECT_THAT(result.offsets, ::testing::ElementsAre(0, 3));
+  }
+  {
+    // User defined pieces are never merged, and consecutive unknown symbols
+    // are merged.
+    const auto result = EncodeString("xya<u>bc", config, /*add_bos=*/false,
+                                     /*add_eos=*/false, /*reverse=*/false);
+    EXPECT_THAT(result.codes, ::testing::ElementsAre(7, 0, 6, 4));
+    EXPECT_THAT(result.offsets, ::testing::ElementsAre(0, 2, 3, 6));
+  }
+  {
+    const auto result = EncodeString("abc", config, /*add_bos=*/true,
+                                     /*add_eos=*/true, /*reverse=*/true);
+    EXPECT_THAT(result.codes, ::testing::ElementsAre(9, 5, 8));
+    EXPECT_THAT(result.offsets, ::testing::ElementsAre(3, 0, 0));
+  }
+
+  Encoder encoder;
+  std::vector<EncoderResult> results;
+  ASSERT_EQ(encoder.NBestEncode(config, utils::string_view("abcab"),
+                                /*nbest_size=*/10, /*add_bos=*/false,
+                                /*add_eos=*/false, /*reverse=*/false,
+                                &results),
+            EncoderResultType::SUCCESS);
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_THAT(results[0].codes, ::testing::ElementsAre(5, 3));
+
+  // With a dropout probability of 1, no merge is applied.
+  std::vector<int> codes;
+  ASSERT_EQ(encoder.SampleEncode(config, utils::string_view("abc"),
+                                 /*nbest_size=*/-1, /*alpha=*/1.0,
+                                 /*add_bos=*/false, /*add_eos=*/false,
+                                 /*reverse=*/false, &codes),
+            EncoderResultType::SUCCESS);
+  EXPECT_THAT(codes, ::testing::ElementsAre(0, 1, 2));
+}
+
 TEST(OptimizedEncoder, ConfigConverter) {
   std::string config;
   auto status = internal::TFReadFileToString(
@@ -181,6 +289,143 @@ TEST(OptimizedEncoder, ConfigConverter) {
   }
 }
 
+TEST(OptimizedEncoder, EncoderReusesWorkspace) {
+  std::string config;
+  auto status = internal::TFReadFileToString(
+      file::JoinPath(::testing::SrcDir(), kConfigFilePath), &config);
+  ASSERT_TRUE(status.ok());
+  const auto converted_model = ConvertSentencepieceModel(config);
+
+  Encoder encoder;
+  std::vector<int> codes;
+  std::vector<int> offsets;
+  for (const std::string test_string :
+       {"Hello world!", "a", "", "Hello world! Hello world!", "Hello"}) {
+    const auto expected = EncodeString(test_string, converted_model.data(),
+                                       /*add_bos=*/true, /*add_eos=*/true,
+                                       /*reverse=*/false);
+    codes.clear();
+    offsets.clear();
+    ASSERT_EQ(encoder.Encode(converted_model.data(),
+                             utils::string_view(test_string),
+                             /*add_bos=*/true, /*add_eos=*/true,
+                             /*reverse=*/false, &codes, &offsets),
+              EncoderResultType::SUCCESS);
+    EXPECT_EQ(codes, expected.codes);
+    EXPECT_EQ(offsets, expected.offsets);
+  }
+
+  // The results are appended to the outputs.
+  codes.assign({-1});
+  ASSERT_EQ(encoder.Encode(converted_model.data(), utils::string_view("a", 1),
+                           /*add_bos=*/false, /*add_eos=*/true,
+                           /*reverse=*/true, &codes),
+            EncoderResultType::SUCCESS);
+  ASSERT_GE(codes.size(), 2);
+  EXPECT_EQ(codes[0], -1);
+  EXPECT_EQ(codes[1], GetEncoderConfig(converted_model.data())->end_code());
+}
+
+TEST(OptimizedEncoder, NBestEncode) {
+  std::string config;
+  auto status = internal::TFReadFileToString(
+      file::JoinPath(::testing::SrcDir(), kConfigFilePath), &config);
+  ASSERT_TRUE(status.ok());
+  const auto converted_model = ConvertSentencepieceModel(config);
+
+  Encoder encoder;
+  std::vector<EncoderResult> results;
+  for (const std::string test_string : {"Hello world!", "a", ""}) {
+    const auto expected = EncodeString(test_string, converted_model.data(),
+                                       /*add_bos=*/true, /*add_eos=*/true,
+                                       /*reverse=*/false);
+    ASSERT_EQ(encoder.NBestEncode(converted_model.data(),
+                                  utils::string_view(test_string),
+                                  /*nbest_size=*/10, /*add_bos=*/true,
+                                  /*add_eos=*/true, /*reverse=*/false,
+                                  &results),
+              EncoderResultType::SUCCESS);
+    ASSERT_FALSE(results.empty());
+    EXPECT_LE(results.size(), 10);
+    // The best segmentation is the one of Encode().
+    EXPECT_EQ(results[0].codes, expected.codes);
+    EXPECT_EQ(results[0].offsets, expected.offsets);
+    for (int i = 0; i < results.size(); ++i) {
+      for (int j = 0; j < i; ++j) {
+        EXPECT_NE(results[i].codes, results[j].codes);
+      }
+    }
+  }
+  ASSERT_EQ(encoder.NBestEncode(converted_model.data(),
+                                utils::string_view("Hello world!"),
+                                /*nbest_size=*/10, /*add_bos=*/false,
+                                /*add_eos=*/false, /*reverse=*/false,
+                                &results),
+            EncoderResultType::SUCCESS);
+  EXPECT_GT(results.size(), 1);
+}
+
+TEST(OptimizedEncoder, SampleEncode) {
+  std::string config;
+  auto status = internal::TFReadFileToString(
+      file::JoinPath(::testing::SrcDir(), kConfigFilePath), &config);
+  ASSERT_TRUE(status.ok());
+  const auto converted_model = ConvertSentencepieceModel(config);
+  const std::string test_string = "Hello world! Hello world!";
+
+  Encoder encoder;
+  encoder.SetRandomSeed(42);
+  std::vector<EncoderResult> nbest;
+  ASSERT_EQ(encoder.NBestEncode(converted_model.data(),
+                                utils::string_view(test_string),
+                                /*nbest_size=*/5, /*add_bos=*/false,
+                                /*add_eos=*/false, /*reverse=*/false, &nbest),
+            EncoderResultType::SUCCESS);
+  std::vector<int> codes;
+  std::vector<int> offsets;
+  for (int i = 0; i < 20; ++i) {
+    // Without sampling, the result is the one of Encode().
+    codes.clear();
+    offsets.clear();
+    ASSERT_EQ(encoder.SampleEncode(converted_model.data(),
+                                   utils::string_view(test_string),
+                                   /*nbest_size=*/1, /*alpha=*/0.1,
+                                   /*add_bos=*/false, /*add_eos=*/false,
+                                   /*reverse=*/false, &codes, &offsets),
+              EncoderResultType::SUCCESS);
+    EXPECT_EQ(codes, nbest[0].codes);
+
+    // A sample of the n-best segmentations is one of them.
+    codes.clear();
+    offsets.clear();
+    ASSERT_EQ(encoder.SampleEncode(converted_model.data(),
+                                   utils::string_view(test_string),
+                                   /*nbest_size=*/5, /*alpha=*/0.1,
+                                   /*add_bos=*/false, /*add_eos=*/false,
+                                   /*reverse=*/false, &codes, &offsets),
+              EncoderResultType::SUCCESS);
+    EXPECT_TRUE(std::any_of(nbest.begin(), nbest.end(),
+                            [&codes, &offsets](const EncoderResult& r) {
+                              return r.codes == codes && r.offsets == offsets;
+                            }));
+
+    // A sample of all the segmentations starts at the start of the string and
+    // goes forward.
+    codes.clear();
+    offsets.clear();
+    ASSERT_EQ(encoder.SampleEncode(converted_model.data(),
+                                   utils::string_view(test_string),
+                                   /*nbest_size=*/-1, /*alpha=*/0.1,
+                                   /*add_bos=*/false, /*add_eos=*/false,
+                                   /*reverse=*/false, &codes, &offsets),
+              EncoderResultType::SUCCESS);
+    ASSERT_FALSE(offsets.empty());
+    EXPECT_EQ(offsets[0], 0);
+    EXPECT_TRUE(std::is_sorted(offsets.begin(), offsets.end()));
+    EXPECT_EQ(codes.size(), offsets.size());
+  }
+}
+
 }  // namespace
 }  // namespace sentencepiece
 }  // namespace text
@@ -27,6 +27,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/shape_inference.h"
@@ -50,29 +55,30 @@ class TFSentencepieceDetokenizerOp : public tensorflow::OpKernel {
         input_values_tensor.flat<tensorflow::int32>();
     const auto& input_splits_tensor = ctx->input(kInputSplits);
     const auto input_splits_flat = input_splits_tensor.flat<Tsplits>();
-    const int num_of_sentences = input_splits_flat.size() - 1;
+    const int64_t num_of_sentences = input_splits_flat.size() - 1;
     Tensor* output_tensor = nullptr;
     OP_REQUIRES_OK(ctx,
                    ctx->allocate_output(0, {num_of_sentences}, &output_tensor));
     auto output_flat = output_tensor->flat<tensorflow::tstring>();
-    std::vector<int> codes_for_split;
-    int input_offset = 0;
-    for (int i = 0; i < num_of_sentences; i++) {
-      // Create a vector of int32 from input according to spans.
-      const int split_size = input_splits_flat(i + 1) - input_splits_flat(i);
-      codes_for_split.clear();
-      codes_for_split.reserve(split_size);
-      for (int j = 0; j < split_size; ++j) {
-        codes_for_split.push_back(input_values_flat(input_offset++));
+    // Decode all the sentences into one buffer, reused across the calls on this
+    // thread, then copy each of them once into its output string.
+    thread_local std::string decoded;
+    thread_local std::vector<size_t> decoded_ends;
+    const auto res = sentencepiece::DecodeStrings(
+        model_tensor.data(), input_values_flat.data(), input_values_flat.size(),
+        input_splits_flat.data(), num_of_sentences, &decoded, &decoded_ends);
+    if (res == sentencepiece::DecoderResultType::SUCCESS) {
+      size_t begin = 0;
+      for (int64_t i = 0; i < num_of_sentences; i++) {
+        output_flat(i).assign(decoded.data() + begin, decoded_ends[i] - begin);
+        begin = decoded_ends[i];
       }
-      const auto res = sentencepiece::DecodeString(
-          codes_for_split, model_tensor.data());
-      OP_REQUIRES(ctx, res.type == sentencepiece::DecoderResultType::SUCCESS,
-                  absl::Status(static_cast<absl::StatusCode>(
-                                   absl::StatusCode::kInternal),
-                               "Sentencepiece conversion failed"));
-      output_flat(i) = res.decoded;
     }
+    sentencepiece::ReleaseLargeDecodeBuffers(&decoded, &decoded_ends);
+    OP_REQUIRES(ctx, res == sentencepiece::DecoderResultType::SUCCESS,
+                absl::Status(static_cast<absl::StatusCode>(
+                                 absl::StatusCode::kInternal),
+                             "Sentencepiece conversion failed"));
   }
 };
 }  // namespace text
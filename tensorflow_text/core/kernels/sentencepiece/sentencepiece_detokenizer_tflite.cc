@@ -28,8 +28,9 @@
 /**
  * Sentencepiece tflite detokenizer implementation.
  */
-#include <algorithm>
-#include <iterator>
+#include <cstddef>
+#include <string>
+#include <vector>
 
 #include "flatbuffers/flexbuffers.h"
 #include "tensorflow/lite/c/common.h"
@@ -49,12 +50,24 @@ namespace sentencepiece {
 namespace detokenizer {
 
 constexpr int kOutputValuesInd = 0;
-// Initializes text encoder object from serialized parameters.
+
+namespace {
+// The buffers of the decoded strings, reused across the invocations of the
+// node.
+struct DecoderWorkspace {
+  std::string decoded;
+  std::vector<size_t> decoded_ends;
+};
+}  // namespace
+
+// Initializes text decoder object from serialized parameters.
 void* Initialize(TfLiteContext* /*context*/, const char* /*buffer*/,
                  size_t /*length*/) {
-  return nullptr;
+  return new DecoderWorkspace();
+}
+void Free(TfLiteContext* /*context*/, void* buffer) {
+  delete reinterpret_cast<DecoderWorkspace*>(buffer);
 }
-void Free(TfLiteContext* /*context*/, void* /*buffer*/) {}
 
 TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   // TODO(mgubin): Add checks for input and output tensors.
@@ -73,31 +86,34 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   const TfLiteTensor& input_encoded =
       context->tensors[node->inputs->data[tensorflow::text::kInputIndex]];
   const int32_t* input_encoded_data = input_encoded.data.i32;
+  const int num_codes = NumElements(input_encoded.dims);
   const TfLiteTensor& input_splits =
       context->tensors[node->inputs->data[tensorflow::text::kInputSplits]];
   const int num_of_sentences = NumElements(input_splits.dims) - 1;
   const int32_t* input_splits_data = input_splits.data.i32;
 
-  DynamicBuffer buf;
+  auto* workspace = reinterpret_cast<DecoderWorkspace*>(node->user_data);
+  const auto res = tensorflow::text::sentencepiece::DecodeStrings(
+      model_buffer_data, input_encoded_data, num_codes, input_splits_data,
+      num_of_sentences, &workspace->decoded, &workspace->decoded_ends);
+  if (res != tensorflow::text::sentencepiece::DecoderResultType::SUCCESS) {
+    tensorflow::text::sentencepiece::ReleaseLargeDecodeBuffers(
+        &workspace->decoded, &workspace->decoded_ends);
+  }
+  TF_LITE_ENSURE_MSG(
+      context,
+      res == tensorflow::text::sentencepiece::DecoderResultType::SUCCESS,
+      "Sentencepiece decoding failed");
 
-  std::vector<int> codes_for_split;
-  int input_offset = 0;
+  DynamicBuffer buf;
+  size_t begin = 0;
   for (int i = 0; i < num_of_sentences; i++) {
-    // Create a vector of int32 from input according to spans.
-    const int split_size = input_splits_data[i + 1] - input_splits_data[i];
-    codes_for_split.clear();
-    std::copy(input_encoded_data + input_offset,
-              input_encoded_data + input_offset + split_size,
-              std::back_inserter(codes_for_split));
-    const auto res = tensorflow::text::sentencepiece::DecodeString(
-        codes_for_split, model_buffer_data);
-    TF_LITE_ENSURE_MSG(
-        context,
-        res.type == tensorflow::text::sentencepiece::DecoderResultType::SUCCESS,
-        "Sentencepiece decoding failed");
-    buf.AddString(res.decoded.data(), res.decoded.length());
-    input_offset += split_size;
+    buf.AddString(workspace->decoded.data() + begin,
+                  workspace->decoded_ends[i] - begin);
+    begin = workspace->decoded_ends[i];
   }
+  tensorflow::text::sentencepiece::ReleaseLargeDecodeBuffers(
+      &workspace->decoded, &workspace->decoded_ends);
   TfLiteTensor& output_values =
       context->tensors[node->outputs->data[kOutputValuesInd]];
   buf.WriteToTensor(&output_values, nullptr);
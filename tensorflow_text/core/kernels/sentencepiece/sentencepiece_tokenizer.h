@@ -36,6 +36,8 @@ namespace text {
 
 constexpr int kSPModelIndex = 0;
 constexpr int kInputIndex = 1;
+constexpr int kNBestSizeInput = 2;
+constexpr int kAlphaInput = 3;
 constexpr int kAddBOSInput = 4;
 constexpr int kAddEOSInput = 5;
 constexpr int kReverseInput = 6;
@@ -27,8 +27,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <cstdint>
-#include <iterator>
 #include <limits>
 #include <vector>
 
@@ -37,12 +37,43 @@ limitations under the License.
 #include "tensorflow/core/framework/shape_inference.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/util/work_sharder.h"
 #include "tensorflow_text/core/kernels/sentencepiece/optimized_encoder.h"
 #include "tensorflow_text/core/kernels/sentencepiece/sentencepiece_tokenizer.h"
+#include "tensorflow_text/core/kernels/text_batch_sharding.h"
 
 namespace tensorflow {
 namespace text{
 
+namespace {
+
+// Cost of encoding one row with Encode(), in the unit of ::tensorflow::Shard's
+// cost_per_unit (about 1ns), as measured with a 16k unigram model on English
+// text.
+constexpr TextRowCost kEncodeCost = {/*per_row=*/100, /*per_byte=*/50};
+
+// Returns the rough cost of encoding one row of `num_bytes` bytes.
+int64_t EncodeCost(int64_t num_bytes, int nbest_size) {
+  const int64_t cost = kEncodeCost(num_bytes);
+  if (nbest_size == 0 || nbest_size == 1) {
+    return cost;
+  }
+  // Sampling builds the lattice of all the segmentations, then runs either
+  // forward-filtering and backward-sampling, or an n-best search whose cost
+  // grows with nbest_size.
+  return nbest_size < 0 ? cost * 4 : cost * (6 + nbest_size) / 2;
+}
+
+// The ids of a block of consecutive rows, encoded by one shard, and the end of
+// the ids of each row.
+struct EncodedBlock {
+  std::vector<int32> codes;
+  std::vector<int32> row_ends;
+  bool ok = true;
+};
+
+}  // namespace
+
 class TFSentencepieceOp : public tensorflow::OpKernel {
  public:
   explicit TFSentencepieceOp(tensorflow::OpKernelConstruction* ctx)
@@ -54,6 +85,10 @@ class TFSentencepieceOp : public tensorflow::OpKernel {
         input_values_tensor.flat<tensorflow::tstring>();
     const int64_t num_of_input_values = input_values_flat.size();
 
+    const auto& nbest_size_tensor = ctx->input(kNBestSizeInput);
+    const int nbest_size = nbest_size_tensor.scalar<int32>()();
+    const auto& alpha_tensor = ctx->input(kAlphaInput);
+    const float alpha = alpha_tensor.scalar<float>()();
     const auto& add_bos_tensor = ctx->input(kAddBOSInput);
     const bool add_bos = add_bos_tensor.scalar<bool>()();
     const auto& add_eos_tensor = ctx->input(kAddEOSInput);
@@ -61,42 +96,87 @@ class TFSentencepieceOp : public tensorflow::OpKernel {
     const auto& reverse_tensor = ctx->input(kReverseInput);
     const bool reverse = reverse_tensor.scalar<bool>()();
 
-    std::vector<int32> encoded;
-    std::vector<int32> splits;
-    for (int i = 0; i < num_of_input_values; ++i) {
-      const auto res = sentencepiece::EncodeString(
-          input_values_flat(i), model_tensor.data(), add_bos, add_eos, reverse);
-      OP_REQUIRES(ctx, res.type == sentencepiece::EncoderResultType::SUCCESS,
+    // Encode blocks of rows in parallel, each into its own buffers.
+    const auto& worker_threads =
+        *(ctx->device()->tensorflow_cpu_worker_threads());
+    int64_t cost_per_block;
+    const std::vector<int64_t> block_starts = SplitIntoBlocks(
+        num_of_input_values, worker_threads.num_threads,
+        [&input_values_flat, nbest_size](int64_t i) {
+          return EncodeCost(input_values_flat(i).size(), nbest_size);
+        },
+        &cost_per_block);
+    const int64_t num_blocks = block_starts.size() - 1;
+    std::vector<EncodedBlock> blocks(num_blocks);
+    const void* model = model_tensor.data();
+    ::tensorflow::Shard(
+        worker_threads.num_threads,  // max parallelism
+        worker_threads.workers,      // thread pool
+        num_blocks,                  // total number of data to process.
+        cost_per_block,
+        [&](int64_t start, int64_t limit) {
+          // The workspace of the encoder is reused by all the calls on a
+          // thread.
+          thread_local sentencepiece::Encoder encoder;
+          for (int64_t b = start; b < limit; ++b) {
+            EncodedBlock& block = blocks[b];
+            block.row_ends.reserve(block_starts[b + 1] - block_starts[b]);
+            for (int64_t i = block_starts[b]; i < block_starts[b + 1]; ++i) {
+              const auto& input_value = input_values_flat(i);
+              if (encoder.SampleEncode(
+                      model,
+                      sentencepiece::utils::string_view(input_value.data(),
+                                                        input_value.size()),
+                      nbest_size, alpha, add_bos, add_eos, reverse,
+                      &block.codes) !=
+                  sentencepiece::EncoderResultType::SUCCESS) {
+                block.ok = false;
+                break;
+              }
+              block.row_ends.push_back(block.codes.size());
+            }
+          }
+        });
+
+    // The start of the ids of each block in the output.
+    std::vector<int64_t> block_code_starts(num_blocks);
+    int64_t num_codes = 0;
+    for (int64_t b = 0; b < num_blocks; ++b) {
+      OP_REQUIRES(ctx, blocks[b].ok,
                   absl::Status(static_cast<absl::StatusCode>(
                                    absl::StatusCode::kInternal),
                                "Sentencepiece conversion failed"));
-      std::copy(res.codes.begin(), res.codes.end(),
-                std::back_inserter(encoded));
-      splits.emplace_back(encoded.size());
+      block_code_starts[b] = num_codes;
+      num_codes += blocks[b].codes.size();
     }
     tensorflow::Tensor* output_values_tensor = nullptr;
     tensorflow::Tensor* output_splits_tensor = nullptr;
-    OP_REQUIRES(ctx, encoded.size() < std::numeric_limits<int32_t>::max(),
+    OP_REQUIRES(ctx, num_codes < std::numeric_limits<int32_t>::max(),
                 errors::InvalidArgument(
                     "Encoded input must contain less than 2^31 characters."));
     OP_REQUIRES(
-        ctx, splits.size() + 1 < std::numeric_limits<int32_t>::max(),
+        ctx, num_of_input_values + 1 < std::numeric_limits<int32_t>::max(),
         errors::InvalidArgument("Splits tensor is limited to 2^31-1 values."));
     OP_REQUIRES_OK(
-        ctx, ctx->allocate_output(0, {static_cast<int32_t>(encoded.size())},
+        ctx, ctx->allocate_output(0, {static_cast<int32_t>(num_codes)},
                                   &output_values_tensor));
     OP_REQUIRES_OK(
-        ctx, ctx->allocate_output(1, {static_cast<int32_t>(splits.size()) + 1},
-                                  &output_splits_tensor));
+        ctx, ctx->allocate_output(
+                 1, {static_cast<int32_t>(num_of_input_values) + 1},
+                 &output_splits_tensor));
 
-    auto values_tensor_flat = output_values_tensor->vec<int32>();
-    auto splits_tensor_flat = output_splits_tensor->vec<int32>();
-    for (int32_t i = 0; i < encoded.size(); ++i) {
-      values_tensor_flat(i) = encoded[i];
-    }
-    splits_tensor_flat(0) = 0;
-    for (int32_t i = 0; i < splits.size(); ++i) {
-      splits_tensor_flat(i + 1) = splits[i];
+    // Merge the blocks straight into the outputs.
+    int32* values = output_values_tensor->flat<int32>().data();
+    int32* splits = output_splits_tensor->flat<int32>().data();
+    splits[0] = 0;
+    for (int64_t b = 0; b < num_blocks; ++b) {
+      const EncodedBlock& block = blocks[b];
+      std::copy(block.codes.begin(), block.codes.end(),
+                values + block_code_starts[b]);
+      int32* block_splits = splits + block_starts[b] + 1;
+      for (int64_t j = 0; j < block.row_ends.size(); ++j) {
+        block_splits[j] = block_code_starts[b] + block.row_ends[j];
+      }
     }
   }
 };
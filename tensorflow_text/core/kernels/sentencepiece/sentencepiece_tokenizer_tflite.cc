@@ -61,12 +61,15 @@ TfLiteIntArray* CreateSizeArray(const std::initializer_list<int>& sizes) {
 }
 }  // namespace
 
-// Initializes text encoder object from serialized parameters.
+// Initializes text encoder object from serialized parameters. The encoder
+// reuses its workspace across the invocations of the node.
 void* Initialize(TfLiteContext* /*context*/, const char* /*buffer*/,
                  size_t /*length*/) {
-  return nullptr;
+  return new tensorflow::text::sentencepiece::Encoder();
+}
+void Free(TfLiteContext* /*context*/, void* buffer) {
+  delete reinterpret_cast<tensorflow::text::sentencepiece::Encoder*>(buffer);
 }
-void Free(TfLiteContext* /*context*/, void* /*buffer*/) {}
 
 TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   // TODO(mgubin): Add checks for input and output tensors.
@@ -87,29 +90,38 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   const TfLiteTensor& input_text =
       context->tensors[node->inputs->data[tensorflow::text::kInputIndex]];
 
-  const TfLiteTensor add_bos_tensor =
+  const TfLiteTensor& nbest_size_tensor =
+      context->tensors[node->inputs->data[tensorflow::text::kNBestSizeInput]];
+  const int nbest_size = nbest_size_tensor.data.i32[0];
+  const TfLiteTensor& alpha_tensor =
+      context->tensors[node->inputs->data[tensorflow::text::kAlphaInput]];
+  const float alpha = alpha_tensor.data.f[0];
+  const TfLiteTensor& add_bos_tensor =
       context->tensors[node->inputs->data[tensorflow::text::kAddBOSInput]];
   const bool add_bos = add_bos_tensor.data.b[0];
-  const TfLiteTensor add_eos_tensor =
+  const TfLiteTensor& add_eos_tensor =
       context->tensors[node->inputs->data[tensorflow::text::kAddEOSInput]];
   const bool add_eos = add_eos_tensor.data.b[0];
-  const TfLiteTensor reverse_tensor =
+  const TfLiteTensor& reverse_tensor =
       context->tensors[node->inputs->data[tensorflow::text::kReverseInput]];
   const bool reverse = reverse_tensor.data.b[0];
 
+  auto* encoder = reinterpret_cast<tensorflow::text::sentencepiece::Encoder*>(
+      node->user_data);
   std::vector<int32> encoded;
   std::vector<int32> splits;
   const int num_strings = tflite::GetStringCount(&input_text);
   for (int i = 0; i < num_strings; ++i) {
     const auto strref = tflite::GetString(&input_text, i);
-    const auto res = tensorflow::text::sentencepiece::EncodeString(
-        std::string(strref.str, strref.len), model_buffer_data, add_bos,
-        add_eos, reverse);
+    const auto res_type = encoder->SampleEncode(
+        model_buffer_data,
+        tensorflow::text::sentencepiece::utils::string_view(strref.str,
+                                                            strref.len),
+        nbest_size, alpha, add_bos, add_eos, reverse, &encoded);
     TF_LITE_ENSURE_MSG(
         context,
-        res.type == tensorflow::text::sentencepiece::EncoderResultType::SUCCESS,
+        res_type == tensorflow::text::sentencepiece::EncoderResultType::SUCCESS,
         "Sentencepiece conversion failed");
-    std::copy(res.codes.begin(), res.codes.end(), std::back_inserter(encoded));
     splits.emplace_back(encoded.size());
   }
 
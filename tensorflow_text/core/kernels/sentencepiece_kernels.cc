@@ -12,6 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "absl/base/attributes.h"
 #include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
@@ -44,32 +51,114 @@
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/work_sharder.h"
+#include "tensorflow_text/core/kernels/text_batch_sharding.h"
 
 namespace tensorflow {
 namespace text {
 
 namespace {
 
-// Our resource object that will hold the SentencePiece processor.
-struct SentencepieceResource : public ResourceBase {
-  sentencepiece::SentencePieceProcessor processor;
-  int64 memory_used;
-  bool add_bos = false;
-  bool add_eos = false;
-  bool reverse = false;
-  mutable absl::Mutex mu;
+::tensorflow::Status ToTFStatus(const sentencepiece::util::Status& s) {
+  if (s.ok()) return ::tensorflow::Status();
+  return ::tensorflow::Status(static_cast<::absl::StatusCode>(s.code()),
+                              ::tensorflow::string(s.message()));
+}
 
-  string DebugString() const override { return "Sentencepiece Resource"; }
+// Our resource object that will hold the SentencePiece processors.
+//
+// The processors are immutable snapshots, one per combination of the extra
+// options, shared through std::shared_ptr and published atomically (RCU
+// style): the kernels read them without locking, and a call in flight keeps
+// its snapshot alive. Only the creation of a snapshot takes a lock.
+//
+// Each snapshot holds its own copy of the model, so only the combinations of
+// options that the graph actually uses are loaded, and all the loaded ones are
+// accounted for in MemoryUsed().
+class SentencepieceResource : public ResourceBase {
+ public:
+  using Processor = sentencepiece::SentencePieceProcessor;
+
+  // Loads the serialized model proto, and the processor without extra options.
+  Status Load(const string& model_proto) {
+    model_proto_ = model_proto;
+    auto processor = std::make_shared<Processor>();
+    TF_RETURN_IF_ERROR(
+        ToTFStatus(processor->LoadFromSerializedProto(model_proto_)));
+    std::atomic_store(&processors_[0],
+                      std::shared_ptr<const Processor>(std::move(processor)));
+    num_processors_.store(1, std::memory_order_relaxed);
+    return absl::OkStatus();
+  }
+
+  // Returns the processor without extra options.
+  std::shared_ptr<const Processor> GetProcessor() const {
+    return std::atomic_load(&processors_[0]);
+  }
+
+  // Sets `processor` to the processor with the extra options, which is created
+  // on first use. Then `created` is set to true, and MemoryUsed() grows by
+  // ProcessorMemoryUsed().
+  Status GetProcessor(bool add_bos, bool add_eos, bool reverse,
+                      std::shared_ptr<const Processor>* processor,
+                      bool* created) {
+    *created = false;
+    const int index = (add_bos ? 1 : 0) | (add_eos ? 2 : 0) | (reverse ? 4 : 0);
+    // Because we expect most of the time the snapshot to exist, we do a quick
+    // check first.
+    *processor = std::atomic_load(&processors_[index]);
+    if (*processor != nullptr) {
+      return absl::OkStatus();
+    }
+
+    absl::MutexLock lock(&mu_);
+    *processor = std::atomic_load(&processors_[index]);
+    if (*processor != nullptr) {
+      return absl::OkStatus();
+    }
+    string options;
+    if (add_bos) {
+      absl::StrAppend(&options, "bos");
+    }
+    if (add_eos) {
+      if (!options.empty()) {
+        absl::StrAppend(&options, ":");
+      }
+      absl::StrAppend(&options, "eos");
+    }
+    if (reverse) {
+      if (!options.empty()) {
+        absl::StrAppend(&options, ":");
+      }
+      absl::StrAppend(&options, "reverse");
+    }
+    auto new_processor = std::make_shared<Processor>();
+    TF_RETURN_IF_ERROR(
+        ToTFStatus(new_processor->LoadFromSerializedProto(model_proto_)));
+    TF_RETURN_IF_ERROR(
+        ToTFStatus(new_processor->SetEncodeExtraOptions(options)));
+    TF_RETURN_IF_ERROR(
+        ToTFStatus(new_processor->SetDecodeExtraOptions(options)));
+    *processor = std::move(new_processor);
+    std::atomic_store(&processors_[index], *processor);
+    num_processors_.fetch_add(1, std::memory_order_relaxed);
+    *created = true;
+    return absl::OkStatus();
+  }
 
-  int64 MemoryUsed() const override { return memory_used; }
+  string DebugString() const override { return "Sentencepiece Resource"; }
 
-  bool SameOptions(bool add_bos, bool add_eos, bool reverse) const {
-    return (add_bos == this->add_bos) && (add_eos == this->add_eos) &&
-           (reverse == this->reverse);
+  // The serialized model, plus the model loaded in each processor. The latter
+  // is at least as large as the serialized one, which is used as an estimate.
+  int64 MemoryUsed() const override {
+    return model_proto_.size() +
+           num_processors_.load(std::memory_order_relaxed) *
+               ProcessorMemoryUsed();
   }
 
+  // The estimated memory used by each processor.
+  int64 ProcessorMemoryUsed() const { return model_proto_.size(); }
+
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    absl::ReaderMutexLock l(&mu);
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the kernel. This means that the lifetime of the re-created
     // resource will be tied to the lifetime of the resource manager it is
@@ -77,27 +166,55 @@ struct SentencepieceResource : public ResourceBase {
     static std::atomic<int64> counter(0);
     std::string unique_node_name = strings::StrCat(
         "SentencepieceResourceFromGraphDef", "/", counter.fetch_add(1));
-    std::string model = processor.model_proto().SerializeAsString();
     *out = ops::SourceOp(
         "SentencepieceOp",
         builder->opts()
             .WithName(unique_node_name)
-            .WithAttr("model", model)
+            .WithAttr("model", model_proto_)
             .WithAttr("use_node_name_sharing", true));
     return absl::OkStatus();
   }
+
+ private:
+  // Immutable after Load().
+  std::string model_proto_;
+  // The snapshots, by extra options: bit 0 for add_bos, bit 1 for add_eos and
+  // bit 2 for reverse. Read with std::atomic_load and published with
+  // std::atomic_store.
+  std::shared_ptr<const Processor> processors_[8];
+  // The number of non-null `processors_`.
+  std::atomic<int> num_processors_{0};
+  // Serializes the creation of the snapshots. Readers never take it.
+  absl::Mutex mu_;
 };
 
-// According to .../tensorflow/core/util/work_sharder.cc, this values determines
-// how much to shard. It assumes each cost unit is 1ns, and the minimum cost
-// per shard is 10000 (10us).
-// TODO(broken) Determine a medium cost of a call to the SentencePiece processor
-constexpr int64 kCostPerUnit = 10000;
+// Costs of the SentencePiece processor, in the unit of ::tensorflow::Shard's
+// cost_per_unit (about 1ns), for sharding the rows by cost, as measured with a
+// 16k unigram model on English text. The fixed cost of a row includes the
+// protos of its results.
+constexpr TextRowCost kEncodeCost = {/*per_row=*/1000, /*per_byte=*/100};
+// The cost of decoding a row, by piece.
+constexpr TextRowCost kDecodeCost = {/*per_row=*/500, /*per_byte=*/250};
+
+// Returns the nbest_size of the row `i`, from a scalar or a vector.
+int32 GetNBestSize(const Tensor& nbest_size_tensor, int64_t i) {
+  return nbest_size_tensor.dims() == 1 ? nbest_size_tensor.vec<int32>()(i)
+                                       : nbest_size_tensor.scalar<int32>()();
+}
 
-::tensorflow::Status ToTFStatus(const sentencepiece::util::Status& s) {
-  if (s.ok()) return ::tensorflow::Status();
-  return ::tensorflow::Status(static_cast<::absl::StatusCode>(s.code()),
-                              ::tensorflow::string(s.message()));
+// Returns the rough cost of encoding one row of `num_bytes` bytes.
+int64_t EncodeCost(int64_t num_bytes, int32 nbest_size, bool return_nbest) {
+  const int64_t cost = kEncodeCost(num_bytes);
+  if (return_nbest) {
+    // NBestEncode() searches and returns `nbest_size` segmentations.
+    return cost * (6 + std::max(nbest_size, 1));
+  }
+  if (nbest_size == 0 || nbest_size == 1) {
+    return cost;
+  }
+  // SampleEncode() runs forward-filtering and backward-sampling on the lattice
+  // of all the segmentations, or samples from the n-best segmentations.
+  return nbest_size < 0 ? cost * 8 : cost * (15 + nbest_size) / 3;
 }
 
 template <typename T>
@@ -115,8 +232,11 @@ int32 GetPieceOrId<int32>(
   return sp.id();
 }
 
-tensorflow::Status HandleExtraOptions(OpKernelContext* ctx,
-                                      SentencepieceResource* sp) {
+// Sets `processor` to the processor of `sp` with the extra options of the
+// inputs of the op.
+tensorflow::Status HandleExtraOptions(
+    OpKernelContext* ctx, SentencepieceResource* sp,
+    std::shared_ptr<const SentencepieceResource::Processor>* processor) {
   const Tensor* add_bos_tensor = nullptr;
   TF_RETURN_IF_ERROR(ctx->input("add_bos", &add_bos_tensor));
   const bool add_bos = add_bos_tensor->scalar<bool>()();
@@ -129,42 +249,12 @@ tensorflow::Status HandleExtraOptions(OpKernelContext* ctx,
   TF_RETURN_IF_ERROR(ctx->input("reverse", &reverse_tensor));
   const bool reverse = reverse_tensor->scalar<bool>()();
 
-  {
-    // Because we expect most of the time no change in these options, we grab
-    // the reader lock once and do a quick check first.
-    absl::ReaderMutexLock l(&sp->mu);
-    if (sp->SameOptions(add_bos, add_eos, reverse)) {
-      return absl::OkStatus();
-    }
-  }
-
-  absl::WriterMutexLock lock(&sp->mu);
-  if (sp->SameOptions(add_bos, add_eos, reverse)) {
-    return absl::OkStatus();
-  }
-  string options;
-  sp->add_bos = add_bos;
-  if (sp->add_bos) {
-    absl::StrAppend(&options, "bos");
+  bool created = false;
+  TF_RETURN_IF_ERROR(
+      sp->GetProcessor(add_bos, add_eos, reverse, processor, &created));
+  if (created && ctx->track_allocations()) {
+    ctx->record_persistent_memory_allocation(sp->ProcessorMemoryUsed());
   }
-  sp->add_eos = add_eos;
-  if (sp->add_eos) {
-    if (!options.empty()) {
-      absl::StrAppend(&options, ":");
-    }
-    absl::StrAppend(&options, "eos");
-  }
-  sp->reverse = reverse;
-  if (sp->reverse) {
-    if (!options.empty()) {
-      absl::StrAppend(&options, ":");
-    }
-    absl::StrAppend(&options, "reverse");
-  }
-
-  TF_RETURN_IF_ERROR(ToTFStatus(sp->processor.SetEncodeExtraOptions(options)));
-  TF_RETURN_IF_ERROR(ToTFStatus(sp->processor.SetDecodeExtraOptions(options)));
-
   return absl::OkStatus();
 }
 
@@ -217,11 +307,7 @@ class SentencepieceOp : public OpKernel {
               // the relatively small sentencepiece model proto into the
               // tensorflow graph such that the tensorflow graph is
               // self-contained.
-              TF_RETURN_IF_ERROR(ToTFStatus(
-                  sp->processor.LoadFromSerializedProto(model_proto_attr)));
-              // TODO(broken): Determine a better computation of what the memory
-              // requirements for the processor are.
-              sp->memory_used = model_proto_attr.size();
+              TF_RETURN_IF_ERROR(sp->Load(model_proto_attr));
 
               if (ctx->track_allocations()) {
                 ctx->record_persistent_memory_allocation(sp->MemoryUsed());
@@ -288,7 +374,8 @@ class SentencepieceTokenizeOp : public OpKernel {
     const Tensor* alpha_tensor = nullptr;
     OP_REQUIRES_OK(ctx, ctx->input("alpha", &alpha_tensor));
 
-    OP_REQUIRES_OK(ctx, HandleExtraOptions(ctx, sp));
+    std::shared_ptr<const SentencepieceResource::Processor> processor;
+    OP_REQUIRES_OK(ctx, HandleExtraOptions(ctx, sp, &processor));
 
     if (return_nbest_) {
       OP_REQUIRES(ctx, nbest_size_tensor->dims() == 0,
@@ -312,31 +399,39 @@ class SentencepieceTokenizeOp : public OpKernel {
       const bool return_nbest = return_nbest_;
       const auto& worker_threads =
           *(ctx->device()->tensorflow_cpu_worker_threads());
+      // Shard blocks of consecutive rows with about the same cost.
+      int64_t cost_per_block;
+      const std::vector<int64_t> block_starts = SplitIntoBlocks(
+          num_of_input_values, worker_threads.num_threads,
+          [&input_values_flat, &nbest_size_tensor, return_nbest](int64_t i) {
+            return EncodeCost(input_values_flat(i).size(),
+                              GetNBestSize(*nbest_size_tensor, i),
+                              return_nbest);
+          },
+          &cost_per_block);
       ::tensorflow::Shard(
           worker_threads.num_threads,  // max parallelism
           worker_threads.workers,      // thread pool
-          num_of_input_values,         // total number of data to process.
-          kCostPerUnit,                // cost per unit
-          [ctx, sp, &input_values_flat, &tokens, &nbest_tokens,
-          &nbest_size_tensor, &alpha_tensor,
+          block_starts.size() - 1,     // total number of data to process.
+          cost_per_block,
+          [ctx, &processor, &input_values_flat, &tokens, &nbest_tokens,
+          &nbest_size_tensor, &alpha_tensor, &block_starts,
           return_nbest](int64 start, int64 limit) {
-            absl::ReaderMutexLock lock(&sp->mu);
-            for (int i = start; i < limit; ++i) {
-              const int32 nbest_size = nbest_size_tensor->dims() == 1
-                                         ? nbest_size_tensor->vec<int32>()(i)
-                                         : nbest_size_tensor->scalar<int32>()();
+            for (int64_t i = block_starts[start]; i < block_starts[limit];
+                 ++i) {
+              const int32 nbest_size = GetNBestSize(*nbest_size_tensor, i);
               if (return_nbest) {
-                OP_REQUIRES_OK(ctx, ToTFStatus(sp->processor.NBestEncode(
+                OP_REQUIRES_OK(ctx, ToTFStatus(processor->NBestEncode(
                                         input_values_flat(i), nbest_size,
                                         &nbest_tokens[i])));
               } else if (nbest_size == 0 || nbest_size == 1) {
-                OP_REQUIRES_OK(ctx, ToTFStatus(sp->processor.Encode(
+                OP_REQUIRES_OK(ctx, ToTFStatus(processor->Encode(
                                         input_values_flat(i), &tokens[i])));
               } else {
                 const float alpha = alpha_tensor->dims() == 1
                                         ? alpha_tensor->vec<float>()(i)
                                         : alpha_tensor->scalar<float>()();
-                OP_REQUIRES_OK(ctx, ToTFStatus(sp->processor.SampleEncode(
+                OP_REQUIRES_OK(ctx, ToTFStatus(processor->SampleEncode(
                                         input_values_flat(i), nbest_size, alpha,
                                         &tokens[i])));
               }
@@ -431,7 +526,8 @@ class SentencepieceTokenizeWithOffsetsOp : public OpKernel {
     const Tensor* alpha_tensor = nullptr;
     OP_REQUIRES_OK(ctx, ctx->input("alpha", &alpha_tensor));
 
-    OP_REQUIRES_OK(ctx, HandleExtraOptions(ctx, sp));
+    std::shared_ptr<const SentencepieceResource::Processor> processor;
+    OP_REQUIRES_OK(ctx, HandleExtraOptions(ctx, sp, &processor));
 
     if (return_nbest_) {
       OP_REQUIRES(ctx, nbest_size_tensor->dims() == 0,
@@ -453,31 +549,39 @@ class SentencepieceTokenizeWithOffsetsOp : public OpKernel {
       const bool return_nbest = return_nbest_;
       const auto& worker_threads =
           *(ctx->device()->tensorflow_cpu_worker_threads());
+      // Shard blocks of consecutive rows with about the same cost.
+      int64_t cost_per_block;
+      const std::vector<int64_t> block_starts = SplitIntoBlocks(
+          num_of_input_values, worker_threads.num_threads,
+          [&input_values_flat, &nbest_size_tensor, return_nbest](int64_t i) {
+            return EncodeCost(input_values_flat(i).size(),
+                              GetNBestSize(*nbest_size_tensor, i),
+                              return_nbest);
+          },
+          &cost_per_block);
       ::tensorflow::Shard(
           worker_threads.num_threads,  // max parallelism
           worker_threads.workers,      // thread pool
-          num_of_input_values,         // total number of data to process.
-          kCostPerUnit,
-          [ctx, sp, &input_values_flat, &results, &nbest_results,
-          &nbest_size_tensor, &alpha_tensor,
+          block_starts.size() - 1,     // total number of data to process.
+          cost_per_block,
+          [ctx, &processor, &input_values_flat, &results, &nbest_results,
+          &nbest_size_tensor, &alpha_tensor, &block_starts,
           return_nbest](int64 start, int64 limit) {
-            absl::ReaderMutexLock lock(&sp->mu);
-            for (int i = start; i < limit; ++i) {
-              const int32 nbest_size = nbest_size_tensor->dims() == 1
-                                         ? nbest_size_tensor->vec<int32>()(i)
-                                         : nbest_size_tensor->scalar<int32>()();
+            for (int64_t i = block_starts[start]; i < block_starts[limit];
+                 ++i) {
+              const int32 nbest_size = GetNBestSize(*nbest_size_tensor, i);
               if (return_nbest) {
-                OP_REQUIRES_OK(ctx, ToTFStatus(sp->processor.NBestEncode(
+                OP_REQUIRES_OK(ctx, ToTFStatus(processor->NBestEncode(
                                         input_values_flat(i), nbest_size,
                                         &nbest_results[i])));
               } else if (nbest_size == 0 || nbest_size == 1) {
-                OP_REQUIRES_OK(ctx, ToTFStatus(sp->processor.Encode(
+                OP_REQUIRES_OK(ctx, ToTFStatus(processor->Encode(
                                         input_values_flat(i), &results[i])));
               } else {
                 const float alpha = alpha_tensor->dims() == 1
                                         ? alpha_tensor->vec<float>()(i)
                                         : alpha_tensor->scalar<float>()();
-                OP_REQUIRES_OK(ctx, ToTFStatus(sp->processor.SampleEncode(
+                OP_REQUIRES_OK(ctx, ToTFStatus(processor->SampleEncode(
                                         input_values_flat(i), nbest_size, alpha,
                                         &results[i])));
               }
@@ -578,7 +682,8 @@ class SentencepieceDetokenizeOp : public OpKernel {
     const auto input_splits_flat = input_splits_tensor.flat<Tsplits>();
     const int64 num_of_sentences = input_splits_flat.size() - 1;
 
-    OP_REQUIRES_OK(ctx, HandleExtraOptions(ctx, sp));
+    std::shared_ptr<const SentencepieceResource::Processor> processor;
+    OP_REQUIRES_OK(ctx, HandleExtraOptions(ctx, sp, &processor));
 
     Tensor* output_tensor;
     OP_REQUIRES_OK(ctx,
@@ -588,15 +693,25 @@ class SentencepieceDetokenizeOp : public OpKernel {
     if (input_values_flat.size() > 0) {
       const auto& worker_threads =
           *(ctx->device()->tensorflow_cpu_worker_threads());
+      // Shard blocks of consecutive rows with about the same cost. The splits
+      // are validated below.
+      int64_t cost_per_block;
+      const std::vector<int64_t> block_starts = SplitIntoBlocks(
+          num_of_sentences, worker_threads.num_threads,
+          [&input_splits_flat](int64_t i) {
+            return kDecodeCost(std::max<int64_t>(
+                0, input_splits_flat(i + 1) - input_splits_flat(i)));
+          },
+          &cost_per_block);
       ::tensorflow::Shard(
           worker_threads.num_threads,  // max parallelism
           worker_threads.workers,      // thread pool
-          num_of_sentences,            // total number of data to process.
-          kCostPerUnit,
-          [ctx, sp, &input_values_flat, &input_splits_flat, &output_flat](
-              int64 start, int64 limit) {
-            absl::ReaderMutexLock lock(&sp->mu);
-            for (int i = start; i < limit; ++i) {
+          block_starts.size() - 1,     // total number of data to process.
+          cost_per_block,
+          [ctx, &processor, &input_values_flat, &input_splits_flat,
+           &output_flat, &block_starts](int64 start, int64 limit) {
+            for (int64_t i = block_starts[start]; i < block_starts[limit];
+                 ++i) {
               if (i + 1 >= input_splits_flat.size()) {
                 ctx->CtxFailure(errors::OutOfRange("Invalid splits; ", i));
                 return;
@@ -613,7 +728,7 @@ class SentencepieceDetokenizeOp : public OpKernel {
                   pieces(&input_values_flat(input_splits_flat(i)),
                         &input_values_flat(input_splits_flat(i + 1)));
               std::string output_flat_str;
-              OP_REQUIRES_OK(ctx, ToTFStatus(sp->processor.Decode(
+              OP_REQUIRES_OK(ctx, ToTFStatus(processor->Decode(
                                       pieces, &output_flat_str)));
               output_flat(i) = output_flat_str;
             }
@@ -660,7 +775,7 @@ class SentencepieceVocabSizeOp : public OpKernel {
 
     Tensor* output_tensor;
     OP_REQUIRES_OK(ctx, ctx->allocate_output(0, {}, &output_tensor));
-    output_tensor->scalar<int32>()() = sp->processor.GetPieceSize();
+    output_tensor->scalar<int32>()() = sp->GetProcessor()->GetPieceSize();
   }
 };
 
@@ -689,9 +804,10 @@ class SentencepieceIdToStringOp : public OpKernel {
         ctx, ctx->allocate_output(0, input_tensor.shape(), &output_tensor));
     auto output_tensor_flat = output_tensor->flat<tensorflow::tstring>();
 
-    absl::ReaderMutexLock lock(&sp->mu);
+    const std::shared_ptr<const SentencepieceResource::Processor> processor =
+        sp->GetProcessor();
     for (int i = 0; i < input_tensor_flat.size(); ++i) {
-      output_tensor_flat(i) = sp->processor.IdToPiece(input_tensor_flat(i));
+      output_tensor_flat(i) = processor->IdToPiece(input_tensor_flat(i));
     }
   }
 };
@@ -721,9 +837,10 @@ class SentencepieceStringToIdOp : public OpKernel {
         ctx, ctx->allocate_output(0, input_tensor.shape(), &output_tensor));
     auto output_tensor_flat = output_tensor->flat<int32>();
 
-    absl::ReaderMutexLock lock(&sp->mu);
+    const std::shared_ptr<const SentencepieceResource::Processor> processor =
+        sp->GetProcessor();
     for (int i = 0; i < input_tensor_flat.size(); ++i) {
-      output_tensor_flat(i) = sp->processor.PieceToId(input_tensor_flat(i));
+      output_tensor_flat(i) = processor->PieceToId(input_tensor_flat(i));
     }
   }
 };
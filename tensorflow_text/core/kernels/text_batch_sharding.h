@@ -0,0 +1,110 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_TEXT_BATCH_SHARDING_H_
+#define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_TEXT_BATCH_SHARDING_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace tensorflow {
+namespace text {
+
+// Helpers to shard the rows of a batch of text inputs over a thread pool, e.g.,
+// with ::tensorflow::Shard, by their estimated cost rather than by their count.
+//
+// All the costs are in the unit of ::tensorflow::Shard's cost_per_unit (about
+// 1ns).
+
+// Runs `work(start, limit)` on disjoint ranges that together cover
+// [0, total), possibly in parallel. `cost_per_unit` is the estimated cost of
+// processing one unit, as in ::tensorflow::Shard.
+using BatchShardRunner = std::function<void(
+    int64_t total, int64_t cost_per_unit,
+    const std::function<void(int64_t start, int64_t limit)>& work)>;
+
+// A BatchShardRunner that runs all the work on the calling thread.
+inline void RunBatchShardsInline(
+    int64_t total, int64_t cost_per_unit,
+    const std::function<void(int64_t start, int64_t limit)>& work) {
+  work(0, total);
+}
+
+// The minimum cost of a block of rows: cheaper blocks are not worth the
+// overhead of scheduling them. This is also the minimum cost of a shard of
+// ::tensorflow::Shard.
+inline constexpr int64_t kMinCostPerBlock = 10000;
+
+// A linear cost model of processing one row of text.
+struct TextRowCost {
+  // The fixed cost of a row, e.g., of the call to the tokenizer and of its
+  // outputs.
+  int64_t per_row = 0;
+  // The cost of each byte (or other unit, e.g., token) of the row.
+  int64_t per_byte = 0;
+
+  int64_t operator()(int64_t num_bytes) const {
+    return per_row + per_byte * num_bytes;
+  }
+};
+
+// Splits the rows [0, `num_rows`) into blocks of consecutive rows with about
+// the same cost, where `row_cost(i)` is the estimated cost of the row `i`.
+// There are at most `4 * max_parallelism` blocks, so that the thread pool can
+// balance them, and, but for the last one, each block costs at least
+// kMinCostPerBlock, so that small batches are not over-sharded.
+//
+// Returns the start of each block followed by `num_rows`, and sets
+// `cost_per_block` to the cost of a block for ::tensorflow::Shard. The blocks
+// only depend on the inputs and on `max_parallelism`, so merging the results of
+// the blocks in order does not depend on the scheduling of the shards.
+template <typename RowCostFn>
+std::vector<int64_t> SplitIntoBlocks(int64_t num_rows, int max_parallelism,
+                                     const RowCostFn& row_cost,
+                                     int64_t* cost_per_block) {
+  std::vector<int64_t> block_starts = {0};
+  if (max_parallelism <= 1 || num_rows <= 1) {
+    // Everything runs on the calling thread anyway.
+    block_starts.push_back(num_rows);
+    *cost_per_block = 0;
+    return block_starts;
+  }
+  int64_t total_cost = 0;
+  for (int64_t i = 0; i < num_rows; ++i) {
+    total_cost += row_cost(i);
+  }
+  // Over-partition a bit so that the thread pool can balance the blocks.
+  const int64_t max_blocks = std::max<int64_t>(
+      1, std::min({num_rows, int64_t{4} * max_parallelism,
+                   total_cost / kMinCostPerBlock}));
+  const int64_t target_cost = total_cost / max_blocks + 1;
+  int64_t block_cost = 0;
+  for (int64_t i = 0; i < num_rows; ++i) {
+    block_cost += row_cost(i);
+    if (block_cost >= target_cost && i + 1 < num_rows) {
+      block_starts.push_back(i + 1);
+      block_cost = 0;
+    }
+  }
+  block_starts.push_back(num_rows);
+  *cost_per_block = target_cost;
+  return block_starts;
+}
+
+}  // namespace text
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_TEXT_BATCH_SHARDING_H_
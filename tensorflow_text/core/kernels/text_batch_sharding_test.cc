@@ -0,0 +1,94 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/text_batch_sharding.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace tensorflow {
+namespace text {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(TextBatchShardingTest, TextRowCost) {
+  const TextRowCost cost{/*per_row=*/100, /*per_byte=*/10};
+  EXPECT_EQ(cost(0), 100);
+  EXPECT_EQ(cost(5), 150);
+}
+
+TEST(TextBatchShardingTest, SingleBlockWithoutParallelism) {
+  int64_t cost_per_block;
+  EXPECT_THAT(SplitIntoBlocks(
+                  10, /*max_parallelism=*/1,
+                  [](int64_t) { return kMinCostPerBlock; }, &cost_per_block),
+              ElementsAre(0, 10));
+  EXPECT_EQ(cost_per_block, 0);
+  EXPECT_THAT(SplitIntoBlocks(
+                  1, /*max_parallelism=*/8,
+                  [](int64_t) { return kMinCostPerBlock; }, &cost_per_block),
+              ElementsAre(0, 1));
+  EXPECT_THAT(SplitIntoBlocks(
+                  0, /*max_parallelism=*/8,
+                  [](int64_t) { return kMinCostPerBlock; }, &cost_per_block),
+              ElementsAre(0, 0));
+}
+
+TEST(TextBatchShardingTest, CheapBatchesAreNotOverSharded) {
+  int64_t cost_per_block;
+  // The whole batch costs less than one block.
+  EXPECT_THAT(SplitIntoBlocks(
+                  100, /*max_parallelism=*/8, [](int64_t) { return 10; },
+                  &cost_per_block),
+              ElementsAre(0, 100));
+  // The whole batch costs two blocks.
+  EXPECT_THAT(SplitIntoBlocks(
+                  100, /*max_parallelism=*/8,
+                  [](int64_t) { return kMinCostPerBlock / 50; },
+                  &cost_per_block),
+              ElementsAre(0, 51, 100));
+}
+
+TEST(TextBatchShardingTest, BlocksHaveAboutTheSameCost) {
+  // One expensive row followed by cheaper ones.
+  const std::vector<int64_t> costs = {
+      8 * kMinCostPerBlock, 2 * kMinCostPerBlock, 2 * kMinCostPerBlock,
+      2 * kMinCostPerBlock, 2 * kMinCostPerBlock};
+  const auto row_cost = [&costs](int64_t i) { return costs[i]; };
+  int64_t cost_per_block;
+  // 5 blocks costing about 3.2 * kMinCostPerBlock.
+  EXPECT_THAT(SplitIntoBlocks(costs.size(), /*max_parallelism=*/1000, row_cost,
+                              &cost_per_block),
+              ElementsAre(0, 1, 3, 5));
+  EXPECT_EQ(cost_per_block, 16 * kMinCostPerBlock / 5 + 1);
+  // At most 4 blocks per thread.
+  EXPECT_THAT(SplitIntoBlocks(costs.size(), /*max_parallelism=*/1, row_cost,
+                              &cost_per_block),
+              ElementsAre(0, 5));
+  // At most one block per kMinCostPerBlock.
+  EXPECT_THAT(SplitIntoBlocks(
+                  costs.size(), /*max_parallelism=*/2,
+                  [&costs](int64_t i) { return costs[i] / 4; },
+                  &cost_per_block),
+              ElementsAre(0, 1, 4, 5));
+  EXPECT_EQ(cost_per_block, kMinCostPerBlock + 1);
+}
+
+}  // namespace
+}  // namespace text
+}  // namespace tensorflow
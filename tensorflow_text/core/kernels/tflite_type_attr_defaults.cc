@@ -0,0 +1,129 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/tflite_type_attr_defaults.h"
+
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "flatbuffers/flexbuffers.h"
+
+namespace tflite {
+namespace ops {
+namespace custom {
+namespace text {
+namespace {
+
+void CopyValue(const flexbuffers::Reference& value, flexbuffers::Builder& fbb);
+
+template <typename VectorT>
+void CopyElements(const VectorT& vector, flexbuffers::Builder& fbb) {
+  for (size_t i = 0; i < vector.size(); ++i) {
+    CopyValue(vector[i], fbb);
+  }
+}
+
+void CopyMapEntries(const flexbuffers::Map& map, flexbuffers::Builder& fbb) {
+  const flexbuffers::TypedVector keys = map.Keys();
+  const flexbuffers::Vector values = map.Values();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    fbb.Key(keys[i].AsKey());
+    CopyValue(values[i], fbb);
+  }
+}
+
+// Appends a copy of `value` to `fbb`.
+void CopyValue(const flexbuffers::Reference& value, flexbuffers::Builder& fbb) {
+  if (value.IsMap()) {
+    const size_t start = fbb.StartMap();
+    CopyMapEntries(value.AsMap(), fbb);
+    fbb.EndMap(start);
+  } else if (value.IsVector()) {
+    const size_t start = fbb.StartVector();
+    CopyElements(value.AsVector(), fbb);
+    fbb.EndVector(start, /*typed=*/false, /*fixed=*/false);
+  } else if (value.IsTypedVector()) {
+    const size_t start = fbb.StartVector();
+    CopyElements(value.AsTypedVector(), fbb);
+    fbb.EndVector(start, /*typed=*/true, /*fixed=*/false);
+  } else if (value.IsFixedTypedVector()) {
+    const size_t start = fbb.StartVector();
+    CopyElements(value.AsFixedTypedVector(), fbb);
+    fbb.EndVector(start, /*typed=*/true, /*fixed=*/true);
+  } else if (value.IsBool()) {
+    fbb.Bool(value.AsBool());
+  } else if (value.IsInt()) {
+    fbb.Int(value.AsInt64());
+  } else if (value.IsUInt()) {
+    fbb.UInt(value.AsUInt64());
+  } else if (value.IsFloat()) {
+    fbb.Double(value.AsDouble());
+  } else if (value.IsString()) {
+    fbb.String(value.AsString().str());
+  } else if (value.IsBlob()) {
+    const flexbuffers::Blob blob = value.AsBlob();
+    fbb.Blob(blob.data(), blob.size());
+  } else {
+    fbb.Null();
+  }
+}
+
+}  // namespace
+
+absl::string_view WithDefaultInt64TypeAttrs(
+    absl::string_view options, absl::Span<const char* const> attr_names) {
+  const flexbuffers::Map map =
+      options.empty()
+          ? flexbuffers::Map::EmptyMap()
+          : flexbuffers::GetRoot(
+                reinterpret_cast<const uint8_t*>(options.data()),
+                options.size())
+                .AsMap();
+  std::vector<const char*> missing;
+  for (const char* name : attr_names) {
+    if (map[name].IsNull()) missing.push_back(name);
+  }
+  if (missing.empty()) return options;
+
+  // EndMap() sorts the keys, so the defaults can follow the other attributes.
+  flexbuffers::Builder fbb;
+  const size_t start = fbb.StartMap();
+  CopyMapEntries(map, fbb);
+  for (const char* name : missing) {
+    fbb.Int(name, kTfLiteInt64);
+  }
+  fbb.EndMap(start);
+  fbb.Finish();
+  const std::vector<uint8_t>& buffer = fbb.GetBuffer();
+
+  // A node-based set, so that the strings never move.
+  static auto* const mu = new absl::Mutex();
+  static auto* const rewritten_options = new std::set<std::string, std::less<>>;
+  absl::MutexLock lock(mu);
+  const std::string& rewritten =
+      *rewritten_options
+           ->emplace(reinterpret_cast<const char*>(buffer.data()),
+                     buffer.size())
+           .first;
+  return rewritten;
+}
+
+}  // namespace text
+}  // namespace custom
+}  // namespace ops
+}  // namespace tflite
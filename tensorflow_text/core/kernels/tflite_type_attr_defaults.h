@@ -0,0 +1,68 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_TFLITE_TYPE_ATTR_DEFAULTS_H_
+#define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_TFLITE_TYPE_ATTR_DEFAULTS_H_
+
+#include <cstddef>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tensorflow/lite/c/common.h"
+
+namespace tflite {
+namespace ops {
+namespace custom {
+namespace text {
+
+// Returns the custom options `options`, a flexbuffer map of attributes, with
+// each of the type attributes in `attr_names` set to int64 where it is missing.
+// Returns `options` itself when no attribute is missing.
+//
+// TFLite keeps a pointer to the custom options of a node for its whole life, so
+// the rewritten options are kept until the end of the process. Equal options
+// share one copy, so that the memory is bounded by the number of distinct op
+// configurations rather than by the number of nodes.
+absl::string_view WithDefaultInt64TypeAttrs(
+    absl::string_view options, absl::Span<const char* const> attr_names);
+
+// Returns the registration of `Kernel`, a TfLiteOpKernel of an OpWrapper over
+// the type attributes `kAttrNames`, that also accepts the models converted
+// before these attributes were added: a missing attribute is int64, the only
+// type that these models support.
+template <typename Kernel, const char*... kAttrNames>
+TfLiteRegistration* GetRegistrationWithInt64TypeDefaults() {
+  static TfLiteRegistration* const registration = [] {
+    auto* r = new TfLiteRegistration(*Kernel::GetTfLiteRegistration());
+    r->init = [](TfLiteContext* context, const char* buffer,
+                 size_t length) -> void* {
+      static constexpr const char* kNames[] = {kAttrNames...};
+      const absl::string_view options = WithDefaultInt64TypeAttrs(
+          buffer == nullptr ? absl::string_view()
+                            : absl::string_view(buffer, length),
+          kNames);
+      return Kernel::GetTfLiteRegistration()->init(context, options.data(),
+                                                   options.size());
+    };
+    return r;
+  }();
+  return registration;
+}
+
+}  // namespace text
+}  // namespace custom
+}  // namespace ops
+}  // namespace tflite
+
+#endif  // THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_TFLITE_TYPE_ATTR_DEFAULTS_H_
@@ -0,0 +1,56 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/vocab_pool.h"
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+namespace tensorflow {
+namespace text {
+
+void VocabPoolBuilder::Add(absl::string_view token) {
+  pool_.append(token.data(), token.size());
+  offsets_.push_back(pool_.size());
+}
+
+VocabPool::VocabPool(const StringVector* vocab_array,
+                     const flatbuffers::String* vocab_pool,
+                     const flatbuffers::Vector<uint32_t>* vocab_offsets) {
+  if (vocab_pool != nullptr && vocab_offsets != nullptr &&
+      vocab_offsets->size() > 0) {
+    pool_ = vocab_pool->data();
+    pool_size_ = vocab_pool->size();
+    offsets_ = vocab_offsets->data();
+    size_ = vocab_offsets->size() - 1;
+  } else if (vocab_array != nullptr) {
+    vocab_array_ = vocab_array;
+    size_ = vocab_array->size();
+  }
+}
+
+absl::Status VocabPool::OutOfRangeIdError(int id) const {
+  return absl::InvalidArgumentError(absl::StrCat(
+      "Token id out of the vocab: ", id, " (vocab size: ", size_, ")"));
+}
+
+absl::Status VocabPool::InvalidOffsetsError(int id) const {
+  return absl::InvalidArgumentError(
+      absl::StrCat("Invalid vocab_offsets of token id ", id, ": [",
+                   offsets_[id], ", ", offsets_[id + 1],
+                   ") in a vocab_pool of ", pool_size_, " bytes"));
+}
+
+}  // namespace text
+}  // namespace tensorflow
@@ -0,0 +1,115 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_VOCAB_POOL_H_
+#define THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_VOCAB_POOL_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "flatbuffers/flatbuffers.h"
+
+namespace tensorflow {
+namespace text {
+
+// Builds the compact form of a vocabulary stored in a model flatbuffer: all the
+// tokens concatenated into a single pool, plus the offset of each token in the
+// pool followed by the end offset of the last token.
+//
+// Compared to a `[string]` vector, this saves the length prefix, the null
+// terminator and the padding of each token (about 6.5 bytes per token with the
+// BERT vocabulary), and keeps the tokens of neighboring ids next to each other.
+class VocabPoolBuilder {
+ public:
+  VocabPoolBuilder() : offsets_({0}) {}
+
+  // Appends `token`, which gets the next id.
+  void Add(absl::string_view token);
+
+  // Creates the values of the `vocab_pool` and `vocab_offsets` fields.
+  flatbuffers::Offset<flatbuffers::String> CreatePool(
+      flatbuffers::FlatBufferBuilder& builder) const {
+    return builder.CreateString(pool_);
+  }
+  flatbuffers::Offset<flatbuffers::Vector<uint32_t>> CreateOffsets(
+      flatbuffers::FlatBufferBuilder& builder) const {
+    return builder.CreateVector(offsets_);
+  }
+
+  int size() const { return offsets_.size() - 1; }
+
+ private:
+  std::string pool_;
+  std::vector<uint32_t> offsets_;
+};
+
+// Reads the vocabulary of a model flatbuffer, in either form: the compact
+// `vocab_pool` and `vocab_offsets` written by VocabPoolBuilder, or the
+// `vocab_array` of strings of models built before it. Lookups are O(1).
+class VocabPool {
+ public:
+  using StringVector =
+      flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>;
+
+  // Reads the vocabulary fields of `config`, a FastWordpieceTokenizerConfig or
+  // a PhraseTokenizerConfig.
+  template <typename ConfigT>
+  static VocabPool FromConfig(const ConfigT& config) {
+    return VocabPool(config.vocab_array(), config.vocab_pool(),
+                     config.vocab_offsets());
+  }
+
+  // All the args may be null, e.g., when the model does not support
+  // detokenization. In that case, the vocabulary is empty.
+  VocabPool(const StringVector* vocab_array,
+            const flatbuffers::String* vocab_pool,
+            const flatbuffers::Vector<uint32_t>* vocab_offsets);
+
+  int size() const { return size_; }
+
+  // Returns the token of `id`, or an InvalidArgumentError if `id` is not in
+  // [0, size()) or the offsets of the token are not within the pool.
+  absl::StatusOr<absl::string_view> Get(int id) const {
+    if (id < 0 || id >= size_) {
+      return OutOfRangeIdError(id);
+    }
+    if (offsets_ != nullptr) {
+      const uint32_t begin = offsets_[id];
+      const uint32_t end = offsets_[id + 1];
+      if (begin > end || end > pool_size_) {
+        return InvalidOffsetsError(id);
+      }
+      return absl::string_view(pool_ + begin, end - begin);
+    }
+    return vocab_array_->Get(id)->string_view();
+  }
+
+ private:
+  absl::Status OutOfRangeIdError(int id) const;
+  absl::Status InvalidOffsetsError(int id) const;
+
+  const StringVector* vocab_array_ = nullptr;
+  const char* pool_ = nullptr;
+  uint32_t pool_size_ = 0;
+  const uint32_t* offsets_ = nullptr;
+  int size_ = 0;
+};
+
+}  // namespace text
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_TEXT_CORE_KERNELS_VOCAB_POOL_H_
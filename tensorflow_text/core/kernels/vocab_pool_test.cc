@@ -0,0 +1,128 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow_text/core/kernels/vocab_pool.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "flatbuffers/flatbuffers.h"
+
+namespace tensorflow {
+namespace text {
+namespace {
+
+const std::vector<std::string>& TestVocab() {
+  // Includes an empty token and a multi-byte one.
+  static const auto* const vocab = new std::vector<std::string>{
+      "[UNK]", "a", "", "bcd", "\xc3\xa9t\xc3\xa9"};
+  return *vocab;
+}
+
+TEST(VocabPoolTest, ReadsVocabArray) {
+  flatbuffers::FlatBufferBuilder builder;
+  const auto vocab_array = builder.CreateVectorOfStrings(TestVocab());
+  const VocabPool vocab(flatbuffers::GetTemporaryPointer(builder, vocab_array),
+                        /*vocab_pool=*/nullptr, /*vocab_offsets=*/nullptr);
+  ASSERT_EQ(vocab.size(), TestVocab().size());
+  for (int id = 0; id < vocab.size(); ++id) {
+    const absl::StatusOr<absl::string_view> token = vocab.Get(id);
+    ASSERT_TRUE(token.ok()) << token.status();
+    EXPECT_EQ(*token, TestVocab()[id]);
+  }
+}
+
+TEST(VocabPoolTest, ReadsVocabPool) {
+  VocabPoolBuilder pool_builder;
+  for (const std::string& token : TestVocab()) pool_builder.Add(token);
+  EXPECT_EQ(pool_builder.size(), TestVocab().size());
+  flatbuffers::FlatBufferBuilder builder;
+  const auto vocab_pool = pool_builder.CreatePool(builder);
+  const auto vocab_offsets = pool_builder.CreateOffsets(builder);
+  const VocabPool vocab(
+      /*vocab_array=*/nullptr,
+      flatbuffers::GetTemporaryPointer(builder, vocab_pool),
+      flatbuffers::GetTemporaryPointer(builder, vocab_offsets));
+  ASSERT_EQ(vocab.size(), TestVocab().size());
+  for (int id = 0; id < vocab.size(); ++id) {
+    const absl::StatusOr<absl::string_view> token = vocab.Get(id);
+    ASSERT_TRUE(token.ok()) << token.status();
+    EXPECT_EQ(*token, TestVocab()[id]);
+  }
+}
+
+TEST(VocabPoolTest, PrefersVocabPool) {
+  VocabPoolBuilder pool_builder;
+  pool_builder.Add("pool");
+  flatbuffers::FlatBufferBuilder builder;
+  const auto vocab_array =
+      builder.CreateVectorOfStrings(std::vector<std::string>{"array"});
+  const auto vocab_pool = pool_builder.CreatePool(builder);
+  const auto vocab_offsets = pool_builder.CreateOffsets(builder);
+  const VocabPool vocab(
+      flatbuffers::GetTemporaryPointer(builder, vocab_array),
+      flatbuffers::GetTemporaryPointer(builder, vocab_pool),
+      flatbuffers::GetTemporaryPointer(builder, vocab_offsets));
+  ASSERT_EQ(vocab.size(), 1);
+  ASSERT_TRUE(vocab.Get(0).ok());
+  EXPECT_EQ(*vocab.Get(0), "pool");
+}
+
+TEST(VocabPoolTest, OutOfRangeIds) {
+  flatbuffers::FlatBufferBuilder builder;
+  const auto vocab_array =
+      builder.CreateVectorOfStrings(std::vector<std::string>{"a", "b"});
+  const VocabPool vocab(flatbuffers::GetTemporaryPointer(builder, vocab_array),
+                        /*vocab_pool=*/nullptr, /*vocab_offsets=*/nullptr);
+  ASSERT_EQ(vocab.size(), 2);
+  for (int id : {-1, 2, 1 << 30}) {
+    EXPECT_EQ(vocab.Get(id).status().code(),
+              absl::StatusCode::kInvalidArgument);
+  }
+}
+
+TEST(VocabPoolTest, OutOfRangeIdsInEmptyVocab) {
+  const VocabPool vocab(/*vocab_array=*/nullptr, /*vocab_pool=*/nullptr,
+                        /*vocab_offsets=*/nullptr);
+  EXPECT_EQ(vocab.size(), 0);
+  EXPECT_EQ(vocab.Get(0).status().code(), absl::StatusCode::kInvalidArgument);
+}
+
+TEST(VocabPoolTest, OffsetsOutOfThePool) {
+  flatbuffers::FlatBufferBuilder builder;
+  const auto vocab_pool = builder.CreateString("abc");
+  const auto vocab_offsets =
+      builder.CreateVector(std::vector<uint32_t>{0, 2, 1, 9});
+  const VocabPool vocab(
+      /*vocab_array=*/nullptr,
+      flatbuffers::GetTemporaryPointer(builder, vocab_pool),
+      flatbuffers::GetTemporaryPointer(builder, vocab_offsets));
+  ASSERT_EQ(vocab.size(), 3);
+  ASSERT_TRUE(vocab.Get(0).ok());
+  EXPECT_EQ(*vocab.Get(0), "ab");
+  // Decreasing offsets.
+  EXPECT_EQ(vocab.Get(1).status().code(), absl::StatusCode::kInvalidArgument);
+  // An end offset past the end of the pool.
+  EXPECT_EQ(vocab.Get(2).status().code(), absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace text
+}  // namespace tensorflow
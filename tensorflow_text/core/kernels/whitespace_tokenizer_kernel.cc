@@ -14,14 +14,27 @@
 
 #include "tensorflow_text/core/kernels/whitespace_tokenizer_kernel.h"
 
+#include <cstdint>
+
 #include "tensorflow/core/framework/op_kernel.h"
 
 namespace tensorflow {
 namespace text {
 
-REGISTER_KERNEL_BUILDER(Name(WhitespaceTokenizeWithOffsetsV2OpKernel::OpName())
-                            .Device(tensorflow::DEVICE_CPU),
-                        WhitespaceTokenizeWithOffsetsV2OpKernel);
+using WhitespaceTokenizeWithOffsetsV2OpKernelInstance =
+    WhitespaceTokenizeWithOffsetsV2OpKernel<int64_t>;
+
+#define REGISTER_WHITESPACE_TOKENIZE(splits_type)                       \
+  REGISTER_KERNEL_BUILDER(                                              \
+      Name(WhitespaceTokenizeWithOffsetsV2OpKernelInstance::OpName())   \
+          .Device(tensorflow::DEVICE_CPU)                               \
+          .TypeConstraint<splits_type>("Tsplits"),                      \
+      WhitespaceTokenizeWithOffsetsV2OpKernel<splits_type>);
+
+REGISTER_WHITESPACE_TOKENIZE(int32_t)
+REGISTER_WHITESPACE_TOKENIZE(int64_t)
+
+#undef REGISTER_WHITESPACE_TOKENIZE
 
 }  // namespace text
 }  // namespace tensorflow
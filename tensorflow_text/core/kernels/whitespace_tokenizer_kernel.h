@@ -21,10 +21,13 @@
 namespace tensorflow {
 namespace text {
 
+template <typename Tsplits>
 class WhitespaceTokenizeWithOffsetsV2OpKernel
-    : public tflite::shim::TfOpKernel<WhitespaceTokenizeWithOffsetsV2Op> {
+    : public tflite::shim::TfOpKernel<WhitespaceTokenizeWithOffsetsV2Op,
+                                      Tsplits> {
  public:
-  using TfOpKernel::TfOpKernel;
+  using tflite::shim::TfOpKernel<WhitespaceTokenizeWithOffsetsV2Op,
+                                 Tsplits>::TfOpKernel;
 };
 
 }  // namespace text
@@ -30,9 +30,11 @@
 namespace tensorflow {
 namespace text {
 
-template <tflite::shim::Runtime Rt>
+// `Tsplits` is the type of the row splits (int32_t or int64_t).
+template <tflite::shim::Runtime Rt, typename Tsplits>
 class WhitespaceTokenizeWithOffsetsV2Op
-    : public tflite::shim::OpKernelShim<WhitespaceTokenizeWithOffsetsV2Op, Rt> {
+    : public tflite::shim::OpKernelShim<WhitespaceTokenizeWithOffsetsV2Op, Rt,
+                                        Tsplits> {
  private:
   enum Inputs {
     kInputValues = 0,
@@ -46,11 +48,11 @@ class WhitespaceTokenizeWithOffsetsV2Op
   };
 
   using typename tflite::shim::OpKernelShim<WhitespaceTokenizeWithOffsetsV2Op,
-                                            Rt>::InitContext;
+                                            Rt, Tsplits>::InitContext;
   using typename tflite::shim::OpKernelShim<WhitespaceTokenizeWithOffsetsV2Op,
-                                            Rt>::InvokeContext;
+                                            Rt, Tsplits>::InvokeContext;
   using typename tflite::shim::OpKernelShim<WhitespaceTokenizeWithOffsetsV2Op,
-                                            Rt>::ShapeInferenceContext;
+                                            Rt, Tsplits>::ShapeInferenceContext;
 
  public:
   WhitespaceTokenizeWithOffsetsV2Op() = default;
@@ -71,6 +73,7 @@ class WhitespaceTokenizeWithOffsetsV2Op
     Args:
       input_values: 1D Tensor of strings to tokenize.
       input_config: A string representing a WhitespaceTokenizerConfig.
+      Tsplits: The type of `output_row_splits`.
 
     Returns:
       * output_tokens: 1D tensor containing the tokens for all input strings.
@@ -90,7 +93,9 @@ class WhitespaceTokenizeWithOffsetsV2Op
   static const char* Doc() { return kDoc; }
 
   // Attributes declaration (syntax: https://www.tensorflow.org/guide/create_op)
-  static std::vector<std::string> Attrs() { return {}; }
+  static std::vector<std::string> Attrs() {
+    return {"Tsplits: {int32, int64} = DT_INT64"};
+  }
 
   // Inputs declaration (syntax: https://www.tensorflow.org/guide/create_op)
   static std::vector<std::string> Inputs();
@@ -108,19 +113,21 @@ class WhitespaceTokenizeWithOffsetsV2Op
   static absl::Status ShapeInference(ShapeInferenceContext* c);
 };
 
-template <tflite::shim::Runtime Rt>
-std::vector<std::string> WhitespaceTokenizeWithOffsetsV2Op<Rt>::Inputs() {
+template <tflite::shim::Runtime Rt, typename Tsplits>
+std::vector<std::string>
+WhitespaceTokenizeWithOffsetsV2Op<Rt, Tsplits>::Inputs() {
   return {"input_values: string", "input_config: string"};
 }
 
-template <tflite::shim::Runtime Rt>
-std::vector<std::string> WhitespaceTokenizeWithOffsetsV2Op<Rt>::Outputs() {
-  return {"output_tokens: string", "output_row_splits: int64",
+template <tflite::shim::Runtime Rt, typename Tsplits>
+std::vector<std::string>
+WhitespaceTokenizeWithOffsetsV2Op<Rt, Tsplits>::Outputs() {
+  return {"output_tokens: string", "output_row_splits: Tsplits",
           "output_start_offsets: int32", "output_end_offsets: int32"};
 }
 
-template <tflite::shim::Runtime Rt>
-absl::Status WhitespaceTokenizeWithOffsetsV2Op<Rt>::ShapeInference(
+template <tflite::shim::Runtime Rt, typename Tsplits>
+absl::Status WhitespaceTokenizeWithOffsetsV2Op<Rt, Tsplits>::ShapeInference(
     ShapeInferenceContext* c) {
   using tflite::shim::Shape;
   const auto input_values_shape_status = c->GetInputShape(kInputValues);
@@ -139,8 +146,8 @@ absl::Status WhitespaceTokenizeWithOffsetsV2Op<Rt>::ShapeInference(
   return absl::OkStatus();
 }
 
-template <tflite::shim::Runtime Rt>
-    absl::Status WhitespaceTokenizeWithOffsetsV2Op<Rt>
+template <tflite::shim::Runtime Rt, typename Tsplits>
+    absl::Status WhitespaceTokenizeWithOffsetsV2Op<Rt, Tsplits>
         ::Invoke(InvokeContext* context) {
   // Inputs
   const auto values_statusor = context->GetInput(kInputValues);
@@ -159,7 +166,7 @@ template <tflite::shim::Runtime Rt>
 
   // Outputs
   std::vector<std::string> tokens;
-  std::vector<int64_t> row_splits;
+  std::vector<Tsplits> row_splits;
   std::vector<int32_t> start_offsets;
   std::vector<int32_t> end_offsets;
 
@@ -178,7 +185,7 @@ template <tflite::shim::Runtime Rt>
   SH_RETURN_IF_ERROR(this->template FillOutputTensor<std::string,
                                                       tensorflow::tstring>(
       tokens, kOutputTokens, context));
-  SH_RETURN_IF_ERROR(this->template FillOutputTensor<int64_t, int64_t>(
+  SH_RETURN_IF_ERROR(this->template FillOutputTensor<Tsplits, Tsplits>(
       row_splits, kOutputRowSplits, context));
   SH_RETURN_IF_ERROR(this->template FillOutputTensor<int32_t, int32_t>(
       start_offsets, kOutputStartOffsets, context));
@@ -14,18 +14,36 @@
 
 #include "tensorflow_text/core/kernels/whitespace_tokenizer_tflite.h"
 
+#include <cstdint>
+
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/shim/tflite_op_shim.h"
+#include "tensorflow/lite/kernels/shim/tflite_op_wrapper.h"
+#include "tensorflow_text/core/kernels/tflite_type_attr_defaults.h"
 #include "tensorflow_text/core/kernels/whitespace_tokenizer_kernel_template.h"
 
 namespace tflite {
 namespace ops {
 namespace custom {
 namespace text {
+namespace {
+const char splits_type[]("Tsplits");
+}  // namespace
+
+using ::tflite::shim::op_wrapper::Attr;
+using ::tflite::shim::op_wrapper::AttrName;
+using ::tflite::shim::op_wrapper::OpWrapper;
+
+template <shim::Runtime Rt>
+using WhitespaceTokenizeOp =
+    OpWrapper<Rt, tensorflow::text::WhitespaceTokenizeWithOffsetsV2Op,
+              Attr<AttrName<splits_type>, int32_t, int64_t>>;
 
 extern "C" void AddWhitespaceTokenize(tflite::MutableOpResolver* resolver) {
-  tflite::shim::TfLiteOpKernel<
-      tensorflow::text::WhitespaceTokenizeWithOffsetsV2Op>::Add(resolver);
+  resolver->AddCustom(
+      WhitespaceTokenizeOp<shim::Runtime::kTfLite>::OpName(),
+      GetRegistrationWithInt64TypeDefaults<
+          tflite::shim::TfLiteOpKernel<WhitespaceTokenizeOp>, splits_type>());
 }
 
 }  // namespace text
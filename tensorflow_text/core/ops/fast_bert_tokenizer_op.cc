@@ -0,0 +1,28 @@
+// Copyright 2026 TF.Text Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+
+#include "tensorflow/lite/kernels/shim/tf_op_shim.h"
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer_tf_kernel.h"
+
+namespace tensorflow {
+namespace text {
+
+using FastBertTokenizeWithOffsetsOpKernelInstance =
+    FastBertTokenizeWithOffsetsOpKernel<int64_t, int64_t>;
+REGISTER_TF_OP_SHIM(FastBertTokenizeWithOffsetsOpKernelInstance);
+
+}  // namespace text
+}  // namespace tensorflow
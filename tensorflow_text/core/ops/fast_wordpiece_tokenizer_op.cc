@@ -15,13 +15,17 @@
 #ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_OPS_FAST_WORDPIECE_TOKENIZER_OP_H_
 #define THIRD_PARTY_TENSORFLOW_TEXT_CORE_OPS_FAST_WORDPIECE_TOKENIZER_OP_H_
 
+#include <cstdint>
+
 #include "tensorflow/lite/kernels/shim/tf_op_shim.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_kernel.h"
 
 namespace tensorflow {
 namespace text {
 
-REGISTER_TF_OP_SHIM(FastWordpieceTokenizeWithOffsetsOpKernel);
+using FastWordpieceTokenizeWithOffsetsOpKernelInstance =
+    FastWordpieceTokenizeWithOffsetsOpKernel<int64_t, int64_t>;
+REGISTER_TF_OP_SHIM(FastWordpieceTokenizeWithOffsetsOpKernelInstance);
 
 REGISTER_TF_OP_SHIM(FastWordpieceDetokenizeOpKernel);
 
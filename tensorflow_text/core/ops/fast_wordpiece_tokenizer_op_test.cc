@@ -21,13 +21,13 @@ namespace {
 TEST(FastWordpieceTokenizeWithOffsetsOpTest, ShapeFn) {
   // FastWordpieceTokenizeWithOffsets(input_values, wp_model) ->
   //     [output_values, output_ids, output_row_splits, start_values,
-  //      end_values]
+  //      end_values, row_truncated]
   ShapeInferenceTestOp op("FastWordpieceTokenizeWithOffsets");
 
-  INFER_OK(op, "?;?", "[?];[?];[?];[?];[?]");
-  INFER_OK(op, "[?];?", "[?];[?];[?];[?];[?]");
-  INFER_OK(op, "[5];?", "[?];[?];[6];[?];[?]");
-  INFER_OK(op, "[6];[?]", "[?];[?];[7];[?];[?]");
+  INFER_OK(op, "?;?", "[?];[?];[?];[?];[?];[?]");
+  INFER_OK(op, "[?];?", "[?];[?];[?];[?];[?];[?]");
+  INFER_OK(op, "[5];?", "[?];[?];[6];[?];[?];[5]");
+  INFER_OK(op, "[6];[?]", "[?];[?];[7];[?];[?];[6]");
   INFER_ERROR("Shape must be rank 1", op, "[];?");
   INFER_ERROR("Shape must be rank 1", op, "[1,2];?");
   INFER_ERROR("Shape must be rank 1", op, "?;[]");
@@ -15,13 +15,17 @@
 #ifndef THIRD_PARTY_TENSORFLOW_TEXT_CORE_OPS_WHITESPACE_TOKENIZER_OP_H_
 #define THIRD_PARTY_TENSORFLOW_TEXT_CORE_OPS_WHITESPACE_TOKENIZER_OP_H_
 
+#include <cstdint>
+
 #include "tensorflow/lite/kernels/shim/tf_op_shim.h"
 #include "tensorflow_text/core/kernels/whitespace_tokenizer_kernel.h"
 
 namespace tensorflow {
 namespace text {
 
-REGISTER_TF_OP_SHIM(WhitespaceTokenizeWithOffsetsV2OpKernel);
+using WhitespaceTokenizeWithOffsetsV2OpKernelInstance =
+    WhitespaceTokenizeWithOffsetsV2OpKernel<int64_t>;
+REGISTER_TF_OP_SHIM(WhitespaceTokenizeWithOffsetsV2OpKernelInstance);
 
 }  // namespace text
 }  // namespace tensorflow
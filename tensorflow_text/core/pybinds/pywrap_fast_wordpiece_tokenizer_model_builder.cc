@@ -24,19 +24,26 @@ namespace text {
 namespace py = pybind11;
 
 PYBIND11_MODULE(pywrap_fast_wordpiece_tokenizer_model_builder, m) {
-  m.def("build_fast_wordpiece_model",
-        [](const std::vector<std::string>& vocab, int max_bytes_per_token,
-           const std::string& suffix_indicator, const std::string& unk_token,
-           bool no_pretokenization, bool support_detokenization) {
-          const auto result = BuildModelAndExportToFlatBuffer(
-              vocab, max_bytes_per_token, suffix_indicator, unk_token,
-              no_pretokenization, support_detokenization);
-          if (!result.status().ok()) {
-            // Propagate the error to the Python code.
-            throw std::runtime_error(std::string(result.status().message()));
-          }
-          return py::bytes(*result);
-        });
+  m.def(
+      "build_fast_wordpiece_model",
+      [](const std::vector<std::string>& vocab, int max_bytes_per_token,
+         const std::string& suffix_indicator, const std::string& unk_token,
+         bool no_pretokenization, bool support_detokenization,
+         bool compact_vocab) {
+        const auto result = BuildModelAndExportToFlatBuffer(
+            vocab, max_bytes_per_token, suffix_indicator, unk_token,
+            no_pretokenization, support_detokenization,
+            /*wide_token_encoding=*/false, compact_vocab);
+        if (!result.status().ok()) {
+          // Propagate the error to the Python code.
+          throw std::runtime_error(std::string(result.status().message()));
+        }
+        return py::bytes(*result);
+      },
+      py::arg("vocab"), py::arg("max_bytes_per_token"),
+      py::arg("suffix_indicator"), py::arg("unk_token"),
+      py::arg("no_pretokenization"), py::arg("support_detokenization"),
+      py::arg("compact_vocab") = false);
 }
 
 }  // namespace text
@@ -13,4 +13,4 @@
 # limitations under the License.
 # ==============================================================================
 
-def build_fast_wordpiece_model(arg0: list[str], arg1: int, arg2: str, arg3: str, arg4: bool, arg5: bool) -> bytes: ...
+def build_fast_wordpiece_model(vocab: list[str], max_bytes_per_token: int, suffix_indicator: str, unk_token: str, no_pretokenization: bool, support_detokenization: bool, compact_vocab: bool = ...) -> bytes: ...
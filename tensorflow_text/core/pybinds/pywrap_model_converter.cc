@@ -16,6 +16,7 @@
 
 #include "include/pybind11/pybind11.h"
 #include "include/pybind11/stl.h"
+#include "tensorflow_text/core/kernels/sentencepiece/model_cache.h"
 #include "tensorflow_text/core/kernels/sentencepiece/model_converter.h"
 
 namespace tensorflow {
@@ -34,6 +35,25 @@ PYBIND11_MODULE(pywrap_model_converter, m) {
         ConvertSentencepieceModelForDecoder(std::string(model_string)));
   });
 
+  // Returns a copy of the converted model from the cache in `cache_dir`, which
+  // it converts and writes on a cache miss. The copy is not shared across
+  // processes: the cache only saves the conversion.
+  m.def("load_cached_sentencepiece_model",
+        [](py::bytes model_string, const std::string& cache_dir,
+           bool for_decoder) {
+          const auto result = LoadOrConvertModel(
+              std::string(model_string), cache_dir,
+              for_decoder ? ConvertedModelType::kDecoder
+                          : ConvertedModelType::kEncoder);
+          if (!result.status().ok()) {
+            // Propagate the error to the Python code.
+            throw std::runtime_error(std::string(result.status().message()));
+          }
+          return py::bytes(static_cast<const char*>((*result)->data()),
+                           (*result)->size());
+        },
+        py::arg("model"), py::arg("cache_dir"), py::arg("for_decoder"));
+
   m.def("get_vocabulary_size", [](py::bytes model_string) {
     return GetVocabularySize(std::string(model_string));
   });
@@ -16,3 +16,4 @@
 def convert_sentencepiece_model(arg0: bytes) -> bytes: ...
 def convert_sentencepiece_model_for_decoder(arg0: bytes) -> bytes: ...
 def get_vocabulary_size(arg0: bytes) -> int: ...
+def load_cached_sentencepiece_model(model: bytes, cache_dir: str, for_decoder: bool) -> bytes: ...
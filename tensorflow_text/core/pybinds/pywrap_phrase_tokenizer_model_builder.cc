@@ -27,16 +27,20 @@ namespace py = pybind11;
 PYBIND11_MODULE(pywrap_phrase_tokenizer_model_builder, m) {
   m.def("build_phrase_model",
         [](const std::vector<std::string>& vocab, const std::string& unk_token,
-           bool support_detokenization, int prob, bool split_end_punctuation) {
+           bool support_detokenization, int prob, bool split_end_punctuation,
+           bool compact_vocab) {
           const auto result = BuildPhraseModelAndExportToFlatBuffer(
               vocab, unk_token, support_detokenization, prob,
-              split_end_punctuation);
+              split_end_punctuation, compact_vocab);
           if (!result.status().ok()) {
             // Propagate the error to the Python code.
             throw std::runtime_error(std::string(result.status().message()));
           }
           return py::bytes(*result);
-        });
+        },
+        py::arg("vocab"), py::arg("unk_token"),
+        py::arg("support_detokenization"), py::arg("prob"),
+        py::arg("split_end_punctuation"), py::arg("compact_vocab") = false);
 }
 
 }  // namespace text
@@ -13,4 +13,4 @@
 # limitations under the License.
 # ==============================================================================
 
-def build_phrase_model(arg0: list[str], arg1: str, arg2: bool, arg3: int, arg4: bool) -> bytes: ...
+def build_phrase_model(vocab: list[str], unk_token: str, support_detokenization: bool, prob: int, split_end_punctuation: bool, compact_vocab: bool = ...) -> bytes: ...
@@ -16,6 +16,7 @@
 #include "include/pybind11/pytypes.h"
 #include "tensorflow_text/core/kernels/byte_splitter_tflite.h"
 #include "tensorflow_text/core/kernels/fast_bert_normalizer_tflite.h"
+#include "tensorflow_text/core/kernels/fast_bert_tokenizer_tflite.h"
 #include "tensorflow_text/core/kernels/fast_wordpiece_tokenizer_tflite.h"
 #include "tensorflow_text/core/kernels/ngrams_tflite.h"
 #include "tensorflow_text/core/kernels/ragged_tensor_to_tensor_tflite.h"
@@ -32,12 +33,12 @@ PYBIND11_MODULE(tflite_registrar, m) {
   )pbdoc";
   m.attr("_allowed_symbols") = pybind11::make_tuple(
       "AddByteSplit", "AddByteSplitByOffsets", "AddFastBertNormalize",
-      "AddFastSentencepieceDetokenize", "AddFastSentencepieceTokenize",
-      "AddFastWordpieceTokenize", "AddFastWordpieceDetokenize",
-      "AddNgramsStringJoin", "AddRaggedTensorToTensor",
-      "AddRoundRobinGenerateMasks", "AddRoundRobinTrim",
-      "AddSentenceFragmenterV2", "AddUtf8Binarize", "AddWhitespaceTokenize",
-      "SELECT_TFTEXT_OPS");
+      "AddFastBertTokenize", "AddFastSentencepieceDetokenize",
+      "AddFastSentencepieceTokenize", "AddFastWordpieceTokenize",
+      "AddFastWordpieceDetokenize", "AddNgramsStringJoin",
+      "AddRaggedTensorToTensor", "AddRoundRobinGenerateMasks",
+      "AddRoundRobinTrim", "AddSentenceFragmenterV2", "AddUtf8Binarize",
+      "AddWhitespaceTokenize", "SELECT_TFTEXT_OPS");
   m.def(
       "AddByteSplit",
       [](uintptr_t resolver) {
@@ -65,6 +66,15 @@ PYBIND11_MODULE(tflite_registrar, m) {
       R"pbdoc(
       The function that adds FastBertNormalize to the TFLite interpreter.
       )pbdoc");
+  m.def(
+      "AddFastBertTokenize",
+      [](uintptr_t resolver) {
+        tflite::ops::custom::text::AddFastBertTokenize(
+            reinterpret_cast<tflite::MutableOpResolver*>(resolver));
+      },
+      R"pbdoc(
+      The function that adds FastBertTokenize to the TFLite interpreter.
+      )pbdoc");
   m.def(
       "AddFastSentencepieceDetokenize",
       [](uintptr_t resolver) {
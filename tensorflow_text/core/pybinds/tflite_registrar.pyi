@@ -16,6 +16,7 @@
 def AddByteSplit(arg0: int) -> None: ...
 def AddByteSplitByOffsets(arg0: int) -> None: ...
 def AddFastBertNormalize(arg0: int) -> None: ...
+def AddFastBertTokenize(arg0: int) -> None: ...
 def AddFastSentencepieceDetokenize(arg0: int) -> None: ...
 def AddFastSentencepieceTokenize(arg0: int) -> None: ...
 def AddFastWordpieceDetokenize(arg0: int) -> None: ...
@@ -0,0 +1,137 @@
+# coding=utf-8
+# Copyright 2026 TF.Text Authors.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Benchmarks for building tokenizer models from vocabularies.
+
+Reports the wall time and the peak memory of each build. The peak memory is the
+growth of the peak resident set size of the process during the build, so run a
+single benchmark per process (e.g., `--benchmarks=<name>`) to measure it
+exactly.
+"""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import random
+import resource
+import time
+
+from absl import app
+from absl import flags
+
+import tensorflow as tf
+
+from tensorflow_text.core.pybinds import pywrap_fast_wordpiece_tokenizer_model_builder
+
+
+FLAGS = flags.FLAGS
+flags.DEFINE_integer("build_iters", 3, "Number of builds to run")
+flags.DEFINE_integer("synthetic_vocab_size", 1000000,
+                     "The size of the synthetic multilingual vocabulary")
+
+_BERT_VOCAB_PATH = "tensorflow_text/python/benchmarks/test_data/uncased_L-12_H-768_A-12/vocab.txt"
+
+
+def _synthetic_multilingual_vocab(size):
+  """Returns a vocab of random Latin, Cyrillic, Greek and CJK words."""
+  rng = random.Random(0)
+  latin = [c + v for c in "bcdfghjklmnprstvwz" for v in "aeiou"]
+  cyrillic = [chr(c) for c in range(0x430, 0x450)]
+  greek = [chr(c) for c in range(0x3b1, 0x3ca)]
+  cjk = [chr(c) for c in range(0x4e00, 0x4e00 + 3000)]
+  vocab = {"[UNK]"}
+  while len(vocab) < size:
+    script, max_len = rng.choice([(latin, 5), (cyrillic, 8), (greek, 8),
+                                  (cjk, 3)])
+    word = "".join(rng.choice(script) for _ in range(rng.randint(1, max_len)))
+    vocab.add(("##" if rng.random() < 0.5 else "") + word)
+  return sorted(vocab)
+
+
+class FastWordpieceModelBuilderBenchmark(tf.test.Benchmark):
+  """Benchmarks for building FastWordpieceTokenizer models."""
+
+  def _run(self, vocab, no_pretokenization, name,
+           support_detokenization=False, compact_vocab=False):
+    wall_times = []
+    peak_memory_mb = 0
+    for _ in range(FLAGS.build_iters):
+      max_rss_before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+      start = time.time()
+      model = (
+          pywrap_fast_wordpiece_tokenizer_model_builder
+          .build_fast_wordpiece_model(vocab, 100, "##", "[UNK]",
+                                      no_pretokenization,
+                                      support_detokenization,
+                                      compact_vocab=compact_vocab))
+      wall_times.append(time.time() - start)
+      max_rss_after = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+      # `ru_maxrss` is in kilobytes on Linux.
+      peak_memory_mb = max(peak_memory_mb,
+                           (max_rss_after - max_rss_before) / 1024)
+    self.report_benchmark(
+        iters=FLAGS.build_iters,
+        wall_time=sum(wall_times) / len(wall_times),
+        name=name,
+        extras={
+            "vocab_size": len(vocab),
+            "model_size_mb": len(model) / 2**20,
+            "peak_memory_growth_mb": peak_memory_mb,
+        })
+
+  def _bert_vocab(self):
+    with tf.io.gfile.GFile(_BERT_VOCAB_PATH, "r") as f:
+      return f.read().splitlines()
+
+  def benchmark_fast_wordpiece_bert_vocab(self):
+    self._run(self._bert_vocab(), no_pretokenization=False,
+              name="fast_wordpiece_bert_vocab")
+
+  def benchmark_fast_wordpiece_bert_vocab_single_word(self):
+    self._run(self._bert_vocab(), no_pretokenization=True,
+              name="fast_wordpiece_bert_vocab_single_word")
+
+  def benchmark_fast_wordpiece_bert_vocab_with_detokenization(self):
+    # The model size includes the vocab, as stored for detokenization.
+    self._run(self._bert_vocab(), no_pretokenization=False,
+              name="fast_wordpiece_bert_vocab_with_detokenization",
+              support_detokenization=True)
+
+  def benchmark_fast_wordpiece_bert_vocab_with_compact_detokenization(self):
+    self._run(self._bert_vocab(), no_pretokenization=False,
+              name="fast_wordpiece_bert_vocab_with_compact_detokenization",
+              support_detokenization=True, compact_vocab=True)
+
+  def benchmark_fast_wordpiece_synthetic_vocab_with_detokenization(self):
+    self._run(_synthetic_multilingual_vocab(FLAGS.synthetic_vocab_size),
+              no_pretokenization=False,
+              name="fast_wordpiece_synthetic_vocab_with_detokenization",
+              support_detokenization=True)
+
+  def benchmark_fast_wordpiece_synthetic_vocab_with_compact_detokenization(
+      self):
+    self._run(_synthetic_multilingual_vocab(FLAGS.synthetic_vocab_size),
+              no_pretokenization=False,
+              name="fast_wordpiece_synthetic_vocab_with_compact_detokenization",
+              support_detokenization=True, compact_vocab=True)
+
+  def benchmark_fast_wordpiece_synthetic_vocab(self):
+    self._run(_synthetic_multilingual_vocab(FLAGS.synthetic_vocab_size),
+              no_pretokenization=False,
+              name="fast_wordpiece_synthetic_vocab")
+
+
+if __name__ == "__main__":
+  app.run(tf.test.main())
@@ -34,6 +34,7 @@ from tensorflow.python.ops import lookup_ops
 from tensorflow.python.ops import random_ops
 from tensorflow.python.ops.ragged import ragged_functional_ops
 from tensorflow.python.platform import benchmark
+from tensorflow_text.core.pybinds import pywrap_fast_wordpiece_tokenizer_model_builder
 from tensorflow_text.python import ops as text_ops
 from tensorflow_text.python.benchmarks import benchmark_utils
 from tensorflow_text.python.ops.bert_tokenizer import BasicTokenizer
@@ -158,17 +159,87 @@ class CustomInputTokenizationBenchmark(benchmark_utils.OpsBaseBenchmark):
         token_out_type=dtypes.int64)
     self._run(tokenizer)
 
+  def _build_fast_wordpiece_model(self, support_detokenization=False,
+                                  compact_vocab=False):
+    with tf.io.gfile.GFile(_BERT_VOCAB_PATH, "r") as f:
+      vocab = f.read().splitlines()
+    return (pywrap_fast_wordpiece_tokenizer_model_builder
+            .build_fast_wordpiece_model(
+                vocab, 100, "##", "[UNK]", False, support_detokenization,
+                compact_vocab=compact_vocab))
+
+  def benchmark_fast_wordpiece_tokenizer(self):
+    tokenizer = text_ops.FastWordpieceTokenizer(
+        model_buffer=self._build_fast_wordpiece_model(),
+        token_out_type=dtypes.int64)
+    self._run(tokenizer)
+
+  def benchmark_fast_wordpiece_tokenizer_max_tokens_per_row(self):
+    tokenizer = text_ops.FastWordpieceTokenizer(
+        model_buffer=self._build_fast_wordpiece_model(),
+        token_out_type=dtypes.int64,
+        max_tokens_per_row=512)
+    self._run(tokenizer)
+
+  def _run_fast_wordpiece_detokenizer(self, compact_vocab):
+    tokenizer = text_ops.FastWordpieceTokenizer(
+        model_buffer=self._build_fast_wordpiece_model(
+            support_detokenization=True, compact_vocab=compact_vocab),
+        token_out_type=dtypes.int64)
+    self.input_data = tokenizer.tokenize(self.input_data)
+    self.run_and_report(
+        tokenizer.detokenize,
+        FLAGS.run_iters,
+        FLAGS.burn_iters,
+        xprof_enabled=FLAGS.xprof_tracing)
+
+  def benchmark_fast_wordpiece_detokenizer(self):
+    self._run_fast_wordpiece_detokenizer(compact_vocab=False)
+
+  def benchmark_fast_wordpiece_detokenizer_compact_vocab(self):
+    self._run_fast_wordpiece_detokenizer(compact_vocab=True)
+
   def benchmark_sentencepiece_tokenizer(self):
     model = tf.io.gfile.GFile((_SENTENCEPIECE_MODEL_FILE), "rb").read()
     tokenizer = text_ops.SentencepieceTokenizer(model)
     self._run(tokenizer)
     # TODO(irinabejan): Add benchmark for detokenization
 
+  def benchmark_sentencepiece_tokenizer_sampling(self):
+    # Compared to benchmark_sentencepiece_tokenizer, calibrates the cost model
+    # of the sharding of the rows for sampling.
+    model = tf.io.gfile.GFile((_SENTENCEPIECE_MODEL_FILE), "rb").read()
+    for nbest_size in (-1, 4, 16):
+      tokenizer = text_ops.SentencepieceTokenizer(
+          model, nbest_size=nbest_size, alpha=0.1)
+      self.run_and_report(
+          tokenizer.tokenize,
+          FLAGS.run_iters,
+          FLAGS.burn_iters,
+          benchmark_name="sentencepiece_tokenizer_nbest_size_%s" %
+          ("all" if nbest_size < 0 else nbest_size),
+          xprof_enabled=FLAGS.xprof_tracing)
+
   def benchmark_fast_sentencepiece_tokenizer(self):
     model = tf.io.gfile.GFile((_FAST_SENTENCEPIECE_MODEL_FILE), "rb").read()
     tokenizer = text_ops.FastSentencepieceTokenizer(model)
     self._run(tokenizer)
 
+  def benchmark_fast_sentencepiece_tokenizer_large_batches(self):
+    # Large batches are where the rows are encoded in parallel.
+    model = tf.io.gfile.GFile((_FAST_SENTENCEPIECE_MODEL_FILE), "rb").read()
+    tokenizer = text_ops.FastSentencepieceTokenizer(model)
+    self.load_input_data(1000)
+    input_data = self.input_data
+    for num_rows in (1000, 10000, 100000):
+      self.input_data = array_ops.tile(input_data, [num_rows // 1000])
+      self.run_and_report(
+          tokenizer.tokenize,
+          FLAGS.run_iters,
+          FLAGS.burn_iters,
+          benchmark_name="fast_sentencepiece_tokenizer_%d_rows" % num_rows,
+          xprof_enabled=FLAGS.xprof_tracing)
+
   def _get_char_level_splits(self):
     """Get splits that match inputs char level."""
     char_tokenizer = text_ops.UnicodeCharTokenizer()
@@ -19,18 +19,39 @@ from __future__ import division
 from __future__ import print_function
 
 from tensorflow.python.eager import monitoring
+from tensorflow.python.framework import constant_op
 from tensorflow.python.framework import dtypes
-from tensorflow.python.ops import array_ops
-from tensorflow_text.python.ops.fast_bert_normalizer import FastBertNormalizer
+from tensorflow.python.framework import ops
+from tensorflow.python.framework import tensor
+from tensorflow.python.ops import array_ops_stack
+from tensorflow.python.ops import math_ops
+from tensorflow.python.ops.ragged import ragged_tensor
+from tensorflow.python.ops.ragged.ragged_tensor import RaggedTensor
+from tensorflow_text.core.pybinds import pywrap_fast_bert_normalizer_model_builder
+from tensorflow_text.core.pybinds import pywrap_fast_wordpiece_tokenizer_model_builder
 from tensorflow_text.python.ops.fast_wordpiece_tokenizer import FastWordpieceTokenizer
 from tensorflow_text.python.ops.tokenization import Detokenizer
 from tensorflow_text.python.ops.tokenization import TokenizerWithOffsets
 
+# pylint: disable=g-bad-import-order
+from tensorflow.python.framework import load_library
+from tensorflow.python.platform import resource_loader
+gen_fast_bert_tokenizer = load_library.load_op_library(resource_loader.get_path_to_datafile('_fast_bert_tokenizer.so'))
+
 _tf_text_fast_bert_tokenizer_op_create_counter = monitoring.Counter(
     '/nlx/api/python/fast_bert_tokenizer_create_counter',
     'Counter for number of FastBertTokenizers created in Python.')
 
 
+def _model_tensor(model_buffer):
+  """Returns `model_buffer` (bytes or a uint8 tensor) as a uint8 tensor."""
+  # Use uint8 tensor as a buffer for the model to avoid any possible changes,
+  # for example truncation by '\0'.
+  if isinstance(model_buffer, tensor.Tensor):
+    return model_buffer
+  return constant_op.constant(list(model_buffer), dtype=dtypes.uint8)
+
+
 class FastBertTokenizer(TokenizerWithOffsets, Detokenizer):
   r"""Tokenizer used for BERT, a faster version with TFLite support.
 
@@ -91,18 +112,24 @@ class FastBertTokenizer(TokenizerWithOffsets, Detokenizer):
     super(FastBertTokenizer, self).__init__()
     _tf_text_fast_bert_tokenizer_op_create_counter.get_cell().increase_by(1)
 
-    self._fast_bert_normalizer = FastBertNormalizer(
-        lower_case_nfd_strip_accents=lower_case_nfd_strip_accents,
-        model_buffer=fast_bert_normalizer_model_buffer)
+    # The models are built here and passed to the fused op explicitly.
+    if fast_bert_normalizer_model_buffer is None:
+      fast_bert_normalizer_model_buffer = (
+          pywrap_fast_bert_normalizer_model_builder
+          .build_fast_bert_normalizer_model(lower_case_nfd_strip_accents))
+    if fast_wordpiece_model_buffer is None:
+      fast_wordpiece_model_buffer = (
+          pywrap_fast_wordpiece_tokenizer_model_builder
+          .build_fast_wordpiece_model(vocab, max_bytes_per_word,
+                                      suffix_indicator, unknown_token,
+                                      no_pretokenization,
+                                      support_detokenization))
+    self._normalizer_model = _model_tensor(fast_bert_normalizer_model_buffer)
+    self._wp_model = _model_tensor(fast_wordpiece_model_buffer)
+    # Only used for `detokenize`, which does not involve the normalizer.
     self._fast_wordpiece_tokenizer = FastWordpieceTokenizer(
-        vocab,
-        suffix_indicator,
-        max_bytes_per_word,
-        token_out_type,
-        unknown_token,
-        no_pretokenization,
-        support_detokenization,
-        model_buffer=fast_wordpiece_model_buffer)
+        token_out_type=token_out_type, model_buffer=self._wp_model)
+    self._token_out_type = token_out_type
 
   def tokenize_with_offsets(self, text_input):
     r"""Tokenizes a tensor of string tokens into subword tokens for BERT.
@@ -127,15 +154,7 @@ class FastBertTokenizer(TokenizerWithOffsets, Detokenizer):
       on tokens.)
 
     """
-    normalized_input, offsets = self._fast_bert_normalizer.normalize_with_offsets(
-        text_input)
-    wordpieces, post_norm_offsets_starts, post_norm_offsets_ends = (
-        self._fast_wordpiece_tokenizer.tokenize_with_offsets(normalized_input))
-    pre_norm_offsets_starts = array_ops.gather(
-        offsets, post_norm_offsets_starts, axis=-1, batch_dims=-1)
-    pre_norm_offsets_ends = array_ops.gather(
-        offsets, post_norm_offsets_ends, axis=-1, batch_dims=-1)
-    return wordpieces, pre_norm_offsets_starts, pre_norm_offsets_ends
+    return self._tokenize_with_offsets(text_input, get_offsets=True)
 
   def tokenize(self, text_input):
     r"""Tokenizes a tensor of string tokens into subword tokens for BERT.
@@ -156,8 +175,85 @@ class FastBertTokenizer(TokenizerWithOffsets, Detokenizer):
       contents (or ID in the vocab_lookup_table representing that string)
       of the `jth` token in `input[i1...iN]`
     """
-    normalized_input = self._fast_bert_normalizer.normalize(text_input)
-    return self._fast_wordpiece_tokenizer.tokenize(normalized_input)
+    wordpieces, _, _ = self._tokenize_with_offsets(
+        text_input, get_offsets=False)
+    return wordpieces
+
+  def _tokenize_with_offsets(self, text_input, get_offsets):
+    """Implements `tokenize_with_offsets`.
+
+    Normalizes and tokenizes the text in a single op, which maps the offsets
+    back to `text_input` on the fly. Only the outputs actually needed are
+    computed by the kernel, as in `FastWordpieceTokenizer`.
+
+    Args:
+      text_input: An N-dimensional `Tensor` or `RaggedTensor` of UTF-8 strings.
+      get_offsets: Whether to compute the offsets.
+
+    Returns:
+      A tuple `(tokens, start_offsets, end_offsets)` as in
+      `tokenize_with_offsets`. The offsets are None if `get_offsets` is false.
+    """
+    with ops.name_scope(None, 'FastBertTokenizeWithOffsets',
+                        [text_input, self._normalizer_model, self._wp_model]):
+      # Check that the types are expected and the ragged rank is appropriate.
+      tokens = ragged_tensor.convert_to_tensor_or_ragged_tensor(text_input)
+      rank = tokens.shape.ndims
+      if rank is None:
+        raise ValueError('input must have a known rank.')
+
+      if rank == 0:
+        wordpieces, starts, ends = self._tokenize_with_offsets(
+            array_ops_stack.stack([tokens]), get_offsets)
+        if not get_offsets:
+          return wordpieces.values, None, None
+        return wordpieces.values, starts.values, ends.values
+
+      elif rank > 1:
+        if not ragged_tensor.is_ragged(tokens):
+          tokens = ragged_tensor.RaggedTensor.from_tensor(
+              tokens, ragged_rank=rank - 1)
+        wordpieces, starts, ends = self._tokenize_with_offsets(
+            tokens.flat_values, get_offsets)
+        wordpieces = wordpieces.with_row_splits_dtype(tokens.row_splits.dtype)
+        if not get_offsets:
+          return tokens.with_flat_values(wordpieces), None, None
+        starts = starts.with_row_splits_dtype(tokens.row_splits.dtype)
+        ends = ends.with_row_splits_dtype(tokens.row_splits.dtype)
+        return (tokens.with_flat_values(wordpieces),
+                tokens.with_flat_values(starts), tokens.with_flat_values(ends))
+
+      # Tokenize the texts into subwords. The subword strings are only
+      # computed when they are returned.
+      get_subwords = self._token_out_type not in (dtypes.int64, dtypes.int32)
+      # The kernel writes int32 ids directly when they are all that is needed.
+      # The offsets stay int64, as returned by `tokenize_with_offsets`.
+      if self._token_out_type == dtypes.int32 and not get_offsets:
+        out_type = dtypes.int32
+      else:
+        out_type = dtypes.int64
+      subwords, subword_ids, row_splits, starts, ends = (
+          gen_fast_bert_tokenizer.fast_bert_tokenize_with_offsets(
+              input_values=tokens,
+              fast_bert_normalizer_model=self._normalizer_model,
+              wp_model=self._wp_model,
+              get_subwords=get_subwords,
+              get_offsets=get_offsets,
+              out_type=out_type))
+
+      if self._token_out_type in (dtypes.int64, dtypes.int32):
+        values = math_ops.cast(subword_ids, self._token_out_type)
+      else:
+        values = subwords
+
+      wordpieces = RaggedTensor.from_row_splits(
+          values, row_splits, validate=False)
+      if not get_offsets:
+        return wordpieces, None, None
+      starts = RaggedTensor.from_row_splits(starts, row_splits, validate=False)
+      ends = RaggedTensor.from_row_splits(ends, row_splits, validate=False)
+
+      return wordpieces, starts, ends
 
   def detokenize(self, token_ids):
     r"""Convert a `Tensor` or `RaggedTensor` of wordpiece IDs to string-words.
@@ -404,6 +404,51 @@ class FastBertTokenizerTest(test_util.TensorFlowTestCase,
     self.assertAllEqual(starts, expected_starts)
     self.assertAllEqual(ends, expected_ends)
 
+  @parameterized.parameters([
+      dict(lower_case_nfd_strip_accents=True),
+      dict(lower_case_nfd_strip_accents=False),
+  ])
+  @test_util.run_in_graph_and_eager_modes
+  def test_same_as_normalizing_then_tokenizing(self,
+                                               lower_case_nfd_strip_accents):
+    text_inputs = constant_op.constant([
+        _utf8(u'taste the rustisc indiefrost'),
+        _utf8(u'Han Kuo-yu (韓國食)🤔'),
+        _utf8(u'Añade la información del formulario y tus preguntas'),
+        _utf8(u'\u1e9b\u0323 LOWer\x11Test½'),
+        b'',
+    ])
+    tokenizer = fast_bert_tokenizer.FastBertTokenizer(
+        vocab=_VOCAB,
+        token_out_type=dtypes.string,
+        lower_case_nfd_strip_accents=lower_case_nfd_strip_accents)
+    tokens, starts, ends = tokenizer.tokenize_with_offsets(text_inputs)
+
+    normalizer = tf_text.FastBertNormalizer(
+        lower_case_nfd_strip_accents=lower_case_nfd_strip_accents)
+    wordpiece_tokenizer = tf_text.FastWordpieceTokenizer(
+        vocab=_VOCAB, token_out_type=dtypes.string)
+    normalized_inputs, offsets = normalizer.normalize_with_offsets(text_inputs)
+    expected_tokens, expected_starts, expected_ends = (
+        wordpiece_tokenizer.tokenize_with_offsets(normalized_inputs))
+    expected_starts = tf.gather(
+        offsets, expected_starts, axis=-1, batch_dims=-1)
+    expected_ends = tf.gather(offsets, expected_ends, axis=-1, batch_dims=-1)
+    self.assertAllEqual(tokens, expected_tokens)
+    self.assertAllEqual(starts, expected_starts)
+    self.assertAllEqual(ends, expected_ends)
+
+    # The int32 ids are written directly by the kernel.
+    id_tokenizer = fast_bert_tokenizer.FastBertTokenizer(
+        vocab=_VOCAB,
+        token_out_type=dtypes.int32,
+        lower_case_nfd_strip_accents=lower_case_nfd_strip_accents)
+    ids = id_tokenizer.tokenize(text_inputs)
+    expected_ids = tf_text.FastWordpieceTokenizer(
+        vocab=_VOCAB, token_out_type=dtypes.int32).tokenize(normalized_inputs)
+    self.assertEqual(ids.dtype, dtypes.int32)
+    self.assertAllEqual(ids, expected_ids)
+
 
 @parameterized.parameters([
     # Test 0.
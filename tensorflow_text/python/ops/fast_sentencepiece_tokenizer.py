@@ -46,10 +46,44 @@ gen_fast_sentencepiece_tokenizer = load_library.load_op_library(resource_loader.
 class FastSentencepieceTokenizer:
   """Sentencepiece tokenizer with tf.text interface."""
 
-  def __init__(self, model, reverse=False, add_bos=False, add_eos=False):
-    converted_model = pywrap_model_converter.convert_sentencepiece_model(model)
-    converted_model_detokenizer = pywrap_model_converter.convert_sentencepiece_model_for_decoder(
-        model)
+  def __init__(self,
+               model,
+               reverse=False,
+               add_bos=False,
+               add_eos=False,
+               nbest_size=0,
+               alpha=1.0,
+               conversion_cache_dir=None):
+    """Initializes the tokenizer.
+
+    Args:
+      model: The sentencepiece model serialized proto.
+      reverse: Reverses the order of the tokens if True.
+      add_bos: Adds the start of sentence token if True.
+      add_eos: Adds the end of sentence token if True.
+      nbest_size: Sampling parameter for unigram models. `nbest_size = {0,1}`:
+        No sampling is performed. `nbest_size > 1`: samples from the
+        `nbest_size` best segmentations. `nbest_size < 0`: samples from all
+        the segmentations, with forward-filtering and backward-sampling.
+      alpha: The inverse temperature of the sampling of the segmentations,
+        used when `nbest_size` is not 0 or 1.
+      conversion_cache_dir: An optional directory where the converted models
+        are cached, keyed by the SHA-256 of `model`. The processes that share
+        it convert each model once, then read it from the cache instead of
+        converting it again. This only saves the conversion: each tokenizer
+        still copies the converted model into its own constants.
+    """
+    if conversion_cache_dir is None:
+      converted_model = pywrap_model_converter.convert_sentencepiece_model(
+          model)
+      converted_model_detokenizer = (
+          pywrap_model_converter.convert_sentencepiece_model_for_decoder(model))
+    else:
+      converted_model = pywrap_model_converter.load_cached_sentencepiece_model(
+          model, conversion_cache_dir, False)
+      converted_model_detokenizer = (
+          pywrap_model_converter.load_cached_sentencepiece_model(
+              model, conversion_cache_dir, True))
     # Use uint8 tensor as a buffer for the model to avoid any possible changes,
     # for example truncation by '\0'.
     self._converted_model = tf.constant(list(converted_model), dtype=tf.uint8)
@@ -60,6 +94,8 @@ class FastSentencepieceTokenizer:
     self._reverse = reverse
     self._add_bos = add_bos
     self._add_eos = add_eos
+    self._nbest_size = nbest_size
+    self._alpha = alpha
 
   def tokenize(self, inputs):
     """The main tokenization function."""
@@ -87,7 +123,8 @@ class FastSentencepieceTokenizer:
         (output_values, row_splits) = (
             gen_fast_sentencepiece_tokenizer
             .tf_text_fast_sentencepiece_tokenize(
-                self._converted_model, input_tensor, 0, 0, self._add_bos,
+                self._converted_model, input_tensor, self._nbest_size,
+                self._alpha, self._add_bos,
                 self._add_eos, self._reverse))
         tokens = tf.RaggedTensor.from_nested_row_splits(
             flat_values=output_values,
@@ -104,6 +104,36 @@ class FastSentencepieceTokenizerTest(tf.test.TestCase):
     opt_tokenized = opt_sp.tokenize(input_text)
     self.assertAllEqual(tftext_tokenized, opt_tokenized)
 
+  def test_sampled_tokenization(self):
+    """Check that sampled tokenizations are valid segmentations."""
+    opt_sp = sentencepiece_tokenizer.FastSentencepieceTokenizer(
+        self.sentencepiece_model)
+    input_text = [u"to be or not to be", u"ignored by length text1"]
+    detokenized = opt_sp.detokenize(opt_sp.tokenize(input_text))
+    for nbest_size in [-1, 2, 10]:
+      sampling_sp = sentencepiece_tokenizer.FastSentencepieceTokenizer(
+          self.sentencepiece_model, nbest_size=nbest_size, alpha=0.1)
+      sampled_tokenized = sampling_sp.tokenize(input_text)
+      self.assertAllInRange(sampled_tokenized.flat_values, 0,
+                            sampling_sp.vocab_size() - 1)
+      self.assertAllEqual(
+          sampling_sp.detokenize(sampled_tokenized), detokenized)
+
+  def test_conversion_cache_dir(self):
+    """Check that the cached models give the same results."""
+    opt_sp = sentencepiece_tokenizer.FastSentencepieceTokenizer(
+        self.sentencepiece_model)
+    input_text = [u"to be or not to be", u"ignored by length text1"]
+    tokenized = opt_sp.tokenize(input_text)
+    cache_dir = self.get_temp_dir()
+    # The first tokenizer fills the cache, the second one reads it.
+    for _ in range(2):
+      cached_sp = sentencepiece_tokenizer.FastSentencepieceTokenizer(
+          self.sentencepiece_model, conversion_cache_dir=cache_dir)
+      self.assertAllEqual(cached_sp.tokenize(input_text), tokenized)
+      self.assertAllEqual(
+          cached_sp.detokenize(tokenized), opt_sp.detokenize(tokenized))
+
   def test_tflite_opt_sentence_tokenizer(self):
     """Check that can convert a Keras model to TFLite and it produces the same result for tokenization."""
 
@@ -24,6 +24,7 @@ from tensorflow.python.framework import constant_op
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import tensor
+from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import array_ops_stack
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops.ragged import ragged_tensor
@@ -87,7 +88,9 @@ class FastWordpieceTokenizer(TokenizerWithOffsets, Detokenizer):
                unknown_token='[UNK]',
                no_pretokenization=False,
                support_detokenization=False,
-               model_buffer=None):
+               model_buffer=None,
+               word_cache_size=0,
+               max_tokens_per_row=None):
     """Initializes the FastWordpieceTokenizer.
 
     Two ways to initialize:
@@ -114,7 +117,18 @@ class FastWordpieceTokenizer(TokenizerWithOffsets, Detokenizer):
       model_buffer: (optional) Bytes object (or a uint8 tf.Tenosr) that contains
         the wordpiece model in flatbuffer format (see
         fast_wordpiece_tokenizer_model.fbs). If not `None`, all other arguments
-        (except `token_output_type`) are ignored.
+        (except `token_output_type`, `word_cache_size` and
+        `max_tokens_per_row`) are ignored.
+      word_cache_size: (optional) If positive, each tokenization op caches the
+        tokenization of up to this many words and reuses it for repeated words.
+        The output is the same with or without the cache. The hits and misses
+        are exported to the `/tensorflow/text/fast_wordpiece_word_cache/lookups`
+        monitoring counter.
+      max_tokens_per_row: (optional) If not `None`, at most this many subword
+        tokens are returned for each input string. The tokenization of a string
+        stops as soon as the budget is reached (at a word boundary), so its
+        cost depends on the budget rather than on the length of the string.
+        See `tokenize_with_truncation` to tell which strings are truncated.
     """
     super(FastWordpieceTokenizer, self).__init__()
     _tf_text_fast_wordpiece_tokenizer_op_create_counter.get_cell().increase_by(
@@ -135,6 +149,9 @@ class FastWordpieceTokenizer(TokenizerWithOffsets, Detokenizer):
       self._model = constant_op.constant(list(model_buffer), dtype=dtypes.uint8)
 
     self._token_out_type = token_out_type
+    self._word_cache_size = word_cache_size
+    self._max_tokens_per_row = (-1 if max_tokens_per_row is None else
+                                max_tokens_per_row)
 
   def tokenize(self, input):  # pylint: disable=redefined-builtin
     """Tokenizes a tensor of UTF-8 string tokens further into subword tokens.
@@ -169,10 +186,40 @@ class FastWordpieceTokenizer(TokenizerWithOffsets, Detokenizer):
       is controlled by the `token_out_type` parameter passed to the initializer
       method.
     """
-    # TODO(xysong): Optimize below by calling different overload kernels.
-    subword, _, _ = self.tokenize_with_offsets(input)
+    subword, _, _, _ = self._tokenize_with_offsets(input, get_offsets=False)
     return subword
 
+  def tokenize_with_truncation(self, input):  # pylint: disable=redefined-builtin
+    """Tokenizes a tensor of UTF-8 strings, and tells which ones are truncated.
+
+    ### Example:
+    >>> vocab = ["they", "##'", "##re", "the", "great", "##est", "[UNK]",
+    ...          "'", "re"]
+    >>> tokenizer = FastWordpieceTokenizer(vocab, token_out_type=tf.string,
+    ...                                    max_tokens_per_row=4)
+    >>> tokens, truncated = tokenizer.tokenize_with_truncation(
+    ...     ["they're the greatest", "the greatest"])
+    >>> tokens
+    <tf.RaggedTensor [[b'they', b"'", b're', b'the'],
+                      [b'the', b'great', b'##est']]>
+    >>> truncated
+    <tf.Tensor: shape=(2,), dtype=bool, numpy=array([ True, False])>
+
+    Args:
+      input: An N-dimensional `Tensor` or `RaggedTensor` of UTF-8 strings.
+
+    Returns:
+      A tuple `(tokens, truncated)` where:
+
+      tokens: is a `RaggedTensor` as returned by `tokenize`.
+      truncated: is a bool `Tensor` or `RaggedTensor` with the shape of
+          `input`, which is true for the strings that have more than
+          `max_tokens_per_row` tokens (i.e., whose tokens are truncated).
+    """
+    subword, _, _, truncated = self._tokenize_with_offsets(
+        input, get_offsets=False)
+    return subword, truncated
+
   def tokenize_with_offsets(self, input):  # pylint: disable=redefined-builtin
     """Tokenizes a tensor of UTF-8 string tokens further into subword tokens.
 
@@ -223,6 +270,26 @@ class FastWordpieceTokenizer(TokenizerWithOffsets, Detokenizer):
           the exclusive end of the `jth` token in `input[i`...iN]` (exclusive,
           i.e., first byte after the end of the token).
     """
+    subword, starts, ends, _ = self._tokenize_with_offsets(
+        input, get_offsets=True)
+    return subword, starts, ends
+
+  def _tokenize_with_offsets(self, input, get_offsets):  # pylint: disable=redefined-builtin
+    """Implements `tokenize_with_offsets`.
+
+    Only the outputs actually needed are computed by the kernel: the subword
+    strings are skipped when `token_out_type` is an integer type, and the
+    offsets are skipped unless `get_offsets` is true.
+
+    Args:
+      input: An N-dimensional `Tensor` or `RaggedTensor` of UTF-8 strings.
+      get_offsets: Whether to compute the offsets.
+
+    Returns:
+      A tuple `(tokens, start_offsets, end_offsets, truncated)`, as in
+      `tokenize_with_offsets` and `tokenize_with_truncation`. The offsets are
+      None if `get_offsets` is false.
+    """
     name = None
     with ops.name_scope(name, 'FastWordpieceTokenizeWithOffsets',
                         [input, self._model]):
@@ -233,41 +300,65 @@ class FastWordpieceTokenizer(TokenizerWithOffsets, Detokenizer):
         raise ValueError('input must have a known rank.')
 
       if rank == 0:
-        wordpieces, starts, ends = self.tokenize_with_offsets(
-            array_ops_stack.stack([tokens]))
-        return wordpieces.values, starts.values, ends.values
+        wordpieces, starts, ends, truncated = self._tokenize_with_offsets(
+            array_ops_stack.stack([tokens]), get_offsets)
+        if not get_offsets:
+          return wordpieces.values, None, None, truncated[0]
+        return wordpieces.values, starts.values, ends.values, truncated[0]
 
       elif rank > 1:
+        dense_shape = None
         if not ragged_tensor.is_ragged(tokens):
+          dense_shape = array_ops.shape(tokens)
           tokens = ragged_tensor.RaggedTensor.from_tensor(
               tokens, ragged_rank=rank - 1)
-        wordpieces, starts, ends = self.tokenize_with_offsets(
-            tokens.flat_values)
+        wordpieces, starts, ends, truncated = self._tokenize_with_offsets(
+            tokens.flat_values, get_offsets)
+        if dense_shape is None:
+          truncated = tokens.with_flat_values(truncated)
+        else:
+          truncated = array_ops.reshape(truncated, dense_shape)
         wordpieces = wordpieces.with_row_splits_dtype(tokens.row_splits.dtype)
+        if not get_offsets:
+          return tokens.with_flat_values(wordpieces), None, None, truncated
         starts = starts.with_row_splits_dtype(tokens.row_splits.dtype)
         ends = ends.with_row_splits_dtype(tokens.row_splits.dtype)
         return (tokens.with_flat_values(wordpieces),
-                tokens.with_flat_values(starts), tokens.with_flat_values(ends))
-
-      # Tokenize the tokens into subwords.
-      # TODO(xysong): Optimize below by calling different overload kernels.
-      subwords, subword_ids, row_splits, starts, ends = (
+                tokens.with_flat_values(starts), tokens.with_flat_values(ends),
+                truncated)
+
+      # Tokenize the tokens into subwords. The subword strings are only
+      # computed when they are returned.
+      get_subwords = self._token_out_type not in (dtypes.int64, dtypes.int32)
+      # The kernel writes int32 ids directly when they are all that is needed.
+      # The offsets stay int64, as returned by `tokenize_with_offsets`.
+      if self._token_out_type == dtypes.int32 and not get_offsets:
+        out_type = dtypes.int32
+      else:
+        out_type = dtypes.int64
+      subwords, subword_ids, row_splits, starts, ends, truncated = (
           gen_fast_wordpiece_tokenizer.fast_wordpiece_tokenize_with_offsets(
-              input_values=tokens, wp_model=self._model))
-
-      if self._token_out_type == dtypes.int64:
-        values = math_ops.cast(subword_ids, dtypes.int64)
-      elif self._token_out_type == dtypes.int32:
-        values = math_ops.cast(subword_ids, dtypes.int32)
+              input_values=tokens,
+              wp_model=self._model,
+              get_subwords=get_subwords,
+              get_offsets=get_offsets,
+              word_cache_size=self._word_cache_size,
+              max_tokens_per_row=self._max_tokens_per_row,
+              out_type=out_type))
+
+      if self._token_out_type in (dtypes.int64, dtypes.int32):
+        values = math_ops.cast(subword_ids, self._token_out_type)
       else:
         values = subwords
 
       wordpieces = RaggedTensor.from_row_splits(
           values, row_splits, validate=False)
+      if not get_offsets:
+        return wordpieces, None, None, truncated
       starts = RaggedTensor.from_row_splits(starts, row_splits, validate=False)
       ends = RaggedTensor.from_row_splits(ends, row_splits, validate=False)
 
-      return wordpieces, starts, ends
+      return wordpieces, starts, ends, truncated
 
   def detokenize(self, input):  # pylint: disable=redefined-builtin
     """Detokenizes a tensor of int64 or int32 subword ids into sentences.
@@ -539,6 +539,19 @@ class FastWordpieceOpAdditionalTest(test_base.DatasetTestBase,
 
     self.assertAllEqual(tokenizer.tokenize(text_inputs), expected_outputs)
 
+  def testTokenizerWithWordCache(self, text_inputs, expected_outputs):
+    tokenizer = FastWordpieceTokenizer(
+        vocab=_TEST_VOCAB,
+        max_bytes_per_word=_TEST_MAX_BYTES_PER_WORD,
+        suffix_indicator=_TEST_SUFFIX_INDICATOR,
+        unknown_token=_TEST_UNKNOWN_TOKEN,
+        no_pretokenization=True,
+        word_cache_size=16)
+
+    # The second call is served from the cache.
+    self.assertAllEqual(tokenizer.tokenize(text_inputs), expected_outputs)
+    self.assertAllEqual(tokenizer.tokenize(text_inputs), expected_outputs)
+
   def testTokenizerBuiltFromModel(self, text_inputs, expected_outputs):
     model_buffer = _LoadTestModelBuffer()
     tokenizer = FastWordpieceTokenizer(model_buffer=model_buffer)
@@ -656,6 +669,50 @@ class EndToEndFastWordpieceOpTest(test_base.DatasetTestBase,
         unknown_token=_TEST_UNKNOWN_TOKEN)
     self.assertAllEqual(tokenizer.tokenize(text_inputs), expected_outputs)
 
+  def testTokenizerWithWordCache(self, text_inputs, expected_outputs):
+    tokenizer = FastWordpieceTokenizer(
+        vocab=_TEST_VOCAB,
+        max_bytes_per_word=_TEST_MAX_BYTES_PER_WORD,
+        suffix_indicator=_TEST_SUFFIX_INDICATOR,
+        unknown_token=_TEST_UNKNOWN_TOKEN,
+        word_cache_size=16)
+    self.assertAllEqual(tokenizer.tokenize(text_inputs), expected_outputs)
+    self.assertAllEqual(tokenizer.tokenize(text_inputs), expected_outputs)
+
+  def testTokenizerWithMaxTokensPerRow(self, text_inputs, expected_outputs):
+    max_tokens_per_row = 3
+
+    def truncate(outputs):
+      """Returns the expected (tokens, truncated) of `outputs`."""
+      if not outputs or not isinstance(outputs[0], list):
+        return outputs[:max_tokens_per_row], len(outputs) > max_tokens_per_row
+      truncated_outputs = [truncate(row) for row in outputs]
+      return ([tokens for tokens, _ in truncated_outputs],
+              [truncated for _, truncated in truncated_outputs])
+
+    expected_tokens, expected_truncated = truncate(expected_outputs)
+    tokenizer = FastWordpieceTokenizer(
+        vocab=_TEST_VOCAB,
+        max_bytes_per_word=_TEST_MAX_BYTES_PER_WORD,
+        suffix_indicator=_TEST_SUFFIX_INDICATOR,
+        unknown_token=_TEST_UNKNOWN_TOKEN,
+        max_tokens_per_row=max_tokens_per_row)
+    tokens, truncated = tokenizer.tokenize_with_truncation(text_inputs)
+    self.assertAllEqual(tokens, expected_tokens)
+    self.assertAllEqual(truncated, expected_truncated)
+    self.assertAllEqual(tokenizer.tokenize(text_inputs), expected_tokens)
+
+  def testTokenizerWithInt32Output(self, text_inputs, expected_outputs):
+    tokenizer = FastWordpieceTokenizer(
+        vocab=_TEST_VOCAB,
+        max_bytes_per_word=_TEST_MAX_BYTES_PER_WORD,
+        suffix_indicator=_TEST_SUFFIX_INDICATOR,
+        unknown_token=_TEST_UNKNOWN_TOKEN,
+        token_out_type=dtypes.int32)
+    tokens = tokenizer.tokenize(text_inputs)
+    self.assertEqual(tokens.dtype, dtypes.int32)
+    self.assertAllEqual(tokens, expected_outputs)
+
 
 @parameterized.parameters([
     # Test 0: Basic.
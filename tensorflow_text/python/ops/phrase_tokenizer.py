@@ -132,15 +132,19 @@ class PhraseTokenizer(Tokenizer, Detokenizer):
         phrases = phrases.with_row_splits_dtype(tokens.row_splits.dtype)
         return tokens.with_flat_values(phrases)
 
-      # Tokenize the tokens into phrases.
+      # Tokenize the tokens into phrases. The kernel writes int32 ids directly
+      # when they are requested.
+      if self._token_out_type == dtypes.int32:
+        out_type = dtypes.int32
+      else:
+        out_type = dtypes.int64
       subwords, phrase_ids, row_splits = (
           gen_phrase_tokenizer.phrase_tokenize(
-              input_values=tokens, phrase_model=self._model))
+              input_values=tokens, phrase_model=self._model,
+              out_type=out_type))
 
-      if self._token_out_type == dtypes.int64:
-        values = math_ops.cast(phrase_ids, dtypes.int64)
-      elif self._token_out_type == dtypes.int32:
-        values = math_ops.cast(phrase_ids, dtypes.int32)
+      if self._token_out_type in (dtypes.int64, dtypes.int32):
+        values = math_ops.cast(phrase_ids, self._token_out_type)
       else:
         values = subwords
 